@@ -25,14 +25,185 @@
 #include "iAMathUtility.h"
 #include "iAVtkDataTypeMapper.h"
 #include "iAToolsVTK.h"
+#include "iATypedCallHelper.h"
 
-#include <vtkImageAccumulate.h>
-#include <vtkImageCast.h>
 #include <vtkImageData.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+namespace
+{
+	//! Result of a histogram computation over the first component of an image
+	struct iAHistogramResult
+	{
+		std::vector<iAPlotData::DataType> bins;
+		double min, max, mean, stdDev, spacing;
+		size_t count;
+	};
+
+	const double RangeEnlargeFactor = 1 + 1e-10;  // to put max values in max bin (as otherwise they would be cut off with < max)
+
+	double binSpacing(double min, double max, size_t binCount)
+	{
+		return ((max - min) * RangeEnlargeFactor) / binCount;
+	}
+
+	size_t binIndex(double value, double min, double spacing, size_t binCount)
+	{
+		return (spacing > 0) ? std::min(binCount - 1, static_cast<size_t>((value - min) / spacing)) : 0;
+	}
+
+	void computeMeanStdDev(double sum, double sumSq, iAHistogramResult & r)
+	{
+		r.mean = (r.count > 0) ? sum / r.count : 0;
+		r.stdDev = (r.count > 1) ? std::sqrt(std::max(0.0, (sumSq - sum * sum / r.count) / (r.count - 1))) : 0;
+	}
+
+	//! Histogram for types with at most 16 bit: in a single pass, each thread counts the occurrences
+	//! of every possible value; min, max, statistics and the final bins are derived from the merged counts.
+	template <typename T>
+	void histogramKernel(T const * data, long long valueCount, long long stride, size_t binCount, iAHistogramResult & r, std::true_type /*small type*/)
+	{
+		const size_t PossibleValues = static_cast<size_t>(1) << (8 * sizeof(T));
+		const long long Lowest = std::numeric_limits<T>::lowest();
+		std::vector<long long> counts(PossibleValues, 0);
+#pragma omp parallel
+		{
+			std::vector<long long> threadCounts(PossibleValues, 0);
+#pragma omp for
+			for (long long i = 0; i < valueCount; ++i)
+			{
+				++threadCounts[static_cast<size_t>(static_cast<long long>(data[i * stride]) - Lowest)];
+			}
+#pragma omp critical
+			for (size_t v = 0; v < PossibleValues; ++v)
+			{
+				counts[v] += threadCounts[v];
+			}
+		}
+		size_t first = 0, last = PossibleValues - 1;
+		while (first < PossibleValues && counts[first] == 0)
+		{
+			++first;
+		}
+		while (last > first && counts[last] == 0)
+		{
+			--last;
+		}
+		r.bins.assign(binCount, 0);
+		r.count = static_cast<size_t>(valueCount);
+		if (first == PossibleValues)
+		{
+			r.min = r.max = r.mean = r.stdDev = r.spacing = 0;
+			return;
+		}
+		r.min = static_cast<double>(Lowest + static_cast<long long>(first));
+		r.max = static_cast<double>(Lowest + static_cast<long long>(last));
+		r.spacing = binSpacing(r.min, r.max, binCount);
+		double sum = 0, sumSq = 0;
+		for (size_t v = first; v <= last; ++v)
+		{
+			double value = static_cast<double>(Lowest + static_cast<long long>(v));
+			sum += value * counts[v];
+			sumSq += value * value * counts[v];
+			r.bins[binIndex(value, r.min, r.spacing, binCount)] += counts[v];
+		}
+		computeMeanStdDev(sum, sumSq, r);
+	}
+
+	//! Histogram for larger types: first pass determines range and statistics, second pass fills the bins;
+	//! both passes use per-thread partial results which are merged at the end.
+	template <typename T>
+	void histogramKernel(T const * data, long long valueCount, long long stride, size_t binCount, iAHistogramResult & r, std::false_type /*small type*/)
+	{
+		double min = std::numeric_limits<double>::max(), max = std::numeric_limits<double>::lowest(), sum = 0, sumSq = 0;
+		size_t count = 0;
+#pragma omp parallel
+		{
+			double threadMin = std::numeric_limits<double>::max(), threadMax = std::numeric_limits<double>::lowest(),
+				threadSum = 0, threadSumSq = 0;
+			size_t threadCount = 0;
+#pragma omp for
+			for (long long i = 0; i < valueCount; ++i)
+			{
+				double value = static_cast<double>(data[i * stride]);
+				if (std::isnan(value))
+				{
+					continue;
+				}
+				threadMin = std::min(threadMin, value);
+				threadMax = std::max(threadMax, value);
+				threadSum += value;
+				threadSumSq += value * value;
+				++threadCount;
+			}
+#pragma omp critical
+			{
+				min = std::min(min, threadMin);
+				max = std::max(max, threadMax);
+				sum += threadSum;
+				sumSq += threadSumSq;
+				count += threadCount;
+			}
+		}
+		r.bins.assign(binCount, 0);
+		r.count = count;
+		if (count == 0)
+		{
+			r.min = r.max = r.mean = r.stdDev = r.spacing = 0;
+			return;
+		}
+		r.min = min;
+		r.max = max;
+		r.spacing = binSpacing(min, max, binCount);
+		computeMeanStdDev(sum, sumSq, r);
+#pragma omp parallel
+		{
+			std::vector<long long> threadBins(binCount, 0);
+#pragma omp for
+			for (long long i = 0; i < valueCount; ++i)
+			{
+				double value = static_cast<double>(data[i * stride]);
+				if (!std::isnan(value))
+				{
+					++threadBins[binIndex(value, min, r.spacing, binCount)];
+				}
+			}
+#pragma omp critical
+			for (size_t b = 0; b < binCount; ++b)
+			{
+				r.bins[b] += threadBins[b];
+			}
+		}
+	}
+
+	template <typename T>
+	void computeHistogram(vtkImageData* img, size_t binCount, size_t sampleStep, iAHistogramResult & r)
+	{
+		int dim[3];
+		img->GetDimensions(dim);
+		long long voxelCount = static_cast<long long>(dim[0]) * dim[1] * dim[2];
+		long long sampleCount = (voxelCount + sampleStep - 1) / sampleStep;
+		histogramKernel(static_cast<T const *>(img->GetScalarPointer()), sampleCount,
+			static_cast<long long>(sampleStep) * img->GetNumberOfScalarComponents(), binCount, r,
+			std::integral_constant<bool, std::is_integral<T>::value && sizeof(T) <= 2>());
+		if (sampleStep > 1)
+		{   // scale frequencies to approximate those of the full image:
+			for (auto & b : r.bins)
+			{
+				b *= sampleStep;
+			}
+			r.count = std::min(static_cast<size_t>(voxelCount), r.count * sampleStep);
+		}
+	}
+}
+
 
 iAHistogramData::iAHistogramData()
-	: m_binCount(0), m_rawData(nullptr), m_accSpacing(0), m_type(Continuous)
+	: m_binCount(0), m_rawData(nullptr), m_accSpacing(0), m_type(Continuous), m_sampleStep(1)
 {
 	m_xBounds[0] = m_xBounds[1] = 0;
 	m_yBounds[0] = m_yBounds[1] = 0;
@@ -58,57 +229,59 @@ iAHistogramData::DataType const * iAHistogramData::rawData() const
 	return m_rawData;
 }
 
+size_t iAHistogramData::previewSampleStep(vtkImageData* img, size_t maxSamples)
+{
+	int dim[3];
+	img->GetDimensions(dim);
+	size_t voxelCount = static_cast<size_t>(dim[0]) * dim[1] * dim[2];
+	if (voxelCount <= maxSamples)
+	{
+		return 1;
+	}
+	// odd step, to avoid always hitting the same columns in images with even dimensions:
+	return ((voxelCount + maxSamples - 1) / maxSamples) | 1;
+}
+
+bool iAHistogramData::isApproximate() const
+{
+	return m_sampleStep > 1;
+}
+
 QSharedPointer<iAHistogramData> iAHistogramData::create(vtkImageData* img, size_t binCount,
-	iAImageInfo* info)
+	iAImageInfo* info, size_t sampleStep)
 {
 	auto result = QSharedPointer<iAHistogramData>(new iAHistogramData);
-	auto accumulate = vtkSmartPointer<vtkImageAccumulate>::New();
-	accumulate->ReleaseDataFlagOn();
-	accumulate->SetInputData(img);
-	accumulate->SetComponentOrigin(img->GetScalarRange()[0], 0.0, 0.0);
-	double * const scalarRange = img->GetScalarRange();
 	if (binCount > std::numeric_limits<int>::max())
 	{
 		DEBUG_LOG(QString("iAHistogramData::create: Only up to %1 bins supported, but requested %2! Bin number will be set to %1!")
 			.arg(std::numeric_limits<int>::max()).arg(binCount));
 		binCount = std::numeric_limits<int>::max();
-	}   // check above guarantees that binCount is smaller than int max, so cast below is safe!
-	accumulate->SetComponentExtent(0, static_cast<int>(binCount - 1), 0, 0, 0, 0);
-	const double RangeEnlargeFactor = 1 + 1e-10;  // to put max values in max bin (as vtkImageAccumulate otherwise would cut off with < max)
-	accumulate->SetComponentSpacing(((scalarRange[1] - scalarRange[0]) * RangeEnlargeFactor) / binCount, 0.0, 0.0);
-	accumulate->Update();
-
-	int extent[6];
-	accumulate->GetComponentExtent(extent);
-	vtkSmartPointer<vtkImageCast> caster = vtkSmartPointer<vtkImageCast>::New();
-	caster->SetInputData(accumulate->GetOutput());
-	caster->SetOutputScalarType(iAVtkDataType<DataType>::value);
-	caster->Update();
-	auto rawImg = caster->GetOutput();
-
-	result->m_binCount = extent[1] + 1;
-	result->m_xBounds[0] = accumulate->GetMin()[0];
-	result->m_xBounds[1] = accumulate->GetMax()[0];
+	}
+	binCount = std::max(binCount, static_cast<size_t>(1));
+	sampleStep = std::max(sampleStep, static_cast<size_t>(1));
+	iAHistogramResult hist;
+	VTK_TYPED_CALL(computeHistogram, img->GetScalarType(), img, binCount, sampleStep, hist);
+	result->m_sampleStep = sampleStep;
+
+	result->m_binCount = binCount;
+	result->m_xBounds[0] = hist.min;
+	result->m_xBounds[1] = hist.max;
 	result->m_rawData = new double[result->m_binCount];
-	auto vtkRawData = static_cast<DataType*>(rawImg->GetScalarPointer());
-	std::copy(vtkRawData, vtkRawData + result->m_binCount, result->m_rawData);
-	double null1, null2;
-	if (isVtkIntegerType(static_cast<vtkImageData*>(accumulate->GetInput())->GetScalarType()))
+	std::copy(hist.bins.begin(), hist.bins.end(), result->m_rawData);
+	if (isVtkIntegerType(img->GetScalarType()))
 	{	// for int types, the last value is inclusive:
 		result->m_accSpacing = (result->m_xBounds[1] - result->m_xBounds[0] + 1) / result->m_binCount;
 	}
 	else
 	{
-		accumulate->GetComponentSpacing(result->m_accSpacing, null1, null2);
+		result->m_accSpacing = hist.spacing;
 	}
 	result->setMaxFreq();
-	result->m_type = (img && (img->GetScalarType() != VTK_FLOAT) && (img->GetScalarType() != VTK_DOUBLE))
+	result->m_type = (img->GetScalarType() != VTK_FLOAT && img->GetScalarType() != VTK_DOUBLE)
 		? Discrete
 		: Continuous;
 	if (info)
-		*info = iAImageInfo(accumulate->GetVoxelCount(),
-			*accumulate->GetMin(), *accumulate->GetMax(),
-			*accumulate->GetMean(), *accumulate->GetStandardDeviation());
+		*info = iAImageInfo(hist.count, hist.min, hist.max, hist.mean, hist.stdDev);
 
 	return result;
 }
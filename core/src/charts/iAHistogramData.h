@@ -43,12 +43,26 @@ public:
 	DataType const * yBounds() const override;
 	iAValueType valueType() const override;
 
-	static QSharedPointer<iAHistogramData> create(vtkImageData* img, size_t binCount, iAImageInfo* imageInfo = nullptr);
+	//! Create a histogram of the first component of the given image.
+	//! @param img the image to compute the histogram for
+	//! @param binCount the number of bins
+	//! @param [out] imageInfo if not null, receives statistics (range, mean, standard deviation) of the image
+	//! @param sampleStep only consider every sampleStep-th voxel, for a fast, approximate histogram (see
+	//!     previewSampleStep); the frequencies are scaled to approximate those of the full image
+	static QSharedPointer<iAHistogramData> create(vtkImageData* img, size_t binCount, iAImageInfo* imageInfo = nullptr,
+		size_t sampleStep = 1);
 	static QSharedPointer<iAHistogramData> create(DataType* data, size_t binCount, double space, DataType min, DataType max);
 	static QSharedPointer<iAHistogramData> create(const std::vector<DataType> &histData, size_t binCount,
 		iAValueType type = Continuous,
 		DataType minValue=std::numeric_limits<double>::infinity(),
 		DataType maxValue=std::numeric_limits<double>::infinity());
+	//! The sample step for a fast preview histogram of the given image, which considers at most maxSamples voxels
+	//! @return the sample step to pass into create, 1 if the image is small enough to be considered fully anyway
+	static size_t previewSampleStep(vtkImageData* img, size_t maxSamples = DefaultPreviewSamples);
+	//! Whether this histogram was computed from a subsample of the image (see create)
+	bool isApproximate() const;
+	//! Default maximum number of voxels considered for preview histograms
+	static const size_t DefaultPreviewSamples = 1 << 22;
 private:
 	iAHistogramData();
 	void setMaxFreq();
@@ -59,4 +73,5 @@ private:
 	double m_accSpacing;
 	double m_xBounds[2];
 	iAValueType m_type;
+	size_t m_sampleStep;
 };
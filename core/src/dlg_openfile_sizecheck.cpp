@@ -20,10 +20,14 @@
 * ************************************************************************************/
 #include "dlg_openfile_sizecheck.h"
 
+#include "charts/iAHistogramData.h"
 #include "dlg_commoninput.h"
+#include "iAImageInfo.h"
+#include "io/iARawFileMapping.h"
 #include "io/iARawFileParameters.h"
 #include "iAToolsVTK.h"    // for mapVTKTypeToReadableDataType, readableDataTypes, ...
 
+#include <vtkImageData.h>
 #include <vtkImageReader.h>  // for VTK_FILE_BYTE_ORDER_... constants
 
 #include <QComboBox>
@@ -31,6 +35,8 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QPushButton>
+#include <QRunnable>
+#include <QTimer>
 
 #include <cassert>
 
@@ -45,15 +51,71 @@ namespace
 		case VTK_FILE_BYTE_ORDER_BIG_ENDIAN: return 1;
 		}
 	}
+	//! maximum number of voxels read for the statistics preview (kept small, since the file
+	//! might be on a slow disk, and the user might still be changing the parameters)
+	const size_t StatisticsPreviewSamples = 1 << 15;
+	//! time (in ms) without further parameter changes after which the statistics preview is computed
+	const int StatisticsPreviewDelayMS = 300;
+
+	//! Computes the statistics preview for a raw file in a background thread,
+	//! and passes the resulting text to the showStatisticsPreview slot of the dialog
+	class iAStatisticsPreviewRunnable : public QRunnable
+	{
+	public:
+		iAStatisticsPreviewRunnable(QObject* dlg, QString const & fileName, iARawFileParameters const & params,
+			int request, std::atomic<int> const & latestRequest) :
+			m_dlg(dlg),
+			m_fileName(fileName),
+			m_params(params),
+			m_request(request),
+			m_latestRequest(latestRequest)
+		{}
+		void run() override
+		{
+			if (m_request != m_latestRequest)
+			{   // parameters have changed in the meantime
+				return;
+			}
+			QString text;
+			QString errorMsg;
+			auto img = mapRawImage(m_fileName, m_params, errorMsg);
+			if (!img)
+			{
+				text = QString("Statistics preview not available (%1).").arg(errorMsg);
+			}
+			else
+			{
+				iAImageInfo info;
+				iAHistogramData::create(img, 1, &info, iAHistogramData::previewSampleStep(img, StatisticsPreviewSamples));
+				text = QString("Statistics preview (sampled): min=%1, max=%2, mean=%3, std.dev.=%4")
+					.arg(info.min()).arg(info.max()).arg(info.mean()).arg(info.standardDeviation());
+			}
+			QMetaObject::invokeMethod(m_dlg, "showStatisticsPreview", Qt::QueuedConnection,
+				Q_ARG(QString, text), Q_ARG(int, m_request));
+		}
+	private:
+		QObject* m_dlg;
+		QString m_fileName;
+		iARawFileParameters m_params;
+		int m_request;
+		std::atomic<int> const & m_latestRequest;
+	};
 }
 
 dlg_openfile_sizecheck::dlg_openfile_sizecheck(QString const & fileName, QWidget *parent, QString const & title,
 	QStringList const & additionalLabels, QList<QVariant> const & additionalValues, iARawFileParameters & rawFileParams):
+	m_fileName(fileName),
+	m_statisticsTimer(new QTimer(this)),
+	m_statisticsRequest(0),
 	m_accepted(false)
 {
+	m_statisticsPool.setMaxThreadCount(1);
+	m_statisticsTimer->setSingleShot(true);
+	m_statisticsTimer->setInterval(StatisticsPreviewDelayMS);
+	connect(m_statisticsTimer, &QTimer::timeout, this, &dlg_openfile_sizecheck::startStatisticsPreview);
 	QFileInfo info1(fileName);
 	m_fileSize = info1.size();
-	m_sizeXIdx = 0; m_sizeYIdx = 1; m_sizeZIdx = 2; m_headerSizeIdx = 9; m_voxelSizeIdx = 10;
+	m_sizeXIdx = 0; m_sizeYIdx = 1; m_sizeZIdx = 2; m_headerSizeIdx = 9; m_voxelSizeIdx = 10; m_byteOrderIdx = 11;
 
 	QStringList datatype(readableDataTypeList(false));
 	QString selectedType = mapVTKTypeToReadableDataType(rawFileParams.m_scalarType);
@@ -91,13 +153,18 @@ dlg_openfile_sizecheck::dlg_openfile_sizecheck(QString const & fileName, QWidget
 	m_proposedSizeLabel->setAlignment(Qt::AlignRight);
 	m_inputDlg->gridLayout->addWidget(m_proposedSizeLabel, labels.size() + 1, 0, 1, 1);
 
-	m_inputDlg->gridLayout->addWidget(m_inputDlg->buttonBox, labels.size() + 2, 0, 1, 1);
+	m_statisticsLabel = new QLabel("");
+	m_statisticsLabel->setAlignment(Qt::AlignRight);
+	m_inputDlg->gridLayout->addWidget(m_statisticsLabel, labels.size() + 2, 0, 1, 1);
+
+	m_inputDlg->gridLayout->addWidget(m_inputDlg->buttonBox, labels.size() + 3, 0, 1, 1);
 
 	connect(qobject_cast<QLineEdit*>(m_inputDlg->widgetList()[m_sizeXIdx]), SIGNAL(textChanged(const QString)), this, SLOT(checkFileSize()));
 	connect(qobject_cast<QLineEdit*>(m_inputDlg->widgetList()[m_sizeYIdx]), SIGNAL(textChanged(const QString)), this, SLOT(checkFileSize()));
 	connect(qobject_cast<QLineEdit*>(m_inputDlg->widgetList()[m_sizeZIdx]), SIGNAL(textChanged(const QString)), this, SLOT(checkFileSize()));
 	connect(qobject_cast<QLineEdit*>(m_inputDlg->widgetList()[m_headerSizeIdx]), SIGNAL(textChanged(const QString)), this, SLOT(checkFileSize()));
 	connect(qobject_cast<QComboBox*>(m_inputDlg->widgetList()[m_voxelSizeIdx]), SIGNAL(currentIndexChanged(int)), this, SLOT(checkFileSize()));
+	connect(qobject_cast<QComboBox*>(m_inputDlg->widgetList()[m_byteOrderIdx]), SIGNAL(currentIndexChanged(int)), this, SLOT(checkFileSize()));
 
 	checkFileSize();
 
@@ -137,6 +204,39 @@ void dlg_openfile_sizecheck::checkFileSize()
 	}
 	m_proposedSizeLabel->setStyleSheet(QString("QLabel { background-color : %1; }").arg(proposedSize == m_fileSize ? "#BFB" : "#FBB" ));
 	m_inputDlg->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(proposedSize == m_fileSize);
+	// parameters changed, so results of a preview still being computed are outdated:
+	++m_statisticsRequest;
+	if (proposedSize != m_fileSize)
+	{
+		m_statisticsTimer->stop();
+		m_statisticsLabel->setText("");
+		return;
+	}
+	m_statisticsLabel->setText("Computing statistics preview...");
+	m_statisticsTimer->start();  // restarts if already active, so the preview is only computed once editing pauses
+}
+
+void dlg_openfile_sizecheck::startStatisticsPreview()
+{
+	iARawFileParameters params;
+	for (int i = 0; i < 3; ++i)
+	{
+		params.m_size[i] = m_inputDlg->getIntValue(m_sizeXIdx + i);
+	}
+	params.m_headersize = m_inputDlg->getDblValue(m_headerSizeIdx);
+	params.m_scalarType = mapReadableDataTypeToVTKType(m_inputDlg->getComboBoxValue(m_voxelSizeIdx));
+	params.m_byteOrder = (m_inputDlg->getComboBoxValue(m_byteOrderIdx) == "Big Endian") ?
+		VTK_FILE_BYTE_ORDER_BIG_ENDIAN : VTK_FILE_BYTE_ORDER_LITTLE_ENDIAN;
+	m_statisticsPool.start(new iAStatisticsPreviewRunnable(this, m_fileName, params, m_statisticsRequest, m_statisticsRequest));
+}
+
+void dlg_openfile_sizecheck::showStatisticsPreview(QString const & text, int request)
+{
+	if (request != m_statisticsRequest)
+	{   // parameters have changed since this preview was started
+		return;
+	}
+	m_statisticsLabel->setText(text);
 }
 
 bool dlg_openfile_sizecheck::accepted() const
@@ -156,5 +256,6 @@ dlg_commoninput const * dlg_openfile_sizecheck::inputDlg() const
 
 dlg_openfile_sizecheck::~dlg_openfile_sizecheck()
 {
+	m_statisticsPool.waitForDone();  // the running preview refers to this object
 	delete m_inputDlg;
 }
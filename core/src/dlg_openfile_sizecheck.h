@@ -21,11 +21,15 @@
 #pragma once
 
 #include <QObject>
+#include <QThreadPool>
+
+#include <atomic>
 
 class dlg_commoninput;
 struct iARawFileParameters;
 
 class QLabel;
+class QTimer;
 
 class dlg_openfile_sizecheck: public QObject
 {
@@ -55,10 +59,15 @@ public:
 	//! @return the common input dialog.
 	dlg_commoninput const * inputDlg() const;
 private:
+	QString m_fileName;
 	qint64 m_fileSize;
 	QLabel * m_actualSizeLabel;
 	QLabel * m_proposedSizeLabel;
-	int m_sizeXIdx, m_sizeYIdx, m_sizeZIdx, m_voxelSizeIdx, m_headerSizeIdx;
+	QLabel * m_statisticsLabel;
+	QTimer * m_statisticsTimer;        //!< delays the statistics preview until the parameters are not changed anymore
+	QThreadPool m_statisticsPool;      //!< computes the statistics preview in the background
+	std::atomic<int> m_statisticsRequest; //!< incremented on every parameter change, to discard outdated previews
+	int m_sizeXIdx, m_sizeYIdx, m_sizeZIdx, m_voxelSizeIdx, m_headerSizeIdx, m_byteOrderIdx;
 	double * dlg;
 	dlg_commoninput* m_inputDlg;
 	bool m_accepted;
@@ -66,4 +75,8 @@ private:
 private slots:
 	//! update labels indicating whether current parameters fit the actual file size
 	void checkFileSize();
+	//! start computing statistics from a subsample of the file with the current parameters, in the background
+	void startStatisticsPreview();
+	//! show the statistics preview computed in the background, if the parameters have not changed since
+	void showStatisticsPreview(QString const & text, int request);
 };
@@ -31,6 +31,9 @@
 #include "iAStringHelper.h"
 #include "iAValueType.h"
 #include "io/iAITKIO.h"
+#include "io/iARawFileMapping.h"
+
+#include <vtkImageData.h>
 
 #include <QFileInfo>
 #include <QTextStream>
@@ -210,19 +213,21 @@ namespace
 			<< "         List available filters" << std::endl
 			<< "     -h FilterName" << std::endl
 			<< "         Print help on a specific filter" << std::endl
-			<< "     -r FilterName -i Input -o Output -p Parameters [-q] [-c] [-f] [-s n]" << std::endl
+			<< "     -r FilterName -i Input -o Output -p Parameters [-q] [-c] [-f] [-s n] [-b n]" << std::endl
 			<< "         Run the filter given by FilterName with Parameters on given Input, write to Output" << std::endl
 			<< "           -q   quiet - no output except for error messages" << std::endl
 			<< "           -c   compress output" << std::endl
 			<< "           -f   overwrite output if it exists" << std::endl
 			<< "           -s n separate input starts at nth filename given under -i" << std::endl // (required for some filters, e.g. Extended Random Walker)
+			<< "           -b n process image in bricks of n voxels per side (for filters supporting it; reduces memory usage;" << std::endl
+			<< "                uncompressed MetaImage (.mhd) input is then read brick by brick instead of completely)" << std::endl
 			<< "         Note: Only image output is written to the filename(s) specified after -o," << std::endl
 			<< "           filters returning one or more output values write those values to the command line." << std::endl
 			<< "     -p FilterName" << std::endl
 			<< "         Output the Parameter Descriptor for the given filter (required for sampling)." << std::endl;
 	}
 
-	enum ParseMode { None, Input, Output, Parameter, InvalidParameter, Quiet, Compress, Overwrite, InputSeparation};
+	enum ParseMode { None, Input, Output, Parameter, InvalidParameter, Quiet, Compress, Overwrite, InputSeparation, BrickSize};
 
 	ParseMode GetMode(QString arg)
 	{
@@ -233,6 +238,7 @@ namespace
 		else if (arg == "-c") return Compress;
 		else if (arg == "-f") return Overwrite;
 		else if (arg == "-s") return InputSeparation;
+		else if (arg == "-b") return BrickSize;
 		else return InvalidParameter;
 	}
 
@@ -276,6 +282,19 @@ namespace
 				mode = None;
 				break;
 			}
+			case BrickSize: {
+				bool ok;
+				int brickSize = args[a].toInt(&ok);
+				if (!ok || brickSize <= 0)
+				{
+					std::cout << "Invalid value '" << args[a].toStdString()
+						<< "' for brick size, expected a positive int!" << std::endl;
+					return 1;
+				}
+				filter->setBrickSize(brickSize);
+				mode = None;
+				break;
+			}
 			case Input:
 			case Output:
 			case Parameter:
@@ -368,10 +387,28 @@ namespace
 				{
 					std::cout << "Reading input file '" << inputFiles[i].toStdString() << "'" << std::endl;
 				}
-				iAITKIO::ScalarPixelType pixelType;
-				iAITKIO::ImagePointer img = iAITKIO::readFile(inputFiles[i], pixelType, false);
 				iAConnector * con = new iAConnector();
-				con->setImage(img);
+				vtkSmartPointer<vtkImageData> mappedImg;
+				if (filter->brickSize() > 0 && filter->haloSize(parameters) != iAFilter::NoBrickedExecution &&
+					QFileInfo(inputFiles[i]).suffix().compare("mhd", Qt::CaseInsensitive) == 0)
+				{   // map the data, so that only the bricks currently processed are read into memory:
+					QString errorMsg;
+					mappedImg = mapMetaImage(inputFiles[i], errorMsg);
+					if (!mappedImg)
+					{
+						std::cout << "Could not map input file (" << errorMsg.toStdString() << "), reading it completely." << std::endl;
+					}
+				}
+				if (mappedImg)
+				{
+					con->setImage(mappedImg);
+				}
+				else
+				{
+					iAITKIO::ScalarPixelType pixelType;
+					iAITKIO::ImagePointer img = iAITKIO::readFile(inputFiles[i], pixelType, false);
+					con->setImage(img);
+				}
 				filter->addInput(con);
 			}
 
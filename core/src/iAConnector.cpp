@@ -21,10 +21,14 @@
 #include "iAConnector.h"
 #include "iAExtendedTypedCallHelper.h"
 #include "iAToolsITK.h"
+#include "iATypedCallHelper.h"
 
 #include <itkVTKImageImport.h>
 #include <itkVTKImageExport.h>
 
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+
 
 //! Connects the given itk::VTKImageExport filter to the given vtkImageImport filter.
 template <typename ITK_Exporter, typename VTK_Importer>
@@ -103,6 +107,25 @@ void SetupPipelineITKtoVTK(
 	importer->Update();
 }
 
+//! Transfers the ownership of the buffer of the given ITK image to the scalar array of the given VTK image,
+//! if the VTK image directly references that buffer (as it does when it was imported from the ITK image).
+template <class T>
+void TransferBufferOwnership(iAConnector::ImagePointer & imageBase, vtkImageData* vtkImg, bool & success)
+{
+	typedef itk::Image< T, 3 > ImageType;
+	ImageType * image = dynamic_cast<ImageType *>(imageBase.GetPointer());
+	auto scalars = vtkImg ? vtkImg->GetPointData()->GetScalars() : nullptr;
+	if (!image || !scalars || !image->GetPixelContainer()->GetContainerManageMemory() ||
+		scalars->GetNumberOfComponents() != 1 || scalars->GetVoidPointer(0) != image->GetBufferPointer())
+	{
+		return;
+	}
+	// ITK allocates its buffers with new[], so VTK needs to free it with delete[]:
+	image->GetPixelContainer()->SetContainerManageMemory(false);
+	scalars->SetVoidArray(image->GetBufferPointer(), scalars->GetNumberOfValues(), 0, vtkAbstractArray::VTK_DATA_ARRAY_DELETE);
+	success = true;
+}
+
 
 iAConnector::iAConnector() :
 	m_ITKImage(ImageBaseType::New()),
@@ -151,6 +174,31 @@ void iAConnector::updateImageITK()
 	m_ITKImage = dynamic_cast<ImageBaseType*>(m_itkImporter->GetOutputs()[0].GetPointer());
 }
 
+vtkSmartPointer<vtkImageData> iAConnector::releaseVTKImage()
+{
+	if (!m_VTKImage || !m_ITKImage || m_VTKImage != m_vtkImporter->GetOutput() ||
+		itkPixelType() != itk::ImageIOBase::SCALAR || itkScalarPixelType() == itk::ImageIOBase::UNKNOWNCOMPONENTTYPE)
+	{
+		return vtkSmartPointer<vtkImageData>();
+	}
+	bool success = false;
+	ITK_TYPED_CALL(TransferBufferOwnership, itkScalarPixelType(), m_ITKImage, m_VTKImage.GetPointer(), success);
+	if (!success)
+	{
+		return vtkSmartPointer<vtkImageData>();
+	}
+	auto result = vtkSmartPointer<vtkImageData>::New();
+	result->ShallowCopy(m_VTKImage);
+	// reset, so that neither the (now buffer-less) ITK image nor the importer referencing it can be used anymore:
+	m_ITKImage = ImageBaseType::New();
+	m_VTKImage = vtkSmartPointer<vtkImageData>::New();
+	m_itkExporter = nullptr;
+	m_vtkImporter = vtkSmartPointer<vtkImageImport>::New();
+	m_isTypeInitialized = false;
+	m_isPixelTypeInitialized = false;
+	return result;
+}
+
 vtkSmartPointer<vtkImageData> iAConnector::vtkImage() const
 {
 	return m_VTKImage;
@@ -59,6 +59,14 @@ public:
 	ITKPixelType itkPixelType() const;
 	//! Set the linked ITK/VTK images as modified
 	void modified();
+	//! Hand over the VTK image without copying the pixel data; only possible for images set as ITK image.
+	//! The ownership of the ITK image buffer is transferred to the scalar array of the returned VTK image,
+	//! which is therefore independent of the ITK image (and of this connector); the connector is reset
+	//! to empty images. Use this instead of a DeepCopy of vtkImage() where the connector is not needed anymore.
+	//! @return the VTK image owning the image buffer, or nullptr if the buffer ownership cannot be transferred
+	//!     (e.g. for images set as VTK image, non-scalar pixel types, or if the ITK image does not own its buffer);
+	//!     the connector is unchanged in that case.
+	vtkSmartPointer<vtkImageData> releaseVTKImage();
 
 private:
 	//! @{ Update one image using the respective other
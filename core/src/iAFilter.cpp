@@ -23,20 +23,115 @@
 #include "iAAttributeDescriptor.h"
 #include "iAConnector.h"
 #include "iAConsole.h"
+#include "iAFilterRegistry.h"
+#include "iAProgress.h"
 #include "iAStringHelper.h"
+#include "io/iARawFileMapping.h"
+
+#include <vtkImageData.h>
 
 #include <QColor>
 #include <QFileInfo>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>    // for memcpy
+
+namespace
+{
+	//! A brick of an image, for bricked execution
+	struct iABrick
+	{
+		int start[3];      //!< start voxel of the brick in the full image
+		int size[3];       //!< size of the brick
+		int haloStart[3];  //!< start voxel of the brick including halo
+		int haloSize[3];   //!< size of the brick including halo
+	};
+
+	//! Copy a box-shaped region between images with the same scalar type and number of components
+	void copyRegion(vtkImageData* src, int const srcStart[3], vtkImageData* dst, int const dstStart[3], int const size[3])
+	{
+		int srcDim[3], dstDim[3];
+		src->GetDimensions(srcDim);
+		dst->GetDimensions(dstDim);
+		size_t voxelBytes = static_cast<size_t>(src->GetScalarSize()) * src->GetNumberOfScalarComponents();
+		size_t rowBytes = voxelBytes * size[0];
+		auto srcData = static_cast<char const *>(src->GetScalarPointer());
+		auto dstData = static_cast<char *>(dst->GetScalarPointer());
+		for (int z = 0; z < size[2]; ++z)
+		{
+			for (int y = 0; y < size[1]; ++y)
+			{
+				size_t srcOfs = ((static_cast<size_t>(srcStart[2] + z) * srcDim[1] + srcStart[1] + y) * srcDim[0] + srcStart[0]) * voxelBytes;
+				size_t dstOfs = ((static_cast<size_t>(dstStart[2] + z) * dstDim[1] + dstStart[1] + y) * dstDim[0] + dstStart[0]) * voxelBytes;
+				std::memcpy(dstData + dstOfs, srcData + srcOfs, rowBytes);
+			}
+		}
+	}
+
+	//! Run a new instance of a filter on a brick of the given input images.
+	//! @return the outputs of the filter for the brick (including halo), empty on error
+	QVector<vtkSmartPointer<vtkImageData>> runOnBrick(QSharedPointer<iAIFilterFactory> factory,
+		QVector<iAConnector*> const & input, iABrick const & brick, QMap<QString, QVariant> const & parameters,
+		unsigned int firstInputChannels, iALogger* logger)
+	{
+		auto filter = factory->create();
+		QVector<QSharedPointer<iAConnector>> brickInput;
+		for (auto con : input)
+		{
+			auto img = con->vtkImage();
+			double origin[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				origin[i] = img->GetOrigin()[i] + brick.haloStart[i] * img->GetSpacing()[i];
+			}
+			auto brickImg = vtkSmartPointer<vtkImageData>::New();
+			brickImg->SetDimensions(brick.haloSize);
+			brickImg->SetSpacing(img->GetSpacing());
+			brickImg->SetOrigin(origin);
+			brickImg->AllocateScalars(img->GetScalarType(), img->GetNumberOfScalarComponents());
+			int const brickStart[3] = { 0, 0, 0 };
+			copyRegion(img, brick.haloStart, brickImg, brickStart, brick.haloSize);
+			QSharedPointer<iAConnector> brickCon(new iAConnector());
+			brickCon->setImage(brickImg);
+			brickCon->modified();
+			filter->addInput(brickCon.data());
+			brickInput.push_back(brickCon);
+		}
+		iAProgress progress;
+		filter->setProgress(&progress);
+		filter->setLogger(logger);
+		filter->setFirstInputChannels(firstInputChannels);
+		QVector<vtkSmartPointer<vtkImageData>> result;
+		if (!filter->run(parameters))
+		{
+			return result;
+		}
+		for (auto con : filter->output())
+		{   // the output connectors are deleted with the filter, so take over their images:
+			auto img = con->releaseVTKImage();
+			if (!img)
+			{
+				img = vtkSmartPointer<vtkImageData>::New();
+				img->DeepCopy(con->vtkImage());
+			}
+			result.push_back(img);
+		}
+		return result;
+	}
+}
+
 iAFilter::iAFilter(QString const & name, QString const & category, QString const & description,
 	unsigned int requiredInputs, unsigned int outputCount) :
+	m_progress(nullptr),
 	m_log(iAStdOutLogger::get()),
 	m_name(name),
 	m_category(category),
 	m_description(description),
 	m_requiredInputs(requiredInputs),
 	m_outputCount(outputCount),
-	m_firstInputChannels(1)
+	m_firstInputChannels(1),
+	m_brickSize(0)
 {}
 
 iAFilter::~iAFilter()
@@ -183,7 +278,170 @@ bool iAFilter::run(QMap<QString, QVariant> const & parameters)
 	}
 	clearOutput();
 	m_outputValues.clear();
-	performWork(parameters);
+	int halo = (m_brickSize > 0) ? haloSize(parameters) : NoBrickedExecution;
+	if (halo == NoBrickedExecution || !runBricked(parameters, halo))
+	{
+		performWork(parameters);
+	}
+	return true;
+}
+
+int iAFilter::haloSize(QMap<QString, QVariant> const & /*parameters*/) const
+{
+	return NoBrickedExecution;
+}
+
+bool iAFilter::needsWholeInput(QMap<QString, QVariant> const & parameters) const
+{
+	return haloSize(parameters) == NoBrickedExecution;
+}
+
+void iAFilter::setBrickSize(int brickSize)
+{
+	m_brickSize = brickSize;
+}
+
+int iAFilter::brickSize() const
+{
+	return m_brickSize;
+}
+
+bool iAFilter::runBricked(QMap<QString, QVariant> const & parameters, int halo)
+{
+	if (m_input.isEmpty())
+	{
+		return false;
+	}
+	auto firstImg = m_input[0]->vtkImage();
+	int dim[3];
+	firstImg->GetDimensions(dim);
+	int brickCount[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		brickCount[i] = (dim[i] + m_brickSize - 1) / m_brickSize;
+	}
+	int totalBricks = brickCount[0] * brickCount[1] * brickCount[2];
+	if (totalBricks <= 1)
+	{   // image fits into a single brick
+		return false;
+	}
+	for (auto con : m_input)
+	{
+		int inDim[3];
+		con->vtkImage()->GetDimensions(inDim);
+		if (inDim[0] != dim[0] || inDim[1] != dim[1] || inDim[2] != dim[2])
+		{
+			addMsg("Bricked execution requires all input images to have the same size, running on whole images.");
+			return false;
+		}
+	}
+	int filterID = iAFilterRegistry::filterID(m_name);
+	if (filterID == -1)
+	{
+		addMsg(QString("Filter '%1' is not registered, which is required for bricked execution; running on whole images.").arg(m_name));
+		return false;
+	}
+	auto factory = iAFilterRegistry::filterFactories()[filterID];
+	auto brickAt = [&](int brickIdx)
+	{
+		int brickCoord[3] = { brickIdx % brickCount[0], (brickIdx / brickCount[0]) % brickCount[1], brickIdx / (brickCount[0] * brickCount[1]) };
+		iABrick brick;
+		for (int i = 0; i < 3; ++i)
+		{
+			brick.start[i] = brickCoord[i] * m_brickSize;
+			brick.size[i] = std::min(m_brickSize, dim[i] - brick.start[i]);
+			brick.haloStart[i] = std::max(0, brick.start[i] - halo);
+			brick.haloSize[i] = std::min(dim[i], brick.start[i] + brick.size[i] + halo) - brick.haloStart[i];
+		}
+		return brick;
+	};
+	QVector<vtkSmartPointer<vtkImageData>> outputs;
+	// check whether brick outputs are as expected, and store them in the full outputs:
+	auto storeBrick = [&outputs](QVector<vtkSmartPointer<vtkImageData>> const & brickOutputs, iABrick const & brick) -> bool
+	{
+		if (brickOutputs.size() != outputs.size())
+		{
+			return false;
+		}
+		int innerStart[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			innerStart[i] = brick.start[i] - brick.haloStart[i];
+		}
+		for (int o = 0; o < outputs.size(); ++o)
+		{
+			int outDim[3];
+			brickOutputs[o]->GetDimensions(outDim);
+			if (outDim[0] != brick.haloSize[0] || outDim[1] != brick.haloSize[1] || outDim[2] != brick.haloSize[2] ||
+				brickOutputs[o]->GetScalarType() != outputs[o]->GetScalarType() ||
+				brickOutputs[o]->GetNumberOfScalarComponents() != outputs[o]->GetNumberOfScalarComponents())
+			{
+				return false;
+			}
+			copyRegion(brickOutputs[o], innerStart, outputs[o], brick.start, brick.size);
+		}
+		return true;
+	};
+
+	// run first brick separately, to determine number and types of the outputs:
+	auto firstBrickOutputs = runOnBrick(factory, m_input, brickAt(0), parameters, m_firstInputChannels, m_log);
+	for (auto brickOutput : firstBrickOutputs)
+	{
+		QString errorMsg;
+		auto output = createFileBackedImage(dim, firstImg->GetSpacing(), firstImg->GetOrigin(),
+			brickOutput->GetScalarType(), brickOutput->GetNumberOfScalarComponents(), QString(), errorMsg);
+		if (!output)
+		{
+			addMsg(QString("Could not create output for bricked execution (%1); running on whole images.").arg(errorMsg));
+			return false;
+		}
+		outputs.push_back(output);
+	}
+	if (firstBrickOutputs.isEmpty() || !storeBrick(firstBrickOutputs, brickAt(0)))
+	{
+		addMsg("Filter did not produce output images of the same size as its input in bricked execution; running on whole images.");
+		return false;
+	}
+	std::atomic<int> finishedBricks(1);
+	std::atomic<bool> failed(false);
+	QString failMsg;
+#pragma omp parallel for schedule(dynamic)
+	for (int b = 1; b < totalBricks; ++b)
+	{
+		if (failed)
+		{
+			continue;
+		}
+		try
+		{
+			auto brick = brickAt(b);
+			if (!storeBrick(runOnBrick(factory, m_input, brick, parameters, m_firstInputChannels, m_log), brick))
+			{
+				failed = true;
+			}
+		}
+		catch (std::exception & e)
+		{
+#pragma omp critical
+			failMsg = e.what();
+			failed = true;
+		}
+		int finished = ++finishedBricks;
+		if (m_progress)
+		{
+			m_progress->emitProgress(finished * 100 / totalBricks);
+		}
+	}
+	if (failed)
+	{
+		addMsg(QString("Bricked execution failed%1; running on whole images.").arg(failMsg.isEmpty() ? "" : QString(" (%1)").arg(failMsg)));
+		return false;
+	}
+	for (auto output : outputs)
+	{
+		addOutput(output);
+	}
+	addMsg(QString("Executed in %1 bricks of size %2 (halo: %3).").arg(totalBricks).arg(m_brickSize).arg(halo));
 	return true;
 }
 
@@ -116,6 +116,33 @@ public:
 	//! Initialize and run the filter
 	//! @param parameters the map of parameters to use in this specific filter run
 	bool run(QMap<QString, QVariant> const & parameters);
+	//! Value returned by haloSize for filters which do not support bricked execution
+	static const int NoBrickedExecution = -1;
+	//! The size of the neighborhood (in voxels, along each axis) which determines the output value at a voxel.
+	//! Filters overriding this method and returning a non-negative value for the given parameters support
+	//! bricked execution (see setBrickSize). Only do so for local operators, i.e. filters for which the
+	//! output at a voxel depends exclusively on the input voxels within the halo size around it.
+	//! @param parameters the parameters that the filter will be called with
+	//! @return the halo size, or NoBrickedExecution (the default) if the filter does not support bricked execution
+	virtual int haloSize(QMap<QString, QVariant> const & parameters) const;
+	//! Whether the filter needs its whole input images in memory, i.e. whether it accesses them repeatedly
+	//! or in arbitrary order. Inputs memory-mapped from a file (see mapRawImage) are then fully loaded before
+	//! the filter is run; other filters work directly on the mapped data, which is only paged in when accessed.
+	//! The default implementation returns true for all filters not supporting bricked execution (see haloSize).
+	//! @param parameters the parameters that the filter will be called with
+	virtual bool needsWholeInput(QMap<QString, QVariant> const & parameters) const;
+	//! Set the brick size for bricked execution; 0 (the default) disables bricked execution.
+	//! In bricked execution, the input images are split into bricks, which are enlarged by the halo
+	//! (see haloSize); the filter is run on multiple bricks in parallel, and the output images are
+	//! assembled in file-backed images (see createFileBackedImage). Each brick is copied out of the input
+	//! images; if these are memory-mapped (see mapRawImage, mapMetaImage), only the parts required for the
+	//! bricks currently processed are read from disk, so images larger than the available memory can be
+	//! processed. Output values are not supported in bricked execution; filters not supporting bricked
+	//! execution are run on the whole images.
+	//! @param brickSize the size of a brick (in voxels, along each axis)
+	void setBrickSize(int brickSize);
+	//! The brick size used for bricked execution (see setBrickSize)
+	int brickSize() const;
 	//! Adds the description of a parameter to the filter
 	//! @param name the parameter's name
 	//! @param valueType the type of value this parameter can have
@@ -191,6 +218,8 @@ private:
 	//! The actual implementation of the filter
 	//! @param parameters the map of parameters to use in this specific filter run
 	virtual void performWork(QMap<QString, QVariant> const & parameters) = 0;
+	//! Run the filter brick by brick (see setBrickSize)
+	bool runBricked(QMap<QString, QVariant> const & parameters, int halo);
 	//! Clears the output values
 	void clearOutput();
 
@@ -213,6 +242,7 @@ private:
 	QMap<unsigned int, QString> m_outputNames;
 	QString m_name, m_category, m_description;
 	int m_requiredInputs, m_outputCount, m_firstInputChannels;
+	int m_brickSize;
 };
 
 //! Convenience Macro for creating the static Create method for your filter
@@ -231,3 +261,16 @@ private: \
 	void performWork(QMap<QString, QVariant> const & parameters) override; \
 	FilterName(); \
 };
+
+//! Same as IAFILTER_DEFAULT_CLASS, but additionally declares the haloSize method,
+//! for filters supporting bricked execution
+#define IAFILTER_DEFAULT_CLASS_WITH_HALO(FilterName) \
+class FilterName : public iAFilter \
+{ \
+public: \
+	static QSharedPointer<FilterName> create(); \
+	int haloSize(QMap<QString, QVariant> const & parameters) const override; \
+private: \
+	void performWork(QMap<QString, QVariant> const & parameters) override; \
+	FilterName(); \
+};
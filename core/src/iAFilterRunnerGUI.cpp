@@ -30,6 +30,7 @@
 #include "iAModality.h"
 #include "iAModalityList.h"
 #include "iAParameterDlg.h"
+#include "io/iARawFileMapping.h"
 #include "mainwindow.h"
 #include "mdichild.h"
 
@@ -80,6 +81,9 @@ QSharedPointer<iAFilter> iAFilterRunnerGUIThread::filter()
 
 namespace
 {
+	const QString BrickSizeParamName("Brick size (0: whole image)");
+	const QString BrickSizeSettingName("Filters/BrickSize");
+
 	QString SettingName(QSharedPointer<iAFilter> filter, QSharedPointer<iAAttributeDescriptor> param)
 	{
 		QString filterNameShort(filter->name());
@@ -151,6 +155,13 @@ bool iAFilterRunnerGUI::askForParameters(QSharedPointer<iAFilter> filter, QMap<Q
 		}
 		dlgParams.push_back(p);
 	}
+	// filters supporting bricked execution can process large (e.g. memory-mapped) images brick by brick:
+	bool const bricked = filter->haloSize(paramValues) != iAFilter::NoBrickedExecution;
+	if (bricked)
+	{
+		dlgParams.push_back(iAAttributeDescriptor::createParam(BrickSizeParamName, Discrete,
+			QSettings().value(BrickSizeSettingName, 0).toInt(), 0));
+	}
 	if (filter->requiredInputs() == 1 && dlgParams.empty())
 	{
 		return true;
@@ -196,6 +207,13 @@ bool iAFilterRunnerGUI::askForParameters(QSharedPointer<iAFilter> filter, QMap<Q
 		return false;
 	}
 	paramValues = dlg.parameterValues();
+	if (bricked)
+	{
+		int brickSize = paramValues[BrickSizeParamName].toInt();
+		QSettings().setValue(BrickSizeSettingName, brickSize);
+		filter->setBrickSize(brickSize);
+		paramValues.remove(BrickSizeParamName);
+	}
 	if (askForAdditionalInput && filter->requiredInputs() > 1)
 	{
 		for (int i = 1; i < filter->requiredInputs(); ++i)
@@ -239,6 +257,20 @@ void iAFilterRunnerGUI::run(QSharedPointer<iAFilter> filter, MainWindow* mainWnd
 		return;
 	}
 
+	// filters accessing their inputs repeatedly or in arbitrary order need inputs which are memory-mapped
+	// from a file (see mapRawImage) completely in memory; all others can work on the mapped data:
+	if (filter->needsWholeInput(paramValues))
+	{
+		for (int m = 0; m < sourceMdi->modalities()->size(); ++m)
+		{
+			materializeImage(sourceMdi->modality(m)->image());
+		}
+		for (auto img : m_additionalInput)
+		{
+			materializeImage(img);
+		}
+	}
+
 	QString oldTitle(sourceMdi->windowTitle());
 	oldTitle = oldTitle.replace("[*]", "").trimmed();
 	auto mdiChild = filter->outputCount() > 0 ?
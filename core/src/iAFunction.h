@@ -21,13 +21,131 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
 #include <map>
+#include <vector>
 
 //! Class representing a generic (single-parameter) function,
 //! which can be passed into the functional boxplot calculation.
+//! Suitable for sparse arguments; for many functions sampled at the same arguments, use iASampledFunctions.
 template <typename ArgType, typename ValType>
 class iAFunction : public std::map<ArgType, ValType> {};
 
+//! A set of functions which are all sampled at the same arguments (e.g. integer or regularly spaced ones).
+//! The values of all functions are stored in a single contiguous buffer, argument-major, i.e. the values
+//! of all functions at one argument are adjacent (this is the access pattern of the band depth
+//! calculation in iAFunctionalBoxplot).
+template <typename ArgType, typename ValType>
+class iASampledFunctions
+{
+public:
+	//! create an empty set of functions
+	iASampledFunctions();
+	//! create a set of functionCount functions sampled at the given arguments, with all values 0
+	iASampledFunctions(std::vector<ArgType> const & arguments, size_t functionCount);
+	//! create a set of functionCount functions sampled at argumentCount arguments
+	//! firstArgument, firstArgument + argumentStep, ..., with all values 0
+	iASampledFunctions(ArgType firstArgument, ArgType argumentStep, size_t argumentCount, size_t functionCount);
+	size_t functionCount() const;
+	size_t argumentCount() const;
+	ArgType argument(size_t argIdx) const;
+	ValType value(size_t funcIdx, size_t argIdx) const;
+	void setValue(size_t funcIdx, size_t argIdx, ValType value);
+	//! the values of all functions at the given argument (functionCount() consecutive values)
+	ValType const * valuesAt(size_t argIdx) const;
+	//! the values of all functions at the given argument, for filling them
+	ValType * valuesAt(size_t argIdx);
+	//! the given function in the map-based representation
+	iAFunction<ArgType, ValType> function(size_t funcIdx) const;
+private:
+	std::vector<ArgType> m_arguments;
+	std::vector<ValType> m_values;
+	size_t m_functionCount;
+};
+
+template <typename ArgType, typename ValType>
+iASampledFunctions<ArgType, ValType>::iASampledFunctions() :
+	m_functionCount(0)
+{}
+
+template <typename ArgType, typename ValType>
+iASampledFunctions<ArgType, ValType>::iASampledFunctions(std::vector<ArgType> const & arguments, size_t functionCount) :
+	m_arguments(arguments),
+	m_values(arguments.size() * functionCount, ValType()),
+	m_functionCount(functionCount)
+{}
+
+template <typename ArgType, typename ValType>
+iASampledFunctions<ArgType, ValType>::iASampledFunctions(ArgType firstArgument, ArgType argumentStep,
+	size_t argumentCount, size_t functionCount) :
+	m_arguments(argumentCount),
+	m_values(argumentCount * functionCount, ValType()),
+	m_functionCount(functionCount)
+{
+	for (size_t a = 0; a < argumentCount; ++a)
+	{
+		m_arguments[a] = static_cast<ArgType>(firstArgument + a * argumentStep);
+	}
+}
+
+template <typename ArgType, typename ValType>
+size_t iASampledFunctions<ArgType, ValType>::functionCount() const
+{
+	return m_functionCount;
+}
+
+template <typename ArgType, typename ValType>
+size_t iASampledFunctions<ArgType, ValType>::argumentCount() const
+{
+	return m_arguments.size();
+}
+
+template <typename ArgType, typename ValType>
+ArgType iASampledFunctions<ArgType, ValType>::argument(size_t argIdx) const
+{
+	assert(argIdx < m_arguments.size());
+	return m_arguments[argIdx];
+}
+
+template <typename ArgType, typename ValType>
+ValType iASampledFunctions<ArgType, ValType>::value(size_t funcIdx, size_t argIdx) const
+{
+	assert(funcIdx < m_functionCount && argIdx < m_arguments.size());
+	return m_values[argIdx * m_functionCount + funcIdx];
+}
+
+template <typename ArgType, typename ValType>
+void iASampledFunctions<ArgType, ValType>::setValue(size_t funcIdx, size_t argIdx, ValType value)
+{
+	assert(funcIdx < m_functionCount && argIdx < m_arguments.size());
+	m_values[argIdx * m_functionCount + funcIdx] = value;
+}
+
+template <typename ArgType, typename ValType>
+ValType const * iASampledFunctions<ArgType, ValType>::valuesAt(size_t argIdx) const
+{
+	assert(argIdx < m_arguments.size());
+	return m_values.data() + argIdx * m_functionCount;
+}
+
+template <typename ArgType, typename ValType>
+ValType * iASampledFunctions<ArgType, ValType>::valuesAt(size_t argIdx)
+{
+	assert(argIdx < m_arguments.size());
+	return m_values.data() + argIdx * m_functionCount;
+}
+
+template <typename ArgType, typename ValType>
+iAFunction<ArgType, ValType> iASampledFunctions<ArgType, ValType>::function(size_t funcIdx) const
+{
+	iAFunction<ArgType, ValType> result;
+	for (size_t a = 0; a < m_arguments.size(); ++a)
+	{
+		result.insert(std::make_pair(m_arguments[a], value(funcIdx, a)));
+	}
+	return result;
+}
+
 /*
 template <typename ArgType, typename ValType>
 class iAFunction
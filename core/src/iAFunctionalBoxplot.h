@@ -35,6 +35,8 @@ class iAFunctionBand
 public:
 	//! merge the given function so that it also lies inside the band
 	void merge(iAFunction<ArgType, ValType> const & f, size_t functionIdx);
+	//! merge the given value range at argument a into the band
+	void merge(ArgType a, ValType min, ValType max);
 
 	//! @{ getters/setters
 	ValType getMin(ArgType a) const;
@@ -73,10 +75,6 @@ public:
 template <typename ArgType, typename ValType>
 class iAFunctionalBoxplot {
 public:
-	// limits for the number of loops that are used during calculation
-	static const unsigned long long MaxOverallFctBoxPlotLoops = 10000000000000;
-	static const unsigned long long MinBandsPerFct            = 40;
-	static const unsigned long long MinArgsPerBand            = 40;
 	enum Index {
 		LOWER,
 		UPPER
@@ -87,18 +85,28 @@ public:
 	//! @param maxBandSize the maximum band size to consider for band depth calculation (i.e. how
 	//!    many functions at most should be combined to bands). Band depth will be calculated
 	//!    as a combination of all band sizes from 2 to maxBandSize
+	//!    If all functions are defined at the same arguments and measure is an iAModifiedDepthMeasure,
+	//!    the depth is calculated exactly with the method of the iASampledFunctions constructor.
 	iAFunctionalBoxplot(std::vector<iAFunction<ArgType, ValType> *> & functions,
 		iADepthMeasure<ArgType, ValType>* measure,
 		size_t maxBandSize = 2);
+	//! Construction & calculation of functional boxplot data for functions sampled at common arguments,
+	//! ordering the functions by their exact modified band depth (see calculateModifiedBandDepth).
+	iAFunctionalBoxplot(iASampledFunctions<ArgType, ValType> const & functions);
 	iAFunction<ArgType, ValType> const & getMedian() const;
 	iAFunctionBand<ArgType, ValType> const & getCentralRegion() const;
 	iAFunctionBand<ArgType, ValType> const & getEnvelope() const;
+	//! the outlier functions; only available when constructed from a list of iAFunction's
 	std::vector<iAFunction<ArgType, ValType>* > const & getOutliers() const;
+	//! the indices of the outlier functions in the list of functions the boxplot was constructed from
+	std::vector<size_t> const & getOutlierIndices() const;
 private:
-	iAFunction<ArgType, ValType>* m_median;
+	void calculate(iASampledFunctions<ArgType, ValType> const & functions);
+	iAFunction<ArgType, ValType> m_median;
 	iAFunctionBand<ArgType, ValType> m_centralRegion;
 	iAFunctionBand<ArgType, ValType> m_envelope;
 	std::vector<iAFunction<ArgType, ValType> *> m_outliers;
+	std::vector<size_t> m_outlierIndices;
 };
 
 
@@ -108,26 +116,26 @@ private:
 template <typename ArgType, typename ValType>
 void iAFunctionBand<ArgType, ValType>::merge(iAFunction<ArgType, ValType> const & f, size_t funcIdx)
 {
-	if (m_Functions.empty())
+	for (auto it = f.begin(); it != f.end(); ++it)
 	{
-		for (auto it = f.begin(); it != f.end(); ++it)
-			m_Bounds.insert(std::make_pair(it->first, std::make_pair(it->second, it->second)));
+		merge(it->first, it->second, it->second);
+	}
+	m_Functions.insert(funcIdx);
+}
+
+template <typename ArgType, typename ValType>
+void iAFunctionBand<ArgType, ValType>::merge(ArgType a, ValType min, ValType max)
+{
+	auto it = m_Bounds.find(a);
+	if (it == m_Bounds.end())
+	{
+		m_Bounds.insert(std::make_pair(a, std::make_pair(min, max)));
 	}
 	else
 	{
-		for (auto it = f.begin(); it != f.end(); ++it)
-		{
-			if (it->second < getMin(it->first))
-			{
-				m_Bounds[it->first].first = it->second;
-			}
-			if (it->second > getMax(it->first))
-			{
-				m_Bounds[it->first].second = it->second;
-			}
-		}
+		it->second.first = std::min(it->second.first, min);
+		it->second.second = std::max(it->second.second, max);
 	}
-	m_Functions.insert(funcIdx);
 }
 
 template <typename ArgType, typename ValType>
@@ -267,6 +275,79 @@ public:
 	}
 };
 
+//! Calculates the modified band depth (for bands formed by pairs of functions) of all given functions exactly.
+//! Instead of testing every function against the band of every pair of functions at each argument, which
+//! takes O(n^3) time per argument, the values at each argument are sorted: a value lies inside the bands
+//! of all pairs except for those where both functions are strictly below or both are strictly above it,
+//! i.e. it is contained in C(n,2) - C(below,2) - C(above,2) bands; this takes only O(n log n) time.
+//! @return the depth of each function, normalized to the range 0..1
+template <typename ArgType, typename ValType>
+std::vector<double> calculateModifiedBandDepth(iASampledFunctions<ArgType, ValType> const & functions)
+{
+	size_t const funcCount = functions.functionCount();
+	long long const argCount = static_cast<long long>(functions.argumentCount());
+	std::vector<double> result(funcCount, 0.0);
+	auto pairCount = [](size_t k) { return k * (static_cast<double>(k) - 1) / 2; };
+#pragma omp parallel
+	{
+		std::vector<double> depth(funcCount, 0.0);
+		std::vector<std::pair<ValType, size_t> > sorted(funcCount);
+#pragma omp for
+		for (long long a = 0; a < argCount; ++a)
+		{
+			ValType const * values = functions.valuesAt(a);
+			for (size_t f = 0; f < funcCount; ++f)
+			{
+				sorted[f] = std::make_pair(values[f], f);
+			}
+			std::sort(sorted.begin(), sorted.end());
+			// for each run of equal values, "below" is the run start, "above" all after the run end:
+			for (size_t runStart = 0; runStart < funcCount; )
+			{
+				size_t runEnd = runStart + 1;
+				while (runEnd < funcCount && !(sorted[runStart].first < sorted[runEnd].first))
+				{
+					++runEnd;
+				}
+				double containedCount = pairCount(funcCount) - pairCount(runStart) - pairCount(funcCount - runEnd);
+				for (size_t f = runStart; f < runEnd; ++f)
+				{
+					depth[sorted[f].second] += containedCount;
+				}
+				runStart = runEnd;
+			}
+		}
+#pragma omp critical
+		for (size_t f = 0; f < funcCount; ++f)
+		{
+			result[f] += depth[f];
+		}
+	}
+	double normalizeFactor = (argCount > 0 && funcCount > 1) ? 1.0 / (argCount * pairCount(funcCount)) : 1.0;
+	for (size_t f = 0; f < funcCount; ++f)
+	{
+		result[f] *= normalizeFactor;
+	}
+	return result;
+}
+
+//! Returns the indices of the given band depths, ordered from deepest to shallowest.
+inline std::vector<size_t> orderByBandDepth(std::vector<double> const & bandDepth)
+{
+	std::vector<std::pair<double, size_t> > bandDepthList;
+	for (size_t f = 0; f < bandDepth.size(); ++f)
+	{
+		bandDepthList.push_back(std::pair<double, size_t>(bandDepth[f], f));
+	}
+	std::sort(bandDepthList.begin(), bandDepthList.end(), iADepthComparator());
+	std::vector<size_t> result(bandDepthList.size());
+	for (size_t f = 0; f < bandDepthList.size(); ++f)
+	{
+		result[f] = bandDepthList[f].second;
+	}
+	return result;
+}
+
 template <typename ArgType, typename ValType>
 iAFunctionalBoxplot<ArgType, ValType>::iAFunctionalBoxplot(std::vector<iAFunction<ArgType, ValType> *> & functions,
 	iADepthMeasure<ArgType, ValType>* measure,
@@ -280,49 +361,50 @@ iAFunctionalBoxplot<ArgType, ValType>::iAFunctionalBoxplot(std::vector<iAFunctio
 	assert(maxBandSize >= 2);
 	assert(functions.size() >= 2);
 
-	double * bandDepth = new double[functions.size()];
-
-	// initialize depth to 0
-	for (size_t i = 0; i < functions.size(); ++i)
+	// functions all defined at the same arguments can use the faster, sample-based calculation:
+	bool sameArguments = dynamic_cast<iAModifiedDepthMeasure<ArgType, ValType>*>(measure) != nullptr;
+	for (size_t f = 1; f < functions.size() && sameArguments; ++f)
 	{
-		bandDepth[i] = 0;
+		sameArguments = functions[f]->size() == functions[0]->size() &&
+			std::equal(functions[f]->begin(), functions[f]->end(), functions[0]->begin(),
+				[](std::pair<const ArgType, ValType> const & a, std::pair<const ArgType, ValType> const & b)
+				{
+					return a.first == b.first;
+				});
 	}
-
-	// set up sampling:
-
-	// start at minimum counts:
-	unsigned long long funcStepCnt = iAFunctionalBoxplot::MinBandsPerFct;
-	unsigned long long argStepCnt = iAFunctionalBoxplot::MinArgsPerBand;
-
-	// if we have room for more detailed calculations, do it:
-	if ((functions.size() * funcStepCnt * funcStepCnt * argStepCnt) < iAFunctionalBoxplot::MaxOverallFctBoxPlotLoops)
+	if (sameArguments)
 	{
-		funcStepCnt = std::min(static_cast<unsigned long long>(functions.size()),
-			static_cast<unsigned long long>(std::sqrt(static_cast<double>(iAFunctionalBoxplot::MaxOverallFctBoxPlotLoops / (functions.size() * argStepCnt))))
-		);
-
-		//if ((functions.size() * funcStepCnt * funcStepCnt * argStepCnt) < iAFunctionalBoxplot::MaxOverallFctBoxPlotLoops)
-		//{
-		//	argStepCnt = std::min(static_cast<unsigned long long>(argMax-argMin),
-		//		static_cast<unsigned long long>(iAFunctionalBoxplot::MaxOverallFctBoxPlotLoops / (functions.size() * funcStepCnt * funcStepCnt))
-		//	);
-		//}
+		std::vector<ArgType> arguments;
+		for (auto it = functions[0]->begin(); it != functions[0]->end(); ++it)
+		{
+			arguments.push_back(it->first);
+		}
+		iASampledFunctions<ArgType, ValType> sampled(arguments, functions.size());
+		for (size_t f = 0; f < functions.size(); ++f)
+		{
+			size_t a = 0;
+			for (auto it = functions[f]->begin(); it != functions[f]->end(); ++it, ++a)
+			{
+				sampled.setValue(f, a, it->second);
+			}
+		}
+		calculate(sampled);
+		for (size_t o : m_outlierIndices)
+		{
+			m_outliers.push_back(functions[o]);
+		}
+		return;
 	}
-	// calculate final step sizes:
-	unsigned long long funcStepSize = std::sqrt(static_cast<double>((functions.size()*functions.size()) / funcStepCnt));
-	//unsigned long long argStepSize = (argMax-argMin) / argStepCnt;
-	// factor which should normalize everything to 0..1
-	//double normalizeFactor = (2 * funcStepCnt * funcStepCnt * argStepCnt) /
-	//	(functions.size()*(functions.size()-1)*(argMax-argMin+1));
-	double normalizeFactor = 1.0;
+
+	std::vector<double> bandDepth(functions.size(), 0.0);
 	assert(functions.size() <= static_cast<size_t>(std::numeric_limits<long>::max()));
 	long longFuncSize = static_cast<long>(functions.size());
 #pragma omp parallel for
 	for (long func_nr = 0; func_nr < longFuncSize; ++func_nr)
 	{
-		for (long func1=0; func1 < longFuncSize -1; func1 += funcStepSize)
+		for (long func1=0; func1 < longFuncSize -1; ++func1)
 		{
-			for (long func2=func1+1; func2 < longFuncSize; func2 += funcStepSize)
+			for (long func2=func1+1; func2 < longFuncSize; ++func2)
 			{
 				if (func_nr != func1 && func_nr != func2)
 				{
@@ -337,33 +419,26 @@ iAFunctionalBoxplot<ArgType, ValType>::iAFunctionalBoxplot(std::vector<iAFunctio
 				}
 			}
 		}
-		bandDepth[func_nr] *= normalizeFactor;
-	}
-	std::vector < std::pair<double, size_t> > bandDepthList;
-
-	for (size_t f = 0; f < functions.size(); ++f)
-	{
-		bandDepthList.push_back(std::pair<double, size_t>(bandDepth[f], f));
 	}
 
 	// order function by bd/mbd
-	std::sort(bandDepthList.begin(), bandDepthList.end(), iADepthComparator());
+	std::vector<size_t> order = orderByBandDepth(bandDepth);
 
-	m_median = functions[bandDepthList[0].second];
+	m_median = *functions[order[0]];
 
-	size_t centralRegionEnd = bandDepthList.size() / 2;
-	size_t envelopeEnd = bandDepthList.size();
+	size_t centralRegionEnd = order.size() / 2;
+	size_t envelopeEnd = order.size();
 
 	// get band for first 50%
 	for (size_t f = 0; f < centralRegionEnd; ++f)
 	{
-		m_centralRegion.merge(*functions[bandDepthList[f].second], f);
+		m_centralRegion.merge(*functions[order[f]], f);
 	}
 
 	m_envelope = m_centralRegion;
 	for (size_t f = centralRegionEnd; f < envelopeEnd; ++f)
 	{
-		m_envelope.merge(*functions[bandDepthList[f].second], f );
+		m_envelope.merge(*functions[order[f]], f );
 	}
 
 	/*
@@ -379,19 +454,83 @@ iAFunctionalBoxplot<ArgType, ValType>::iAFunctionalBoxplot(std::vector<iAFunctio
 	*/
 
 	// determine outliers -> everything outside envelope
-	for (size_t f = centralRegionEnd; f < bandDepthList.size(); ++f)
+	for (size_t f = centralRegionEnd; f < order.size(); ++f)
 	{
-		if (!m_envelope.contains(*functions[bandDepthList[f].second])) {
-			m_outliers.push_back(functions[bandDepthList[f].second]);
+		if (!m_envelope.contains(*functions[order[f]])) {
+			m_outliers.push_back(functions[order[f]]);
+			m_outlierIndices.push_back(order[f]);
+		}
+	}
+}
+
+template <typename ArgType, typename ValType>
+iAFunctionalBoxplot<ArgType, ValType>::iAFunctionalBoxplot(iASampledFunctions<ArgType, ValType> const & functions)
+{
+	assert(functions.functionCount() >= 2);
+	calculate(functions);
+}
+
+template <typename ArgType, typename ValType>
+void iAFunctionalBoxplot<ArgType, ValType>::calculate(iASampledFunctions<ArgType, ValType> const & functions)
+{
+	std::vector<size_t> order = orderByBandDepth(calculateModifiedBandDepth(functions));
+	m_median = functions.function(order[0]);
+
+	// central region is the band of the deepest 50% of the functions, the envelope the band of all:
+	size_t const funcCount = functions.functionCount();
+	size_t const argCount = functions.argumentCount();
+	size_t centralRegionEnd = std::max(order.size() / 2, static_cast<size_t>(1));
+	std::vector<char> isCentral(funcCount, 0);
+	for (size_t f = 0; f < centralRegionEnd; ++f)
+	{
+		isCentral[order[f]] = 1;
+	}
+	std::vector<ValType> centralMin(argCount), centralMax(argCount), envelopeMin(argCount), envelopeMax(argCount);
+#pragma omp parallel for
+	for (long long a = 0; a < static_cast<long long>(argCount); ++a)
+	{
+		ValType const * values = functions.valuesAt(a);
+		ValType cMin = values[order[0]], cMax = cMin, eMin = cMin, eMax = cMin;
+		for (size_t f = 0; f < funcCount; ++f)
+		{
+			eMin = std::min(eMin, values[f]);
+			eMax = std::max(eMax, values[f]);
+			if (isCentral[f])
+			{
+				cMin = std::min(cMin, values[f]);
+				cMax = std::max(cMax, values[f]);
+			}
+		}
+		centralMin[a] = cMin;
+		centralMax[a] = cMax;
+		envelopeMin[a] = eMin;
+		envelopeMax[a] = eMax;
+	}
+	for (size_t a = 0; a < argCount; ++a)
+	{
+		m_centralRegion.merge(functions.argument(a), centralMin[a], centralMax[a]);
+		m_envelope.merge(functions.argument(a), envelopeMin[a], envelopeMax[a]);
+	}
+
+	// determine outliers -> everything outside envelope
+	for (size_t f = centralRegionEnd; f < order.size(); ++f)
+	{
+		for (size_t a = 0; a < argCount; ++a)
+		{
+			ValType value = functions.value(order[f], a);
+			if (value < envelopeMin[a] || value > envelopeMax[a])
+			{
+				m_outlierIndices.push_back(order[f]);
+				break;
+			}
 		}
 	}
-	delete[] bandDepth;
 }
 
 template <typename ArgType, typename ValType>
 iAFunction<ArgType, ValType> const & iAFunctionalBoxplot<ArgType, ValType>::getMedian() const
 {
-	return *m_median;
+	return m_median;
 }
 
 template <typename ArgType, typename ValType>
@@ -411,3 +550,9 @@ std::vector<iAFunction<ArgType, ValType> *> const & iAFunctionalBoxplot<ArgType,
 {
 	return m_outliers;
 }
+
+template <typename ArgType, typename ValType>
+std::vector<size_t> const & iAFunctionalBoxplot<ArgType, ValType>::getOutlierIndices() const
+{
+	return m_outlierIndices;
+}
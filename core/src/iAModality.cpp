@@ -20,6 +20,7 @@
 * ************************************************************************************/
 #include "iAModality.h"
 
+#include "charts/iAHistogramData.h"
 #include "defines.h"  // for NotExistingChannel
 #include "iAConsole.h"
 #include "iAImageCoordinate.h"
@@ -262,9 +263,14 @@ QString iAModality::positionString()
 	return m_renderer ? arrayToString(m_renderer->position(), 3) : QString();
 }
 
-void iAModality::computeHistogramData(size_t numBin)
+void iAModality::computeHistogramData(size_t numBin, size_t sampleStep)
 {
-	m_transfer->computeHistogramData(image(), numBin);
+	m_transfer->computeHistogramData(image(), numBin, sampleStep);
+}
+
+void iAModality::setHistogramData(QSharedPointer<iAHistogramData> histogramData, iAImageInfo const & info)
+{
+	m_transfer->setHistogramData(histogramData, info);
 }
 
 void iAModality::computeImageStatistics()
@@ -321,12 +327,24 @@ iAStatisticsUpdater::iAStatisticsUpdater(int modalityIdx, QSharedPointer<iAModal
 
 void iAHistogramUpdater::run()
 {
-	m_modality->computeHistogramData(m_binCount);
-	emit HistogramReady(m_modalityIdx);
+	auto img = m_modality->image();
+	size_t previewStep = iAHistogramData::previewSampleStep(img);
+	if (previewStep > 1)
+	{
+		iAImageInfo previewInfo;
+		auto previewData = iAHistogramData::create(img, m_binCount, &previewInfo, previewStep);
+		emit HistogramReady(m_modalityIdx, previewData, previewInfo);
+	}
+	iAImageInfo info;
+	auto histogramData = iAHistogramData::create(img, m_binCount, &info);
+	emit HistogramReady(m_modalityIdx, histogramData, info);
 }
 
 iAHistogramUpdater::iAHistogramUpdater(int modalityIdx, QSharedPointer<iAModality> modality, size_t binCount) :
 	m_modalityIdx(modalityIdx),
 	m_modality(modality),
 	m_binCount(binCount)
-{}
+{
+	qRegisterMetaType<QSharedPointer<iAHistogramData>>();
+	qRegisterMetaType<iAImageInfo>();
+}
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "open_iA_Core_export.h"
+#include "iAImageInfo.h"
 #include "iAVolumeSettings.h"
 
 #include <vtkImageData.h>
@@ -34,7 +35,6 @@
 
 class iAHistogramData;
 class iAImageCoordConverter;
-class iAImageInfo;
 class iAModalityTransfer;
 class iAVolumeRenderer;
 
@@ -108,7 +108,9 @@ public:
 	void setStringSettings(QString const & pos, QString const & ori, QString const & tfFile);
 	void setData(vtkSmartPointer<vtkImageData> imgData);
 	void computeImageStatistics();
-	void computeHistogramData(size_t numBin);
+	void computeHistogramData(size_t numBin, size_t sampleStep = 1);
+	//! replace the histogram data (and the image information computed along with it), e.g. by one computed in a separate thread
+	void setHistogramData(QSharedPointer<iAHistogramData> histogramData, iAImageInfo const & info);
 	QSharedPointer<iAHistogramData> const histogramData() const;
 
 	void setVolSettings(const iAVolumeSettings &volSettings);
@@ -171,13 +173,17 @@ public:
 };
 
 
-//! class for updating the histogram of a modality
+//! class for updating the histogram of a modality.
+//! For large images, first a fast preview histogram is computed from a subsample of the image,
+//! and HistogramReady is emitted; then the exact histogram is computed and HistogramReady is emitted again.
+//! The histogram data is not stored in the modality by the updater, since the modality's data might be
+//! accessed concurrently in the GUI thread; the receiver of HistogramReady needs to do so (see iAModality::setHistogramData).
 class iAHistogramUpdater : public QThread
 {
 Q_OBJECT
 	void run() override;
 signals:
-	void HistogramReady(int modalityIdx);
+	void HistogramReady(int modalityIdx, QSharedPointer<iAHistogramData> histogramData, iAImageInfo info);
 private:
 	int m_modalityIdx;
 	QSharedPointer<iAModality> m_modality;
@@ -185,3 +191,6 @@ private:
 public:
 	iAHistogramUpdater(int modalityIdx, QSharedPointer<iAModality> modality, size_t binCount);
 };
+
+Q_DECLARE_METATYPE(QSharedPointer<iAHistogramData>)
+Q_DECLARE_METATYPE(iAImageInfo)
@@ -27,7 +27,9 @@
 #include <cassert>
 
 iAModalityTransfer::iAModalityTransfer(double range[2]):
-	m_statisticsComputed(false)
+	m_statisticsComputed(false),
+	m_histogramComputing(false),
+	m_histogramUpdatePending(false)
 {
 	m_ctf = defaultColorTF(range);
 	m_otf = defaultOpacityTF(range, true);
@@ -48,11 +50,40 @@ void iAModalityTransfer::reset()
 	m_histogramData.clear();
 }
 
-void iAModalityTransfer::computeHistogramData(vtkSmartPointer<vtkImageData> imgData, size_t binCount)
+void iAModalityTransfer::computeHistogramData(vtkSmartPointer<vtkImageData> imgData, size_t binCount, size_t sampleStep)
 {
-	if (imgData->GetNumberOfScalarComponents() != 1 || (m_histogramData && m_histogramData->numBin() == binCount))
+	if (imgData->GetNumberOfScalarComponents() != 1 ||
+		(m_histogramData && m_histogramData->numBin() == binCount && (!m_histogramData->isApproximate() || sampleStep > 1)))
 		return;
-	m_histogramData = iAHistogramData::create(imgData, binCount, &m_imageInfo);
+	iAImageInfo info;
+	m_histogramData = iAHistogramData::create(imgData, binCount, &info, sampleStep);
+	m_imageInfo = info;
+}
+
+void iAModalityTransfer::setHistogramData(QSharedPointer<iAHistogramData> histogramData, iAImageInfo const & info)
+{
+	m_histogramData = histogramData;
+	m_imageInfo = info;
+}
+
+void iAModalityTransfer::setHistogramComputing(bool computing)
+{
+	m_histogramComputing = computing;
+}
+
+bool iAModalityTransfer::histogramComputing() const
+{
+	return m_histogramComputing;
+}
+
+void iAModalityTransfer::setHistogramUpdatePending(bool pending)
+{
+	m_histogramUpdatePending = pending;
+}
+
+bool iAModalityTransfer::histogramUpdatePending() const
+{
+	return m_histogramUpdatePending;
 }
 
 QSharedPointer<iAHistogramData> const iAModalityTransfer::histogramData() const
@@ -46,7 +46,22 @@ public:
 	iAModalityTransfer(double range[2]);
 	QSharedPointer<iAHistogramData> const histogramData() const;
 	void computeStatistics(vtkSmartPointer<vtkImageData> img);
-	void computeHistogramData(vtkSmartPointer<vtkImageData> imgData, size_t binCount);
+	//! Compute the histogram of the given image (if not yet computed with the same bin count).
+	//! @param imgData the image to compute the histogram for
+	//! @param binCount the number of histogram bins
+	//! @param sampleStep only consider every sampleStep-th voxel, for a fast preview (see iAHistogramData::create)
+	void computeHistogramData(vtkSmartPointer<vtkImageData> imgData, size_t binCount, size_t sampleStep = 1);
+	//! Replace the histogram data and the image information computed along with it.
+	void setHistogramData(QSharedPointer<iAHistogramData> histogramData, iAImageInfo const & info);
+	//! Mark whether a histogram is currently computed in the background (see iAHistogramUpdater).
+	void setHistogramComputing(bool computing);
+	//! Whether a histogram is currently computed in the background.
+	bool histogramComputing() const;
+	//! Mark whether the histogram needs to be computed again once the current computation has finished
+	//! (e.g. because the number of bins was changed while it was computing).
+	void setHistogramUpdatePending(bool pending);
+	//! Whether the histogram needs to be computed again once the current computation has finished.
+	bool histogramUpdatePending() const;
 	void reset();
 	bool statisticsComputed() const;
 
@@ -60,4 +75,6 @@ private:
 	vtkSmartPointer<vtkColorTransferFunction> m_ctf;
 	vtkSmartPointer<vtkPiecewiseFunction> m_otf;
 	bool m_statisticsComputed;
+	bool m_histogramComputing;
+	bool m_histogramUpdatePending;
 };
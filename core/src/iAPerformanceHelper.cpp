@@ -24,7 +24,11 @@
 
 #include <QString>
 
+#include <atomic>
+#include <condition_variable>
 #include <iomanip>
+#include <mutex>
+#include <thread>
 
 /*
  * Author:  David Robert Nadeau
@@ -150,6 +154,80 @@ iAPerformanceTimer::DurationType iATimeAdder::elapsed() const
 }
 
 
+// class iAPeakMemoryTracker
+
+class iAPeakMemTrackerImpl
+{
+public:
+	iAPeakMemTrackerImpl(int intervalMS) :
+		m_startRSS(getCurrentRSS()),
+		m_peakRSS(m_startRSS),
+		m_stopped(false),
+		m_thread(&iAPeakMemTrackerImpl::sample, this, intervalMS)
+	{}
+	void sample(int intervalMS)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		do
+		{
+			update();
+		} while (!m_stopCondition.wait_for(lock, std::chrono::milliseconds(intervalMS), [this] { return m_stopped; }));
+	}
+	void update()
+	{
+		size_t curRSS = getCurrentRSS();
+		size_t peakRSS = m_peakRSS;
+		while (curRSS > peakRSS && !m_peakRSS.compare_exchange_weak(peakRSS, curRSS))
+		{}
+	}
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_stopped)
+			{
+				return;
+			}
+			m_stopped = true;
+		}
+		m_stopCondition.notify_all();
+		m_thread.join();
+		update();  // catch peaks since last sample
+	}
+	size_t m_startRSS;                       //!< memory usage at start
+	std::atomic<size_t> m_peakRSS;           //!< maximum memory usage encountered so far
+	bool m_stopped;                          //!< whether tracking was stopped
+	std::mutex m_mutex;                      //!< guards m_stopped
+	std::condition_variable m_stopCondition; //!< signals stopping to the sampling thread
+	std::thread m_thread;                    //!< the thread sampling memory usage; needs to be initialized last!
+};
+
+iAPeakMemoryTracker::iAPeakMemoryTracker(int intervalMS):
+	m_pImpl(new iAPeakMemTrackerImpl(intervalMS))
+{}
+
+iAPeakMemoryTracker::~iAPeakMemoryTracker()
+{
+	m_pImpl->stop();
+	delete m_pImpl;
+}
+
+void iAPeakMemoryTracker::stop()
+{
+	m_pImpl->stop();
+}
+
+size_t iAPeakMemoryTracker::startRSS() const
+{
+	return m_pImpl->m_startRSS;
+}
+
+size_t iAPeakMemoryTracker::peakRSS() const
+{
+	return m_pImpl->m_peakRSS;
+}
+
+
 // class iAPerformanceHelper
 class iAPerfHelperImpl
 {
@@ -129,9 +129,36 @@ private:
 	iAPerformanceHelper m_perfHelper;
 };
 
+class iAPeakMemTrackerImpl;
+
+//! Tracks the peak memory usage (resident set size) of the application during an operation.
+//! Starts sampling the memory usage in a background thread on construction, until stop() is called
+//! (or the tracker is destroyed). Example:
+//! iAPeakMemoryTracker memTracker;
+//! ... operation to measure ...
+//! memTracker.stop();
+//! DEBUG_LOG(QString("Peak memory: %1 MB").arg(memTracker.peakRSS() / 1048576));
+class open_iA_Core_API iAPeakMemoryTracker
+{
+public:
+	//! start tracking
+	//! @param intervalMS the time between two samples, in milliseconds
+	iAPeakMemoryTracker(int intervalMS = 10);
+	//! destructor, stops tracking
+	~iAPeakMemoryTracker();
+	//! stop tracking; the peak memory usage is not updated afterwards
+	void stop();
+	//! the memory usage at the start of tracking, in bytes
+	size_t startRSS() const;
+	//! the peak memory usage since the start of tracking (until stop), in bytes
+	size_t peakRSS() const;
+private:
+	iAPeakMemTrackerImpl* m_pImpl;
+};
+
 //! Helper method for getting the current memory usage
 //! @return the number of bytes currently in use by the application
-size_t getCurrentRSS();
+open_iA_Core_API size_t getCurrentRSS();
 
 //! format the given time in a human-readable format
 //! @param duration the time to format (in seconds)
@@ -31,7 +31,9 @@
 #include "iAFileUtils.h"
 #include "iAModalityList.h"
 #include "iAOIFReader.h"
+#include "iAPerformanceHelper.h"
 #include "iAProgress.h"
+#include "iARawFileMapping.h"
 #include "iAStringHelper.h"
 #include "iAVolumeStack.h"
 #include "iAToolsVTK.h"
@@ -186,6 +188,7 @@ void iAIO::init(QWidget *par)
 	m_fileName = "";
 	m_fileNameArray = vtkStringArray::New();
 	m_ioID = 0;
+	m_mapRawFile = false;
 	loadIOSettings();
 }
 
@@ -408,6 +411,7 @@ void iAIO::writeProject()
 void iAIO::run()
 {
 	qApp->processEvents();
+	iAPeakMemoryTracker memTracker;
 	try
 	{
 		switch (m_ioID)
@@ -518,10 +522,18 @@ void iAIO::run()
 			default:
 				addMsg(tr("Unknown reader type"));
 		}
+		memTracker.stop();
 		if ((m_ioID == MHD_WRITER) || (m_ioID == STL_WRITER) || (m_ioID == TIF_STACK_WRITER)
 			|| (m_ioID == JPG_STACK_WRITER) || (m_ioID == PNG_STACK_WRITER)|| (m_ioID == BMP_STACK_WRITER) || (m_ioID ==DCM_WRITER) )
 			emit done(true);
-		else emit done();
+		else
+		{
+			if (m_ioID != PROJECT_WRITER && m_ioID != VOLUME_STACK_VOLSTACK_WRITER)
+			{
+				printLoadMemoryUsage(memTracker.startRSS(), memTracker.peakRSS());
+			}
+			emit done();
+		}
 	}
 	catch (std::exception & e)
 	{
@@ -1063,9 +1075,7 @@ void iAIO::readVolumeMHDStack()
 		loadMetaImageFile(m_fileName);
 		if (m_volumes)
 		{
-			vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
-			image->DeepCopy(getConnector()->vtkImage());
-			m_volumes->push_back(image);
+			m_volumes->push_back(takeConnectorImage());
 		}
 		if (m_fileNames_volstack)
 			m_fileNames_volstack->push_back(m_fileName);
@@ -1083,10 +1093,8 @@ void iAIO::readVolumeStack()
 	{
 		m_fileName=(m_fileNameArray->GetValue(m));
 		readRawImage();
-		vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
-		image->DeepCopy(getConnector()->vtkImage());
 		if(m_volumes)
-			m_volumes->push_back(image);
+			m_volumes->push_back(takeConnectorImage());
 		if(m_fileNames_volstack)
 			m_fileNames_volstack->push_back(m_fileName);
 		int progress = (m * 100) / m_fileNameArray->GetMaxId();
@@ -1130,17 +1138,77 @@ void iAIO::readRawImage()
 	VTK_TYPED_CALL(read_raw_image_template, m_rawFileParams.m_scalarType, m_rawFileParams, m_fileName, ProgressObserver(), getConnector());
 }
 
+vtkSmartPointer<vtkImageData> iAIO::takeConnectorImage()
+{
+	auto image = getConnector()->releaseVTKImage();
+	if (!image)
+	{	// buffer cannot be handed over (e.g. for images read via VTK), so copy it:
+		image = vtkSmartPointer<vtkImageData>::New();
+		image->DeepCopy(getConnector()->vtkImage());
+	}
+	return image;
+}
+
 void iAIO::postImageReadActions()
 {
+	auto connectorImage = getConnector()->vtkImage(); // keep for pipeline information
+	auto image = takeConnectorImage();
 	getVtkImageData()->ReleaseData();
 	getVtkImageData()->Initialize();
-	getVtkImageData()->DeepCopy(getConnector()->vtkImage());
-	getVtkImageData()->CopyInformationFromPipeline(getConnector()->vtkImage()->GetInformation());
+	getVtkImageData()->ShallowCopy(image);
+	getVtkImageData()->CopyInformationFromPipeline(connectorImage->GetInformation());
 	addMsg(tr("File loaded."));
 }
 
+void iAIO::printLoadMemoryUsage(size_t startRSS, size_t peakRSS)
+{
+	if (peakRSS == 0)
+	{	// memory usage not available on this platform
+		return;
+	}
+	unsigned long long dataSize = 0;  // in KiB
+	if (m_volumes && !m_volumes->empty())
+	{
+		for (auto volume : *m_volumes)
+		{
+			dataSize += volume->GetActualMemorySize();
+		}
+	}
+	else if (getVtkImageData())
+	{
+		dataSize += getVtkImageData()->GetActualMemorySize();
+	}
+	if (getVtkPolyData())
+	{
+		dataSize += getVtkPolyData()->GetActualMemorySize();
+	}
+	const double MiB = 1024.0 * 1024.0;
+	double peakIncrease = (peakRSS - startRSS) / MiB;
+	double dataSizeMiB = dataSize / 1024.0;
+	addMsg(tr("Peak memory usage while loading: %1 MB above the %2 MB in use before; loaded data: %3 MB (ratio %4).")
+		.arg(peakIncrease, 0, 'f', 1)
+		.arg(startRSS / MiB, 0, 'f', 1)
+		.arg(dataSizeMiB, 0, 'f', 1)
+		.arg((dataSizeMiB > 0) ? QString::number(peakIncrease / dataSizeMiB, 'f', 2) : QString("-")));
+}
+
 void iAIO::readImageData()
 {
+	if (m_mapRawFile)
+	{
+		QString errorMsg;
+		auto image = mapRawImage(m_fileName, m_rawFileParams, errorMsg);
+		if (image)
+		{
+			getVtkImageData()->ReleaseData();
+			getVtkImageData()->Initialize();
+			getVtkImageData()->ShallowCopy(image);
+			addMsg(tr("File mapped into memory, data will be loaded on demand."));
+			storeIOSettings();
+			return;
+		}
+		addMsg(tr("Cannot load file on demand (%1), reading it completely.").arg(errorMsg));
+	}
 	readRawImage();
 	postImageReadActions();
 	storeIOSettings();
@@ -1325,8 +1393,16 @@ bool iAIO::setupVolumeStackReader(QString const & f)
 bool iAIO::setupRAWReader( QString const & f )
 {
 	m_fileName = f;
-	dlg_openfile_sizecheck dlg(f, m_parent, "RAW file specs", QStringList(), QVariantList(), m_rawFileParams);
-	return dlg.accepted();
+	// only offered (and remembered) for plain raw files; VGI and PARS files are always read completely:
+	QSettings settings;
+	QStringList additionalLabels = (QStringList() << tr("$Load on demand (memory-mapped)"));
+	QList<QVariant> additionalValues = (QList<QVariant>() << settings.value("IO/rawMapped", false).toBool());
+	dlg_openfile_sizecheck dlg(f, m_parent, "RAW file specs", additionalLabels, additionalValues, m_rawFileParams);
+	if (!dlg.accepted())
+		return false;
+	m_mapRawFile = dlg.inputDlg()->getCheckValue(dlg.fixedParams()) != 0;
+	settings.setValue("IO/rawMapped", m_mapRawFile);
+	return true;
 }
 
 bool iAIO::setupPARSReader( QString const & f )
@@ -1439,6 +1515,8 @@ bool iAIO::setupVGIReader( QString const & f )
 
 void iAIO::writeMetaImage( vtkSmartPointer<vtkImageData> imgToWrite, QString fileName )
 {
+	// the image might be mapped from the very file that is about to be overwritten:
+	materializeImage(imgToWrite);
 	iAConnector con; con.setImage(imgToWrite); con.modified();
 	iAConnector::ITKScalarPixelType itkType = con.itkScalarPixelType();
 	iAConnector::ITKPixelType itkPixelType = con.itkPixelType();
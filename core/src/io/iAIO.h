@@ -113,7 +113,11 @@ private:
 	void writeImageStack( );
 	void writeProject();
 
+	//! Take the image from the connector; without copying if possible (see iAConnector::releaseVTKImage)
+	vtkSmartPointer<vtkImageData> takeConnectorImage();
 	void postImageReadActions();
+	//! Output peak memory usage while loading, together with the size of the loaded data
+	void printLoadMemoryUsage(size_t startRSS, size_t peakRSS);
 	void printSTLFileInfos();
 	void storeIOSettings();
 	void loadIOSettings();
@@ -128,6 +132,7 @@ private:
 	vtkStringArray* m_fileNameArray;
 	bool m_compression;
 	iARawFileParameters m_rawFileParams;
+	bool m_mapRawFile;  //!< whether raw files should be memory-mapped instead of read (see mapRawImage)
 
 	int m_ioID;
 	std::vector<vtkSmartPointer<vtkImageData> > * m_volumes;
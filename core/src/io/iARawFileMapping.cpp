@@ -0,0 +1,324 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iARawFileMapping.h"
+
+#include "iARawFileParameters.h"
+#include "iAToolsVTK.h"    // for mapVTKTypeToSize
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkImageReader.h>  // for VTK_FILE_BYTE_ORDER_... constants
+#include <vtkInformation.h>
+#include <vtkInformationIntegerKey.h>
+#include <vtkPointData.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QSysInfo>
+#include <QTemporaryFile>
+
+#include <map>
+#include <memory>
+
+namespace
+{
+	//! key marking a data array as referencing a memory-mapped file
+	vtkInformationIntegerKey* MappedFileKey()
+	{
+		static vtkInformationIntegerKey* key = vtkInformationIntegerKey::MakeKey("MAPPED_FILE", "iARawFileMapping");
+		return key;
+	}
+
+	QMutex & mappedFilesMutex()
+	{
+		static QMutex mutex;
+		return mutex;
+	}
+
+	//! the files mapped into memory, by the address of their mapped memory
+	std::map<void*, QFile*> & mappedFiles()
+	{
+		static std::map<void*, QFile*> files;
+		return files;
+	}
+
+	//! Free function of the buffer referencing the mapped memory; called by VTK when the buffer is deleted,
+	//! i.e. when neither the array nor any other array sharing its buffer (e.g. through ShallowCopy) uses it.
+	void unmapBuffer(void* data)
+	{
+		QFile* file = nullptr;
+		{
+			QMutexLocker locker(&mappedFilesMutex());
+			auto it = mappedFiles().find(data);
+			if (it == mappedFiles().end())
+			{
+				return;
+			}
+			file = it->second;
+			mappedFiles().erase(it);
+		}
+		delete file;  // also unmaps the memory
+	}
+
+	//! Map the given part of the (opened) file and create a data array referencing the mapped memory.
+	//! The array's buffer takes ownership of the file, it is closed when the buffer is deleted.
+	vtkSmartPointer<vtkDataArray> createMappedArray(std::unique_ptr<QFile> file, qint64 offset,
+		qint64 valueCount, int scalarType, int numComponents, QFileDevice::MemoryMapFlags flags, QString & errorMsg)
+	{
+		qint64 byteSize = valueCount * static_cast<qint64>(mapVTKTypeToSize(scalarType));
+		uchar* data = file->map(offset, byteSize, flags);
+		if (!data)
+		{
+			errorMsg = QString("Could not map file: %1").arg(file->errorString());
+			return nullptr;
+		}
+		vtkSmartPointer<vtkDataArray> scalars;
+		scalars.TakeReference(vtkDataArray::CreateDataArray(scalarType));
+		scalars->SetNumberOfComponents(numComponents);
+		{
+			QMutexLocker locker(&mappedFilesMutex());
+			mappedFiles()[data] = file.release();
+		}
+		scalars->SetVoidArray(data, valueCount, 0);
+		// the memory is "freed" by unmapping the file; tying this to the buffer (instead of the array)
+		// keeps the mapping valid as long as any array shares the buffer:
+		scalars->SetArrayFreeFunction(unmapBuffer);
+		scalars->GetInformation()->Set(MappedFileKey(), 1);
+		return scalars;
+	}
+
+	//! VTK data type corresponding to the given MetaImage element type (0 if unknown)
+	int mapMetaElementTypeToVTK(QString const & elementType)
+	{
+		if (elementType == "MET_CHAR")           return VTK_SIGNED_CHAR;
+		if (elementType == "MET_UCHAR")          return VTK_UNSIGNED_CHAR;
+		if (elementType == "MET_SHORT")          return VTK_SHORT;
+		if (elementType == "MET_USHORT")         return VTK_UNSIGNED_SHORT;
+		if (elementType == "MET_INT")            return VTK_INT;
+		if (elementType == "MET_UINT")           return VTK_UNSIGNED_INT;
+		if (elementType == "MET_LONG_LONG")      return VTK_LONG_LONG;
+		if (elementType == "MET_ULONG_LONG")     return VTK_UNSIGNED_LONG_LONG;
+		if (elementType == "MET_FLOAT")          return VTK_FLOAT;
+		if (elementType == "MET_DOUBLE")         return VTK_DOUBLE;
+		return 0;
+	}
+
+	vtkSmartPointer<vtkImageData> createImage(int const dim[3], double const spacing[3], double const origin[3],
+		vtkSmartPointer<vtkDataArray> scalars)
+	{
+		auto image = vtkSmartPointer<vtkImageData>::New();
+		image->SetDimensions(dim[0], dim[1], dim[2]);
+		image->SetSpacing(spacing[0], spacing[1], spacing[2]);
+		image->SetOrigin(origin[0], origin[1], origin[2]);
+		image->GetPointData()->SetScalars(scalars);
+		return image;
+	}
+}
+
+vtkSmartPointer<vtkImageData> mapRawImage(QString const & fileName,
+	iARawFileParameters const & params, QString & errorMsg)
+{
+	qint64 typeSize = static_cast<qint64>(mapVTKTypeToSize(params.m_scalarType));
+	if (typeSize == 0)
+	{
+		errorMsg = "Unknown data type.";
+		return nullptr;
+	}
+	bool littleEndianFile = (params.m_byteOrder == VTK_FILE_BYTE_ORDER_LITTLE_ENDIAN);
+	if (typeSize > 1 && littleEndianFile != (QSysInfo::ByteOrder == QSysInfo::LittleEndian))
+	{
+		errorMsg = "Byte order of the file differs from the byte order of this machine.";
+		return nullptr;
+	}
+	if (params.m_headersize % typeSize != 0)
+	{
+		errorMsg = "Header size is not a multiple of the data type size.";
+		return nullptr;
+	}
+	qint64 voxelCount = static_cast<qint64>(params.m_size[0]) * params.m_size[1] * params.m_size[2];
+	std::unique_ptr<QFile> file(new QFile(fileName));
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		errorMsg = QString("Could not open file: %1").arg(file->errorString());
+		return nullptr;
+	}
+	if (voxelCount == 0 || file->size() < static_cast<qint64>(params.m_headersize) + voxelCount * typeSize)
+	{
+		errorMsg = "File is smaller than expected from the given parameters.";
+		return nullptr;
+	}
+	auto scalars = createMappedArray(std::move(file), params.m_headersize, voxelCount, params.m_scalarType, 1,
+		QFileDevice::MapPrivateOption, errorMsg);
+	if (!scalars)
+	{
+		return nullptr;
+	}
+	int dim[3] = { static_cast<int>(params.m_size[0]), static_cast<int>(params.m_size[1]), static_cast<int>(params.m_size[2]) };
+	return createImage(dim, params.m_spacing, params.m_origin, scalars);
+}
+
+vtkSmartPointer<vtkImageData> mapMetaImage(QString const & fileName, QString & errorMsg)
+{
+	QFile headerFile(fileName);
+	if (!headerFile.open(QIODevice::ReadOnly))
+	{
+		errorMsg = QString("Could not open file: %1").arg(headerFile.errorString());
+		return nullptr;
+	}
+	QMap<QString, QString> header;
+	while (!headerFile.atEnd() && !header.contains("ElementDataFile"))
+	{
+		QString line = QString::fromLatin1(headerFile.readLine()).trimmed();
+		int eqPos = line.indexOf('=');
+		if (eqPos > 0)
+		{
+			header.insert(line.left(eqPos).trimmed(), line.mid(eqPos + 1).trimmed());
+		}
+	}
+	auto isTrue = [&header](QString const & key)
+	{
+		return header.value(key).compare("True", Qt::CaseInsensitive) == 0;
+	};
+	int nDims = header.value("NDims").toInt();
+	QStringList dimSize = header.value("DimSize").split(' ', QString::SkipEmptyParts);
+	if ((nDims != 2 && nDims != 3) || dimSize.size() != nDims)
+	{
+		errorMsg = "Only 2D and 3D images are supported.";
+		return nullptr;
+	}
+	if (header.value("ElementNumberOfChannels", "1").toInt() != 1)
+	{
+		errorMsg = "Only single-channel images are supported.";
+		return nullptr;
+	}
+	if (isTrue("CompressedData"))
+	{
+		errorMsg = "Compressed data can not be mapped.";
+		return nullptr;
+	}
+	iARawFileParameters params;
+	params.m_scalarType = mapMetaElementTypeToVTK(header.value("ElementType"));
+	params.m_byteOrder = (isTrue("BinaryDataByteOrderMSB") || isTrue("ElementByteOrderMSB")) ?
+		VTK_FILE_BYTE_ORDER_BIG_ENDIAN : VTK_FILE_BYTE_ORDER_LITTLE_ENDIAN;
+	QStringList spacing = header.value("ElementSpacing").split(' ', QString::SkipEmptyParts);
+	QStringList origin = header.value("Offset", header.value("Origin", header.value("Position")))
+		.split(' ', QString::SkipEmptyParts);
+	for (int i = 0; i < nDims; ++i)
+	{
+		params.m_size[i] = dimSize[i].toUInt();
+		params.m_spacing[i] = (i < spacing.size()) ? spacing[i].toDouble() : 1.0;
+		params.m_origin[i] = (i < origin.size()) ? origin[i].toDouble() : 0.0;
+	}
+	QString dataFileName = header.value("ElementDataFile");
+	qint64 headerSize = header.value("HeaderSize", "0").toLongLong();
+	if (dataFileName == "LOCAL")
+	{   // data follows the header in the same file
+		dataFileName = fileName;
+		headerSize = headerFile.pos();
+	}
+	else if (dataFileName.isEmpty() || dataFileName.startsWith("LIST") || dataFileName.contains('%'))
+	{
+		errorMsg = "Only images stored in a single data file can be mapped.";
+		return nullptr;
+	}
+	else
+	{
+		dataFileName = QFileInfo(fileName).absoluteDir().absoluteFilePath(dataFileName);
+	}
+	if (headerSize < 0)
+	{   // header size -1: data is at the end of the file
+		qint64 dataSize = static_cast<qint64>(params.m_size[0]) * params.m_size[1] * params.m_size[2] *
+			static_cast<qint64>(mapVTKTypeToSize(params.m_scalarType));
+		headerSize = QFileInfo(dataFileName).size() - dataSize;
+		if (headerSize < 0)
+		{
+			errorMsg = "File is smaller than expected from the given parameters.";
+			return nullptr;
+		}
+	}
+	params.m_headersize = static_cast<quint64>(headerSize);
+	return mapRawImage(dataFileName, params, errorMsg);
+}
+
+vtkSmartPointer<vtkImageData> createFileBackedImage(int const dim[3], double const spacing[3], double const origin[3],
+	int scalarType, int numComponents, QString const & fileName, QString & errorMsg)
+{
+	qint64 typeSize = static_cast<qint64>(mapVTKTypeToSize(scalarType));
+	qint64 valueCount = static_cast<qint64>(dim[0]) * dim[1] * dim[2] * numComponents;
+	if (typeSize == 0 || valueCount <= 0)
+	{
+		errorMsg = "Unknown data type or invalid size.";
+		return nullptr;
+	}
+	std::unique_ptr<QFile> file;
+	if (fileName.isEmpty())
+	{
+		file.reset(new QTemporaryFile(QDir::tempPath() + "/open_iA_XXXXXX.raw"));
+		if (!static_cast<QTemporaryFile*>(file.get())->open())
+		{
+			errorMsg = QString("Could not create temporary file: %1").arg(file->errorString());
+			return nullptr;
+		}
+	}
+	else
+	{
+		file.reset(new QFile(fileName));
+		if (!file->open(QIODevice::ReadWrite | QIODevice::Truncate))
+		{
+			errorMsg = QString("Could not open file: %1").arg(file->errorString());
+			return nullptr;
+		}
+	}
+	if (!file->resize(valueCount * typeSize))
+	{
+		errorMsg = QString("Could not resize file: %1").arg(file->errorString());
+		return nullptr;
+	}
+	auto scalars = createMappedArray(std::move(file), 0, valueCount, scalarType, numComponents,
+		QFileDevice::NoOptions, errorMsg);
+	return scalars ? createImage(dim, spacing, origin, scalars) : nullptr;
+}
+
+bool isMappedImage(vtkImageData* img)
+{
+	auto scalars = img ? img->GetPointData()->GetScalars() : nullptr;
+	return scalars && scalars->HasInformation() && scalars->GetInformation()->Has(MappedFileKey());
+}
+
+void materializeImage(vtkImageData* img)
+{
+	if (!isMappedImage(img))
+	{
+		return;
+	}
+	auto mappedScalars = img->GetPointData()->GetScalars();
+	vtkSmartPointer<vtkDataArray> scalars;
+	scalars.TakeReference(mappedScalars->NewInstance());
+	scalars->DeepCopy(mappedScalars);
+	scalars->GetInformation()->Remove(MappedFileKey());
+	scalars->SetName(mappedScalars->GetName());
+	img->GetPointData()->SetScalars(scalars);
+}
@@ -0,0 +1,78 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#pragma once
+
+#include "open_iA_Core_export.h"
+
+#include <vtkSmartPointer.h>
+
+class vtkImageData;
+
+class QString;
+
+struct iARawFileParameters;
+
+//! Create an image directly referencing the data of the given raw file, without reading it.
+//! The file is memory-mapped, so the operating system loads the slabs of the volume only when
+//! they are accessed (and may release them again if memory gets short); this way, volumes larger
+//! than the physical memory can be viewed. The mapping is private, i.e. modifications of the image
+//! data are not written back to the file. The file stays mapped as long as the buffer of the scalar
+//! array of the image is in use (also by other arrays sharing it, e.g. through ShallowCopy).
+//! @param fileName the name of the raw file
+//! @param params the parameters (size, data type, header size, ...) of the raw file
+//! @param [out] errorMsg the reason why the file could not be mapped (if it could not)
+//! @return the image referencing the mapped file, or nullptr if the file could not be mapped
+//!     (e.g. if its byte order differs from the one of the current machine, or if the header
+//!     size is not a multiple of the data type size)
+open_iA_Core_API vtkSmartPointer<vtkImageData> mapRawImage(QString const & fileName,
+	iARawFileParameters const & params, QString & errorMsg);
+
+//! Create an image directly referencing the data of the given MetaImage file (.mhd), without reading it
+//! (see mapRawImage). Only uncompressed, single-channel, 2D or 3D images are supported.
+//! @param fileName the name of the MetaImage header file
+//! @param [out] errorMsg the reason why the file could not be mapped (if it could not)
+//! @return the image referencing the mapped data file, or nullptr if it could not be mapped
+open_iA_Core_API vtkSmartPointer<vtkImageData> mapMetaImage(QString const & fileName, QString & errorMsg);
+
+//! Create an image whose data is stored in a file instead of main memory (memory-mapped).
+//! Modifications of the image data are written to the file, so the operating system can release
+//! the memory again if it gets short. The data is stored in native byte order, without header.
+//! @param dim the size of the image (in voxels) along each axis
+//! @param spacing the spacing of the image
+//! @param origin the origin of the image
+//! @param scalarType the (VTK) data type of the image
+//! @param numComponents the number of components per voxel
+//! @param fileName the name of the file to store the data in (overwritten if it exists); if empty,
+//!     a temporary file is used, which is removed as soon as the image data is deleted
+//! @param [out] errorMsg the reason why the image could not be created (if it could not)
+//! @return the image stored in the file, or nullptr if it could not be created
+open_iA_Core_API vtkSmartPointer<vtkImageData> createFileBackedImage(int const dim[3], double const spacing[3],
+	double const origin[3], int scalarType, int numComponents, QString const & fileName, QString & errorMsg);
+
+//! Check whether the data of the given image is memory-mapped from a file (see mapRawImage).
+open_iA_Core_API bool isMappedImage(vtkImageData* img);
+
+//! Load the data of a memory-mapped image fully into memory.
+//! Call this for operations which need to access the whole volume repeatedly, or in random order,
+//! or which might overwrite the mapped file; the GUI filter runner does so for the inputs of filters
+//! which need the whole input (see iAFilter::needsWholeInput), and the MetaImage writer for the image
+//! it writes. Does nothing if the image is not memory-mapped.
+open_iA_Core_API void materializeImage(vtkImageData* img);
@@ -59,6 +59,7 @@
 #include "io/iAFileUtils.h"    // for fileNameOnly
 #include "io/iAIO.h"
 #include "io/iAIOProvider.h"
+#include "io/iARawFileMapping.h"
 #include "mainwindow.h"
 
 #include <vtkCamera.h>
@@ -467,7 +468,14 @@ bool MdiChild::displayResult(QString const& title, vtkImageData* image, vtkPolyD
 	if (image)
 	{
 		m_imageData->ReleaseData();
-		m_imageData->DeepCopy(image);
+		if (isMappedImage(image))
+		{   // share the mapped data instead of loading it completely into memory:
+			m_imageData->ShallowCopy(image);
+		}
+		else
+		{
+			m_imageData->DeepCopy(image);
+		}
 	}
 
 	initView(title);
@@ -691,7 +699,7 @@ void MdiChild::setupStackView(bool active)
 
 	int currentIndexOfVolume = 0;
 
-	m_imageData->DeepCopy(m_volumeStack->volume(currentIndexOfVolume));
+	m_imageData->ShallowCopy(m_volumeStack->volume(currentIndexOfVolume));
 	setupViewInternal(active);
 	for (size_t i = 0; i < m_volumeStack->numberOfVolumes(); ++i)
 	{
@@ -2705,7 +2713,8 @@ void MdiChild::histogramDataAvailable(int modalityIdx)
 {
 	QString modalityName = modality(modalityIdx)->name();
 	m_currentHistogramModality = modalityIdx;
-	addMsg(QString("Displaying histogram for modality %1.").arg(modalityName));
+	bool preview = modality(modalityIdx)->histogramData()->isApproximate();
+	addMsg(QString("Displaying %1histogram for modality %2.").arg(preview ? "preview " : "").arg(modalityName));
 	m_histogram->removePlot(m_histogramPlot);
 	m_histogramPlot = QSharedPointer<iAPlot>(new
 		iABarGraphPlot(modality(modalityIdx)->histogramData(),
@@ -2734,7 +2743,7 @@ void MdiChild::displayHistogram(int modalityIdx)
 	{
 		newBinCount = std::min(newBinCount, static_cast<size_t>(scalarRange[1] - scalarRange[0] + 1));
 	}
-	if (histData && histData->numBin() == newBinCount)
+	if (histData && histData->numBin() == newBinCount && !histData->isApproximate())
 	{
 		if (modalityIdx != m_currentHistogramModality)
 		{
@@ -2742,12 +2751,36 @@ void MdiChild::displayHistogram(int modalityIdx)
 		}
 		return;
 	}
+	auto transfer = modality(modalityIdx)->transfer();
+	if (transfer->histogramComputing())
+	{   // the current computation might use an outdated bin count, so compute again once it has finished:
+		transfer->setHistogramUpdatePending(true);
+		return;
+	}
 
 	addMsg(QString("Computing histogram for modality %1...")
 		.arg(modality(modalityIdx)->name()));
+	transfer->setHistogramComputing(true);
 	auto workerThread = new iAHistogramUpdater(modalityIdx,
 		modality(modalityIdx), newBinCount);
-	connect(workerThread, &iAHistogramUpdater::HistogramReady, this, &MdiChild::histogramDataAvailable);
+	connect(workerThread, &iAHistogramUpdater::HistogramReady, this,
+		[this](int modalityIdx, QSharedPointer<iAHistogramData> histogramData, iAImageInfo info)
+	{   // only store the data here, in the GUI thread, since it is accessed from here as well:
+		modality(modalityIdx)->setHistogramData(histogramData, info);
+		histogramDataAvailable(modalityIdx);
+	});
+	connect(workerThread, &iAHistogramUpdater::finished, this, [this, modalityIdx, transfer]
+	{
+		transfer->setHistogramComputing(false);
+		if (transfer->histogramUpdatePending())
+		{
+			transfer->setHistogramUpdatePending(false);
+			if (modalityIdx < modalities()->size() && modality(modalityIdx)->transfer() == transfer)
+			{
+				displayHistogram(modalityIdx);
+			}
+		}
+	});
 	connect(workerThread, &iAHistogramUpdater::finished, workerThread, &QObject::deleteLater);
 	workerThread->start();
 }
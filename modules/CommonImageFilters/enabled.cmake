@@ -5,4 +5,18 @@ IF (openiA_TESTING_ENABLED)
 
 	ADD_TEST(NAME CMD_Invert COMMAND ${TEST_CMD_Binary} -r "Invert" -i ${TEST_DATA_DIR}/test2x2x2.mhd -o ${CMAKE_BINARY_DIR}/Testing/Temporary/test_invert.mhd -p true 1 -q -f)
 	# TODO: check output?
+
+	get_filename_component(CoreSrcDir "../core/src" REALPATH BASE_DIR "${CMAKE_CURRENT_SOURCE_DIR}")
+	get_filename_component(CoreBinDir "../core" REALPATH BASE_DIR "${CMAKE_CURRENT_BINARY_DIR}")
+	ADD_EXECUTABLE(BrickedExecutionTest CommonImageFilters/iABrickedExecutionTest.cpp CommonImageFilters/iAGradients.cpp CommonImageFilters/iAMorphologyFilters.cpp)
+	TARGET_LINK_LIBRARIES(BrickedExecutionTest PRIVATE ${CORE_LIBRARY_NAME})
+	TARGET_INCLUDE_DIRECTORIES(BrickedExecutionTest PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/CommonImageFilters ${CoreSrcDir} ${CoreBinDir})
+	ADD_TEST(NAME BrickedExecutionTest COMMAND BrickedExecutionTest)
+	IF (MSVC)
+		STRING(REGEX REPLACE "/" "\\\\" QT_WIN_DLL_DIR ${QT_LIB_DIR})
+		SET_TESTS_PROPERTIES(BrickedExecutionTest PROPERTIES ENVIRONMENT "PATH=${QT_WIN_DLL_DIR};$ENV{PATH}")
+	ENDIF()
+	IF (openiA_USE_IDE_FOLDERS)
+		SET_PROPERTY(TARGET BrickedExecutionTest PROPERTY FOLDER "Tests")
+	ENDIF()
 ENDIF()
@@ -0,0 +1,218 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iAGradients.h"
+#include "iAMorphologyFilters.h"
+
+#include <iAConnector.h>
+#include <iAFilterRegistry.h>
+#include <io/iARawFileMapping.h>
+
+#include <vtkImageData.h>
+
+#include <QFile>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <cstring>
+#include <iostream>
+#include <random>
+
+// Checks that bricked execution (see iAFilter::setBrickSize) of the filters declaring a halo size
+// produces output which is bit-identical to running the filter on the whole image, both for an input
+// in memory and for the same input memory-mapped from a MetaImage file (see mapMetaImage). The image
+// size is chosen such that it is not a multiple of the brick size, so bricks at the border are smaller.
+
+namespace
+{
+	const int ImageDim[3] = { 45, 38, 29 };
+	const int BrickSize = 16;
+
+	vtkSmartPointer<vtkImageData> createTestImage()
+	{
+		auto img = vtkSmartPointer<vtkImageData>::New();
+		img->SetDimensions(ImageDim[0], ImageDim[1], ImageDim[2]);
+		img->SetSpacing(0.5, 1.0, 2.0);
+		img->SetOrigin(1.0, 2.0, 3.0);
+		img->AllocateScalars(VTK_SHORT, 1);
+		// random blobs on top of a gradient, so that there is structure at all scales:
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<int> noise(-50, 50);
+		auto data = static_cast<short*>(img->GetScalarPointer());
+		for (int z = 0; z < ImageDim[2]; ++z)
+		{
+			for (int y = 0; y < ImageDim[1]; ++y)
+			{
+				for (int x = 0; x < ImageDim[0]; ++x)
+				{
+					*data++ = static_cast<short>(10 * x + 5 * y - 3 * z + ((x / 3 + y / 4 + z / 2) % 2) * 200 + noise(rng));
+				}
+			}
+		}
+		return img;
+	}
+
+	//! Write the given image as MetaImage (header and separate raw data file) and map it into memory.
+	vtkSmartPointer<vtkImageData> writeAndMapImage(vtkSmartPointer<vtkImageData> img, QString const & dir)
+	{
+		QFile rawFile(dir + "/input.raw");
+		if (!rawFile.open(QIODevice::WriteOnly))
+		{
+			return nullptr;
+		}
+		qint64 byteCount = static_cast<qint64>(ImageDim[0]) * ImageDim[1] * ImageDim[2] * img->GetScalarSize();
+		rawFile.write(static_cast<char const *>(img->GetScalarPointer()), byteCount);
+		rawFile.close();
+		QFile headerFile(dir + "/input.mhd");
+		if (!headerFile.open(QIODevice::WriteOnly | QIODevice::Text))
+		{
+			return nullptr;
+		}
+		QTextStream header(&headerFile);
+		header << "ObjectType = Image\n"
+			<< "NDims = 3\n"
+			<< "BinaryData = True\n"
+			<< "BinaryDataByteOrderMSB = " << (QSysInfo::ByteOrder == QSysInfo::BigEndian ? "True" : "False") << "\n"
+			<< "CompressedData = False\n"
+			<< "Offset = " << img->GetOrigin()[0] << " " << img->GetOrigin()[1] << " " << img->GetOrigin()[2] << "\n"
+			<< "ElementSpacing = " << img->GetSpacing()[0] << " " << img->GetSpacing()[1] << " " << img->GetSpacing()[2] << "\n"
+			<< "DimSize = " << ImageDim[0] << " " << ImageDim[1] << " " << ImageDim[2] << "\n"
+			<< "ElementType = MET_SHORT\n"
+			<< "ElementDataFile = input.raw\n";
+		header.flush();
+		headerFile.close();
+		QString errorMsg;
+		auto mapped = mapMetaImage(dir + "/input.mhd", errorMsg);
+		if (!mapped)
+		{
+			std::cout << "Could not map test image: " << errorMsg.toStdString() << std::endl;
+		}
+		return mapped;
+	}
+
+	bool runFilter(QString const & filterName, QMap<QString, QVariant> const & parameters,
+		vtkSmartPointer<vtkImageData> input, int brickSize, vtkSmartPointer<vtkImageData> & output)
+	{
+		auto filter = iAFilterRegistry::filter(filterName);
+		iAConnector con;
+		con.setImage(input);
+		con.modified();
+		filter->addInput(&con);
+		filter->setBrickSize(brickSize);
+		if (!filter->run(parameters) || filter->output().size() != 1)
+		{
+			std::cout << "    Running filter failed!" << std::endl;
+			return false;
+		}
+		output = vtkSmartPointer<vtkImageData>::New();
+		output->DeepCopy(filter->output()[0]->vtkImage());
+		// bricked outputs are assembled in file-backed images, unbricked ones are not:
+		if (isMappedImage(filter->output()[0]->vtkImage().GetPointer()) != (brickSize > 0))
+		{
+			std::cout << "    Filter was " << (brickSize > 0 ? "not " : "") << "run bricked!" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool compareImages(vtkSmartPointer<vtkImageData> whole, vtkSmartPointer<vtkImageData> bricked)
+	{
+		int wholeDim[3], brickedDim[3];
+		whole->GetDimensions(wholeDim);
+		bricked->GetDimensions(brickedDim);
+		for (int i = 0; i < 3; ++i)
+		{
+			if (wholeDim[i] != brickedDim[i] || whole->GetSpacing()[i] != bricked->GetSpacing()[i] ||
+				whole->GetOrigin()[i] != bricked->GetOrigin()[i])
+			{
+				std::cout << "    Geometry of bricked output differs!" << std::endl;
+				return false;
+			}
+		}
+		if (whole->GetScalarType() != bricked->GetScalarType() ||
+			whole->GetNumberOfScalarComponents() != bricked->GetNumberOfScalarComponents())
+		{
+			std::cout << "    Data type of bricked output differs!" << std::endl;
+			return false;
+		}
+		size_t voxelBytes = static_cast<size_t>(whole->GetScalarSize()) * whole->GetNumberOfScalarComponents();
+		size_t voxelCount = static_cast<size_t>(wholeDim[0]) * wholeDim[1] * wholeDim[2];
+		auto wholeData = static_cast<char const *>(whole->GetScalarPointer());
+		auto brickedData = static_cast<char const *>(bricked->GetScalarPointer());
+		size_t differing = 0;
+		for (size_t v = 0; v < voxelCount; ++v)
+		{
+			if (std::memcmp(wholeData + v * voxelBytes, brickedData + v * voxelBytes, voxelBytes) != 0)
+			{
+				++differing;
+			}
+		}
+		std::cout << "    " << differing << " of " << voxelCount << " voxels differ." << std::endl;
+		return differing == 0;
+	}
+
+	bool compareBrickedToWhole(QString const & filterName, QMap<QString, QVariant> const & parameters,
+		vtkSmartPointer<vtkImageData> input, vtkSmartPointer<vtkImageData> mappedInput)
+	{
+		std::cout << filterName.toStdString() << ":" << std::endl;
+		vtkSmartPointer<vtkImageData> whole, bricked, brickedMapped;
+		if (!runFilter(filterName, parameters, input, 0, whole) ||
+			!runFilter(filterName, parameters, input, BrickSize, bricked) ||
+			!runFilter(filterName, parameters, mappedInput, BrickSize, brickedMapped))
+		{
+			return false;
+		}
+		std::cout << "  in-memory input:" << std::endl;
+		bool result = compareImages(whole, bricked);
+		std::cout << "  memory-mapped input:" << std::endl;
+		return compareImages(whole, brickedMapped) && result;
+	}
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	REGISTER_FILTER(iADilation);
+	REGISTER_FILTER(iAMorphClosing);
+	REGISTER_FILTER(iAGradientMagnitude);
+
+	auto input = createTestImage();
+	QTemporaryDir tempDir;
+	auto mappedInput = tempDir.isValid() ? writeAndMapImage(input, tempDir.path()) : nullptr;
+	if (!mappedInput)
+	{
+		std::cout << "Could not create memory-mapped test image!" << std::endl << "Overall: FAILED" << std::endl;
+		return 1;
+	}
+	bool success = true;
+	QMap<QString, QVariant> dilationParams;
+	dilationParams["Radius"] = 2;
+	dilationParams["Structuring Element"] = "Ball";
+	success = compareBrickedToWhole("Dilation", dilationParams, input, mappedInput) && success;
+	QMap<QString, QVariant> closingParams;
+	closingParams["Radius"] = 1;
+	closingParams["Structuring Element"] = "Box";
+	success = compareBrickedToWhole("Closing", closingParams, input, mappedInput) && success;
+	QMap<QString, QVariant> gradientParams;
+	gradientParams["Use Image Spacing"] = true;
+	success = compareBrickedToWhole("Gradient Magnitude", gradientParams, input, mappedInput) && success;
+	std::cout << "Overall: " << (success ? "PASSED" : "FAILED") << std::endl;
+	return success ? 0 : 1;
+}
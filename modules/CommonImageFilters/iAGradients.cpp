@@ -57,6 +57,11 @@ void iAGradientMagnitude::performWork(QMap<QString, QVariant> const & parameters
 
 IAFILTER_CREATE(iAGradientMagnitude)
 
+int iAGradientMagnitude::haloSize(QMap<QString, QVariant> const & /*parameters*/) const
+{
+	return 1;
+}
+
 iAGradientMagnitude::iAGradientMagnitude() :
 	iAFilter("Gradient Magnitude", "Gradients",
 		"Computes the gradient magnitude at each image element.<br/>"
@@ -23,7 +23,7 @@
 #include <iAFilter.h>
 
 IAFILTER_DEFAULT_CLASS(iADerivative);
-IAFILTER_DEFAULT_CLASS(iAGradientMagnitude);
+IAFILTER_DEFAULT_CLASS_WITH_HALO(iAGradientMagnitude);
 IAFILTER_DEFAULT_CLASS(iAGradientMagnitudeRecursiveGaussian);
 #ifdef ITKHigherOrderGradient
 IAFILTER_DEFAULT_CLASS(iAHigherOrderAccurateDerivative);
@@ -102,6 +102,11 @@ void iADilation::performWork(QMap<QString, QVariant> const & parameters)
 
 IAFILTER_CREATE(iADilation)
 
+int iADilation::haloSize(QMap<QString, QVariant> const & parameters) const
+{
+	return parameters["Radius"].toInt();
+}
+
 iADilation::iADilation() :
 	iAFilter("Dilation", "Morphology",
 		"Dilate an image using grayscale morphology.<br/>"
@@ -135,6 +140,11 @@ void iAErosion::performWork(QMap<QString, QVariant> const & parameters)
 
 IAFILTER_CREATE(iAErosion)
 
+int iAErosion::haloSize(QMap<QString, QVariant> const & parameters) const
+{
+	return parameters["Radius"].toInt();
+}
+
 iAErosion::iAErosion() :
 	iAFilter("Erosion", "Morphology",
 		"Erodes an image using grayscale morphology.<br/>"
@@ -168,6 +178,11 @@ void iAMorphOpening::performWork(QMap<QString, QVariant> const & parameters)
 
 IAFILTER_CREATE(iAMorphOpening)
 
+int iAMorphOpening::haloSize(QMap<QString, QVariant> const & parameters) const
+{
+	return 2 * parameters["Radius"].toInt();  // erosion and dilation in sequence
+}
+
 iAMorphOpening::iAMorphOpening():
 	iAFilter("Opening", "Morphology",
 		"The morphological opening of an image 'f' is defined as: Opening(f) = Dilatation(Erosion(f)).<br/>"
@@ -201,6 +216,11 @@ void iAMorphClosing::performWork(QMap<QString, QVariant> const & parameters)
 
 IAFILTER_CREATE(iAMorphClosing)
 
+int iAMorphClosing::haloSize(QMap<QString, QVariant> const & parameters) const
+{
+	return 2 * parameters["Radius"].toInt();  // erosion and dilation in sequence
+}
+
 iAMorphClosing::iAMorphClosing() :
 	iAFilter("Closing", "Morphology",
 		"The morphological closing of an image 'f' is defined as: Closing(f) = Erosion(Dilation(f)).<br/>"
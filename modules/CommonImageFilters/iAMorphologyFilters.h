@@ -22,10 +22,10 @@
 
 #include <iAFilter.h>
 
-IAFILTER_DEFAULT_CLASS(iADilation);
-IAFILTER_DEFAULT_CLASS(iAErosion);
-IAFILTER_DEFAULT_CLASS(iAMorphOpening);
-IAFILTER_DEFAULT_CLASS(iAMorphClosing);
+IAFILTER_DEFAULT_CLASS_WITH_HALO(iADilation);
+IAFILTER_DEFAULT_CLASS_WITH_HALO(iAErosion);
+IAFILTER_DEFAULT_CLASS_WITH_HALO(iAMorphOpening);
+IAFILTER_DEFAULT_CLASS_WITH_HALO(iAMorphClosing);
 IAFILTER_DEFAULT_CLASS(iAOpeningByReconstruction);
 IAFILTER_DEFAULT_CLASS(iAClosingByReconstruction);
 
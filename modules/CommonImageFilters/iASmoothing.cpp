@@ -48,6 +48,7 @@
 #endif
 #endif
 
+#include <algorithm>
 
 typedef float RealType;
 typedef itk::Image<RealType, DIM> RealImageType;
@@ -79,6 +80,11 @@ void iAMedianFilter::performWork(QMap<QString, QVariant> const & parameters)
 
 IAFILTER_CREATE(iAMedianFilter)
 
+int iAMedianFilter::haloSize(QMap<QString, QVariant> const & parameters) const
+{
+	return std::max({ parameters["Kernel radius X"].toInt(), parameters["Kernel radius Y"].toInt(), parameters["Kernel radius Z"].toInt() });
+}
+
 iAMedianFilter::iAMedianFilter() :
 	iAFilter("Median Filter", "Smoothing/Blurring",
 		"Applies a median filter to the volume.<br/>"
@@ -34,7 +34,7 @@
 // Blurring
 IAFILTER_DEFAULT_CLASS(iADiscreteGaussian);
 IAFILTER_DEFAULT_CLASS(iARecursiveGaussian);
-IAFILTER_DEFAULT_CLASS(iAMedianFilter);
+IAFILTER_DEFAULT_CLASS_WITH_HALO(iAMedianFilter);
 IAFILTER_DEFAULT_CLASS(iANonLocalMeans);
 
 // Edge-Preserving
@@ -829,9 +829,13 @@ void iADreamCaster::RenderViewsSlot()
 		ui.l_ttime->setText(QString(t2));
 		ui.simulationProgress->setValue(100);
 	}
-	else if(ui.cudaEnabled->isChecked())//using GPU
+	else// render batches of views, either on GPU or concurrently on CPU
 	{
-		SetupGPUBuffers();
+		bool useGPU = ui.cudaEnabled->isChecked();
+		if (useGPU)
+		{
+			SetupGPUBuffers();
+		}
 		int counter = 0;
 		unsigned int batch_counter=0;
 		//batch parameters for every render
@@ -919,11 +923,18 @@ void iADreamCaster::RenderViewsSlot()
 				localTime.start();//int fstart = GetTickCount();
 				try
 				{
-					tracer->RenderBatchGPU(batch_counter, s1_o, corners, dxs, dys, rotsX, rotsY, rotsZ, true, ui.cb_dipAsColor->isChecked());
+					if (useGPU)
+					{
+						tracer->RenderBatchGPU(batch_counter, s1_o, corners, dxs, dys, rotsX, rotsY, rotsZ, true, ui.cb_dipAsColor->isChecked());
+					}
+					else
+					{
+						tracer->RenderBatchCPU(batch_counter, s1_o, corners, dxs, dys, rotsX, rotsY, rotsZ, true, ui.cb_dipAsColor->isChecked());
+					}
 				}
 				catch( itk::ExceptionObject &excep)
 				{
-					log(tr("RenderBatchGPU terminated unexpectedly."));
+					log(tr("Batch rendering terminated unexpectedly."));
 					log(tr("  %1 in File %2, Line %3").arg(excep.GetDescription())
 						.arg(excep.GetFile())
 						.arg(excep.GetLine()));
@@ -1021,171 +1032,6 @@ void iADreamCaster::RenderViewsSlot()
 		Time2Char(totalTime, t2);
 		ui.simulationProgress->setValue(100);
 		ui.l_ttime->setText(t2);
-	}//GPU
-	else//using CPU
-	{
-		iAVec3f o; // rays' origin point
-		iAVec3f vp_corners[2];// plane's corners in 3d
-		iAVec3f vp_delta[2];// plane's x and y axes' directions in 3D
-		int counter = 0;
-		for (int x=0; x< renderCntX; x++)
-		{
-			for (int z=0; z< renderCntZ; z++)
-			{
-				placementsParams[x][z]= iAparameters_t();
-				for (int y=0; y< renderCntY; y++)
-				{
-					if (isStopped)
-					{
-						return;
-					}
-					actor->SetOrientation(0,0,0);
-					actor->RotateWXYZ( vtkMath::DegreesFromRadians(minValX) + vtkMath::DegreesFromRadians(deltaX)*x	,1,0,0 );//degrees
-					actor->RotateWXYZ(                    vtkMath::DegreesFromRadians(deltaY)*y	,0,1,0 );
-					actor->RotateZ   ( vtkMath::DegreesFromRadians(minValZ) + vtkMath::DegreesFromRadians(deltaZ)*z);
-					actor->SetPosition(set_pos[0], set_pos[1], set_pos[2]);
-					cutAABActor->SetOrientation(0,0,0);
-					cutAABActor->RotateWXYZ( vtkMath::DegreesFromRadians(minValX) + vtkMath::DegreesFromRadians(deltaX)*x	,1,0,0 );//degrees
-					cutAABActor->RotateWXYZ(                    vtkMath::DegreesFromRadians(deltaY)*y	,0,1,0 );
-					cutAABActor->RotateZ   ( vtkMath::DegreesFromRadians(minValZ) + vtkMath::DegreesFromRadians(deltaZ)*z);
-					cutAABActor->SetPosition(set_pos[0], set_pos[1], set_pos[2]);
-					float rx = minValX + deltaX*x;
-					float ry =         + deltaY*y;
-					float rz = minValZ + deltaZ*z;
-					tracer->setRotations(rx, ry, rz);
-					rotations[x][y][z] = iArotation_t(rx/M_PI, ry/M_PI, rz/M_PI);
-					InitRender(vp_corners, vp_delta, &o);
-					if(ui.cb_RadonSA->currentIndex() == 1 && y == 0)
-					{
-						placementsParams[x][z].badAreaPercentage = RandonSpaceAnalysis();
-					}
-					QElapsedTimer localTime;
-					localTime.start();//int fstart = GetTickCount();
-					//while (!tracer->Render()) UpdateSlot();
-					Render(vp_corners, vp_delta, &o, true);
-					int ftime = localTime.elapsed();// GetTickCount() - fstart;
-					char t[] = "00:00.000";
-					Time2Char(ftime, t);
-					ui.TimeLabel->setText(t);
-					totalTime = totalQTime.elapsed();//GetTickCount() - totalStart;
-					char t2[] = "00:00.000";
-					Time2Char(totalTime, t2);
-					double percentage = ((double)counter)/totalRends*100;
-					ui.simulationProgress->setValue((int)percentage);
-					ui.l_ttime->setText( QString(t2) + "  "+QString::number(percentage)+"%");
-					//remember bad area percentage
-					tracer->curRender.badAreaPercentage = placementsParams[x][z].badAreaPercentage;
-					//write data to file
-					tracer->curRender.write2BinaryFile(fptr, ui.cb_saveAdditionalData->isChecked());
-					//
-					/*float cur_param;// = tracer->curRender.m_avPenetrLen;
-					switch(paramIndex)
-					{
-					case 0:
-						cur_param = tracer->curRender.m_avPenetrLen;
-						break;
-					case 1:
-						cur_param = tracer->curRender.m_avDipAngle;
-						break;
-					case 2:
-						cur_param = tracer->curRender.m_maxPenetrLen;
-						break;
-					default:
-						break;
-					}
-					plotData[x][y][z] = cur_param;*/
-
-					rotationsParams[x][y][z].avPenLen = tracer->curRender.avPenetrLen;
-					rotationsParams[x][y][z].avDipAng = tracer->curRender.avDipAngle;
-					rotationsParams[x][y][z].maxPenLen = tracer->curRender.maxPenetrLen;
-
-					/*switch(paramIndex)
-					{
-					case 0:
-						plotColumnData[x][z] += cur_param;
-						break;
-					case 1:
-						plotColumnData[x][z] += cur_param;
-						break;
-					case 2:
-						if(cur_param > plotColumnData[x][z])
-							plotColumnData[x][z] = cur_param;
-						break;
-					}*/
-					placementsParams[x][z].avPenLen += rotationsParams[x][y][z].avPenLen;
-					placementsParams[x][z].avDipAng += rotationsParams[x][y][z].avDipAng;
-					if (rotationsParams[x][y][z].maxPenLen > placementsParams[x][z].maxPenLen)
-					{
-						placementsParams[x][z].maxPenLen = rotationsParams[x][y][z].maxPenLen;
-					}
-
-					curRend++;
-					counter++;
-				}
-
-				/*switch(paramIndex)
-				{
-				case 0:
-					plotColumnData[x][z] /= cntY;
-					break;
-				case 1:
-					plotColumnData[x][z] /= cntY;
-					break;
-				case 2:
-					;
-					break;
-				}*/
-				placementsParams[x][z].avPenLen /= renderCntY;
-				placementsParams[x][z].avDipAng /= renderCntY;
-				//if(plotColumnData[x][z] > max_param)
-				//	max_param =  plotColumnData[x][z];
-				//if(plotColumnData[x][z] < min_param)
-				//	min_param =  plotColumnData[x][z];
-				//float avlen = 0.5f*cur_param/SCALE_COEF;
-				float cur_param = 0.0f;
-				switch(paramIndex)
-				{
-				case 0://av. penetratoin length
-					cur_param=stngs.COLORING_COEF*placementsParams[x][z].avPenLen;
-					break;
-				case 1://dip angle cos
-					cur_param = (1-placementsParams[x][z].avDipAng);
-					break;
-				case 2://max penetratoin length
-					cur_param=stngs.COLORING_COEF*placementsParams[x][z].maxPenLen;
-					break;
-				case 3://bad area percentage
-					cur_param=stngs.COLORING_COEF*placementsParams[x][z].badAreaPercentage;
-					break;
-				default:
-					break;
-				}
-				if (cur_param > 1.f)
-				{
-					cur_param = 1.f;
-				}
-				//Pixel lencol = (lenval << 16) + (0 << 8) + (255-lenval);
-				unsigned int lencol = ((unsigned int)(stngs.COL_RANGE_MIN_R+stngs.COL_RANGE_DR*cur_param) << 16) +
-					((unsigned int)(stngs.COL_RANGE_MIN_G+stngs.COL_RANGE_DG*cur_param) << 8) +
-					(unsigned int)(stngs.COL_RANGE_MIN_B+stngs.COL_RANGE_DB*cur_param);
-				viewsBuffer[x + z*renderCntX] = lencol;
-				UpdateSlot();
-				RenderFrame->repaint();
-				stabilityView->repaint();
-				app->processEvents();
-				///plot->loadFromData(plotData, renderCntX, renderCntY, 0,1,0,1);
-				//if(max_param==0)
-				//	max_param=1;
-				///plot->setScale(1.,1., 1./max_param);
-				///plot->updateData();
-				///plot->updateGL();
-			}
-		}
-		totalTime = totalQTime.elapsed();//GetTickCount() - totalStart;
-		char t2[] = "00:00.000";
-		Time2Char(totalTime, t2);
-		ui.simulationProgress->setValue(100);
-		ui.l_ttime->setText( QString(t2));
 	}
 	tracer->SetCutAABBList(0);
 	datasetOpened = true;
@@ -2453,36 +2299,34 @@ void iADreamCaster::ConfigureSettingsSlot()
 void iADreamCaster::SaveSettingsSlot()
 {
 	QSettings s;
-	s.setValue( "DreamCaster/THREAD_GRID_X", settingsUi.tableWidget->item(0, 0)->text().toInt());
-	s.setValue( "DreamCaster/THREAD_GRID_Y", settingsUi.tableWidget->item(1, 0)->text().toInt());
-	s.setValue( "DreamCaster/SCALE_COEF",    settingsUi.tableWidget->item(2, 0)->text().toFloat());
-	s.setValue( "DreamCaster/COLORING_COEF", settingsUi.tableWidget->item(3, 0)->text().toFloat());
-	s.setValue( "DreamCaster/RFRAME_W",      settingsUi.tableWidget->item(4, 0)->text().toInt());
-	s.setValue( "DreamCaster/RFRAME_H",      settingsUi.tableWidget->item(5, 0)->text().toInt());
-	s.setValue( "DreamCaster/VFRAME_W",      settingsUi.tableWidget->item(6, 0)->text().toInt());
-	s.setValue( "DreamCaster/VFRAME_H",      settingsUi.tableWidget->item(7, 0)->text().toInt());
-	s.setValue( "DreamCaster/ORIGIN_Z",      settingsUi.tableWidget->item(8, 0)->text().toFloat());
-	s.setValue( "DreamCaster/PLANE_Z",       settingsUi.tableWidget->item(9, 0)->text().toFloat());
-	s.setValue( "DreamCaster/PLANE_H_W",     settingsUi.tableWidget->item(10, 0)->text().toFloat());
-	s.setValue( "DreamCaster/PLANE_H_H",     settingsUi.tableWidget->item(11, 0)->text().toFloat());
-	s.setValue( "DreamCaster/TREE_L1",       settingsUi.tableWidget->item(12, 0)->text().toInt());
-	s.setValue( "DreamCaster/TREE_L2",       settingsUi.tableWidget->item(13, 0)->text().toInt());
-	s.setValue( "DreamCaster/TREE_L3",       settingsUi.tableWidget->item(14, 0)->text().toInt());
-	s.setValue( "DreamCaster/TREE_SPLIT1",   settingsUi.tableWidget->item(15, 0)->text().toInt());
-	s.setValue( "DreamCaster/TREE_SPLIT2",   settingsUi.tableWidget->item(16, 0)->text().toInt());
-	s.setValue( "DreamCaster/BG_COL_R",      settingsUi.tableWidget->item(17, 0)->text().toInt());
-	s.setValue( "DreamCaster/BG_COL_G",      settingsUi.tableWidget->item(18, 0)->text().toInt());
-	s.setValue( "DreamCaster/BG_COL_B",      settingsUi.tableWidget->item(19, 0)->text().toInt());
-	s.setValue( "DreamCaster/PLATE_COL_R",   settingsUi.tableWidget->item(20, 0)->text().toInt());
-	s.setValue( "DreamCaster/PLATE_COL_G",   settingsUi.tableWidget->item(21, 0)->text().toInt());
-	s.setValue( "DreamCaster/PLATE_COL_B",   settingsUi.tableWidget->item(22, 0)->text().toInt());
-	s.setValue( "DreamCaster/COL_RANGE_MIN_R", settingsUi.tableWidget->item(23, 0)->text().toInt());
-	s.setValue( "DreamCaster/COL_RANGE_MIN_G", settingsUi.tableWidget->item(24, 0)->text().toInt());
-	s.setValue( "DreamCaster/COL_RANGE_MIN_B", settingsUi.tableWidget->item(25, 0)->text().toInt());
-	s.setValue( "DreamCaster/COL_RANGE_MAX_R", settingsUi.tableWidget->item(26, 0)->text().toInt());
-	s.setValue( "DreamCaster/COL_RANGE_MAX_G", settingsUi.tableWidget->item(27, 0)->text().toInt());
-	s.setValue( "DreamCaster/COL_RANGE_MAX_B", settingsUi.tableWidget->item(28, 0)->text().toInt());
-	s.setValue( "DreamCaster/BATCH_SIZE",      settingsUi.tableWidget->item(29, 0)->text().toInt());
+	s.setValue( "DreamCaster/SCALE_COEF",    settingsUi.tableWidget->item(0, 0)->text().toFloat());
+	s.setValue( "DreamCaster/COLORING_COEF", settingsUi.tableWidget->item(1, 0)->text().toFloat());
+	s.setValue( "DreamCaster/RFRAME_W",      settingsUi.tableWidget->item(2, 0)->text().toInt());
+	s.setValue( "DreamCaster/RFRAME_H",      settingsUi.tableWidget->item(3, 0)->text().toInt());
+	s.setValue( "DreamCaster/VFRAME_W",      settingsUi.tableWidget->item(4, 0)->text().toInt());
+	s.setValue( "DreamCaster/VFRAME_H",      settingsUi.tableWidget->item(5, 0)->text().toInt());
+	s.setValue( "DreamCaster/ORIGIN_Z",      settingsUi.tableWidget->item(6, 0)->text().toFloat());
+	s.setValue( "DreamCaster/PLANE_Z",       settingsUi.tableWidget->item(7, 0)->text().toFloat());
+	s.setValue( "DreamCaster/PLANE_H_W",     settingsUi.tableWidget->item(8, 0)->text().toFloat());
+	s.setValue( "DreamCaster/PLANE_H_H",     settingsUi.tableWidget->item(9, 0)->text().toFloat());
+	s.setValue( "DreamCaster/TREE_L1",       settingsUi.tableWidget->item(10, 0)->text().toInt());
+	s.setValue( "DreamCaster/TREE_L2",       settingsUi.tableWidget->item(11, 0)->text().toInt());
+	s.setValue( "DreamCaster/TREE_L3",       settingsUi.tableWidget->item(12, 0)->text().toInt());
+	s.setValue( "DreamCaster/TREE_SPLIT1",   settingsUi.tableWidget->item(13, 0)->text().toInt());
+	s.setValue( "DreamCaster/TREE_SPLIT2",   settingsUi.tableWidget->item(14, 0)->text().toInt());
+	s.setValue( "DreamCaster/BG_COL_R",      settingsUi.tableWidget->item(15, 0)->text().toInt());
+	s.setValue( "DreamCaster/BG_COL_G",      settingsUi.tableWidget->item(16, 0)->text().toInt());
+	s.setValue( "DreamCaster/BG_COL_B",      settingsUi.tableWidget->item(17, 0)->text().toInt());
+	s.setValue( "DreamCaster/PLATE_COL_R",   settingsUi.tableWidget->item(18, 0)->text().toInt());
+	s.setValue( "DreamCaster/PLATE_COL_G",   settingsUi.tableWidget->item(19, 0)->text().toInt());
+	s.setValue( "DreamCaster/PLATE_COL_B",   settingsUi.tableWidget->item(20, 0)->text().toInt());
+	s.setValue( "DreamCaster/COL_RANGE_MIN_R", settingsUi.tableWidget->item(21, 0)->text().toInt());
+	s.setValue( "DreamCaster/COL_RANGE_MIN_G", settingsUi.tableWidget->item(22, 0)->text().toInt());
+	s.setValue( "DreamCaster/COL_RANGE_MIN_B", settingsUi.tableWidget->item(23, 0)->text().toInt());
+	s.setValue( "DreamCaster/COL_RANGE_MAX_R", settingsUi.tableWidget->item(24, 0)->text().toInt());
+	s.setValue( "DreamCaster/COL_RANGE_MAX_G", settingsUi.tableWidget->item(25, 0)->text().toInt());
+	s.setValue( "DreamCaster/COL_RANGE_MAX_B", settingsUi.tableWidget->item(26, 0)->text().toInt());
+	s.setValue( "DreamCaster/BATCH_SIZE",      settingsUi.tableWidget->item(27, 0)->text().toInt());
 }
 
 void iADreamCaster::ResetSettingsSlot()
@@ -2493,36 +2337,34 @@ void iADreamCaster::ResetSettingsSlot()
 int iADreamCaster::SetupSettingsFromConfigFile()
 {
 	QSettings s;
-	settingsUi.tableWidget->item(0, 0)->setText(QString::number(s.value( "DreamCaster/THREAD_GRID_X", stngs.THREAD_GRID_X).toInt()));
-	settingsUi.tableWidget->item(1, 0)->setText(QString::number(s.value( "DreamCaster/THREAD_GRID_Y", stngs.THREAD_GRID_Y ).toInt()));
-	settingsUi.tableWidget->item(2, 0)->setText(QString::number(s.value( "DreamCaster/SCALE_COEF", stngs.SCALE_COEF ).value<float>()));
-	settingsUi.tableWidget->item(3, 0)->setText(QString::number(s.value( "DreamCaster/COLORING_COEF", stngs.COLORING_COEF ).value<float>()));
-	settingsUi.tableWidget->item(4, 0)->setText(QString::number(s.value( "DreamCaster/RFRAME_W", stngs.RFRAME_W ).toInt()));
-	settingsUi.tableWidget->item(5, 0)->setText(QString::number(s.value( "DreamCaster/RFRAME_H", stngs.RFRAME_H ).toInt()));
-	settingsUi.tableWidget->item(6, 0)->setText(QString::number(s.value( "DreamCaster/VFRAME_W", stngs.VFRAME_W ).toInt()));
-	settingsUi.tableWidget->item(7, 0)->setText(QString::number(s.value( "DreamCaster/VFRAME_H", stngs.VFRAME_H ).toInt()));
-	settingsUi.tableWidget->item(8, 0)->setText(QString::number(s.value( "DreamCaster/ORIGIN_Z", stngs.ORIGIN_Z ).value<float>()));
-	settingsUi.tableWidget->item(9, 0)->setText(QString::number(s.value( "DreamCaster/PLANE_Z", stngs.PLANE_Z ).value<float>()));
-	settingsUi.tableWidget->item(10,0)->setText(QString::number(s.value( "DreamCaster/PLANE_H_W", stngs.PLANE_H_W ).value<float>()));
-	settingsUi.tableWidget->item(11,0)->setText(QString::number(s.value( "DreamCaster/PLANE_H_H", stngs.PLANE_H_H ).value<float>()));
-	settingsUi.tableWidget->item(12,0)->setText(QString::number(s.value( "DreamCaster/TREE_L1", stngs.TREE_L1 ).toInt()));
-	settingsUi.tableWidget->item(13,0)->setText(QString::number(s.value( "DreamCaster/TREE_L2", stngs.TREE_L2 ).toInt()));
-	settingsUi.tableWidget->item(14,0)->setText(QString::number(s.value( "DreamCaster/TREE_L3", stngs.TREE_L3 ).toInt()));
-	settingsUi.tableWidget->item(15,0)->setText(QString::number(s.value( "DreamCaster/TREE_SPLIT1", stngs.TREE_SPLIT1 ).toInt()));
-	settingsUi.tableWidget->item(16,0)->setText(QString::number(s.value( "DreamCaster/TREE_SPLIT2", stngs.TREE_SPLIT2 ).toInt()));
-	settingsUi.tableWidget->item(17,0)->setText(QString::number(s.value( "DreamCaster/BG_COL_R", stngs.BG_COL_R ).toInt()));
-	settingsUi.tableWidget->item(18,0)->setText(QString::number(s.value( "DreamCaster/BG_COL_G", stngs.BG_COL_G ).toInt()));
-	settingsUi.tableWidget->item(19,0)->setText(QString::number(s.value( "DreamCaster/BG_COL_B", stngs.BG_COL_B ).toInt()));
-	settingsUi.tableWidget->item(20,0)->setText(QString::number(s.value( "DreamCaster/PLATE_COL_R", stngs.PLATE_COL_R ).toInt()));
-	settingsUi.tableWidget->item(21,0)->setText(QString::number(s.value( "DreamCaster/PLATE_COL_G", stngs.PLATE_COL_G ).toInt()));
-	settingsUi.tableWidget->item(22,0)->setText(QString::number(s.value( "DreamCaster/PLATE_COL_B", stngs.PLATE_COL_B ).toInt()));
-	settingsUi.tableWidget->item(23,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MIN_R", stngs.COL_RANGE_MIN_R ).toInt()));
-	settingsUi.tableWidget->item(24,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MIN_G", stngs.COL_RANGE_MIN_G ).toInt()));
-	settingsUi.tableWidget->item(25,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MIN_B", stngs.COL_RANGE_MIN_B ).toInt()));
-	settingsUi.tableWidget->item(26,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MAX_R", stngs.COL_RANGE_MAX_R ).toInt()));
-	settingsUi.tableWidget->item(27,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MAX_G", stngs.COL_RANGE_MAX_G ).toInt()));
-	settingsUi.tableWidget->item(28,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MAX_B", stngs.COL_RANGE_MAX_B ).toInt()));
-	settingsUi.tableWidget->item(29,0)->setText(QString::number(s.value( "DreamCaster/BATCH_SIZE", stngs.BATCH_SIZE ).toInt()));
+	settingsUi.tableWidget->item(0, 0)->setText(QString::number(s.value( "DreamCaster/SCALE_COEF", stngs.SCALE_COEF ).value<float>()));
+	settingsUi.tableWidget->item(1, 0)->setText(QString::number(s.value( "DreamCaster/COLORING_COEF", stngs.COLORING_COEF ).value<float>()));
+	settingsUi.tableWidget->item(2, 0)->setText(QString::number(s.value( "DreamCaster/RFRAME_W", stngs.RFRAME_W ).toInt()));
+	settingsUi.tableWidget->item(3, 0)->setText(QString::number(s.value( "DreamCaster/RFRAME_H", stngs.RFRAME_H ).toInt()));
+	settingsUi.tableWidget->item(4, 0)->setText(QString::number(s.value( "DreamCaster/VFRAME_W", stngs.VFRAME_W ).toInt()));
+	settingsUi.tableWidget->item(5, 0)->setText(QString::number(s.value( "DreamCaster/VFRAME_H", stngs.VFRAME_H ).toInt()));
+	settingsUi.tableWidget->item(6, 0)->setText(QString::number(s.value( "DreamCaster/ORIGIN_Z", stngs.ORIGIN_Z ).value<float>()));
+	settingsUi.tableWidget->item(7, 0)->setText(QString::number(s.value( "DreamCaster/PLANE_Z", stngs.PLANE_Z ).value<float>()));
+	settingsUi.tableWidget->item(8, 0)->setText(QString::number(s.value( "DreamCaster/PLANE_H_W", stngs.PLANE_H_W ).value<float>()));
+	settingsUi.tableWidget->item(9, 0)->setText(QString::number(s.value( "DreamCaster/PLANE_H_H", stngs.PLANE_H_H ).value<float>()));
+	settingsUi.tableWidget->item(10,0)->setText(QString::number(s.value( "DreamCaster/TREE_L1", stngs.TREE_L1 ).toInt()));
+	settingsUi.tableWidget->item(11,0)->setText(QString::number(s.value( "DreamCaster/TREE_L2", stngs.TREE_L2 ).toInt()));
+	settingsUi.tableWidget->item(12,0)->setText(QString::number(s.value( "DreamCaster/TREE_L3", stngs.TREE_L3 ).toInt()));
+	settingsUi.tableWidget->item(13,0)->setText(QString::number(s.value( "DreamCaster/TREE_SPLIT1", stngs.TREE_SPLIT1 ).toInt()));
+	settingsUi.tableWidget->item(14,0)->setText(QString::number(s.value( "DreamCaster/TREE_SPLIT2", stngs.TREE_SPLIT2 ).toInt()));
+	settingsUi.tableWidget->item(15,0)->setText(QString::number(s.value( "DreamCaster/BG_COL_R", stngs.BG_COL_R ).toInt()));
+	settingsUi.tableWidget->item(16,0)->setText(QString::number(s.value( "DreamCaster/BG_COL_G", stngs.BG_COL_G ).toInt()));
+	settingsUi.tableWidget->item(17,0)->setText(QString::number(s.value( "DreamCaster/BG_COL_B", stngs.BG_COL_B ).toInt()));
+	settingsUi.tableWidget->item(18,0)->setText(QString::number(s.value( "DreamCaster/PLATE_COL_R", stngs.PLATE_COL_R ).toInt()));
+	settingsUi.tableWidget->item(19,0)->setText(QString::number(s.value( "DreamCaster/PLATE_COL_G", stngs.PLATE_COL_G ).toInt()));
+	settingsUi.tableWidget->item(20,0)->setText(QString::number(s.value( "DreamCaster/PLATE_COL_B", stngs.PLATE_COL_B ).toInt()));
+	settingsUi.tableWidget->item(21,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MIN_R", stngs.COL_RANGE_MIN_R ).toInt()));
+	settingsUi.tableWidget->item(22,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MIN_G", stngs.COL_RANGE_MIN_G ).toInt()));
+	settingsUi.tableWidget->item(23,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MIN_B", stngs.COL_RANGE_MIN_B ).toInt()));
+	settingsUi.tableWidget->item(24,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MAX_R", stngs.COL_RANGE_MAX_R ).toInt()));
+	settingsUi.tableWidget->item(25,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MAX_G", stngs.COL_RANGE_MAX_G ).toInt()));
+	settingsUi.tableWidget->item(26,0)->setText(QString::number(s.value( "DreamCaster/COL_RANGE_MAX_B", stngs.COL_RANGE_MAX_B ).toInt()));
+	settingsUi.tableWidget->item(27,0)->setText(QString::number(s.value( "DreamCaster/BATCH_SIZE", stngs.BATCH_SIZE ).toInt()));
 	return 1;
 }
 
@@ -27,10 +27,16 @@
 
 #include <algorithm>
 #include <cassert>
+#include <limits>
 #include <vector>
 
 extern iADreamCaster * dcast;
 
+//! Number of bins per axis used to find the split plane in the SAH tree construction.
+const int SAHBinCount = 32;
+//! Number of rays traced together by iABSPTree::GetIntersectionsPacket.
+const int RayPacketSize = 4;
+
 //! Class representing a BSP-tree node. AABB specified BSP-tree node.
 class iABSPNode
 {
@@ -87,19 +93,18 @@ public:
 	//! @param m_aabb node's aabb
 	//! @param nodes vector of all tree nodes
 	//! @param tri_ind vector of index-triangle mapping array
-	//! @param parent_tris
-	//! @param tri_start_ind
+	//! @param parent_tris primitives of the current node
 	//! @return 1 if successful
 	int DistributePrims(int &level, int &max_level, iAaabb &m_aabb, std::vector<iABSPNode*> &nodes,
 						std::vector<unsigned int> &tri_ind,
-						std::vector<iATriPrim*> &parent_tris, unsigned int tri_start_ind)
+						std::vector<iATriPrim*> &parent_tris)
 	{
 		unsigned int trisSz = (unsigned int) parent_tris.size();
 		if (level == max_level)
 			setLeaf(true);
 		if(isLeaf())
 		{
-			set_tri_start(tri_start_ind);
+			set_tri_start((unsigned int) tri_ind.size());
 			set_tri_count(trisSz);
 			for (unsigned int i=0; i<trisSz; i++)
 				tri_ind.push_back(parent_tris[i]->GetIndex());
@@ -108,7 +113,7 @@ public:
 		if(trisSz<=dcast->stngs.MIN_TRI_PER_NODE)//if number of primitives in node small, node is leaf
 		{
 			setLeaf(true);
-			set_tri_start(tri_start_ind);
+			set_tri_start((unsigned int) tri_ind.size());
 			set_tri_count(trisSz);
 			for (unsigned int i=0; i<trisSz; i++)
 				tri_ind.push_back(parent_tris[i]->GetIndex());
@@ -122,20 +127,19 @@ public:
 		nodes.push_back(new iABSPNode());
 		set_has_right(true);
 
-		iAVec3f center = m_aabb.center(), h_size = m_aabb.half_size();
-		unsigned int l_tri_start_ind = (unsigned int) tri_ind.size();
+		iAVec3f l_center = l_aabb.center(), l_h_size = l_aabb.half_size();
+		iAVec3f r_center = r_aabb.center(), r_h_size = r_aabb.half_size();
 		std::vector<iATriPrim*> l_tris, r_tris;
 		for (unsigned int i=0; i<trisSz; i++)
 		{
-			if(parent_tris[i]->Intersect( l_aabb, center, h_size))
+			if(parent_tris[i]->Intersect( l_aabb, l_center, l_h_size))
 			{
 				l_tris.push_back(parent_tris[i]);
 			}
 		}
-		unsigned int r_tri_start_ind = (unsigned int) tri_ind.size();
 		for (unsigned int i=0; i<trisSz; i++)
 		{
-			if(parent_tris[i]->Intersect( r_aabb, center, h_size))
+			if(parent_tris[i]->Intersect( r_aabb, r_center, r_h_size))
 			{
 				r_tris.push_back(parent_tris[i]);
 			}
@@ -159,9 +163,9 @@ public:
 			set_offset(offset()-1);
 
 		if(has_left())
-			get_left(nodes)->DistributePrims(nxtLvl, max_level, l_aabb, nodes, tri_ind, /*prims,*/ l_tris, l_tri_start_ind);
+			get_left(nodes)->DistributePrims(nxtLvl, max_level, l_aabb, nodes, tri_ind, /*prims,*/ l_tris);
 		if(has_right())
-			get_right(nodes)->DistributePrims(nxtLvl, max_level, r_aabb, nodes, tri_ind, /*prims,*/ r_tris, r_tri_start_ind);
+			get_right(nodes)->DistributePrims(nxtLvl, max_level, r_aabb, nodes, tri_ind, /*prims,*/ r_tris);
 		return 1;
 	}
 
@@ -192,14 +196,14 @@ public:
 
 	int DistributePrimsSAH(int &level, int &max_level, iAaabb &m_aabb, std::vector<iABSPNode*> &nodes,
 		std::vector<unsigned int> &tri_ind,
-		std::vector<iATriPrim*> &parent_tris, unsigned int tri_start_ind)
+		std::vector<iATriPrim*> &parent_tris)
 	{
 		unsigned int primSz = (unsigned int) parent_tris.size();
 		if (level == max_level)
 			setLeaf(true);
 		if(isLeaf())
 		{
-			set_tri_start(tri_start_ind);
+			set_tri_start((unsigned int) tri_ind.size());
 			set_tri_count(primSz);
 			for (unsigned int i=0; i<primSz; i++)
 				tri_ind.push_back(parent_tris[i]->GetIndex());
@@ -208,46 +212,50 @@ public:
 		if(primSz<=dcast->stngs.MIN_TRI_PER_NODE)//if number of primitives in node small, node is leaf
 		{
 			setLeaf(true);
-			set_tri_start(tri_start_ind);
+			set_tri_start((unsigned int) tri_ind.size());
 			set_tri_count(primSz);
 			for (unsigned int i=0; i<primSz; i++)
 				tri_ind.push_back(parent_tris[i]->GetIndex());
 			return 1;
 		}
-		//SAH bound determining
-		float minCost = 10000000.f, cur_cost;
-		unsigned int axis_ind=0, cur_axis_ind, is_maximum;
+		//SAH bound determining: the extents of the primitives along each axis are sorted into bins;
+		//the bin boundaries are the split candidates, their costs follow from prefix sums over the bins
+		float minCost = std::numeric_limits<float>::max(), cur_cost;
+		unsigned int axis_ind = m_aabb.mainDim(), cur_axis_ind;
 		unsigned int l_counter, r_counter;
-		//unsigned int l_count=0, r_count=0;
-		float bound=0, cur_bound;
+		float bound = m_aabb.center()[axis_ind], cur_bound;
 		iAaabb l_aabb, r_aabb;
-		for (unsigned int i=0; i<primSz; i++)
+		for (cur_axis_ind=0; cur_axis_ind<=2; cur_axis_ind++)
 		{
-			for (cur_axis_ind=0; cur_axis_ind<=2; cur_axis_ind++)
+			float lowerBound = (cur_axis_ind == 0) ? m_aabb.x1 : ((cur_axis_ind == 1) ? m_aabb.y1 : m_aabb.z1);
+			float upperBound = (cur_axis_ind == 0) ? m_aabb.x2 : ((cur_axis_ind == 1) ? m_aabb.y2 : m_aabb.z2);
+			float binWidth = (upperBound - lowerBound) / SAHBinCount;
+			if (!(binWidth > 0))
+				continue;
+			unsigned int startCount[SAHBinCount] = { 0 }, endCount[SAHBinCount] = { 0 };
+			for (unsigned int i=0; i<primSz; i++)
 			{
-				for (is_maximum=0; is_maximum<=1; is_maximum++)
+				int startBin = (int)((parent_tris[i]->getAxisBound(cur_axis_ind, 0) - lowerBound) / binWidth);
+				int endBin = (int)((parent_tris[i]->getAxisBound(cur_axis_ind, 1) - lowerBound) / binWidth);
+				startCount[std::max(0, std::min(startBin, SAHBinCount - 1))]++;
+				endCount[std::max(0, std::min(endBin, SAHBinCount - 1))]++;
+			}
+			// left of the plane at the start of bin b are all primitives starting in a bin before b,
+			// right of it all primitives not ending before b:
+			l_counter = 0;
+			r_counter = primSz;
+			for (int b = 1; b < SAHBinCount; b++)
+			{
+				l_counter += startCount[b - 1];
+				r_counter -= endCount[b - 1];
+				cur_bound = lowerBound + b * binWidth;
+				SplitSAH(m_aabb, l_aabb, r_aabb, cur_axis_ind, cur_bound);
+				cur_cost = 0.5f + l_aabb.surfaceArea()*l_counter + r_aabb.surfaceArea()*r_counter;
+				if(cur_cost < minCost)
 				{
-					l_counter=0; r_counter=0;
-					cur_bound = ((iATriPrim*)parent_tris[i])->getAxisBound(cur_axis_ind, is_maximum);
-					SplitSAH(m_aabb, l_aabb, r_aabb, cur_axis_ind, cur_bound );
-					iAVec3f l_center = l_aabb.center(), l_h_size = l_aabb.half_size();
-					iAVec3f r_center = r_aabb.center(), r_h_size = r_aabb.half_size();
-					for (unsigned int i2=0; i2<primSz; i2++)
-					{
-						if( ((iATriPrim*)parent_tris[i2])->Intersect( l_aabb, l_center, l_h_size))
-							l_counter++;
-						if( ((iATriPrim*)parent_tris[i2])->Intersect( r_aabb, r_center, r_h_size))
-							r_counter++;
-					}
-					cur_cost = 0.5f + l_aabb.surfaceArea()*l_counter + r_aabb.surfaceArea()*r_counter;
-					if(cur_cost < minCost)
-					{
-						minCost = cur_cost;
-						bound = cur_bound;
-						axis_ind = cur_axis_ind;
-						//l_count = l_counter;
-						//r_count = r_counter;
-					}
+					minCost = cur_cost;
+					bound = cur_bound;
+					axis_ind = cur_axis_ind;
 				}
 			}
 		}
@@ -260,24 +268,18 @@ public:
 		nodes.push_back(new iABSPNode());
 		set_has_right(true);
 
-		unsigned int l_tri_start_ind = (unsigned int) tri_ind.size();
-		unsigned int r_tri_start_ind = (unsigned int) tri_ind.size();
-
 		std::vector<iATriPrim*> l_tris, r_tris;
-		int cntr;
-		iAVec3f center = m_aabb.center(), h_size = m_aabb.half_size();
+		iAVec3f l_center = l_aabb.center(), l_h_size = l_aabb.half_size();
+		iAVec3f r_center = r_aabb.center(), r_h_size = r_aabb.half_size();
 		for (unsigned int i=0; i<primSz; i++)
 		{
-			cntr=0;
-			if(parent_tris[i]->Intersect( l_aabb, center, h_size))
+			if(parent_tris[i]->Intersect( l_aabb, l_center, l_h_size))
 			{
 				l_tris.push_back(parent_tris[i]);
-				cntr++;
 			}
-			if(parent_tris[i]->Intersect( r_aabb, center, h_size))
+			if(parent_tris[i]->Intersect( r_aabb, r_center, r_h_size))
 			{
 				r_tris.push_back(parent_tris[i]);
-				cntr++;
 			}
 		}
 		int nxtLvl = level+1;
@@ -299,9 +301,9 @@ public:
 			set_offset(offset()-1);
 
 		if(has_left())
-			get_left(nodes)->DistributePrimsSAH(nxtLvl, max_level, l_aabb, nodes, tri_ind, /*prims,*/ l_tris, l_tri_start_ind);
+			get_left(nodes)->DistributePrimsSAH(nxtLvl, max_level, l_aabb, nodes, tri_ind, /*prims,*/ l_tris);
 		if(has_right())
-			get_right(nodes)->DistributePrimsSAH(nxtLvl, max_level, r_aabb, nodes, tri_ind, /*prims,*/ r_tris, r_tri_start_ind);
+			get_right(nodes)->DistributePrimsSAH(nxtLvl, max_level, r_aabb, nodes, tri_ind, /*prims,*/ r_tris);
 		return 1;
 	}
 	//SAH_END////////////////////////////////////////////////////////////////////////
@@ -408,6 +410,19 @@ protected:
 	iATrace * t;
 };
 
+//! Stack for the traversal of the tree with a packet of rays (see iABSPTree::GetIntersectionsPacket).
+//! Each entry holds the rays of the packet that traverse the node, together with their ray intervals.
+struct iAPacketTraverseStack
+{
+	struct iATrace {
+		unsigned int node;
+		unsigned int mask;                //!< bit r is set if ray r of the packet traverses the node
+		float tmin[RayPacketSize];
+		float tmax[RayPacketSize];
+	};
+	std::vector<iATrace> traces;
+};
+
 //! Class representing a BSP-tree. Assigned with root node, level and AABB.
 class iABSPTree
 {
@@ -446,9 +461,10 @@ public:
 		dcast->log("Fill BSP-tree with data..........");
 		int int_null = 0;
 		if(dcast->stngs.USE_SAH != 0)
-			root->DistributePrimsSAH(int_null, splitLevel, m_aabb, nodes, tri_ind, triangles,0);
+			root->DistributePrimsSAH(int_null, splitLevel, m_aabb, nodes, tri_ind, triangles);
 		else
-			root->DistributePrims(int_null, splitLevel, m_aabb, nodes, tri_ind, triangles,0);
+			root->DistributePrims(int_null, splitLevel, m_aabb, nodes, tri_ind, triangles);
+		Flatten();
 		dcast->log("done",true);
 	}
 	//! Fills already created tree with primitives.
@@ -457,8 +473,20 @@ public:
 	{
 		m_triangles = &triangles;
 		dcast->log("Fill BSP-tree with data..........");
+		Flatten();
 		dcast->log("done\n",true);
 	}
+	//! Copies the nodes, and the triangles referenced by the leaves (in leaf order), into contiguous
+	//! arrays, so that the traversal in GetIntersectionsPacket does not need to chase pointers.
+	void Flatten()
+	{
+		flatNodes.resize(nodes.size());
+		for (size_t i=0; i<nodes.size(); i++)
+			flatNodes[i] = *nodes[i];
+		leafTris.resize(tri_ind.size());
+		for (size_t i=0; i<tri_ind.size(); i++)
+			leafTris[i] = (*m_triangles)[tri_ind[i]]->GetWaldTri();
+	}
 
 	//! Finds all intersections between ray and primitives of tree.
 	//! @note non recursive (stack based) tree traversal version
@@ -545,6 +573,87 @@ public:
 		}
 		return 1;
 	}
+	//! Finds all intersections between a packet of rays and primitives of tree.
+	//! @note the rays of the packet traverse the tree together; each ray visits the same leaves in the same
+	//! order as in GetIntersectionsNR, and the triangles of a leaf are tested against all rays of the packet
+	//! at once. Requires the flattened tree, see Flatten().
+	//! @param rays the RayPacketSize rays of the packet.
+	//! @param activeMask bit r is set if ray r of the packet should be traced.
+	//! @param[out] intersections RayPacketSize vectors, where the intersections of the respective ray are placed.
+	//! @param tr_stack traversal stack, its memory is reused across calls
+	//! @return mask of the rays intersecting the tree AABB
+	unsigned int GetIntersectionsPacket(iARay const * rays, unsigned int activeMask,
+		std::vector<iAintersection*> * intersections, iAPacketTraverseStack * tr_stack) const
+	{
+		float o[3][RayPacketSize], d[3][RayPacketSize];
+		iAPacketTraverseStack::iATrace cur_t;
+		cur_t.node = 0;
+		cur_t.mask = 0;
+		for (int r=0; r<RayPacketSize; r++)
+		{
+			for (int a=0; a<3; a++)
+			{
+				o[a][r] = rays[r].GetOrigin()[a];
+				d[a][r] = rays[r].GetDirection()[a];
+			}
+			cur_t.tmin[r] = 0;
+			cur_t.tmax[r] = 100000.f;
+			if ((activeMask & (1u<<r)) && IntersectAABB(rays[r], m_aabb, cur_t.tmin[r], cur_t.tmax[r]))
+				cur_t.mask |= 1u<<r;
+		}
+		unsigned int const hitMask = cur_t.mask;
+		if (!hitMask) return 0;
+		tr_stack->traces.clear();
+		tr_stack->traces.push_back(cur_t);
+		iAPacketTraverseStack::iATrace l_t, r_t;
+		while (!tr_stack->traces.empty())
+		{
+			cur_t = tr_stack->traces.back();
+			tr_stack->traces.pop_back();
+			iABSPNode cur_node = flatNodes[cur_t.node];
+			if (cur_node.isLeaf())
+			{
+				IntersectLeaf(cur_node.tri_start(), cur_node.tri_count(), o, d, cur_t.mask, intersections);
+				continue;
+			}
+			int const axis = cur_node.axisInd();
+			float const split = cur_node.splitCoord();
+			l_t.node = cur_node.offset();
+			r_t.node = cur_node.offset()+1;
+			l_t.mask = r_t.mask = 0;
+			for (int r=0; r<RayPacketSize; r++)
+			{
+				if (!(cur_t.mask & (1u<<r)))
+					continue;
+				// same classification as in GetIntersectionState:
+				float rd = d[axis][r];
+				if(!rd)
+					rd=0.00000001f;
+				float const t = (split - o[axis][r]) / rd;
+				unsigned int const sign = (rd >= 0.0f);
+				float const tmin = cur_t.tmin[r], tmax = cur_t.tmax[r];
+				int state = (t<tmin) ? (int)(sign^0) : ((t>tmax) ? (int)(sign^1) : 2);
+				switch (state)
+				{
+				case 1://right only
+					r_t.mask |= 1u<<r; r_t.tmin[r] = tmin; r_t.tmax[r] = tmax;
+					break;
+				case 2://both
+					r_t.mask |= 1u<<r; r_t.tmin[r] = sign ? t : tmin; r_t.tmax[r] = sign ? tmax : t;
+					l_t.mask |= 1u<<r; l_t.tmin[r] = sign ? tmin : t; l_t.tmax[r] = sign ? t : tmax;
+					break;
+				default://left only
+					l_t.mask |= 1u<<r; l_t.tmin[r] = tmin; l_t.tmax[r] = tmax;
+					break;
+				}
+			}
+			if (r_t.mask && cur_node.has_right())
+				tr_stack->traces.push_back(r_t);
+			if (l_t.mask && cur_node.has_left())
+				tr_stack->traces.push_back(l_t);
+		}
+		return hitMask;
+	}
 	//! Saves tree in file specified by filename.
 	//! @note tree in file [splitLevel][aabb][num nodes][n0...nN][num tri inds][ti1...tiN]
 	//! @param filename filename of ouput file
@@ -653,5 +762,39 @@ public:
 	std::vector<unsigned int> tri_ind;
 	std::vector<iABSPNode*> nodes;
 protected:
+	//! Tests the triangles leafTris[triStart..triStart+triCount-1] against the rays of a packet in
+	//! structure-of-arrays layout; same test as iATriPrim::Intersect, with the loop over the rays being
+	//! free of branches so that the compiler can vectorize it.
+	void IntersectLeaf(unsigned int triStart, unsigned int triCount, float const o[3][RayPacketSize],
+		float const d[3][RayPacketSize], unsigned int mask, std::vector<iAintersection*> * intersections) const
+	{
+		static const unsigned int axisModulo[] = { 0, 1, 2, 0, 1 };
+		for (unsigned int i=triStart; i<triStart+triCount; i++)
+		{
+			iAwald_tri const & tri = leafTris[i];
+			unsigned int const k = tri.k, ku = axisModulo[k+1], kv = axisModulo[k+2];
+			float dist[RayPacketSize];
+			int hit[RayPacketSize];
+			for (int r=0; r<RayPacketSize; r++)
+			{
+				const float lnd = 1.0f / (d[k][r] + tri.nu * d[ku][r] + tri.nv * d[kv][r]);
+				const float t = (tri.nd - o[k][r] - tri.nu * o[ku][r] - tri.nv * o[kv][r]) * lnd;
+				float hu = o[ku][r] + t * d[ku][r] - tri.m_A[ku];
+				float hv = o[kv][r] + t * d[kv][r] - tri.m_A[kv];
+				float beta = hv * tri.bnu + hu * tri.bnv;
+				float gamma = hu * tri.cnu + hv * tri.cnv;
+				hit[r] = (1000000.0f > t && t > 0) & !(beta < 0) & !(gamma < 0) & !((beta + gamma) > 1);
+				dist[r] = t;
+			}
+			for (int r=0; r<RayPacketSize; r++)
+			{
+				if (hit[r] && (mask & (1u<<r)))
+					intersections[r].push_back(new iAintersection((*m_triangles)[tri_ind[i]], dist[r]));
+			}
+		}
+	}
+
 	std::vector<iATriPrim*>* m_triangles;
+	std::vector<iABSPNode> flatNodes;  //!< copy of nodes, in one contiguous array
+	std::vector<iAwald_tri> leafTris;  //!< triangle data in leaf order, i.e. leafTris[i] belongs to tri_ind[i]
 };
@@ -38,8 +38,6 @@ struct iADreamCasterSettings
 		EPSILON		= 0.0011f;
 		TRACEDEPTH		= 6;
 
-		THREAD_GRID_X	= 4;
-		THREAD_GRID_Y	= 4;
 		SCALE_COEF	= 1.0f;
 		COLORING_COEF = 0.007f;
 
@@ -82,8 +80,6 @@ struct iADreamCasterSettings
 	float EPSILON;
 	int TRACEDEPTH;
 
-	int THREAD_GRID_X;
-	int THREAD_GRID_Y;
 	float SCALE_COEF;
 	float COLORING_COEF;
 
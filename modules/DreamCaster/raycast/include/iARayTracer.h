@@ -20,8 +20,6 @@
 * ************************************************************************************/
 #pragma once
 
-#include <QThread>
-
 #include "iADreamCasterCommon.h"
 #include "iADataFormat.h"
 
@@ -44,13 +42,13 @@ private:
 };
 
 class iAScene;
-class iARaycastingThread;
 struct iATraverseStack;
+struct iAPacketTraverseStack;
+struct iAintersection;
 
 //! Class in charge of the raycasting process; it is used to init the render system, start the rendering process and contains all scene data.
 class iAEngine
 {
-	friend class iARaycastingThread;
 public:
 	iAEngine(iADreamCasterSettings * settings, float * dc_cuda_avpl_buff,	float * dc_cuda_dipang_buff );
 	~iAEngine();
@@ -60,9 +58,6 @@ public:
 	//! Get engine's scene.
 	//! @return pointer to scene class
 	iAScene* scene() { return m_Scene; }
-	//! Raytrace single ray.
-	//! @note not used (using thread->DepthRaytrace(...) instead)
-	int DepthRaytrace (iARay& a_Ray, iAVec3f & a_Acc, int a_Depth, float a_RIndex, float& a_Dist, iARayPenetration * ray_p, std::vector<iAIntersection*> &vecIntersections, iATraverseStack * stack, bool dipAsColor=false );
 	//! Initializes the renderer, by resetting line / tile counters´(=render parameters) and precalculating some values.
 	//! Prepares transformation matrix which is applied to origin and screen plane.
 	//! @param vp_corners [out] plane's corners in 3d
@@ -83,10 +78,15 @@ public:
 	//! @return true
 	bool Render(const iAVec3f * vp_corners, const iAVec3f * vp_delta, const iAVec3f * o, bool rememberData = true, bool dipAsColor = false, bool cuda_enabled=false, bool rasterization = false);
 	//! Render scene on CPU
+	//! The image is split into tiles which are distributed dynamically among all available threads.
 	bool RenderCPU(const iAVec3f * vp_corners, const iAVec3f * vp_delta, const iAVec3f * o, bool rememberData = true, bool dipAsColor = false);
 	//! Render scene on GPU
 	bool RenderGPU(const iAVec3f * vp_corners, const iAVec3f * vp_delta, const iAVec3f * o, bool rememberData = true, bool dipAsColor = false, bool rasterization = false);
 	bool RenderBatchGPU(unsigned int batchSize, iAVec3f *os, iAVec3f * corns, iAVec3f * deltaxs, iAVec3f * deltays, float * rotsX, float * rotsY, float * rotsZ, bool rememberData = true, bool dipAsColor = false);
+	//! Render a batch of views (given by their ray origin, plane corner and plane axes) on CPU.
+	//! The tiles of all views are traced concurrently; the results are stored in curBatchRenders,
+	//! the image of the last view of the batch in the pixel buffer.
+	bool RenderBatchCPU(unsigned int batchSize, iAVec3f *os, iAVec3f * corns, iAVec3f * deltaxs, iAVec3f * deltays, float * rotsX, float * rotsY, float * rotsZ, bool rememberData = true, bool dipAsColor = false);
 	//! Get ray traced image pixel buffer.
 	unsigned int* getBuffer(){return m_Dest;}
 	//! Set camera rotations.
@@ -164,6 +164,25 @@ private://properties
 
 private://methods
 	void InitOpenCL();
+	//! Traces the given views on CPU and stores their statistics in renders (one per view).
+	void RenderViewsCPU(unsigned int viewCount, const iAVec3f * os, const iAVec3f * corners, const iAVec3f * deltaxs, const iAVec3f * deltays,
+		iARenderFromPosition * renders, bool rememberData, bool dipAsColor);
+	//! Traces the rays of the pixels x1..x2-1, y1..y2-1 of one view.
+	//! @param rays receives the penetration data of each ray ((x2-x1)*(y2-y1) entries)
+	//! @param intersections receives all intersections found
+	//! @param stack the BSP tree packet traversal stack to use (one per thread)
+	//! @param writeImage whether to write the resulting colors to the pixel buffer
+	void RaycastTile(const iAVec3f & o, const iAVec3f & corner, const iAVec3f & dx, const iAVec3f & dy,
+		int x1, int x2, int y1, int y2, iARayPenetration * rays, std::vector<iAIntersection*> & intersections,
+		iAPacketTraverseStack * stack, bool writeImage, bool dipAsColor);
+	//! Checks whether the ray needs to be traced, i.e. whether it hits any of the cut AABBs (if there are any).
+	bool HitsCutAABBs(const iARay & a_Ray) const;
+	//! Computes penetration data, dip angles and color of a ray from the intersections found along it.
+	//! @param intersections the intersections of the ray (in any order); they are deleted, and the vector is cleared
+	//! @param vecIntersections receives the resulting intersection data
+	//! @return 1 if the ray hit anything, 0 otherwise
+	int EvaluateIntersections(const iARay & a_Ray, iAVec3f & a_Acc, iARayPenetration * ray_p,
+		std::vector<iAintersection*> & intersections, std::vector<iAIntersection*> & vecIntersections, bool dipAsColor);
 public://TODO: qndh
 	void AllocateOpenCLBuffers();
 	void setup_nodes( void * data );
@@ -197,66 +216,3 @@ private:
 		float* out_res,
 		float * out_dip_res );
 };
-
-//! Class in charge of raycasting process. Executes raycastring on tile prescribed by X,Y screen coordinates ranges(in pixels).
-//! Used directly for rendering process. Has a pointer on parent Engine class, which is used to obtain scene data and to store some results.
-class iARaycastingThread : public QThread
-{
-public:
-	iARaycastingThread(iAEngine* a_engine){
-		e = a_engine;
-	};
-	iARaycastingThread(){
-		e = 0;
-		rays = 0;
-	};
-	~iARaycastingThread(){
-	};
-	//! Sets parent Engine pointer.
-	inline void setEngine(iAEngine* a_e)
-	{
-		e=a_e;
-	}
-	//! Sets position of plane and ray's origin.
-	inline void setPlaneAndOrigin( const iAVec3f *vp_corners, const iAVec3f *vp_delta, const iAVec3f *o)
-	{
-		m_o = o;
-		m_vp_corners = vp_corners;
-		m_vp_delta = vp_delta;
-	}
-	//! Gets rays' penetrations data.
-	inline iARayPenetration * getRays()
-	{
-		return rays;
-	}
-	//! Gets intersections data.
-	inline std::vector<iAIntersection*> * getIntersections()
-	{
-		return &intersections;
-	}
-	//! Runs thread, executes raycasting of thread's tile.
-	void run();
-	void stop()
-	{
-		stopped = true;
-	}
-	//! Free memory that has been allocated for rays and intersections.
-	void clearMemory()
-	{
-		if(rays)
-			delete [] rays;
-		for (unsigned int i=0; i<intersections.size(); i++)
-			delete intersections[i];
-	}
-	int x1,x2,y1,y2;
-	int rayCount;    //!< number of casted rays
-	bool dipAsColor; //!< image colored corresponding to dip angles
-private:
-	const iAVec3f *m_o;                       //!< rays' origin point
-	const iAVec3f *m_vp_corners;              //!< plane's corners in 3d
-	const iAVec3f *m_vp_delta;                //!< plane's x and y axes' directions in 3D
-	iAEngine* e;                                //!< parent Engine
-	iARayPenetration * rays;                    //!< rays' penetrations data
-	std::vector<iAIntersection*> intersections; //!< intersections data
-	volatile bool stopped;
-};
@@ -205,7 +205,7 @@ public:
 	int Intersect(iARay& a_Ray, float& a_Dist ) const;
 	int Intersect(iAaabb &a_aabb, iAVec3f & a_BoxCentre, iAVec3f & a_BoxHalfsize) const;
 	int CenterInside(iAaabb &a_aabb) const;
-	inline float GetAngleCos(iARay& a_Ray){ return a_Ray.GetDirection()&m_Tri.N; }
+	inline float GetAngleCos(const iARay& a_Ray){ return a_Ray.GetDirection()&m_Tri.N; }
 	iAwald_tri GetWaldTri() {return m_WaldTri;}
 	//! recalculate d coefficient when translation vector is given.
 	void recalculateD(iAVec3f *translate);
@@ -30,8 +30,6 @@ inline float Rand( float a_Range ) { return ((float)rand() / RAND_MAX) * a_Range
 int ParseConfigFile(iADreamCasterSettings * s)
 {
 	QSettings settings;
-	s->THREAD_GRID_X   = settings.value("DreamCaster/THREAD_GRID_X", s->THREAD_GRID_X).toInt();
-	s->THREAD_GRID_Y   = settings.value("DreamCaster/THREAD_GRID_Y", s->THREAD_GRID_Y ).toInt();
 	s->SCALE_COEF      = settings.value("DreamCaster/SCALE_COEF", s->SCALE_COEF ).value<float>();
 	s->COLORING_COEF   = settings.value("DreamCaster/COLORING_COEF", s->COLORING_COEF ).value<float>();
 	s->RFRAME_W        = settings.value("DreamCaster/RFRAME_W", s->RFRAME_W).toInt();
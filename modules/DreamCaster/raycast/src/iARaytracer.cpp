@@ -26,10 +26,30 @@
 #include <QFile>
 
 #include <algorithm>
+#include <cassert>
 #include <vector>
 
 #define MAX_CUT_AAB_COUNT 10
 
+namespace
+{
+	//! edge length (in pixels) of the image tiles distributed among the threads in CPU rendering
+	const int RenderTileSize = 16;
+
+	//! An image tile of one view in CPU rendering, and the raycasting results for it.
+	struct iARenderTile
+	{
+		unsigned int view;
+		int x1, x2, y1, y2;
+		iARayPenetration * rays;
+		std::vector<iAIntersection*> intersections;
+		int rayCount() const
+		{
+			return (x2 - x1) * (y2 - y1);
+		}
+	};
+}
+
 // #include "../../enable_memleak.h"
 static const char * clDreamcaster_Source[] = {
 #include "../../OpenCL/dreamcaster_embedded.txt"
@@ -102,24 +122,13 @@ void iAEngine::SetTarget( unsigned int* a_Dest)
 	m_DY = (m_WY2 - m_WY1) / m_Height;
 }
 
-// -----------------------------------------------------------
-// iAEngine::Raytrace
-// Naive ray tracing: Intersects the ray with every primitive
-// in the scene to determine the closest intersection
-// -----------------------------------------------------------
 bool intersectionCompare(iAintersection *e1, iAintersection *e2 )
 {
 	return e1->dist < e2->dist;
 }
 
-int iAEngine::DepthRaytrace(iARay& a_Ray, iAVec3f & a_Acc, int a_Depth, float /*a_RIndex*/, float& a_Dist, iARayPenetration * ray_p, std::vector<iAIntersection*> &vecIntersections, iATraverseStack * stack, bool dipAsColor )
+bool iAEngine::HitsCutAABBs(const iARay & a_Ray) const
 {
-	if (a_Depth > s->TRACEDEPTH) return 0;
-	// trace primary ray
-	a_Dist = 1000000.0f;
-	iAVec3f pi;
-	std::vector<iAintersection*> intersections;
-	// find intersections
 	unsigned int cutAABBListSize;
 	if(m_cutAABBList)
 		cutAABBListSize = m_cutAABBListSize;
@@ -139,9 +148,14 @@ int iAEngine::DepthRaytrace(iARay& a_Ray, iAVec3f & a_Acc, int a_Depth, float /*
 			}
 		}
 		if(!intersects)
-			return 0;
+			return false;
 	}
-	m_Scene->getBSPTree()->GetIntersectionsNR(a_Ray, intersections,stack);
+	return true;
+}
+
+int iAEngine::EvaluateIntersections(const iARay & a_Ray, iAVec3f & a_Acc, iARayPenetration * ray_p,
+	std::vector<iAintersection*> & intersections, std::vector<iAIntersection*> & vecIntersections, bool dipAsColor)
+{
 	if(intersections.size()==0)
 		return 0;
 	std::sort(intersections.begin(), intersections.end(), intersectionCompare);
@@ -194,6 +208,7 @@ int iAEngine::DepthRaytrace(iARay& a_Ray, iAVec3f & a_Acc, int a_Depth, float /*
 	//rayPenetr->totalPenetrLen/=(rayPenetr->penetrations.size());
 	for (unsigned int i=0; i<intersections.size(); i++)
 		delete intersections[i];
+	intersections.clear();
 	float coef = penetrationDepth*s->COLORING_COEF;
 	if(dipAsColor)
 	{
@@ -252,80 +267,170 @@ bool iAEngine::RenderCPU(const iAVec3f * vp_corners, const iAVec3f * vp_delta, c
 	curRender.maxPenetrLen = 0.f;
 	curRender.avDipAngle = 0.f;
 
-	int threadCount = s->THREAD_GRID_X*s->THREAD_GRID_Y;
-	iARaycastingThread * threads = new iARaycastingThread[threadCount];
-	for (int x=0; x<s->THREAD_GRID_X; x++)
-		for (int y=0; y<s->THREAD_GRID_Y; y++)
+	RenderViewsCPU(1, o, vp_corners, &vp_delta[0], &vp_delta[1], &curRender, rememberData, dipAsColor);
+	return true;
+}
+
+bool iAEngine::RenderBatchCPU(unsigned int batchSize, iAVec3f * a_o, iAVec3f * corns, iAVec3f * deltaxs, iAVec3f * deltays, float * rotsX, float * rotsY, float * rotsZ, bool rememberData /*= true*/, bool dipAsColor /*= false*/)
+{
+	assert(batchSize <= m_batchSize);
+	for (unsigned int batch=0; batch<batchSize; batch++)
+	{
+		curBatchRenders[batch].clear();
+		curBatchRenders[batch].rotX = rotsX[batch];
+		curBatchRenders[batch].rotY = rotsY[batch];
+		curBatchRenders[batch].rotZ = rotsZ[batch];
+		for(unsigned int i=0; i<3; i++)
+			curBatchRenders[batch].pos[i] = position[i];
+		curBatchRenders[batch].avPenetrLen = 0.f;
+		curBatchRenders[batch].maxPenetrLen = 0.f;
+		curBatchRenders[batch].avDipAngle = 0.f;
+	}
+	RenderViewsCPU(batchSize, a_o, corns, deltaxs, deltays, curBatchRenders, rememberData, dipAsColor);
+	return true;
+}
+
+void iAEngine::RenderViewsCPU(unsigned int viewCount, const iAVec3f * os, const iAVec3f * corners, const iAVec3f * deltaxs, const iAVec3f * deltays,
+	iARenderFromPosition * renders, bool rememberData, bool dipAsColor)
+{
+	// split all views into small tiles, and let each thread pick the next free tile once it is done with
+	// its previous one; this way, differing costs per tile (and per view) are balanced among the threads:
+	int tilesX = (m_Width + RenderTileSize - 1) / RenderTileSize;
+	int tilesY = (m_Height + RenderTileSize - 1) / RenderTileSize;
+	std::vector<iARenderTile> tiles(static_cast<size_t>(viewCount) * tilesX * tilesY);
+	size_t tileIdx = 0;
+	for (unsigned int view = 0; view < viewCount; ++view)
+	{
+		for (int ty = 0; ty < tilesY; ++ty)
 		{
-			int tIndex = y*s->THREAD_GRID_X+x;
-			threads[tIndex].setEngine(this);
-			threads[tIndex].setPlaneAndOrigin(vp_corners, vp_delta, o);
-			threads[tIndex].dipAsColor=dipAsColor;
-			threads[tIndex].x1 =  x   *m_Width /s->THREAD_GRID_X;
-			threads[tIndex].x2 = (x+1)*m_Width /s->THREAD_GRID_X;
-			threads[tIndex].y1 =  y   *m_Height/s->THREAD_GRID_Y;
-			threads[tIndex].y2 = (y+1)*m_Height/s->THREAD_GRID_Y;
+			for (int tx = 0; tx < tilesX; ++tx)
+			{
+				iARenderTile & tile = tiles[tileIdx++];
+				tile.view = view;
+				tile.x1 = tx * RenderTileSize;
+				tile.x2 = std::min((tx + 1) * RenderTileSize, m_Width);
+				tile.y1 = ty * RenderTileSize;
+				tile.y2 = std::min((ty + 1) * RenderTileSize, m_Height);
+				tile.rays = new iARayPenetration[tile.rayCount()];
+			}
 		}
-	for (int i=0; i<threadCount; i++)
-		threads[i].start();
-	for (int i=0; i<threadCount; i++)
-		threads[i].wait();
-	for (int i=0; i<threadCount; i++)
-		threads[i].stop();
-	//now extract all penetration data from threads
-	float avPenetrLen=0;
-	float avDipAngle=0;
-	float maxPenetrLen=0;
-	float raysCount=0;
-	float isecCount=0;
-	for (int i=0; i<threadCount; i++)
+	}
+	long long const tileCount = static_cast<long long>(tiles.size());
+#pragma omp parallel
 	{
-		if(rememberData)
-			curRender.rawPtrRaysVec.push_back(threads[i].getRays());
-		for (int j=0; j<threads[i].rayCount; j++)
+		iAPacketTraverseStack * tr_stack = new iAPacketTraverseStack();
+#pragma omp for schedule(dynamic)
+		for (long long t = 0; t < tileCount; ++t)
+		{
+			iARenderTile & tile = tiles[t];
+			RaycastTile(os[tile.view], corners[tile.view], deltaxs[tile.view], deltays[tile.view],
+				tile.x1, tile.x2, tile.y1, tile.y2, tile.rays, tile.intersections, tr_stack,
+				tile.view == viewCount - 1, dipAsColor);
+		}
+		delete tr_stack;
+	}
+
+	//now extract all penetration data from the tiles
+	for (unsigned int view = 0; view < viewCount; ++view)
+	{
+		iARenderFromPosition & render = renders[view];
+		float avPenetrLen=0;
+		float avDipAngle=0;
+		float maxPenetrLen=0;
+		float raysCount=0;
+		float isecCount=0;
+		for (size_t t = static_cast<size_t>(view) * tilesX * tilesY; t < static_cast<size_t>(view + 1) * tilesX * tilesY; ++t)
 		{
-			if(threads[i].getRays()[j].penetrationsSize!=0)
+			iARenderTile & tile = tiles[t];
+			if(rememberData)
+				render.rawPtrRaysVec.push_back(tile.rays);
+			for (int j=0; j<tile.rayCount(); j++)
 			{
-				raysCount++;
+				if(tile.rays[j].penetrationsSize!=0)
+				{
+					raysCount++;
+					if(rememberData)
+						render.rays.push_back(&tile.rays[j]);
+					float curPenetrLen = tile.rays[j].totalPenetrLen;
+					avPenetrLen+=curPenetrLen;
+					if(curPenetrLen > maxPenetrLen)
+						maxPenetrLen = curPenetrLen;
+				}
+			}
+			for (size_t j=0; j<tile.intersections.size(); j++)
+			{
+				isecCount++;
 				if(rememberData)
-					curRender.rays.push_back(&threads[i].getRays()[j]);
-				//(*renders)[curRend]->m_avPenetrLen+=threads[i].getRays()[j].totalPenetrLen;
-				float curPenetrLen = threads[i].getRays()[j].totalPenetrLen;
-				avPenetrLen+=curPenetrLen;
-				if(curPenetrLen > maxPenetrLen)
-					maxPenetrLen = curPenetrLen;
+					render.intersections.push_back(tile.intersections[j]);
+				avDipAngle+= fabs(tile.intersections[j]->dip_angle);
+			}
+			if(!rememberData)
+			{
+				delete [] tile.rays;
+				for (size_t j=0; j<tile.intersections.size(); j++)
+					delete tile.intersections[j];
 			}
 		}
-		size_t intersectionsCount = threads[i].getIntersections()->size();
-		for (size_t j=0; j<intersectionsCount; j++)
+		render.raysSize = (unsigned int) render.rays.size();
+		render.intersectionsSize = (unsigned int) render.intersections.size();
+		avPenetrLen/=raysCount;
+		avDipAngle/=isecCount;
+		m_lastAvPenetrLen  = avPenetrLen;
+		m_lastAvDipAngle = avDipAngle;
+		if(rememberData)
 		{
-			isecCount++;
-			if(rememberData)
-				curRender.intersections.push_back( ( *(threads[i].getIntersections()) )[j] );
-			avDipAngle+= fabs(( *(threads[i].getIntersections()) )[j]->dip_angle);
+			render.avPenetrLen=avPenetrLen;
+			render.avDipAngle=avDipAngle;
+			render.maxPenetrLen=maxPenetrLen;
 		}
 	}
-	curRender.raysSize = (unsigned int) curRender.rays.size();
-	curRender.intersectionsSize = (unsigned int) curRender.intersections.size();
-	avPenetrLen/=raysCount;
-	avDipAngle/=isecCount;
-	m_lastAvPenetrLen  = avPenetrLen;
-	m_lastAvDipAngle = avDipAngle;
-	//(*renders)[curRend]->m_avPenetrLen/=(*renders)[curRend]->rays.size();
-	if(rememberData)
-	{
-		curRender.avPenetrLen=avPenetrLen;
-		curRender.avDipAngle=avDipAngle;
-		curRender.maxPenetrLen=maxPenetrLen;
-		curRender.raysSize = (unsigned int) curRender.rays.size();
-	}
-	else
-	{
-		for (int i=0; i<threadCount; i++)
-			threads[i].clearMemory();
-	}
-	delete [] threads;
-	return true;
+}
+
+void iAEngine::RaycastTile(const iAVec3f & o, const iAVec3f & corner, const iAVec3f & dx, const iAVec3f & dy,
+	int x1, int x2, int y1, int y2, iARayPenetration * rays, std::vector<iAIntersection*> & intersections,
+	iAPacketTraverseStack * stack, bool writeImage, bool dipAsColor)
+{
+	// rays of neighbouring pixels of one column are traced together as one packet:
+	iARay packet[RayPacketSize];
+	std::vector<iAintersection*> packetIntersections[RayPacketSize];
+	unsigned int rayInd=0;
+	for(int x=x1; x<x2; x++)
+		for(int y0=y1; y0<y2; y0+=RayPacketSize)
+		{
+			int const packetSize = std::min(RayPacketSize, y2-y0);
+			unsigned int activeMask = 0;
+			for (int r=0; r<packetSize; r++)
+			{
+				iAVec3f dir = (corner + x*dx + (y0+r)*dy) - o;
+				dir.normalize();
+				packet[r] = iARay( &o, dir );
+				if (s->TRACEDEPTH >= 1 && HitsCutAABBs(packet[r]))
+					activeMask |= 1u<<r;
+			}
+			if (activeMask)
+				m_Scene->getBSPTree()->GetIntersectionsPacket(packet, activeMask, packetIntersections, stack);
+			for (int r=0; r<packetSize; r++)
+			{
+				int y = y0+r;
+				rays[rayInd].m_X=x;
+				rays[rayInd].m_Y=y;
+				rays[rayInd].totalPenetrLen=0.0f;
+				iAVec3f acc( 0, 0, 0 );
+				EvaluateIntersections(packet[r], acc, &rays[rayInd], packetIntersections[r], intersections, dipAsColor);
+				if (writeImage)
+				{
+					int red = (int)(acc[0] * 255);
+					int green = (int)(acc[1] * 255);
+					int blue = (int)(acc[2] * 255);
+					if (red > 255) red = 255;
+					if (green > 255) green = 255;
+					if (blue > 255) blue = 255;
+					//invert by y axis
+					m_Dest[y*m_Width+(m_Width-x-1)] = (red << 16) + (green << 8) + blue;
+				}
+				rayInd++;
+			}
+		}
 }
 
 bool iAEngine::RenderGPU(const iAVec3f * vp_corners, const iAVec3f * vp_delta, const iAVec3f * o, bool rememberData, bool dipAsColor, bool rasteriztion )
@@ -783,43 +888,4 @@ void iAEngine::raycast_single(
 	this->raycast_batch(a_aabb, a_o, a_c, a_dx, a_dy, w, h, 1, a_cut_aabbs, a_cut_aabbs_count, out_res, out_dip_res);
 }
 
-//////////////////////////////////////////////////////////////////////////
-// iARaycastingThread implementation
-//////////////////////////////////////////////////////////////////////////
-void iARaycastingThread::run()
-{
-	iATraverseStack * tr_stack = new iATraverseStack(e->scene()->getBSPTree()->splitLevel+1);
-	rayCount = (x2-x1)*(y2-y1);
-	delete [] rays;
-	rays = new iARayPenetration[rayCount];
-	unsigned int rayInd=0;
-	for(int x=x1; x<x2; x++)
-		for(int y=y1; y<y2; y++)
-		{
-			rays[rayInd].m_X=x;
-			rays[rayInd].m_Y=y;
-			rays[rayInd].totalPenetrLen=0.0f;
-			// fire primary ray
-			iAVec3f acc( 0, 0, 0 );
-			iAVec3f dir = (m_vp_corners[0] + x*m_vp_delta[0] + y*m_vp_delta[1]) - (*m_o);
-			dir.normalize();
-			iARay r( m_o, dir );
-			float dist;
-			e->DepthRaytrace( r, acc, 1, 1.0f, dist, &rays[rayInd], intersections, tr_stack, dipAsColor );
-			int red = (int)(acc[0] * 255);
-			int green = (int)(acc[1] * 255);
-			int blue = (int)(acc[2] * 255);
-			if (red > 255) red = 255;
-			if (green > 255) green = 255;
-			if (blue > 255) blue = 255;
-
-			//e->destMutex.lock();
-			//invert by y axis
-			e->m_Dest[y*e->m_Width+(e->m_Width-x-1)] = (red << 16) + (green << 8) + blue;
-			//e->destMutex.unlock();
-			rayInd++;
-		}
-	if(tr_stack)
-		delete tr_stack;
-}
 //}; // namespace Raytracer
@@ -38,17 +38,6 @@ template <typename ArgType, typename ValType>
 class iAFunctionalBoxplot;
 typedef iAFunctionalBoxplot< unsigned int, double> FunctionalBoxPlot;
 
-struct icData
-{
-	icData(double i, itk::Index<DIM> coord ) :
-		intensity(i), x(coord[0]), y(coord[1]), z(coord[2]) {}
-
-	double intensity;
-	unsigned int x;
-	unsigned int y;
-	unsigned int z;
-};
-
 enum PathID
 {
 	P_HILBERT,
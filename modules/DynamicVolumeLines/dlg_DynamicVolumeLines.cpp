@@ -109,7 +109,9 @@ dlg_DynamicVolumeLines::dlg_DynamicVolumeLines(QWidget *parent /*= 0*/, QDir dat
 }
 
 dlg_DynamicVolumeLines::~dlg_DynamicVolumeLines()
-{}
+{
+	qDeleteAll(m_segmTreeList);
+}
 
 void dlg_DynamicVolumeLines::setupScaledPlot(QCustomPlot *qcp)
 {
@@ -315,7 +317,7 @@ void dlg_DynamicVolumeLines::generateHilbertIdx()
 	m_mdiChild->initProgressBar();
 	QThread *thread = new QThread;
 	iAIntensityMapper *im = new iAIntensityMapper(m_iMProgress, m_datasetsDir, PathNameToId[cb_Paths->currentText()],
-		m_DatasetIntensityMap, m_imgDataList, m_minEnsembleIntensity, m_maxEnsembleIntensity);
+		m_profiles, m_imgDataList, m_minEnsembleIntensity, m_maxEnsembleIntensity);
 	im->moveToThread(thread);
 	connect(thread, SIGNAL(started()), im, SLOT(process()));
 	connect(im, SIGNAL(finished()), thread, SLOT(quit()));
@@ -335,21 +337,22 @@ void dlg_DynamicVolumeLines::visualizePath()
 {
 	double *spacing = m_imgDataList[0]->GetSpacing();
 	auto pts = vtkSmartPointer<vtkPoints>::New();
-	auto pathSteps = m_DatasetIntensityMap.at(0).second.size();
-	QList<icData>  pathData = m_DatasetIntensityMap.at(0).second;
+	auto pathSteps = m_profiles.pathLength();
 	double point[3];
-	for (int i = 0; i < pathSteps; ++i)
+	unsigned int coord[3];
+	for (size_t i = 0; i < pathSteps; ++i)
 	{
-		point[0] = pathData[i].x * spacing[0];
-		point[1] = pathData[i].y * spacing[1];
-		point[2] = pathData[i].z * spacing[2];
+		m_profiles.coordinates(i, coord);
+		point[0] = coord[0] * spacing[0];
+		point[1] = coord[1] * spacing[1];
+		point[2] = coord[2] * spacing[2];
 		pts->InsertNextPoint(point);
 	}
 
 	auto linesPolyData = vtkSmartPointer<vtkPolyData>::New();
 	linesPolyData->SetPoints(pts);
 	auto lines = vtkSmartPointer<vtkCellArray>::New();
-	for (int i = 0; i < pathSteps - 1; ++i)
+	for (size_t i = 0; i + 1 < pathSteps; ++i)
 	{
 		auto line = vtkSmartPointer<vtkLine>::New();
 		line->GetPointIds()->SetId(0, i);
@@ -382,15 +385,15 @@ void dlg_DynamicVolumeLines::visualize()
 
 	if (m_linearScaledPlot->graphCount() < 1)
 	{
-		std::vector<iAFunction<double, double> *> linearFCPFunctions;
-		for (auto it = m_DatasetIntensityMap.begin(); it != m_DatasetIntensityMap.end(); ++it)
+		iASampledFunctions<double, double> linearFBPFunctions(0.0, 1.0, m_profiles.pathLength(), m_profiles.datasetCount());
+		for (int datasetIdx = 0; datasetIdx < m_profiles.datasetCount(); ++datasetIdx)
 		{
 			m_linearScaledPlot->addGraph();
 			m_linearScaledPlot->graph()->setVisible(false);
 			m_linearScaledPlot->graph()->setSelectable(QCP::stMultipleDataRanges);
-			m_linearScaledPlot->graph()->setPen(getDatasetPen(it - m_DatasetIntensityMap.begin(),
-				m_DatasetIntensityMap.size(), 2, plotColor));
-			m_linearScaledPlot->graph()->setName(it->first);
+			m_linearScaledPlot->graph()->setPen(getDatasetPen(datasetIdx,
+				m_profiles.datasetCount(), 2, plotColor));
+			m_linearScaledPlot->graph()->setName(m_profiles.datasetName(datasetIdx));
 			QCPScatterStyle scatter;
 			scatter.setShape(QCPScatterStyle::ssNone);	 // Check ssDisc/ssDot to show single selected points
 			scatter.setSize(3.0);
@@ -400,18 +403,16 @@ void dlg_DynamicVolumeLines::visualize()
 			p.setColor(QColor(255, 0, 0));  // Selection color: red
 			m_linearScaledPlot->graph()->selectionDecorator()->setPen(p);
 			QSharedPointer<QCPGraphDataContainer> linearScaledPlotData(new QCPGraphDataContainer);
-			auto * funct = new iAFunction<double, double>();
-			for (int i = 0; i < it->second.size(); ++i)
+			for (size_t i = 0; i < m_profiles.pathLength(); ++i)
 			{
-				linearScaledPlotData->add(QCPGraphData(double(i), it->second[i].intensity));
-				funct->insert(std::make_pair(i, it->second[i].intensity));
+				double intensity = m_profiles.intensity(datasetIdx, i);
+				linearScaledPlotData->add(QCPGraphData(double(i), intensity));
+				linearFBPFunctions.setValue(datasetIdx, i, intensity);
 			}
-			linearFCPFunctions.push_back(funct);
 			m_linearScaledPlot->graph()->setData(linearScaledPlotData);
 		}
-		iAModifiedDepthMeasure<double, double> l_measure;
-		auto l_functionalBoxplotData = new iAFunctionalBoxplot<double, double>(linearFCPFunctions, &l_measure, 2);
-		setupFBPGraphs(m_linearScaledPlot, l_functionalBoxplotData);
+		iAFunctionalBoxplot<double, double> linearFBPData(linearFBPFunctions);
+		setupFBPGraphs(m_linearScaledPlot, &linearFBPData);
 	}
 
 	m_linearDataPointInfo = new QCPItemText(m_linearScaledPlot);
@@ -441,15 +442,15 @@ void dlg_DynamicVolumeLines::visualize()
 	m_linearIdxLine->point2->setCoords(0.0, 0.0);
 	m_linearIdxLine->setClipToAxisRect(true);
 
-	std::vector<iAFunction<double, double> *> nonlinearFCPFunctions;
-	for (auto it = m_DatasetIntensityMap.begin(); it != m_DatasetIntensityMap.end(); ++it)
+	iASampledFunctions<double, double> nonlinearFBPFunctions(m_nonlinearMappingVec.toStdVector(), m_profiles.datasetCount());
+	for (int datasetIdx = 0; datasetIdx < m_profiles.datasetCount(); ++datasetIdx)
 	{
 		m_nonlinearScaledPlot->addGraph();
 		m_nonlinearScaledPlot->graph()->setVisible(false);
 		m_nonlinearScaledPlot->graph()->setSelectable(QCP::stMultipleDataRanges);
-		m_nonlinearScaledPlot->graph()->setPen(getDatasetPen(it - m_DatasetIntensityMap.begin(),
-			m_DatasetIntensityMap.size(), 2, plotColor));
-		m_nonlinearScaledPlot->graph()->setName(it->first);
+		m_nonlinearScaledPlot->graph()->setPen(getDatasetPen(datasetIdx,
+			m_profiles.datasetCount(), 2, plotColor));
+		m_nonlinearScaledPlot->graph()->setName(m_profiles.datasetName(datasetIdx));
 		QCPScatterStyle scatter;
 		scatter.setShape(QCPScatterStyle::ssNone);	 // Check ssDisc/ssDot to show single selected points
 		scatter.setSize(3.0);
@@ -459,19 +460,17 @@ void dlg_DynamicVolumeLines::visualize()
 		p.setColor(QColor(255, 0, 0));  // Selection color: red
 		m_nonlinearScaledPlot->graph()->selectionDecorator()->setPen(p);
 		QSharedPointer<QCPGraphDataContainer> nonlinearScaledPlotData(new QCPGraphDataContainer);
-		auto * funct = new iAFunction<double, double>();
 		for (int i = 0; i < m_nonlinearMappingVec.size(); ++i)
 		{
-			nonlinearScaledPlotData->add(QCPGraphData(m_nonlinearMappingVec[i], it->second[i].intensity));
-			funct->insert(std::make_pair(m_nonlinearMappingVec[i], it->second[i].intensity));
+			double intensity = m_profiles.intensity(datasetIdx, i);
+			nonlinearScaledPlotData->add(QCPGraphData(m_nonlinearMappingVec[i], intensity));
+			nonlinearFBPFunctions.setValue(datasetIdx, i, intensity);
 		}
-		nonlinearFCPFunctions.push_back(funct);
 		m_nonlinearScaledPlot->graph()->setData(nonlinearScaledPlotData);
 	}
 
-	iAModifiedDepthMeasure<double, double> nl_measure;
-	auto nonlinearFBPData = new iAFunctionalBoxplot<double, double>(nonlinearFCPFunctions, &nl_measure, 2);
-	setupFBPGraphs(m_nonlinearScaledPlot, nonlinearFBPData);
+	iAFunctionalBoxplot<double, double> nonlinearFBPData(nonlinearFBPFunctions);
+	setupFBPGraphs(m_nonlinearScaledPlot, &nonlinearFBPData);
 
 	m_nonlinearTicker = QSharedPointer<iANonLinearAxisTicker>(new iANonLinearAxisTicker);
 	m_nonlinearTicker->setTickData(m_nonlinearMappingVec);
@@ -510,7 +509,7 @@ void dlg_DynamicVolumeLines::visualize()
 	showBkgrdThrRanges(m_linearScaledPlot);
 
 	m_selGraphList.clear();
-	for (int i = 0; i < m_DatasetIntensityMap.size(); ++i)
+	for (int i = 0; i < m_profiles.datasetCount(); ++i)
 	{
 		m_selGraphList.append(m_nonlinearScaledPlot->graph(i));
 		m_selGraphList.append(m_linearScaledPlot->graph(i));
@@ -556,17 +555,19 @@ void dlg_DynamicVolumeLines::calcNonLinearMapping()
 	QList<double> innerEnsembleDistList;
 	double maxInnerEnsableDist = 0.0;
 
-	for (int i = 0; i < m_DatasetIntensityMap[0].second.size(); ++i)
+	double thr = sb_BkgrdThr->value();
+	for (size_t i = 0; i < m_profiles.pathLength(); ++i)
 	{
 		double innerEnsembleDist = -1.0;
-		double thr = sb_BkgrdThr->value();
-		if (m_DatasetIntensityMap[0].second[i].intensity >= thr)
+		if (m_profiles.intensity(0, i) >= thr)
 		{
-			QList<double> localIntValList;
-			for (int j = 0; j < m_DatasetIntensityMap.size(); ++j)
-				localIntValList.append(m_DatasetIntensityMap[j].second[i].intensity);
-			auto minLocalVal = *std::min_element(std::begin(localIntValList), std::end(localIntValList));
-			auto maxLocalVal = *std::max_element(std::begin(localIntValList), std::end(localIntValList));
+			double minLocalVal = m_profiles.intensity(0, i), maxLocalVal = minLocalVal;
+			for (int j = 1; j < m_profiles.datasetCount(); ++j)
+			{
+				double localVal = m_profiles.intensity(j, i);
+				minLocalVal = std::min(minLocalVal, localVal);
+				maxLocalVal = std::max(maxLocalVal, localVal);
+			}
 			innerEnsembleDist = maxLocalVal - minLocalVal;
 		}
 		innerEnsembleDistList.append(innerEnsembleDist);
@@ -627,14 +628,12 @@ void dlg_DynamicVolumeLines::generateSegmentTree()
 
 	if (m_segmTreeList.isEmpty() | m_subHistBinCntChanged)
 	{
+		qDeleteAll(m_segmTreeList);
 		m_segmTreeList.clear();
 		m_subHistBinCntChanged = false;
-		for (int datsetNumber = 0; datsetNumber < m_DatasetIntensityMap.size(); ++datsetNumber)
+		for (int datsetNumber = 0; datsetNumber < m_profiles.datasetCount(); ++datsetNumber)
 		{
-			std::vector<int> intensityVec;
-			for (int hIdx = 0; hIdx < m_DatasetIntensityMap[datsetNumber].second.size(); ++hIdx)
-				intensityVec.push_back(m_DatasetIntensityMap[datsetNumber].second[hIdx].intensity);
-			iASegmentTree *segmentTree = new iASegmentTree(intensityVec, subhistBinCnt, lowerBnd, upperBnd);
+			iASegmentTree *segmentTree = new iASegmentTree(m_profiles.intensities(datsetNumber), subhistBinCnt, lowerBnd, upperBnd);
 			m_segmTreeList.append(segmentTree);
 		}
 	}
@@ -680,14 +679,15 @@ void dlg_DynamicVolumeLines::generateSegmentTree()
 
 		m_linearHistBinBoarderVec.append(linearUpperDbl);
 
+		std::vector<unsigned int> nonlinearHist(subhistBinCnt, 0), linearHist(subhistBinCnt, 0);
+		for (int treeNumber = 0; treeNumber < m_segmTreeList.size(); ++treeNumber)
+		{
+			m_segmTreeList[treeNumber]->hist_query(nonlinearLowerIdx, nonlinearUpperIdx, nonlinearHist);
+			m_segmTreeList[treeNumber]->hist_query(linearLowerIdx, linearUpperIdx, linearHist);
+		}
 		for (int yBinNumber = 0; yBinNumber < subhistBinCnt; ++yBinNumber)
 		{
-			unsigned int nonlinear_sum = 0, linear_sum = 0;
-			for (int treeNumber = 0; treeNumber < m_segmTreeList.size(); ++treeNumber)
-			{
-				nonlinear_sum += m_segmTreeList[treeNumber]->hist_query(nonlinearLowerIdx, nonlinearUpperIdx)[yBinNumber];
-				linear_sum += m_segmTreeList[treeNumber]->hist_query(linearLowerIdx, linearUpperIdx)[yBinNumber];
-			}
+			unsigned int nonlinear_sum = nonlinearHist[yBinNumber], linear_sum = linearHist[yBinNumber];
 
 			QCPItemRect *nonlin_histRectItem = new QCPItemRect(m_nonlinearScaledPlot);
 			nonlin_histRectItem->setObjectName("histRect");
@@ -846,7 +846,7 @@ void  dlg_DynamicVolumeLines::checkHistVisMode(int lowerIdx, int upperIdx)
 		if (cb_showFBP->isChecked())
 		{
 			switchFBPMode(cb_FBPView->currentText(), m_nonlinearScaledPlot, m_linearScaledPlot,
-				m_DatasetIntensityMap.size(), sl_FBPTransparency);
+				m_profiles.datasetCount(), sl_FBPTransparency);
 		}
 		else
 		{
@@ -1102,7 +1102,7 @@ void dlg_DynamicVolumeLines::mouseMove(QMouseEvent* e)
 		return;
 
 	QVector<double> distList;
-	for (int i = 0; i < m_DatasetIntensityMap.size(); ++i)
+	for (int i = 0; i < m_profiles.datasetCount(); ++i)
 		distList.append(plot->graph(i)->selectTest(
 			QPoint(e->pos().x(), e->pos().y()), true));
 	auto minDist = std::min_element(distList.begin(), distList.end());
@@ -1234,9 +1234,9 @@ void dlg_DynamicVolumeLines::selectionChangedByUser()
 		m_mrvTxtAct->VisibilityOff();
 		for (auto graph : selVisibleGraphsList)
 		{
-			for (int i = 0; i < m_DatasetIntensityMap.size(); ++i)
+			for (int i = 0; i < m_profiles.datasetCount(); ++i)
 			{
-				if (m_DatasetIntensityMap[i].first == graph->name())
+				if (m_profiles.datasetName(i) == graph->name())
 				{
 					plotP->graph(i)->setSelection(graph->selection());
 					break;
@@ -1254,7 +1254,7 @@ void dlg_DynamicVolumeLines::selectionChangedByUser()
 		vtkRenderWindow * renWin = ren->renderWindow();
 		renWin->GetRenderers()->GetFirstRenderer()->RemoveActor(ren->selectedActor());
 		renWin->Render();
-		for (int i = 0; i < m_DatasetIntensityMap.size(); ++i)
+		for (int i = 0; i < m_profiles.datasetCount(); ++i)
 			plotP->graph(i)->setSelection(plotU->graph(i)->selection());
 	}
 
@@ -1331,7 +1331,9 @@ void dlg_DynamicVolumeLines::legendClick(QCPLegend* legendU,
 void dlg_DynamicVolumeLines::updateDynamicVolumeLines()
 {
 	m_imgDataList.clear();
-	m_DatasetIntensityMap.clear();
+	m_profiles.clear();
+	qDeleteAll(m_segmTreeList);
+	m_segmTreeList.clear();
 	generateHilbertIdx();
 }
 
@@ -1340,14 +1342,14 @@ void dlg_DynamicVolumeLines::showFBPGraphs()
 	if (cb_showFBP->isChecked())
 	{
 		switchFBPMode(cb_FBPView->currentText(), m_nonlinearScaledPlot, m_linearScaledPlot,
-			m_DatasetIntensityMap.size(), sl_FBPTransparency);
+			m_profiles.datasetCount(), sl_FBPTransparency);
 	}
 	else
 	{
 		sl_FBPTransparency->hide();
 		for (int i = 0; i < m_nonlinearScaledPlot->graphCount(); ++i)
 		{
-			if (i >= m_DatasetIntensityMap.size())
+			if (i >= m_profiles.datasetCount())
 			{
 				hideGraphandRemoveFromLegend(m_nonlinearScaledPlot, m_linearScaledPlot, i);
 			}
@@ -1392,7 +1394,7 @@ void dlg_DynamicVolumeLines::setFBPTransparency(int value)
 {
 	double alpha = round(value * 255 / 100.0);
 	QPen p; QColor c; QBrush b;
-	for (int i = m_DatasetIntensityMap.size(); i < m_nonlinearScaledPlot->graphCount(); ++i)
+	for (int i = m_profiles.datasetCount(); i < m_nonlinearScaledPlot->graphCount(); ++i)
 	{
 		p = m_nonlinearScaledPlot->graph(i)->pen();
 		c = m_nonlinearScaledPlot->graph(i)->pen().color();
@@ -1515,31 +1517,33 @@ void dlg_DynamicVolumeLines::setSelectionForRenderer(QList<QCPGraph *> visSelGra
 	{
 		int datasetIdx = datasetsList.indexOf(visSelGraphList[i]->name());
 		auto selHilbertIndices = visSelGraphList[i]->selection().dataRanges();
-		auto pathSteps = m_DatasetIntensityMap[datasetIdx].second.size();
-		auto pathData = m_DatasetIntensityMap[datasetIdx].second;
+		auto pathSteps = m_profiles.pathLength();
 		int scalarType = m_imgDataList[datasetIdx]->GetScalarType();
+		unsigned int coord[3];
 
 		if (selHilbertIndices.size() < 1)
 		{
-			for (int hIdx = 0; hIdx < pathSteps; ++hIdx)
+			for (size_t hIdx = 0; hIdx < pathSteps; ++hIdx)
 			{
+				m_profiles.coordinates(hIdx, coord);
 				VTK_TYPED_CALL(setVoxelIntensity, scalarType, m_imgDataList[datasetIdx],
-					pathData[hIdx].x, pathData[hIdx].y, pathData[hIdx].z, pathData[hIdx].intensity);
+					coord[0], coord[1], coord[2], m_profiles.intensity(datasetIdx, hIdx));
 			}
 			m_nonlinearDataPointInfo->setVisible(false);
 		}
 		else
 		{
 			double const *r = m_mdiChild->histogram()->xBounds();
-			for (int hIdx = 0; hIdx < pathSteps; ++hIdx)
+			for (size_t hIdx = 0; hIdx < pathSteps; ++hIdx)
 			{
+				m_profiles.coordinates(hIdx, coord);
 				bool showVoxel = false;
 				for (int j = 0; j < selHilbertIndices.size(); ++j)
 				{
-					if (hIdx >= selHilbertIndices.at(j).begin() && hIdx < selHilbertIndices.at(j).end())
+					if (static_cast<int>(hIdx) >= selHilbertIndices.at(j).begin() && static_cast<int>(hIdx) < selHilbertIndices.at(j).end())
 					{
 						VTK_TYPED_CALL(setVoxelIntensity, scalarType, m_imgDataList[datasetIdx],
-							pathData[hIdx].x, pathData[hIdx].y, pathData[hIdx].z, pathData[hIdx].intensity);
+							coord[0], coord[1], coord[2], m_profiles.intensity(datasetIdx, hIdx));
 						//qDebug() << "M3DRV shows voxel at Pos: " << data[hIdx].x << data[hIdx].y << data[hIdx].z << " Hidx: " << hIdx;
 						showVoxel = true;
 						break;
@@ -1548,7 +1552,7 @@ void dlg_DynamicVolumeLines::setSelectionForRenderer(QList<QCPGraph *> visSelGra
 				if (!showVoxel)
 				{
 					VTK_TYPED_CALL(setVoxelIntensity, scalarType, m_imgDataList[datasetIdx],
-						pathData[hIdx].x, pathData[hIdx].y, pathData[hIdx].z, r[0]);
+						coord[0], coord[1], coord[2], r[0]);
 				}
 			}
 		}
@@ -1640,16 +1644,17 @@ void dlg_DynamicVolumeLines::setSelectionForPlots(vtkPoints *selCellPoints)
 {
 	// TODO: a single index idx is presented as a line (from idx to idx+1) in the plots,
 	// just paint a point in the plots for single indices (performance?)
-	auto pathSteps = m_DatasetIntensityMap.at(0).second.size();
-	auto pathData = m_DatasetIntensityMap.at(0).second;
+	auto pathSteps = m_profiles.pathLength();
+	unsigned int coord[3];
 	QList<bool> selHilbertIdxList;
-	for (int i = 0; i < pathSteps; ++i)
+	for (size_t i = 0; i < pathSteps; ++i)
 	{
+		m_profiles.coordinates(i, coord);
 		bool found = false;
 		for (int j = 0; j < selCellPoints->GetNumberOfPoints(); ++j)
 		{
 			double *pt = selCellPoints->GetPoint(j);
-			if (pathData[i].x == pt[0] && pathData[i].y == pt[1] && pathData[i].z == pt[2])
+			if (coord[0] == pt[0] && coord[1] == pt[1] && coord[2] == pt[2])
 			{
 				//qDebug() << j << ".selCellPoints :" << pt[0] << pt[1] << pt[2] << "at Hidx: " << i;
 				found = true;
@@ -1687,7 +1692,7 @@ void dlg_DynamicVolumeLines::setSelectionForPlots(vtkPoints *selCellPoints)
 
 
 	QList<QString> visibleGraphsNameList;
-	for (int i = 0; i < m_DatasetIntensityMap.size(); ++i)
+	for (int i = 0; i < m_profiles.datasetCount(); ++i)
 		if (m_nonlinearScaledPlot->graph(i)->visible())
 			visibleGraphsNameList.append(m_nonlinearScaledPlot->graph(i)->name());
 
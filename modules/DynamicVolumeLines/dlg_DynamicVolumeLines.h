@@ -20,6 +20,7 @@
 * ************************************************************************************/
 #pragma once
 
+#include "iAProfileStore.h"
 #include "iAScalingWidget.h"
 #include "DynamicVolumeLinesHelpers.h"
 #include "ui_dlg_DynamicVolumeLines.h"
@@ -55,7 +56,7 @@ public:
 	~dlg_DynamicVolumeLines();
 
 	QDir m_datasetsDir;
-	QList<QPair <QString, QList<icData> >> m_DatasetIntensityMap;
+	iAProfileStore m_profiles;
 
 public slots:
 	void mousePress(QMouseEvent*);
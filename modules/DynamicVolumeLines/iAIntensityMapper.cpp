@@ -23,16 +23,15 @@
 #include "io/iAITKIO.h"
 #include "iATypedCallHelper.h"
 
-#include <itkImageRegionIteratorWithIndex.h>
 #include <itkImageToVTKImageFilter.h>
 
 #include <Hilbert.hpp>
 
 
 template<class T>
-void getIntensities(iAProgress &imp, PathID m_pathID, ImagePointer &image, QList<icData> &intensityList,
-	QList<vtkSmartPointer<vtkImageData>> &m_imgDataList, QList<double> &minEnsembleIntensityList,
-	QList<double> &maxEnsembleIntensityList, QList<QVector<unsigned int>> &coordList)
+void getIntensities(iAProgress &imp, PathID m_pathID, ImagePointer &image, QString const & datasetName,
+	iAProfileStore &profiles, QList<vtkSmartPointer<vtkImageData>> &m_imgDataList,
+	QList<double> &minEnsembleIntensityList, QList<double> &maxEnsembleIntensityList)
 {
 	typedef itk::Image< T, DIM >   InputImageType;
 	InputImageType * input = dynamic_cast<InputImageType*>(image.GetPointer());
@@ -46,72 +45,72 @@ void getIntensities(iAProgress &imp, PathID m_pathID, ImagePointer &image, QList
 	maxEnsembleIntensityList.append(imageData->GetScalarRange()[1]);
 	m_imgDataList.append(imageData);
 
-	switch (m_pathID)
-	{
-		case P_HILBERT:
+	if (profiles.datasetCount() == 0)
+	{	// the path is the same for all datasets, so only compute it for the first one:
+		auto size = input->GetLargestPossibleRegion().GetSize();
+		int dim[DIM];
+		for (int i = 0; i < DIM; ++i)
+		{
+			dim[i] = static_cast<int>(size[i]);
+		}
+		std::vector<size_t> voxelIndices;
+		switch (m_pathID)
 		{
-			if (coordList.size() == 0)
+			case P_HILBERT:
 			{
-				QVector<unsigned int> coord(QVector<unsigned int>(3));
-				auto size = input->GetLargestPossibleRegion().GetSize();
 				unsigned int HilbertCnt = size[0] * size[1] * size[2];
 				int nbOfBitsPerDim[DIM];
 				for (int i = 0; i < DIM; ++i)
 					nbOfBitsPerDim[i] = ceil(sqrt((size[i] - 1)));
 
+				voxelIndices.reserve(HilbertCnt);
+				int lastProgress = -1;
 				for (unsigned int h = 0; h < HilbertCnt; ++h)
 				{
-					CFixBitVec *coordPtr = new CFixBitVec[HilbertCnt];
+					CFixBitVec coordPtr[DIM];
 					CFixBitVec compHilbertIdx;
 					compHilbertIdx = (FBV_UINT)h;
 					Hilbert::compactIndexToCoords(coordPtr,
 						nbOfBitsPerDim, DIM, compHilbertIdx);
-
-					for (int i = 0; i < DIM; i++)
-						coord[i] = coordPtr[i].rack();
-
-					delete[] coordPtr;
-					coordList.append(coord);
-					imp.emitProgress((h + 1) * 100 / HilbertCnt);
+					voxelIndices.push_back(coordPtr[0].rack() +
+						(coordPtr[1].rack() + static_cast<size_t>(coordPtr[2].rack()) * size[1]) * size[0]);
+					int progress = static_cast<int>((h + 1) * 100.0 / HilbertCnt);
+					if (progress != lastProgress)
+					{
+						imp.emitProgress(progress);
+						lastProgress = progress;
+					}
 				}
 			}
+			break;
 
-			for (int h = 0; h < coordList.size(); ++h)
-			{
-				typename InputImageType::IndexType c;
-				for (int i = 0; i < DIM; i++)
-				{
-					c[i] = coordList[h][i];
-				}
-				icData data(input->GetPixel(c), c);
-				intensityList.append(data);
-			}
+			case P_SCAN_LINE:
+				// path steps equal the (x-fastest) voxel indices, no need to store them
+			break;
 		}
-		break;
+		profiles.setPath(dim, std::move(voxelIndices));
+	}
 
-		case P_SCAN_LINE:
-		{
-			itk::ImageRegionIteratorWithIndex<InputImageType> imageIterator(
-				input, input->GetLargestPossibleRegion());
-			for (imageIterator.GoToBegin(); !imageIterator.IsAtEnd(); ++imageIterator)
-			{
-				auto coord = imageIterator.GetIndex();
-				icData data(input->GetPixel(coord), coord);
-				intensityList.append(data);
-			}
-		}
-		break;
+	// copy the intensities along the path into a column of the dataset's type:
+	auto intensities = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(imageData->GetScalarType()));
+	intensities->SetNumberOfTuples(static_cast<vtkIdType>(profiles.pathLength()));
+	T const * src = input->GetBufferPointer();
+	T * dst = static_cast<T*>(intensities->GetVoidPointer(0));
+	for (size_t step = 0; step < profiles.pathLength(); ++step)
+	{
+		dst[step] = src[profiles.voxelIndex(step)];
 	}
+	profiles.addProfile(datasetName, intensities);
 	itkToVTKConverter->ReleaseDataFlagOn();
 }
 
-iAIntensityMapper::iAIntensityMapper(iAProgress &iMProgress, QDir datasetsDir, PathID pathID, QList<QPair<QString,
-	QList<icData>>> &datasetIntensityMap, QList<vtkSmartPointer<vtkImageData>> &imgDataList,
+iAIntensityMapper::iAIntensityMapper(iAProgress &iMProgress, QDir datasetsDir, PathID pathID,
+	iAProfileStore &profiles, QList<vtkSmartPointer<vtkImageData>> &imgDataList,
 	double &minEnsembleIntensity, double &maxEnsembleIntensity) :
 	m_iMProgress(iMProgress),
 	m_datasetsDir(datasetsDir),
 	m_pathID(pathID),
-	m_DatasetIntensityMap(datasetIntensityMap),
+	m_profiles(profiles),
 	m_imgDataList(imgDataList),
 	m_minEnsembleIntensity(minEnsembleIntensity),
 	m_maxEnsembleIntensity(maxEnsembleIntensity)
@@ -125,16 +124,13 @@ void iAIntensityMapper::process()
 	QStringList datasetsList = m_datasetsDir.entryList();
 	QList<double> minEnsembleIntensityList;
 	QList<double> maxEnsembleIntensityList;
-	QList<QVector<unsigned int>> coordList;
 	for (int i = 0; i < datasetsList.size(); ++i)
 	{
-		QList<icData> intensityList;
 		QString dataset = m_datasetsDir.filePath(datasetsList.at(i));
 		ScalarPixelType pixelType;
 		ImagePointer image = iAITKIO::readFile(dataset, pixelType, true);
-		ITK_TYPED_CALL(getIntensities, pixelType, m_iMProgress, m_pathID, image, intensityList,
-			m_imgDataList, minEnsembleIntensityList, maxEnsembleIntensityList, coordList);
-		m_DatasetIntensityMap.push_back(qMakePair(datasetsList.at(i), intensityList));
+		ITK_TYPED_CALL(getIntensities, pixelType, m_iMProgress, m_pathID, image, datasetsList.at(i),
+			m_profiles, m_imgDataList, minEnsembleIntensityList, maxEnsembleIntensityList);
 	}
 	m_minEnsembleIntensity = *std::min_element(
 		std::begin(minEnsembleIntensityList), std::end(minEnsembleIntensityList));
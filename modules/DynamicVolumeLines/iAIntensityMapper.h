@@ -27,7 +27,7 @@ class iAIntensityMapper : public QObject
 	Q_OBJECT
 
 public:
-	iAIntensityMapper(iAProgress &iMProgress, QDir datasetsDir, PathID pathID, QList<QPair<QString, QList<icData>>> &datasetIntensityMap,
+	iAIntensityMapper(iAProgress &iMProgress, QDir datasetsDir, PathID pathID, iAProfileStore &profiles,
 		QList<vtkSmartPointer<vtkImageData>> &m_imgDataList, double &minEnsembleIntensity, double &maxEnsembleIntensity);
 	~iAIntensityMapper();
 
@@ -42,7 +42,7 @@ private:
 	iAProgress &m_iMProgress;
 	QDir m_datasetsDir;
 	PathID m_pathID;
-	QList<QPair<QString, QList<icData>>> &m_DatasetIntensityMap;
+	iAProfileStore &m_profiles;
 	QList<vtkSmartPointer<vtkImageData>> &m_imgDataList;
 	double &m_minEnsembleIntensity, &m_maxEnsembleIntensity;
 };
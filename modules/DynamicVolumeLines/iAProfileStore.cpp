@@ -0,0 +1,90 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iAProfileStore.h"
+
+#include <algorithm>
+#include <cassert>
+
+iAProfileStore::iAProfileStore()
+{
+	clear();
+}
+
+void iAProfileStore::clear()
+{
+	std::fill(m_dim, m_dim + 3, 0);
+	m_voxelIndices.clear();
+	m_voxelIndices.shrink_to_fit();
+	m_names.clear();
+	m_intensities.clear();
+}
+
+void iAProfileStore::setPath(int const dim[3], std::vector<size_t> && voxelIndices)
+{
+	std::copy(dim, dim + 3, m_dim);
+	m_voxelIndices = std::move(voxelIndices);
+	assert(m_voxelIndices.empty() || m_voxelIndices.size() == static_cast<size_t>(dim[0]) * dim[1] * dim[2]);
+}
+
+size_t iAProfileStore::pathLength() const
+{
+	return static_cast<size_t>(m_dim[0]) * m_dim[1] * m_dim[2];
+}
+
+size_t iAProfileStore::voxelIndex(size_t step) const
+{
+	return m_voxelIndices.empty() ? step : m_voxelIndices[step];
+}
+
+void iAProfileStore::coordinates(size_t step, unsigned int coord[3]) const
+{
+	size_t idx = voxelIndex(step);
+	coord[0] = static_cast<unsigned int>(idx % m_dim[0]);
+	coord[1] = static_cast<unsigned int>((idx / m_dim[0]) % m_dim[1]);
+	coord[2] = static_cast<unsigned int>(idx / (static_cast<size_t>(m_dim[0]) * m_dim[1]));
+}
+
+void iAProfileStore::addProfile(QString const & name, vtkSmartPointer<vtkDataArray> intensities)
+{
+	assert(static_cast<size_t>(intensities->GetNumberOfTuples()) == pathLength());
+	m_names.append(name);
+	m_intensities.append(intensities);
+}
+
+int iAProfileStore::datasetCount() const
+{
+	return m_intensities.size();
+}
+
+QString const & iAProfileStore::datasetName(int datasetIdx) const
+{
+	return m_names[datasetIdx];
+}
+
+vtkDataArray* iAProfileStore::intensities(int datasetIdx) const
+{
+	return m_intensities[datasetIdx];
+}
+
+double iAProfileStore::intensity(int datasetIdx, size_t step) const
+{
+	return m_intensities[datasetIdx]->GetComponent(static_cast<vtkIdType>(step), 0);
+}
@@ -0,0 +1,71 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#pragma once
+
+#include <vtkDataArray.h>
+#include <vtkSmartPointer.h>
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <vector>
+
+//! Contiguous storage for the intensity profiles of an ensemble of datasets along a common path
+//! through the volume (e.g. a Hilbert curve or the scan line order).
+//! The path, i.e. which voxel is visited at each step, is stored only once for all datasets,
+//! as linear voxel index. The intensities of each dataset are kept in a separate column,
+//! in the data type of the dataset.
+class iAProfileStore
+{
+public:
+	iAProfileStore();
+	//! remove path and all profiles
+	void clear();
+	//! Set the path for the profiles.
+	//! @param dim the size of the volumes (all datasets need to have the same size)
+	//! @param voxelIndices the linear (x-fastest) index of the voxel visited at each step of the path;
+	//!        if empty, the path is the scan line order (i.e. step and voxel index are the same)
+	void setPath(int const dim[3], std::vector<size_t> && voxelIndices);
+	//! the number of steps in the path
+	size_t pathLength() const;
+	//! the linear index of the voxel at the given path step
+	size_t voxelIndex(size_t step) const;
+	//! the coordinates of the voxel at the given path step
+	void coordinates(size_t step, unsigned int coord[3]) const;
+	//! add the profile of a dataset
+	//! @param name the dataset name
+	//! @param intensities the intensities of the dataset at each step of the path (pathLength() values)
+	void addProfile(QString const & name, vtkSmartPointer<vtkDataArray> intensities);
+	//! the number of datasets
+	int datasetCount() const;
+	//! the name of the given dataset
+	QString const & datasetName(int datasetIdx) const;
+	//! the intensity column of the given dataset
+	vtkDataArray* intensities(int datasetIdx) const;
+	//! the intensity of the given dataset at the given path step
+	double intensity(int datasetIdx, size_t step) const;
+private:
+	int m_dim[3];
+	std::vector<size_t> m_voxelIndices;
+	QStringList m_names;
+	QVector<vtkSmartPointer<vtkDataArray>> m_intensities;
+};
@@ -20,30 +20,35 @@
 * ************************************************************************************/
 #pragma once
 
+#include <vtkDataArray.h>
+#include <vtkSmartPointer.h>
+
 #include <vector>
 
 // Resource: http://codeforces.com/blog/entry/18051
 
+//! Segment tree for querying histograms of ranges of an intensity profile.
+//! The leaf histograms (containing a single value each) are not stored but derived from the
+//! profile on the fly; the histograms of the inner nodes are stored in one contiguous array.
 class iASegmentTree
 {
-//TODO: to unsigned int or other more general type
 public:
-	iASegmentTree(const std::vector<int> &input, int binCnt, int lowerBnd, int upperBnd);
-	~iASegmentTree();
-	std::vector<int> hist_query(int l, int r);
-	double avg_query(int l, int r);
-	int min_query(int l, int r);
-	int max_query(int l, int r);
+	//! @param input the profile (referenced, not copied)
+	//! @param binCnt the number of histogram bins
+	//! @param lowerBnd the lower bound of the histogram range
+	//! @param upperBnd the upper bound of the histogram range
+	iASegmentTree(vtkDataArray* input, int binCnt, int lowerBnd, int upperBnd);
+	//! adds the histogram of the values in the (half-open) index range [l, r) to hist
+	//! (which needs to have binCnt elements)
+	void hist_query(int l, int r, std::vector<unsigned int> & hist) const;
 
 private:
 	int m_inputElemCnt;
-	std::vector<int> m_input;
-	std::vector<std::vector<int>> m_hist;
-	std::vector<double> m_avg;
-	std::vector<int> m_min;
-	std::vector<int> m_max;
+	int m_binCnt;
+	int m_lowerBnd, m_upperBnd;
+	vtkSmartPointer<vtkDataArray> m_input;
+	std::vector<unsigned int> m_hist;   //!< histograms of the inner nodes 1..m_inputElemCnt-1, node * m_binCnt + bin
+	int leafBin(int leafIdx) const;
+	void addNode(int node, unsigned int * hist) const;
 	void hist_build();
-	void sum_build();
-	void min_build();
-	void max_build();
 };
@@ -0,0 +1,17 @@
+IF (openiA_TESTING_ENABLED)
+	get_filename_component(CoreSrcDir "../core/src" REALPATH BASE_DIR "${CMAKE_CURRENT_SOURCE_DIR}")
+	get_filename_component(CoreBinDir "../core" REALPATH BASE_DIR "${CMAKE_CURRENT_BINARY_DIR}")
+	ADD_EXECUTABLE(CsvParserTest FeatureScout/iACsvParserTest.cpp)
+	TARGET_LINK_LIBRARIES(CsvParserTest PRIVATE FeatureScout ${CORE_LIBRARY_NAME})
+	TARGET_INCLUDE_DIRECTORIES(CsvParserTest PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/FeatureScout ${CMAKE_CURRENT_BINARY_DIR} ${CoreSrcDir} ${CoreBinDir})
+	# small row count for the regular test run; for actual benchmarking, run with larger row count (default 5 million):
+	ADD_TEST(NAME CsvParserTest COMMAND CsvParserTest 10000)
+	IF (MSVC)
+		STRING(REGEX REPLACE "/" "\\\\" QT_WIN_DLL_DIR ${QT_LIB_DIR})
+		SET_TESTS_PROPERTIES(CsvParserTest PROPERTIES ENVIRONMENT "PATH=${QT_WIN_DLL_DIR};$ENV{PATH}")
+	ENDIF()
+
+	IF (openiA_USE_IDE_FOLDERS)
+		SET_PROPERTY(TARGET CsvParserTest PROPERTY FOLDER "Tests")
+	ENDIF()
+ENDIF ()
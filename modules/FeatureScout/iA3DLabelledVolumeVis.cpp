@@ -30,411 +30,226 @@
 
 #include <QStandardItem>
 
+namespace
+{
+	//! if more than 1/RebuildFraction of all labels changed, the transfer functions are rebuilt from the table
+	//! instead of updating the nodes of the changed labels one by one
+	const size_t RebuildFraction = 4;
+	const double ObjectAlpha = 0.5;
+	//! shape of all transfer function nodes; a sharpness of 1 gives constant color/opacity
+	//! up to the midpoint between two labels, as with the previous per-object nodes:
+	const double NodeMidpoint = 0.5;
+	const double NodeSharpness = 1.0;
+}
+
 iA3DLabelledVolumeVis::iA3DLabelledVolumeVis(vtkRenderer* ren, vtkColorTransferFunction* color, vtkPiecewiseFunction* opac,
 		vtkTable* objectTable, QSharedPointer<QMap<uint, uint> > columnMapping, double const * bounds ):
 	iA3DObjectVis(ren, objectTable, columnMapping),
 	oTF(opac),
-	cTF(color)
+	cTF(color),
+	m_colorTFMTime(0),
+	m_opacityTFMTime(0),
+	m_selectionRendered(false),
+	m_selectionClassItem(nullptr),
+	m_selectionClassSize(0)
 {
 	std::copy(bounds, bounds + 6, m_bounds);
 }
 
-void iA3DLabelledVolumeVis::renderSelection( std::vector<size_t> const & sortedSelInds, int /*classID*/, QColor const & classColor, QStandardItem* activeClassItem )
+void iA3DLabelledVolumeVis::resetLabels(QColor const & color, double opacity)
 {
-	QColor BackColor(128, 128, 128, 0);
-	double backRGB[3];
-	backRGB[0] = BackColor.redF(); backRGB[1] = BackColor.greenF(); backRGB[2] = BackColor.blueF(); // background color
-	double red = 0.0, green = 0.0, blue = 0.0, alpha = 0.5, backAlpha = 0.00, classRGB[3], selRGB[3];
-	selRGB[0] = SelectedColor.redF();
-	selRGB[1] = SelectedColor.greenF();
-	selRGB[2] = SelectedColor.blueF();
-	classRGB[0] = classColor.redF();
-	classRGB[1] = classColor.greenF();
-	classRGB[2] = classColor.blueF();
-
-	// clear existing points
-	oTF->RemoveAllPoints();
-	cTF->RemoveAllPoints();
-	oTF->ClampingOff();
-	cTF->ClampingOff();
-	oTF->AddPoint( 0, backAlpha, 0.5, 1.0 );
-	cTF->AddRGBPoint( 0, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-
-	size_t const HidInvalid = std::numeric_limits<size_t>::max();
-	size_t hid = 0, next_hid = 1, prev_hid = HidInvalid;
-	size_t selectionIndex = 0, previous_selectionIndex = 0;
-	bool starting = false, hid_isASelection = false, previous_hid_isASelection = false;
+	size_t labelCount = static_cast<size_t>(m_objectTable->GetNumberOfRows()) + 1;
+	if (m_labelOpacity.size() != labelCount)
+	{
+		m_labelRGB.assign(3 * labelCount, 0.0);
+		m_labelOpacity.assign(labelCount, 0.0);
+		m_labelChanged.assign(labelCount, 0);
+		m_changedLabels.clear();
+		m_colorTFMTime = m_opacityTFMTime = 0;   // forces rebuild
+	}
+	for (size_t label = 0; label < labelCount; ++label)
+	{
+		setLabel(label, color, opacity);
+	}
+}
 
-	int countClass = activeClassItem->rowCount();
-	for (int j = 0; j < countClass; ++j )
+void iA3DLabelledVolumeVis::setLabel(size_t label, QColor const & color, double opacity)
+{
+	double * rgb = &m_labelRGB[3 * label];
+	if (rgb[0] == color.redF() && rgb[1] == color.greenF() && rgb[2] == color.blueF() && m_labelOpacity[label] == opacity)
 	{
-		hid = activeClassItem->child( j )->text().toULongLong();
+		return;
+	}
+	rgb[0] = color.redF();
+	rgb[1] = color.greenF();
+	rgb[2] = color.blueF();
+	m_labelOpacity[label] = opacity;
+	if (!m_labelChanged[label])
+	{
+		m_labelChanged[label] = 1;
+		m_changedLabels.push_back(label);
+	}
+}
 
-		if (sortedSelInds.size() > 0 )
+void iA3DLabelledVolumeVis::updateTransferFunctions()
+{
+	size_t labelCount = m_labelOpacity.size();
+	bool tfUnmodified = cTF->GetMTime() == m_colorTFMTime && oTF->GetMTime() == m_opacityTFMTime &&
+		static_cast<size_t>(cTF->GetSize()) == labelCount && static_cast<size_t>(oTF->GetSize()) == labelCount;
+	if (!tfUnmodified || m_changedLabels.size() > labelCount / RebuildFraction)
+	{
+		// one node per label, at the label value:
+		oTF->BuildFunctionFromTable(0, labelCount - 1, static_cast<int>(labelCount), m_labelOpacity.data());
+		cTF->BuildFunctionFromTable(0, labelCount - 1, static_cast<int>(labelCount), m_labelRGB.data());
+		oTF->ClampingOff();
+		cTF->ClampingOff();
+		// BuildFunctionFromTable creates nodes with sharpness 0 (i.e., linear interpolation between labels):
+		double opacityNode[4], colorNode[6];
+		for (int n = 0; n < oTF->GetSize(); ++n)
 		{
-			if (hid-1 == sortedSelInds[selectionIndex] )
-			{
-				hid_isASelection = true;
-				red = SelectedColor.redF(), green = SelectedColor.greenF(), blue = SelectedColor.blueF();
-
-				if ( selectionIndex + 1 < sortedSelInds.size() )
-					selectionIndex++;
-			}
-			else
-			{
-				hid_isASelection = false;
-				red = classRGB[0]; green = classRGB[1]; blue = classRGB[2];
-			}
-
-			if (prev_hid != HidInvalid)
-			{
-				if (prev_hid-1 == sortedSelInds[previous_selectionIndex])
-				{
-					previous_hid_isASelection = true;
-
-					if ( previous_selectionIndex + 1 < sortedSelInds.size())
-						previous_selectionIndex++;
-				}
-				else
-					previous_hid_isASelection = false;
-			}
+			oTF->GetNodeValue(n, opacityNode);
+			opacityNode[2] = NodeMidpoint;
+			opacityNode[3] = NodeSharpness;
+			oTF->SetNodeValue(n, opacityNode);
 		}
-		else
+		for (int n = 0; n < cTF->GetSize(); ++n)
 		{
-			red = classRGB[0]; green = classRGB[1]; blue = classRGB[2];
+			cTF->GetNodeValue(n, colorNode);
+			colorNode[4] = NodeMidpoint;
+			colorNode[5] = NodeSharpness;
+			cTF->SetNodeValue(n, colorNode);
 		}
-
-		// If we are not yet at the last object (of the class) get the next hid
-		if ( ( j + 1 ) < countClass )
+	}
+	else
+	{
+		for (size_t label : m_changedLabels)
 		{
-			next_hid = activeClassItem->child( j + 1 )->text().toULongLong();
+			// node positions stay the same, so the nodes are not re-sorted:
+			double opacityNode[4] = { static_cast<double>(label), m_labelOpacity[label], NodeMidpoint, NodeSharpness };
+			double colorNode[6] = { static_cast<double>(label),
+				m_labelRGB[3 * label], m_labelRGB[3 * label + 1], m_labelRGB[3 * label + 2], NodeMidpoint, NodeSharpness };
+			oTF->SetNodeValue(static_cast<int>(label), opacityNode);
+			cTF->SetNodeValue(static_cast<int>(label), colorNode);
 		}
-		else	// If hid = the last object (of the class) we have to set the last object points
-		{
-			if ( starting )	// If we are in a sequence we have to set the ending (\)
-			{
-				oTF->AddPoint( hid - 1 + 0.3, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid - 0.5, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid + 0.3, backAlpha, 0.5, 1.0 );
-
-				if ( hid_isASelection )
-				{
-					cTF->AddRGBPoint( hid - 0.5, 1.0, 0.0, 0.0, 0.5, 1.0 );
-					cTF->AddRGBPoint( hid, 1.0, 0.0, 0.0, 0.5, 1.0 );
-					cTF->AddRGBPoint( hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-				}
-				else
-				{
-					cTF->AddRGBPoint( hid - 0.5, classRGB[0], classRGB[1], classRGB[2], 0.5, 1.0 );
-					cTF->AddRGBPoint( hid, classRGB[0], classRGB[1], classRGB[2], 0.5, 1.0 );
-					cTF->AddRGBPoint( hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-				}
+	}
+	for (size_t label : m_changedLabels)
+	{
+		m_labelChanged[label] = 0;
+	}
+	m_changedLabels.clear();
+	m_colorTFMTime = cTF->GetMTime();
+	m_opacityTFMTime = oTF->GetMTime();
+	updateRenderer();
+}
 
-				if ( previous_hid_isASelection )
-					cTF->AddRGBPoint( hid - 1 + 0.3, 1.0, 0.0, 0.0, 0.5, 1.0 );
-				else
-					cTF->AddRGBPoint( hid - 1 + 0.3, classRGB[0], classRGB[1], classRGB[2], 0.5, 1.0 );
-				break;
-			}
-			else	// if we are not in a sequence we have to create the last tooth (/\)
+void iA3DLabelledVolumeVis::renderSelection( std::vector<size_t> const & sortedSelInds, int /*classID*/, QColor const & classColor, QStandardItem* activeClassItem )
+{
+	bool sameClass = m_selectionRendered && m_selectionClassItem == activeClassItem &&
+		m_selectionClassSize == activeClassItem->rowCount() && m_selectionClassColor == classColor &&
+		m_labelOpacity.size() == static_cast<size_t>(m_objectTable->GetNumberOfRows()) + 1;
+	if (sameClass)
+	{
+		// only the objects added to or removed from the selection need to change:
+		auto setSelected = [this, &classColor](size_t selIdx, bool selected)
+		{
+			size_t label = selIdx + 1;
+			if (label < m_inSelectionClass.size() && m_inSelectionClass[label])
 			{
-				oTF->AddPoint( hid - 0.5, backAlpha, 0.5, 1.0 );
-				oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid + 0.3, backAlpha, 0.5, 1.0 );
-
-				cTF->AddRGBPoint( hid - 0.5, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-				cTF->AddRGBPoint( hid, red, green, blue, 0.5, 1.0 );
-				cTF->AddRGBPoint( hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-				break;
+				setLabel(label, selected ? SelectedColor : classColor, ObjectAlpha);
 			}
-		}
-
-		if ( next_hid > hid + 1 && !starting )		//Create one single tooth
-		{
-			oTF->AddPoint( hid - 0.5, backAlpha, 0.5, 1.0 );
-			oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-			oTF->AddPoint( hid + 0.3, backAlpha, 0.5, 1.0 );
-			cTF->AddRGBPoint( hid - 0.5, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-			cTF->AddRGBPoint( hid, red, green, blue, 0.5, 1.0 );
-			cTF->AddRGBPoint( hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-		}
-		else if ( next_hid == hid + 1 && !starting )	//Creates the beginning of a sequence (/)
-		{
-			starting = true;
-			oTF->AddPoint( hid - 0.5, backAlpha, 0.5, 1.0 );
-			oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-			cTF->AddRGBPoint( hid - 0.5, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-			cTF->AddRGBPoint( hid, red, green, blue, 0.5, 1.0 );
-		}
-		else if ( next_hid == hid + 1 && starting )	//Continues the started sequence (-)
+		};
+		auto oldIt = m_selection.begin(), newIt = sortedSelInds.begin();
+		while (oldIt != m_selection.end() || newIt != sortedSelInds.end())
 		{
-			if ( !hid_isASelection && previous_hid_isASelection )
+			if (newIt == sortedSelInds.end() || (oldIt != m_selection.end() && *oldIt < *newIt))
 			{
-				cTF->AddRGBPoint( hid - 1 + 0.3, selRGB[0], selRGB[1], selRGB[2], 0.5, 1.0 );
-				cTF->AddRGBPoint( hid - 0.5, classRGB[0], classRGB[1], classRGB[2], 0.5, 1.0 );
-				cTF->AddRGBPoint( hid + 0.3, classRGB[0], classRGB[1], classRGB[2], 0.5, 1.0 );
-
-				oTF->AddPoint( hid - 1 + 0.3, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid - 0.5, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid + 0.3, alpha, 0.5, 1.0 );
+				setSelected(*oldIt++, false);
 			}
-			else if ( hid_isASelection && !previous_hid_isASelection )
+			else if (oldIt == m_selection.end() || *newIt < *oldIt)
 			{
-				cTF->AddRGBPoint( hid - 0.5, selRGB[0], selRGB[1], selRGB[2], 0.5, 1.0 );
-				cTF->AddRGBPoint( hid + 0.3, selRGB[0], selRGB[1], selRGB[2], 0.5, 1.0 );
-				cTF->AddRGBPoint( hid - 1 + 0.3, classRGB[0], classRGB[1], classRGB[2], 0.5, 1.0 );
-
-				oTF->AddPoint( hid - 0.5, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid + 0.3, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid - 1 + 0.3, alpha, 0.5, 1.0 );
+				setSelected(*newIt++, true);
 			}
-		}
-		else if ( next_hid > hid + 1 && starting )	//  (\)
-		{
-			starting = false;
-
-			oTF->AddPoint( hid - 1 + 0.3, alpha, 0.5, 1.0 );
-			oTF->AddPoint( hid - 0.5, alpha, 0.5, 1.0 );
-			oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-			oTF->AddPoint( hid + 0.3, backAlpha, 0.5, 1.0 );
-
-			if ( previous_hid_isASelection )
-				cTF->AddRGBPoint( hid - 1 + 0.3, selRGB[0], selRGB[1], selRGB[2], 0.5, 1.0 );
 			else
-				cTF->AddRGBPoint( hid - 1 + 0.3, classRGB[0], classRGB[1], classRGB[2], 0.5, 1.0 );
-
-			cTF->AddRGBPoint( hid - 0.5, red, green, blue, 0.5, 1.0 );
-			cTF->AddRGBPoint( hid, red, green, blue, 0.5, 1.0 );
-			cTF->AddRGBPoint( hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
+			{
+				++oldIt;
+				++newIt;
+			}
 		}
-		prev_hid = hid;
 	}
-
-	if ( hid < static_cast<size_t>(m_objectTable->GetNumberOfRows()) )	// Creates the very last points (for all objects)  if it's not created yet
+	else
 	{
-		oTF->AddPoint( m_objectTable->GetNumberOfRows() + 0.3, backAlpha, 0.5, 1.0 );
-		cTF->AddRGBPoint( m_objectTable->GetNumberOfRows() + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
+		resetLabels(QColor(128, 128, 128), 0.0);
+		m_inSelectionClass.assign(m_labelOpacity.size(), 0);
+		for (int j = 0; j < activeClassItem->rowCount(); ++j)
+		{
+			size_t label = activeClassItem->child(j)->text().toULongLong();
+			if (label > 0 && label < m_labelOpacity.size())
+			{
+				m_inSelectionClass[label] = 1;
+				setLabel(label, classColor, ObjectAlpha);
+			}
+		}
+		for (size_t selIdx : sortedSelInds)
+		{
+			if (selIdx + 1 < m_inSelectionClass.size() && m_inSelectionClass[selIdx + 1])
+			{
+				setLabel(selIdx + 1, SelectedColor, ObjectAlpha);
+			}
+		}
 	}
-	updateRenderer();
+	m_selectionRendered = true;
+	m_selectionClassItem = activeClassItem;
+	m_selectionClassSize = activeClassItem->rowCount();
+	m_selectionClassColor = classColor;
+	m_selection = sortedSelInds;
+	updateTransferFunctions();
 }
 
 void iA3DLabelledVolumeVis::renderSingle(IndexType selectedObjID, int /*classID*/, QColor const & classColor, QStandardItem* activeClassItem )
 {
-	int itemL = activeClassItem->rowCount();
-	double red   = classColor.redF(),
-		   green = classColor.greenF(),
-		   blue  = classColor.blueF(),
-		   alpha = 0.5,
-		   backAlpha = 0.0,
-		   backRGB[3] = { 0.0, 0.0, 0.0 };
-
-	// clear existing points
-	oTF->RemoveAllPoints();
-	cTF->RemoveAllPoints();
-
-	// set background opacity and color with clamping off
-	oTF->ClampingOff();
-	cTF->ClampingOff();
-	oTF->AddPoint(0, backAlpha);
-	cTF->AddRGBPoint(0, backRGB[0], backRGB[1], backRGB[2]);
-	if (selectedObjID > 0 ) // for single object selection
+	m_selectionRendered = false;
+	resetLabels(QColor(0, 0, 0), 0.0);
+	if (selectedObjID > 0) // for single object selection
 	{
-		if ( (selectedObjID - 1) >= 0)
-		{
-			oTF->AddPoint(selectedObjID - 0.5, backAlpha);
-			oTF->AddPoint(selectedObjID - 0.49, alpha);
-			cTF->AddRGBPoint(selectedObjID - 0.5, backRGB[0], backRGB[1], backRGB[2]);
-			cTF->AddRGBPoint(selectedObjID - 0.49, red, green, blue);
-		}
-		oTF->AddPoint(selectedObjID, alpha);
-		cTF->AddRGBPoint(selectedObjID, red, green, blue);
-		if ((selectedObjID + 1) <= m_objectTable->GetNumberOfRows())
+		if (static_cast<size_t>(selectedObjID) < m_labelOpacity.size())
 		{
-			oTF->AddPoint(selectedObjID + 0.3, backAlpha);
-			oTF->AddPoint(selectedObjID + 0.29, alpha);
-			cTF->AddRGBPoint(selectedObjID + 0.3, backRGB[0], backRGB[1], backRGB[2]);
-			cTF->AddRGBPoint(selectedObjID + 0.29, red, green, blue);
+			setLabel(static_cast<size_t>(selectedObjID), classColor, ObjectAlpha);
 		}
 	}
 	else // for single class selection
 	{
-		int hid = 0, next_hid = 1;
-		bool starting = false;
-		for ( int j = 0; j < itemL; ++j )
+		for (int j = 0; j < activeClassItem->rowCount(); ++j)
 		{
-			hid = activeClassItem->child( j, 0 )->text().toInt();
-
-			if (j + 1 < itemL)
+			size_t label = activeClassItem->child(j, 0)->text().toULongLong();
+			if (label > 0 && label < m_labelOpacity.size())
 			{
-				next_hid = activeClassItem->child(j + 1, 0)->text().toInt();
+				setLabel(label, classColor, ObjectAlpha);
 			}
-			else
-			{
-				if ( starting )
-				{
-					oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-					oTF->AddPoint( hid + 0.3, backAlpha, 0.5, 1.0 );
-					cTF->AddRGBPoint( hid, red, green, blue, 0.5, 1.0 );
-					cTF->AddRGBPoint( hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-					break;
-				}
-				else
-				{
-					oTF->AddPoint( hid - 0.5, backAlpha, 0.5, 1.0 );
-					oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-					cTF->AddRGBPoint( hid - 0.5, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-					cTF->AddRGBPoint( hid, red, green, blue, 0.5, 1.0 );
-					oTF->AddPoint( hid + 0.3, backAlpha, 0.5, 1.0 );
-					cTF->AddRGBPoint( hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-					break;
-				}
-			}
-
-			//Create one single tooth
-			if ( next_hid > hid + 1 && !starting )
-			{
-				oTF->AddPoint( hid - 0.5, backAlpha, 0.5, 1.0 );
-				oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid + 0.3, backAlpha, 0.5, 1.0 );
-				cTF->AddRGBPoint( hid - 0.5, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-				cTF->AddRGBPoint( hid, red, green, blue, 0.5, 1.0 );
-				cTF->AddRGBPoint( hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-			}
-			else if ( next_hid == hid + 1 && !starting )
-			{
-				starting = true;
-				oTF->AddPoint( hid - 0.5, backAlpha, 0.5, 1.0 );
-				oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-				cTF->AddRGBPoint( hid - 0.5, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-				cTF->AddRGBPoint( hid, red, green, blue, 0.5, 1.0 );
-			}
-			else if ( next_hid == hid + 1 && starting )
-				continue;
-			else if ( next_hid > hid + 1 && starting )
-			{
-				starting = false;
-				oTF->AddPoint( hid, alpha, 0.5, 1.0 );
-				oTF->AddPoint( hid + 0.3, backAlpha, 0.5, 1.0 );
-				cTF->AddRGBPoint( hid, red, green, blue, 0.5, 1.0 );
-				cTF->AddRGBPoint( hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
-			}
-		}
-
-		if ( hid < m_objectTable->GetNumberOfRows() )
-		{
-			oTF->AddPoint( m_objectTable->GetNumberOfRows() + 0.3, backAlpha, 0.5, 1.0 );
-			cTF->AddRGBPoint( m_objectTable->GetNumberOfRows() + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0 );
 		}
 	}
-	updateRenderer();
+	updateTransferFunctions();
 }
 
 void iA3DLabelledVolumeVis::multiClassRendering( QList<QColor> const & classColors, QStandardItem* rootItem, double alpha )
 {
-	double backAlpha = 0.00005;
-	double backRGB[3];
-	backRGB[0] = classColors.at(0).redF();
-	backRGB[1] = classColors.at(0).greenF();
-	backRGB[2] = classColors.at(0).blueF();
-
-	double red = 0.0;
-	double green = 0.0;
-	double blue = 0.0;
-
-	// clear existing points
-	oTF->RemoveAllPoints();
-	cTF->RemoveAllPoints();
-
-	// set background opacity and color
-	oTF->ClampingOff();
-	cTF->ClampingOff();
-
+	m_selectionRendered = false;
+	// objects not in any class are shown almost transparent in the color of the "unclassified" class:
+	resetLabels(classColors.at(0), 0.00005);
+	setLabel(0, classColors.at(0), 0.0);
 	// Iterate through all classes to render, starting with 0 unclassified, 1 Class1,...
 	for (int i = 0; i < classColors.size(); i++)
 	{
-		red   = classColors.at(i).redF();
-		green = classColors.at(i).greenF();
-		blue  = classColors.at(i).blueF();
-
 		QStandardItem *item = rootItem->child(i, 0);
-		int itemL = item->rowCount();
-
-		// Class has no objects, proceed with next class
-		if (!itemL)
-			continue;
-
-		int hid = 0, next_hid = 1;
-		bool starting = false;
-
-		for (int j = 0; j < itemL; ++j)
+		for (int j = 0; j < item->rowCount(); ++j)
 		{
-			hid = item->child(j, 0)->text().toInt();
-
-			if ((j + 1) < itemL)
+			size_t label = item->child(j, 0)->text().toULongLong();
+			if (label > 0 && label < m_labelOpacity.size())
 			{
-				next_hid = item->child(j + 1, 0)->text().toInt();
-			}
-			else
-			{
-				if (starting)
-				{
-					oTF->AddPoint(hid, alpha, 0.5, 1.0);
-					oTF->AddPoint(hid + 0.3, backAlpha, 0.5, 1.0);
-					cTF->AddRGBPoint(hid, red, green, blue, 0.5, 1.0);
-					cTF->AddRGBPoint(hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0);
-					break;
-				}
-				else
-				{
-					oTF->AddPoint(hid - 0.5, backAlpha, 0.5, 1.0);
-					oTF->AddPoint(hid, alpha, 0.5, 1.0);
-					cTF->AddRGBPoint(hid - 0.5, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0);
-					cTF->AddRGBPoint(hid, red, green, blue, 0.5, 1.0);
-					oTF->AddPoint(hid + 0.3, backAlpha, 0.5, 1.0);
-					cTF->AddRGBPoint(hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0);
-					break;
-				}
-			}
-
-			//Create one single tooth
-			if (next_hid > hid + 1 && !starting)
-			{
-				oTF->AddPoint(hid - 0.5, backAlpha, 0.5, 1.0);
-				oTF->AddPoint(hid, alpha, 0.5, 1.0);
-				oTF->AddPoint(hid + 0.3, backAlpha, 0.5, 1.0);
-				cTF->AddRGBPoint(hid - 0.5, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0);
-				cTF->AddRGBPoint(hid, red, green, blue, 0.5, 1.0);
-				cTF->AddRGBPoint(hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0);
-			}
-			else if (next_hid == hid + 1 && !starting)
-			{
-				starting = true;
-				oTF->AddPoint(hid - 0.5, backAlpha, 0.5, 1.0);
-				oTF->AddPoint(hid, alpha, 0.5, 1.0);
-				cTF->AddRGBPoint(hid - 0.5, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0);
-				cTF->AddRGBPoint(hid, red, green, blue, 0.5, 1.0);
-			}
-			else if (next_hid == hid + 1 && starting)
-				continue;
-
-			else if (next_hid > hid + 1 && starting)
-			{
-				starting = false;
-				oTF->AddPoint(hid, alpha, 0.5, 1.0);
-				oTF->AddPoint(hid + 0.3, backAlpha, 0.5, 1.0);
-				cTF->AddRGBPoint(hid, red, green, blue, 0.5, 1.0);
-				cTF->AddRGBPoint(hid + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0);
+				setLabel(label, classColors.at(i), alpha);
 			}
 		}
-
-		if ( hid < m_objectTable->GetNumberOfRows() )
-		{
-			oTF->AddPoint(m_objectTable->GetNumberOfRows() + 0.3, backAlpha, 0.5, 1.0);
-			cTF->AddRGBPoint(m_objectTable->GetNumberOfRows() + 0.3, backRGB[0], backRGB[1], backRGB[2], 0.5, 1.0);
-		}
 	}
-	updateRenderer();
+	updateTransferFunctions();
 }
 
 void iA3DLabelledVolumeVis::renderOrientationDistribution( vtkImageData* oi )
@@ -22,9 +22,15 @@
 
 #include "iA3DObjectVis.h"
 
+#include <QColor>
+
 class vtkPiecewiseFunction;
 class vtkColorTransferFunction;
 
+//! Visualizes objects through a labelled volume, in which each voxel holds the ID (1-based row in the object table)
+//! of the object it belongs to. Color and opacity of each label are kept in a dense table indexed by label ID; the
+//! transfer functions of the volume contain exactly one node per label, at the label's value. On changes, only the
+//! nodes of labels whose color or opacity changed are updated.
 class iA3DLabelledVolumeVis: public iA3DObjectVis
 {
 public:
@@ -37,8 +43,34 @@ public:
 	void renderLengthDistribution(vtkColorTransferFunction* ctFun, vtkFloatArray* extents, double halfInc, int filterID, double const * range ) override;
 	double const * bounds() override;
 private:
+	//! Prepares the label table for the current number of objects, sets all labels to the given color and opacity.
+	void resetLabels(QColor const & color, double opacity);
+	//! Sets color and opacity of one label in the table (and remembers it as changed if they differ).
+	void setLabel(size_t label, QColor const & color, double opacity);
+	//! Transfers the changed labels to the transfer functions; rebuilds them from the table if they were
+	//! modified from elsewhere in the meantime, or if a large part of the labels has changed.
+	void updateTransferFunctions();
+
 	vtkPiecewiseFunction     *oTF;
 	vtkColorTransferFunction *cTF;
 	double m_bounds[6];
+
+	//! @{ dense label table: rgb color (3 values per label) and opacity, indexed by label ID (0 = background)
+	std::vector<double> m_labelRGB;
+	std::vector<double> m_labelOpacity;
+	std::vector<char> m_labelChanged;
+	std::vector<size_t> m_changedLabels;
+	//! @}
+	//! modification times of the transfer functions after they were last set from the table
+	vtkMTimeType m_colorTFMTime, m_opacityTFMTime;
+
+	//! @{ state of the last renderSelection call, to only update the labels whose selection state changed
+	bool m_selectionRendered;
+	QStandardItem* m_selectionClassItem;
+	int m_selectionClassSize;
+	QColor m_selectionClassColor;
+	std::vector<char> m_inSelectionClass;  //!< per label: whether the object is part of the rendered class
+	std::vector<size_t> m_selection;
+	//! @}
 };
 
@@ -30,6 +30,10 @@
 #include <QStringList>
 #include <QTextCodec>
 #include <QTextStream>
+#include <QThread>
+
+#include <atomic>
+#include <cstring>    // for memchr
 
 const char* iACsvIO::ColNameAutoID = "Auto_ID";
 const char* iACsvIO::ColNameClassID = "Class_ID";
@@ -108,12 +112,280 @@ namespace
 		}
 		return transformValue(value, index, config).toDouble();
 	}
+
+	//! numeric equivalent of transformValue
+	double transformNumericValue(double value, uint idx, iACsvConfig const& config)
+	{
+		if (config.offset[0] != 0 && (
+			(config.columnMapping.contains(iACsvConfig::CenterX) && idx == config.columnMapping[iACsvConfig::CenterX]) ||
+			(config.columnMapping.contains(iACsvConfig::StartX) && idx == config.columnMapping[iACsvConfig::StartX]) ||
+			(config.columnMapping.contains(iACsvConfig::EndX) && idx == config.columnMapping[iACsvConfig::EndX])))
+		{
+			return value + config.offset[0];
+		}
+		else if (config.offset[1] != 0 && (
+			(config.columnMapping.contains(iACsvConfig::CenterY) && idx == config.columnMapping[iACsvConfig::CenterY]) ||
+			(config.columnMapping.contains(iACsvConfig::StartY) && idx == config.columnMapping[iACsvConfig::StartY]) ||
+			(config.columnMapping.contains(iACsvConfig::EndY) && idx == config.columnMapping[iACsvConfig::EndY])))
+		{
+			return value + config.offset[1];
+		}
+		else if (config.offset[2] != 0 && (
+			(config.columnMapping.contains(iACsvConfig::CenterZ) && idx == config.columnMapping[iACsvConfig::CenterZ]) ||
+			(config.columnMapping.contains(iACsvConfig::StartZ) && idx == config.columnMapping[iACsvConfig::StartZ]) ||
+			(config.columnMapping.contains(iACsvConfig::EndZ) && idx == config.columnMapping[iACsvConfig::EndZ])))
+		{
+			return value + config.offset[2];
+		}
+		else if (config.columnMapping.contains(iACsvConfig::Theta) && idx == config.columnMapping[iACsvConfig::Theta] && value < 0)
+		{
+			return 2 * vtkMath::Pi() + value;
+		}
+		else
+		{
+			return value;
+		}
+	}
+
+	//! Computes the values of the columns derived from other columns (as specified in the configuration),
+	//! in the order in which they are appended to the output table.
+	//! @param config the csv configuration
+	//! @param getValue function returning the (transformed) value of the input column with given index
+	//! @param addValue function appending a derived value to the output row
+	template <typename GetValueFunc, typename AddValueFunc>
+	void computeDerivedValues(iACsvConfig const & config, GetValueFunc getValue, AddValueFunc addValue)
+	{
+		if (config.computeStartEnd)
+		{
+			double center[3];
+			center[0] = getValue(config.columnMapping[iACsvConfig::CenterX]);
+			center[1] = getValue(config.columnMapping[iACsvConfig::CenterY]);
+			center[2] = getValue(config.columnMapping[iACsvConfig::CenterZ]);
+			double phi = getValue(config.columnMapping[iACsvConfig::Phi]);
+			double theta = getValue(config.columnMapping[iACsvConfig::Theta]);
+			double radius = getValue(config.columnMapping[iACsvConfig::Length]) * 0.5;
+			double dir[3];
+			dir[0] = radius * std::sin(phi) * std::cos(theta);
+			dir[1] = radius * std::sin(phi) * std::sin(theta);
+			dir[2] = radius * std::cos(phi);
+			for (int i = 0; i < 3; ++i)
+			{
+				addValue(center[i] + dir[i]); // start
+			}
+			for (int i = 0; i < 3; ++i)
+			{
+				addValue(center[i] - dir[i]); // end
+			}
+		}
+		if (config.isDiameterFixed)
+		{
+			addValue(config.fixedDiameterValue);
+		}
+		double phi = 0.0, theta = 0.0;
+		if (config.computeLength || config.computeAngles || config.computeCenter)
+		{
+			double x1 = getValue(config.columnMapping[iACsvConfig::StartX]);
+			double y1 = getValue(config.columnMapping[iACsvConfig::StartY]);
+			double z1 = getValue(config.columnMapping[iACsvConfig::StartZ]);
+			double x2 = getValue(config.columnMapping[iACsvConfig::EndX]);
+			double y2 = getValue(config.columnMapping[iACsvConfig::EndY]);
+			double z2 = getValue(config.columnMapping[iACsvConfig::EndZ]);
+			double dx = x1 - x2;
+			double dy = y1 - y2;
+			double dz = z1 - z2;
+			if (dz < 0)
+			{
+				dx = x2 - x1;
+				dy = y2 - y1;
+				dz = z2 - z1;
+			}
+			if (config.computeLength)
+			{
+				double length = std::sqrt(dx * dx + dy * dy + dz * dz);
+				addValue(length);
+			}
+			if (config.computeCenter)
+			{
+				double xm = (x1 + x2) / 2.0f;
+				double ym = (y1 + y2) / 2.0f;
+				double zm = (z1 + z2) / 2.0f;
+				addValue(xm);
+				addValue(ym);
+				addValue(zm);
+			}
+			if (config.computeAngles)
+			{
+				if (dx == 0 && dy == 0)
+				{
+					phi = 0.0;
+					theta = 0.0;
+				}
+				else
+				{
+					phi = asin(dy / sqrt(dx * dx + dy * dy));
+					theta = acos(dz / sqrt(dx * dx + dy * dy + dz * dz));
+					phi = vtkMath::DegreesFromRadians(phi);
+					theta = vtkMath::DegreesFromRadians(theta);
+					// locate the phi value to quadrant
+					if (dx < 0)
+					{
+						phi = 180.0 - phi;
+					}
+					if (phi < 0.0)
+					{
+						phi = phi + 360.0;
+					}
+				}
+				addValue(phi);
+				addValue(theta);
+			}
+		}
+		if (config.computeTensors)
+		{
+			if (!config.computeAngles)
+			{
+				phi = getValue(config.columnMapping[iACsvConfig::Phi]);
+				theta = getValue(config.columnMapping[iACsvConfig::Theta]);
+			}
+			double rad_phi = vtkMath::RadiansFromDegrees(phi);
+			double rad_theta = vtkMath::RadiansFromDegrees(theta);
+			double a11 = cos(rad_phi) * cos(rad_phi) * sin(rad_theta) * sin(rad_theta);
+			double a22 = sin(rad_phi) * sin(rad_phi) * sin(rad_theta) * sin(rad_theta);
+			double a33 = cos(rad_theta) * cos(rad_theta);
+			double a12 = cos(rad_phi) * sin(rad_theta) * sin(rad_theta) * sin(rad_phi);
+			double a13 = cos(rad_phi) * sin(rad_theta) * cos(rad_theta);
+			double a23 = sin(rad_phi) * sin(rad_theta) * cos(rad_theta);
+			addValue(a11);
+			addValue(a22);
+			addValue(a33);
+			addValue(a12);
+			addValue(a13);
+			addValue(a23);
+		}
+	}
+
+	//! powers of ten which are exactly representable as double
+	const double ExactPowersOf10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const int MaxExactPowerOf10 = 22;
+	const int MaxMantissaDigits = 19;
+	const quint64 MaxExactMantissa = static_cast<quint64>(1) << 53;
+
+	bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	bool isBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	//! Parse a floating point number from the given (not null-terminated) character range, independent of locale.
+	//! Numbers whose mantissa and power of ten are both exactly representable as double are computed
+	//! directly (the result is then correctly rounded, see Clinger's fast path); all other numbers,
+	//! and special values like nan or inf, are parsed through QByteArray::toDouble.
+	//! As with QString::toDouble, an invalid number results in 0.
+	double parseDouble(char const * begin, char const * end, char decimalSeparator)
+	{
+		while (begin < end && isBlank(*begin))
+		{
+			++begin;
+		}
+		while (end > begin && isBlank(*(end - 1)))
+		{
+			--end;
+		}
+		char const * p = begin;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			++p;
+		}
+		quint64 mantissa = 0;
+		int digits = 0;
+		int exp10 = 0;
+		bool anyDigit = false;
+		bool exact = true;
+		for (; p < end && isDigit(*p); ++p)
+		{
+			anyDigit = true;
+			if (mantissa == 0 && *p == '0')
+			{
+				continue;
+			}
+			exact &= (++digits <= MaxMantissaDigits);
+			mantissa = mantissa * 10 + (*p - '0');
+		}
+		if (p < end && *p == decimalSeparator)
+		{
+			for (++p; p < end && isDigit(*p); ++p)
+			{
+				anyDigit = true;
+				--exp10;
+				if (mantissa == 0 && *p == '0')
+				{
+					continue;
+				}
+				exact &= (++digits <= MaxMantissaDigits);
+				mantissa = mantissa * 10 + (*p - '0');
+			}
+		}
+		if (anyDigit && p < end && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+			bool expNegative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				expNegative = (*p == '-');
+				++p;
+			}
+			int exponent = 0;
+			bool anyExpDigit = false;
+			for (; p < end && isDigit(*p); ++p)
+			{
+				anyExpDigit = true;
+				exponent = std::min(exponent * 10 + (*p - '0'), 100000);
+			}
+			exact &= anyExpDigit;
+			exp10 += expNegative ? -exponent : exponent;
+		}
+		if (exact && anyDigit && p == end && mantissa <= MaxExactMantissa &&
+			(mantissa == 0 || (exp10 >= -MaxExactPowerOf10 && exp10 <= MaxExactPowerOf10)))
+		{
+			double value = static_cast<double>(mantissa);
+			if (mantissa != 0)
+			{
+				value = (exp10 < 0) ? value / ExactPowersOf10[-exp10] : value * ExactPowersOf10[exp10];
+			}
+			return negative ? -value : value;
+		}
+		// slow path:
+		QByteArray number(begin, static_cast<int>(end - begin));
+		if (decimalSeparator != '.')
+		{
+			number.replace(decimalSeparator, '.');
+		}
+		return number.toDouble();
+	}
+
+	//! minimum number of bytes per chunk processed by a single thread in the fast parser
+	const qint64 MinChunkSize = 1 << 20;
 }
 
 iACsvIO::iACsvIO():
-	m_outputMapping(new QMap<uint, uint>)
+	m_outputMapping(new QMap<uint, uint>),
+	m_fastParsing(true)
 {}
 
+void iACsvIO::setFastParsing(bool enabled)
+{
+	m_fastParsing = enabled;
+}
+
 bool iACsvIO::loadCSV(iACsvTableCreator & dstTbl, iACsvConfig const & cnfg_params, size_t const rowCount)
 {
 	m_csvConfig = cnfg_params;
@@ -122,6 +394,14 @@ bool iACsvIO::loadCSV(iACsvTableCreator & dstTbl, iACsvConfig const & cnfg_param
 		DEBUG_LOG("Error loading csv file, file does not exist.");
 		return false;
 	}
+	if (m_fastParsing && dstTbl.acceptsNumericRows())
+	{
+		FastParseResult result = loadCSVFast(dstTbl, rowCount);
+		if (result != FastParseNotApplicable)
+		{
+			return result == FastParseSuccess;
+		}
+	}
 	QFile file(m_csvConfig.fileName);
 	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
 	{
@@ -198,135 +478,209 @@ bool iACsvIO::loadCSV(iACsvTableCreator & dstTbl, iACsvConfig const & cnfg_param
 			}
 			entries.append(transformValue(value, valIdx, m_csvConfig));
 		}
-		if (m_csvConfig.computeStartEnd)
+		computeDerivedValues(m_csvConfig,
+			[&values, this](uint idx) { return getValueAsDouble(values, idx, m_csvConfig); },
+			[&entries](double value) { entries.append(DblToString(value)); });
+		if (m_csvConfig.addClassID)
 		{
-			double center[3];
-			center[0] = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::CenterX], m_csvConfig);
-			center[1] = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::CenterY], m_csvConfig);
-			center[2] = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::CenterZ], m_csvConfig);
-			double phi = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::Phi], m_csvConfig);
-			double theta = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::Theta], m_csvConfig);
-			double radius = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::Length], m_csvConfig) * 0.5;
-			double dir[3];
-			dir[0] = radius * std::sin(phi) * std::cos(theta);
-			dir[1] = radius * std::sin(phi) * std::sin(theta);
-			dir[2] = radius * std::cos(phi);
-			for (int i = 0; i < 3; ++i)
-			{
-				entries.append(DblToString(center[i] + dir[i])); // start
-			}
-			for (int i = 0; i < 3; ++i)
+			entries.append("0"); // class ID
+		}
+		dstTbl.addRow(resultRowID-1, entries);
+		++resultRowID;
+	}
+	if (file.isOpen())
+	{
+		file.close();
+	}
+	return true;
+}
+
+iACsvIO::FastParseResult iACsvIO::loadCSVFast(iACsvTableCreator & dstTbl, size_t const rowCount)
+{
+	// check whether configuration allows fast parsing:
+	QTextCodec* codec = QTextCodec::codecForName(m_csvConfig.encoding.toLatin1());
+	QByteArray const asciiChars(",;.:|\t 0123456789+-eE\r\n");
+	if (!codec || codec->fromUnicode(QString::fromLatin1(asciiChars)) != asciiChars ||
+		m_csvConfig.columnSeparator.size() != 1 || m_csvConfig.columnSeparator[0].unicode() > 127 ||
+		m_csvConfig.decimalSeparator.size() != 1 || m_csvConfig.decimalSeparator[0].unicode() > 127)
+	{
+		return FastParseNotApplicable;
+	}
+	char const columnSeparator = m_csvConfig.columnSeparator[0].toLatin1();
+	char const decimalSeparator = m_csvConfig.decimalSeparator[0].toLatin1();
+
+	QFile file(m_csvConfig.fileName);
+	if (!file.open(QIODevice::ReadOnly) || file.size() <= 0)
+	{
+		return FastParseNotApplicable;
+	}
+	char const * data = reinterpret_cast<char const *>(file.map(0, file.size()));
+	if (!data)
+	{
+		return FastParseNotApplicable;
+	}
+	char const * end = data + file.size();
+	auto nextLine = [end](char const * p) -> char const *
+	{
+		char const * newLine = static_cast<char const *>(std::memchr(p, '\n', end - p));
+		return newLine ? newLine + 1 : end;
+	};
+	auto isBlankLine = [](char const * lineStart, char const * lineEnd)
+	{
+		for (char const * p = lineStart; p < lineEnd; ++p)
+		{
+			if (!isBlank(*p))
 			{
-				entries.append(DblToString(center[i] - dir[i])); // end
+				return false;
 			}
 		}
-		if (m_csvConfig.isDiameterFixed)
+		return true;
+	};
+
+	char const * pos = data;
+	if (end - pos >= 3 && static_cast<uchar>(pos[0]) == 0xEF && static_cast<uchar>(pos[1]) == 0xBB && static_cast<uchar>(pos[2]) == 0xBF)
+	{	// skip UTF-8 byte order mark
+		pos += 3;
+	}
+	for (size_t i = 0; i < m_csvConfig.skipLinesStart && pos < end; ++i)
+	{
+		pos = nextLine(pos);
+	}
+	if (m_csvConfig.containsHeader)
+	{
+		char const * headerEnd = nextLine(pos);
+		QString headerLine = codec->toUnicode(pos, static_cast<int>(headerEnd - pos));
+		while (headerLine.endsWith('\n') || headerLine.endsWith('\r'))
 		{
-			entries.append(DblToString(m_csvConfig.fixedDiameterValue));
+			headerLine.chop(1);
 		}
-		double phi = 0.0, theta = 0.0;
-		if (m_csvConfig.computeLength || m_csvConfig.computeAngles || m_csvConfig.computeCenter)
-		{
-			double x1 = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::StartX], m_csvConfig);
-			double y1 = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::StartY], m_csvConfig);
-			double z1 = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::StartZ], m_csvConfig);
-			double x2 = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::EndX], m_csvConfig);
-			double y2 = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::EndY], m_csvConfig);
-			double z2 = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::EndZ], m_csvConfig);
-			double dx = x1 - x2;
-			double dy = y1 - y2;
-			double dz = z1 - z2;
-			if (dz < 0)
+		m_fileHeaders = headerLine.split(m_csvConfig.columnSeparator);
+		pos = headerEnd;
+	}
+	else
+	{
+		m_fileHeaders = m_csvConfig.currentHeaders;
+	}
+
+	// split remaining data into line-aligned chunks:
+	qint64 const dataSize = end - pos;
+	qint64 const chunkCount = std::max(static_cast<qint64>(1),
+		std::min(static_cast<qint64>(QThread::idealThreadCount()) * 4, dataSize / MinChunkSize));
+	std::vector<char const *> chunkStart(chunkCount + 1);
+	chunkStart[0] = pos;
+	for (qint64 c = 1; c < chunkCount; ++c)
+	{
+		chunkStart[c] = nextLine(std::max(pos + dataSize * c / chunkCount, chunkStart[c - 1]));
+	}
+	chunkStart[chunkCount] = end;
+
+	// count (non-empty) lines per chunk:
+	std::vector<qint64> chunkFirstRow(chunkCount + 1, 0);
+#pragma omp parallel for
+	for (qint64 c = 0; c < chunkCount; ++c)
+	{
+		qint64 lineCount = 0;
+		for (char const * lineStart = chunkStart[c]; lineStart < chunkStart[c + 1]; )
+		{
+			char const * lineEnd = nextLine(lineStart);
+			if (!isBlankLine(lineStart, lineEnd))
 			{
-				dx = x2 - x1;
-				dy = y2 - y1;
-				dz = z2 - z1;
+				++lineCount;
 			}
-			if (m_csvConfig.computeLength)
+			lineStart = lineEnd;
+		}
+		chunkFirstRow[c + 1] = lineCount;
+	}
+	for (qint64 c = 0; c < chunkCount; ++c)
+	{
+		chunkFirstRow[c + 1] += chunkFirstRow[c];
+	}
+	size_t totalRowCount = static_cast<size_t>(chunkFirstRow[chunkCount]);
+	size_t effectiveRowCount = std::min(rowCount,
+		(totalRowCount > m_csvConfig.skipLinesEnd) ? totalRowCount - m_csvConfig.skipLinesEnd : 0);
+	if (effectiveRowCount == 0)
+	{
+		DEBUG_LOG("No rows to load in the csv file!");
+		return FastParseFailed;
+	}
+
+	auto selectedColIdx = computeSelectedColIdx();
+	determineOutputHeaders(selectedColIdx);
+	dstTbl.initialize(m_outputHeaders, effectiveRowCount);
+
+	// parse chunks in parallel:
+	size_t const minFieldCount = static_cast<size_t>(m_csvConfig.currentHeaders.size());
+	std::atomic<bool> irregular(false);
+#pragma omp parallel for
+	for (qint64 c = 0; c < chunkCount; ++c)
+	{
+		std::vector<double> fields;
+		std::vector<double> row;
+		row.reserve(m_outputHeaders.size());
+		size_t rowIdx = static_cast<size_t>(chunkFirstRow[c]);
+		for (char const * lineStart = chunkStart[c]; lineStart < chunkStart[c + 1] && rowIdx < effectiveRowCount && !irregular; )
+		{
+			char const * lineEnd = nextLine(lineStart);
+			if (isBlankLine(lineStart, lineEnd))
 			{
-				double length = std::sqrt(dx * dx + dy * dy + dz * dz);
-				entries.append(DblToString(length));
+				lineStart = lineEnd;
+				continue;
 			}
-			if (m_csvConfig.computeCenter)
+			char const * contentEnd = lineEnd;
+			while (contentEnd > lineStart && (*(contentEnd - 1) == '\n' || *(contentEnd - 1) == '\r'))
 			{
-				double xm = (x1 + x2) / 2.0f;
-				double ym = (y1 + y2) / 2.0f;
-				double zm = (z1 + z2) / 2.0f;
-				entries.append(DblToString(xm));
-				entries.append(DblToString(ym));
-				entries.append(DblToString(zm));
+				--contentEnd;
 			}
-			if (m_csvConfig.computeAngles)
+			fields.clear();
+			for (char const * fieldStart = lineStart; ; )
 			{
-				if (dx == 0 && dy == 0)
+				char const * sepPos = static_cast<char const *>(std::memchr(fieldStart, columnSeparator, contentEnd - fieldStart));
+				fields.push_back(parseDouble(fieldStart, sepPos ? sepPos : contentEnd, decimalSeparator));
+				if (!sepPos)
 				{
-					phi = 0.0;
-					theta = 0.0;
+					break;
 				}
-				else
+				fieldStart = sepPos + 1;
+			}
+			if (fields.size() < minFieldCount || (!m_csvConfig.addAutoID && fields[0] != rowIdx + 1))
+			{   // let the regular parser handle (and report) the irregularities:
+				irregular = true;
+				break;
+			}
+			row.clear();
+			if (m_csvConfig.addAutoID)
+			{
+				row.push_back(rowIdx + 1);
+			}
+			for (uint valIdx : selectedColIdx)
+			{
+				if (valIdx >= fields.size())
 				{
-					phi = asin(dy / sqrt(dx * dx + dy * dy));
-					theta = acos(dz / sqrt(dx * dx + dy * dy + dz * dz));
-					phi = vtkMath::DegreesFromRadians(phi);
-					theta = vtkMath::DegreesFromRadians(theta);
-					// locate the phi value to quadrant
-					if (dx < 0)
-					{
-						phi = 180.0 - phi;
-					}
-					if (phi < 0.0)
-					{
-						phi = phi + 360.0;
-					}
+					irregular = true;
+					break;
 				}
-				entries.append(DblToString(phi));
-				entries.append(DblToString(theta));
+				row.push_back(transformNumericValue(fields[valIdx], valIdx, m_csvConfig));
 			}
-		}
-		if (m_csvConfig.computeTensors)
-		{
-			if (!m_csvConfig.computeAngles)
+			computeDerivedValues(m_csvConfig,
+				[&fields, this](uint idx) { return (idx < fields.size()) ? transformNumericValue(fields[idx], idx, m_csvConfig) : 0.0; },
+				[&row](double value) { row.push_back(value); });
+			if (m_csvConfig.addClassID)
 			{
-				phi = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::Phi], m_csvConfig);
-				theta = getValueAsDouble(values, m_csvConfig.columnMapping[iACsvConfig::Theta], m_csvConfig);
+				row.push_back(0); // class ID
 			}
-			double rad_phi = vtkMath::RadiansFromDegrees(phi);
-			double rad_theta = vtkMath::RadiansFromDegrees(theta);
-			double a11 = cos(rad_phi) * cos(rad_phi) * sin(rad_theta) * sin(rad_theta);
-			double a22 = sin(rad_phi) * sin(rad_phi) * sin(rad_theta) * sin(rad_theta);
-			double a33 = cos(rad_theta) * cos(rad_theta);
-			double a12 = cos(rad_phi) * sin(rad_theta) * sin(rad_theta) * sin(rad_phi);
-			double a13 = cos(rad_phi) * sin(rad_theta) * cos(rad_theta);
-			double a23 = sin(rad_phi) * sin(rad_theta) * cos(rad_theta);
-			/*
-			if (dx == 0 && dy == 0)
+			if (!irregular)
 			{
-				a11 = 0.0;
-				a22 = 0.0;
-				a12 = 0.0;
-				a13 = 0.0;
-				a23 = 0.0;
+				dstTbl.addNumericRow(rowIdx, row.data(), row.size());
 			}
-			*/
-			entries.append(DblToString(a11));
-			entries.append(DblToString(a22));
-			entries.append(DblToString(a33));
-			entries.append(DblToString(a12));
-			entries.append(DblToString(a13));
-			entries.append(DblToString(a23));
-		}
-		if (m_csvConfig.addClassID)
-		{
-			entries.append("0"); // class ID
+			++rowIdx;
+			lineStart = lineEnd;
 		}
-		dstTbl.addRow(resultRowID-1, entries);
-		++resultRowID;
 	}
-	if (file.isOpen())
+	if (irregular)
 	{
-		file.close();
+		return FastParseNotApplicable;
 	}
-	return true;
+	return FastParseSuccess;
 }
 
 void iACsvIO::determineOutputHeaders(QVector<uint> const & selectedCols)
@@ -46,6 +46,12 @@ class iACsvTableCreator
 public:
 	virtual void initialize(QStringList const & headers, size_t const rowCount) = 0;
 	virtual void addRow(size_t row, QStringList const & values) = 0;
+	//! whether this creator can receive rows as numeric values (see addNumericRow).
+	//! If it can, iACsvIO uses a faster, multi-threaded parser (if the csv configuration allows it).
+	virtual bool acceptsNumericRows() const { return false; }
+	//! add a row of numeric values; only called if acceptsNumericRows() returns true.
+	//! Might be called concurrently from multiple threads (but never twice for the same row).
+	virtual void addNumericRow(size_t /*row*/, double const * /*values*/, size_t /*count*/) {}
 };
 
 //! class for reading a csv into a table, using given options
@@ -58,6 +64,11 @@ public:
 	//! reads table entries from csv file
 	bool loadCSV(iACsvTableCreator & dstTbl, iACsvConfig const & params,
 		size_t const rowCount = std::numeric_limits<size_t>::max());
+	//! Enable or disable the fast parser (enabled by default).
+	//! The fast parser memory-maps the file and parses it in parallel, directly into numeric values;
+	//! it is only used if the table creator accepts numeric rows, and the csv configuration allows it
+	//! (ASCII-compatible encoding, single-character column and decimal separators).
+	void setFastParsing(bool enabled);
 	//! get the list of columns/headers as it is in the file
 	const QStringList & getFileHeaders() const;
 	//! get list of all headers in result table (including computed columns)
@@ -69,6 +80,12 @@ private:
 	QStringList m_outputHeaders;        //!< list of column header names in result table
 	iACsvConfig m_csvConfig;            //!< settings used for reading the csv
 	QSharedPointer<QMap<uint, uint> > m_outputMapping;   //!< maps a value identifier (given as a value out of the iACsvConfig::MappedColumn enum) to the index of the column in the output which contains this value
+	bool m_fastParsing;                 //!< whether the fast parser should be used (if possible)
+
+	//! possible outcomes of the fast parser
+	enum FastParseResult { FastParseSuccess, FastParseFailed, FastParseNotApplicable };
+	//! reads table entries from csv file with the fast parser
+	FastParseResult loadCSVFast(iACsvTableCreator & dstTbl, size_t const rowCount);
 
 	//! determine the header columns used in the output
 	void determineOutputHeaders(QVector<uint> const & selectedCols);
@@ -0,0 +1,161 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iACsvConfig.h"
+#include "iACsvIO.h"
+#include "iACsvVectorTableCreator.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// Compares the regular (line-by-line, QString-based) csv parser to the fast (memory-mapped,
+// multi-threaded) parser: both have to produce the same values; reports the time taken by each.
+// Usage: CsvParserTest [rowCount]
+
+namespace
+{
+	const size_t DefaultRowCount = 5000000;
+	const double Tolerance = 1e-9;
+
+	bool writeSyntheticCsv(QString const & fileName, size_t rowCount)
+	{
+		QFile file(fileName);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		{
+			return false;
+		}
+		QTextStream out(&file);
+		out << "ID,X1,Y1,Z1,X2,Y2,Z2,Diameter,Volume\n";
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<double> coordDist(0.0, 500.0);
+		std::uniform_real_distribution<double> diameterDist(5.0, 15.0);
+		for (size_t row = 0; row < rowCount; ++row)
+		{
+			out << (row + 1);
+			for (int i = 0; i < 6; ++i)
+			{
+				out << "," << QString::number(coordDist(rng), 'f', 6);
+			}
+			out << "," << QString::number(diameterDist(rng), 'g', 8)
+				<< "," << QString::number(coordDist(rng) * 1e4, 'e', 5) << "\n";
+		}
+		return true;
+	}
+
+	iACsvConfig benchmarkConfig(QString const & fileName)
+	{
+		iACsvConfig config;
+		config.fileName = fileName;
+		config.encoding = "UTF-8";
+		config.skipLinesStart = 0;
+		config.columnSeparator = ",";
+		config.currentHeaders = QString("ID,X1,Y1,Z1,X2,Y2,Z2,Diameter,Volume").split(",");
+		config.selectedHeaders = config.currentHeaders;
+		config.offset[0] = 1.5;
+		for (uint i = iACsvConfig::StartX; i <= iACsvConfig::EndZ; ++i)
+		{
+			config.columnMapping.insert(i, i + 1);
+		}
+		config.columnMapping.insert(iACsvConfig::Diameter, 7);
+		config.computeLength = true;
+		config.computeCenter = true;
+		config.computeAngles = true;
+		config.computeTensors = true;
+		return config;
+	}
+
+	bool load(iACsvConfig const & config, bool fastParsing, iACsvVectorTableCreator & creator, qint64 & elapsed)
+	{
+		iACsvIO io;
+		io.setFastParsing(fastParsing);
+		QElapsedTimer timer;
+		timer.start();
+		bool result = io.loadCSV(creator, config);
+		elapsed = timer.elapsed();
+		return result;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	size_t rowCount = (argc > 1) ? QString(argv[1]).toULongLong() : DefaultRowCount;
+	QTemporaryDir tmpDir;
+	QString fileName = tmpDir.path() + "/benchmark.csv";
+	if (!tmpDir.isValid() || !writeSyntheticCsv(fileName, rowCount))
+	{
+		std::cout << "Could not create benchmark data file " << fileName.toStdString() << std::endl;
+		return 1;
+	}
+	auto config = benchmarkConfig(fileName);
+
+	iACsvVectorTableCreator regular, fast;
+	qint64 regularTime, fastTime;
+	if (!load(config, false, regular, regularTime) || !load(config, true, fast, fastTime))
+	{
+		std::cout << "Loading csv file failed!" << std::endl;
+		return 1;
+	}
+	std::cout << "Rows: " << rowCount << std::endl
+		<< "Regular parser: " << regularTime << " ms" << std::endl
+		<< "Fast parser:    " << fastTime << " ms" << std::endl;
+
+	auto const & expected = regular.table();
+	auto const & actual = fast.table();
+	if (regular.header() != fast.header() || expected.size() != actual.size())
+	{
+		std::cout << "Column mismatch between regular and fast parser!" << std::endl;
+		return 1;
+	}
+	size_t mismatches = 0;
+	for (size_t col = 0; col < expected.size(); ++col)
+	{
+		if (expected[col].size() != actual[col].size())
+		{
+			std::cout << "Row count mismatch in column " << col << "!" << std::endl;
+			return 1;
+		}
+		for (size_t row = 0; row < expected[col].size(); ++row)
+		{
+			double diff = std::abs(expected[col][row] - actual[col][row]);
+			if (diff > Tolerance * std::max(1.0, std::abs(expected[col][row])))
+			{
+				if (mismatches < 10)
+				{
+					std::cout << "Mismatch in row " << row << ", column " << col << ": "
+						<< expected[col][row] << " != " << actual[col][row] << std::endl;
+				}
+				++mismatches;
+			}
+		}
+	}
+	if (mismatches > 0)
+	{
+		std::cout << mismatches << " values differ between regular and fast parser!" << std::endl;
+		return 1;
+	}
+	std::cout << "Results of regular and fast parser are equal." << std::endl;
+	return 0;
+}
@@ -27,6 +27,7 @@ iACsvVectorTableCreator::iACsvVectorTableCreator()
 void iACsvVectorTableCreator::initialize(QStringList const & headers, size_t const rowCount)
 {
 	m_header = headers;
+	m_values.clear();
 	for (int col = 0; col < headers.size(); ++col)
 	{
 		m_values.push_back(std::vector<double>(rowCount, 0));
@@ -41,6 +42,19 @@ void iACsvVectorTableCreator::addRow(size_t row, QStringList const & values)
 	}
 }
 
+bool iACsvVectorTableCreator::acceptsNumericRows() const
+{
+	return true;
+}
+
+void iACsvVectorTableCreator::addNumericRow(size_t row, double const * values, size_t count)
+{
+	for (size_t col = 0; col < count; ++col)
+	{
+		m_values[col][row] = values[col];
+	}
+}
+
 iACsvVectorTableCreator::TableType const& iACsvVectorTableCreator::table()
 {
 	return m_values;
@@ -34,6 +34,8 @@ public:
 	iACsvVectorTableCreator();
 	void initialize(QStringList const & headers, size_t const rowCount) override;
 	void addRow(size_t row, QStringList const & values) override;
+	bool acceptsNumericRows() const override;
+	void addNumericRow(size_t row, double const * values, size_t count) override;
 	TableType const & table();
 	QStringList const& header();
 private:
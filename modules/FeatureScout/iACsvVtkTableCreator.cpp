@@ -26,7 +26,9 @@
 #include <vtkTable.h>
 
 iACsvVtkTableCreator::iACsvVtkTableCreator()
-	: m_table(vtkSmartPointer<vtkTable>::New())
+	: m_table(vtkSmartPointer<vtkTable>::New()),
+	m_idValues(nullptr),
+	m_classValues(nullptr)
 {}
 
 void iACsvVtkTableCreator::initialize(QStringList const & headers, size_t const rowCount)
@@ -49,6 +51,15 @@ void iACsvVtkTableCreator::initialize(QStringList const & headers, size_t const
 	m_table->AddColumn(arr);
 
 	m_table->SetNumberOfRows(rowCount);
+
+	// remember raw data pointers for fast (and thread-safe) access in addNumericRow:
+	m_idValues = arrID->GetPointer(0);
+	m_floatValues.clear();
+	for (int col = 1; col < headers.size() - 1; ++col)
+	{
+		m_floatValues.push_back(vtkFloatArray::SafeDownCast(m_table->GetColumn(col))->GetPointer(0));
+	}
+	m_classValues = arr->GetPointer(0);
 }
 
 void iACsvVtkTableCreator::addRow(size_t row, QStringList const & values)
@@ -59,6 +70,21 @@ void iACsvVtkTableCreator::addRow(size_t row, QStringList const & values)
 	m_table->SetValue(row, values.size() - 1, values[values.size() - 1].toFloat()); // class
 }
 
+bool iACsvVtkTableCreator::acceptsNumericRows() const
+{
+	return true;
+}
+
+void iACsvVtkTableCreator::addNumericRow(size_t row, double const * values, size_t count)
+{
+	m_idValues[row] = static_cast<int>(values[0]);
+	for (size_t col = 1; col < count - 1; ++col)
+	{
+		m_floatValues[col - 1][row] = static_cast<float>(values[col]);
+	}
+	m_classValues[row] = static_cast<int>(values[count - 1]);
+}
+
 vtkSmartPointer<vtkTable> iACsvVtkTableCreator::table()
 {
 	return m_table;
@@ -26,6 +26,8 @@
 
 #include <vtkSmartPointer.h>
 
+#include <vector>
+
 class vtkTable;
 
 class FeatureScout_API iACsvVtkTableCreator: public iACsvTableCreator
@@ -34,8 +36,13 @@ public:
 	iACsvVtkTableCreator();
 	void initialize(QStringList const & headers, size_t const rowCount) override;
 	void addRow(size_t row, QStringList const & values) override;
+	bool acceptsNumericRows() const override;
+	void addNumericRow(size_t row, double const * values, size_t count) override;
 	vtkSmartPointer<vtkTable> table();
 private:
 	vtkSmartPointer<vtkTable> m_table;   //!< output vtk table
+	int* m_idValues;                     //!< raw pointer to the values of the ID column
+	std::vector<float*> m_floatValues;   //!< raw pointers to the values of the float columns
+	int* m_classValues;                  //!< raw pointer to the values of the class column
 	//void debugTable(const bool useTabSeparator); //! <debugTable)
 };
@@ -22,6 +22,7 @@
 
 #include "iAFiberCharData.h"
 #include "iAFiberData.h"     // for samplePoints
+#include "iAFiberSpatialIndex.h"
 #include "iAJobListView.h"
 #include "iAMeasureSelectionDlg.h"
 #include "iARefDistCompute.h"
@@ -153,6 +154,7 @@ namespace
 	const QString ProjectFileFolder("Folder");
 	const QString ProjectFileFormatName("Format");
 	const QString ProjectFileReference("Reference");
+	const QString ProjectFileCandidateSearchRadius("CandidateSearchRadius");
 	const QString ProjectFileStepShift("StepShift");
 	const QString ProjectFileSaveFormatName("CsvFormat");
 	const QString ProjectUseStepData("UseStepData");
@@ -209,6 +211,7 @@ iAFiAKErController::iAFiAKErController(MainWindow* mainWnd, MdiChild* mdiChild)
 	m_mainWnd(mainWnd),
 	m_mdiChild(mdiChild),
 	m_referenceID(NoResult),
+	m_candidateSearchRadius(iARefDistCompute::DefaultCandidateSearchRadius),
 	m_colorByThemeName(iALUT::GetColorMapNames()[0]),
 	m_showFiberContext(false),
 	m_mergeContextBoxes(false),
@@ -1209,6 +1212,7 @@ void iAFiAKErController::sensitivitySlot()
 	}
 	auto measures = selectMeasure.measures();
 	auto optimizationMeasureIdx = selectMeasure.optimizeMeasureIdx();
+	auto candidateSearchRadius = selectMeasure.candidateSearchRadius();
 
 	m_dissimilarityMatrix = std::vector<std::vector<iAResultPairInfo>>(m_data->result.size(),
 		std::vector<iAResultPairInfo>(m_data->result.size(),
@@ -1225,6 +1229,7 @@ void iAFiAKErController::sensitivitySlot()
 		double diagonalLength = std::sqrt(std::pow(a, 2) + std::pow(b, 2) + std::pow(c, 2));
 		double const* lengthRange = m_data->spmData->paramRange(mapping[iACsvConfig::Length]);
 		double maxLength = lengthRange[1] - lengthRange[0];
+		iAFiberSpatialIndex res1Index(res1.table, mapping, res1.curveInfo);
 		for (size_t resultID2 = 0; resultID2 < m_data->result.size(); ++resultID2)
 		{
 			for (size_t m = 0; m < measures.size(); ++m)
@@ -1245,8 +1250,8 @@ void iAFiAKErController::sensitivitySlot()
 				auto it = res2.curveInfo.find(fiberID);
 				// find the best-matching fibers in reference & compute difference:
 				iAFiberData fiber(res2.table, fiberID, mapping, (it != res2.curveInfo.end()) ? it->second : std::vector<iAVec3f>());
-				getBestMatches(fiber, mapping, res1.table, dissimilarities[fiberID], res1.curveInfo,
-					diagonalLength, maxLength, measures, optimizationMeasureIdx);
+				getBestMatches(fiber, res1Index, dissimilarities[fiberID],
+					diagonalLength, maxLength, measures, optimizationMeasureIdx, candidateSearchRadius);
 				for (size_t m = 0; m < measures.size(); ++m)
 				{
 					m_dissimilarityMatrix[resultID1][resultID2].avgDissim[m] += dissimilarities[fiberID][m][0].dissimilarity;
@@ -2445,10 +2450,12 @@ void iAFiAKErController::referenceToggled()
 	{
 		return;
 	}
-	setReference(referenceID, measureDlg.measures(), measureDlg.optimizeMeasureIdx(), measureDlg.bestMeasureIdx());
+	setReference(referenceID, measureDlg.measures(), measureDlg.optimizeMeasureIdx(), measureDlg.bestMeasureIdx(),
+		measureDlg.candidateSearchRadius());
 }
 
-void iAFiAKErController::setReference(size_t referenceID, std::vector<std::pair<int, bool>> measures, int optimizationMeasure, int bestMeasure)
+void iAFiAKErController::setReference(size_t referenceID, std::vector<std::pair<int, bool>> measures, int optimizationMeasure, int bestMeasure,
+	double candidateSearchRadius)
 {
 	if (referenceID == m_referenceID)
 	{
@@ -2493,6 +2500,7 @@ void iAFiAKErController::setReference(size_t referenceID, std::vector<std::pair<
 	{
 		m_refDistCompute->setMeasuresToCompute(measures, optimizationMeasure, bestMeasure);
 	}
+	m_refDistCompute->setCandidateSearchRadius(candidateSearchRadius);
 	connect(m_refDistCompute, &QThread::finished, this, &iAFiAKErController::refDistAvailable);
 	m_views[JobView]->show();
 	m_jobs->addJob("Computing Reference Similarities", m_refDistCompute->progress(), m_refDistCompute);
@@ -2694,7 +2702,8 @@ bool iAFiAKErController::loadReferenceInternal(iASettings settings)
 	{   // defer loading the rest of the settings until reference is computed
 		loadSettings(settings);
 	});
-	setReference(referenceID, std::vector<std::pair<int,bool>>(), 0, 0);
+	double candidateSearchRadius = settings.value(ProjectFileCandidateSearchRadius, iARefDistCompute::DefaultCandidateSearchRadius).toDouble();
+	setReference(referenceID, std::vector<std::pair<int,bool>>(), 0, 0, candidateSearchRadius);
 	return true;
 }
 
@@ -2750,6 +2759,7 @@ void iAFiAKErController::saveSettings(QSettings & settings)
 	if (m_referenceID != NoResult)
 	{
 		settings.setValue(ProjectFileReference, QFileInfo(m_data->result[m_referenceID].fileName).completeBaseName());
+		settings.setValue(ProjectFileCandidateSearchRadius, m_candidateSearchRadius);
 	}
 	m_spm->saveSettings(settings);
 	::saveSettings(settings, m_settingsWidgetMap);
@@ -2779,6 +2789,7 @@ void iAFiAKErController::refDistAvailable()
 	}
 	m_data->spmData->updateRanges(changedSpmColumns);
 	m_referenceID = m_refDistCompute->referenceID();
+	m_candidateSearchRadius = m_refDistCompute->candidateSearchRadius();
 	m_spnboxReferenceCount->setMaximum(std::min(iARefDistCompute::MaxNumberOfCloseFibers, static_cast<int>(m_data->result[m_referenceID].fiberCount)));
 	std::vector<char> v(m_data->spmData->numParams(), false);
 	v[0] = v[1] = v[2] = true;
@@ -238,7 +238,8 @@ private:
 	void showSelectionDetail();
 	void hideSamplePointsPrivate();
 	void showSpatialOverview();
-	void setReference(size_t referenceID, std::vector<std::pair<int, bool>> measures, int optimizationMeasure, int bestMeasure);
+	void setReference(size_t referenceID, std::vector<std::pair<int, bool>> measures, int optimizationMeasure, int bestMeasure,
+		double candidateSearchRadius);
 	void showMainVis(size_t resultID, int state);
 	void updateRefDistPlots();
 	bool matchQualityVisActive() const;
@@ -264,6 +265,7 @@ private:
 	MainWindow* m_mainWnd;
 	MdiChild* m_mdiChild;
 	size_t m_referenceID;
+	double m_candidateSearchRadius;  //!< candidate search radius used when computing the similarities to the current reference
 	SelectionType m_selection;
 	vtkSmartPointer<vtkTable> m_refVisTable;
 	iACsvConfig m_config;
@@ -20,6 +20,7 @@
 * ************************************************************************************/
 #include "iAFiberCharData.h"
 
+#include "iAFiberResultCache.h"
 #include "iARefDistCompute.h" // only for SimilarityMeasureCount!
 
 #include "iACsvIO.h"
@@ -33,6 +34,7 @@
 #include <vtkTable.h>
 
 #include <QDataStream>
+#include <QDir>
 #include <QFileInfo>
 #include <QSettings>
 #include <QTextStream>
@@ -207,22 +209,38 @@ bool iAFiberResultsCollection::loadData(QString const & path, iACsvConfig const
 	QStringList noStepFiberFiles;
 	QString stepInfoErrorMsgs;
 	size_t totalFiberCount = 0;
+	QString cachePath(path + "/cache/");
+	QDir().mkdir(cachePath);
 	// load all datasets:
 	for (QString csvFile : csvFileNames)
 	{
 		iACsvConfig config(cfg);
 		config.fileName = csvFile;
 		objectType = config.visType;
-		iACsvIO io;
-		iACsvVtkTableCreator tableCreator;
-		if (!io.loadCSV(tableCreator, config))
+		QString curvedFileName(QFileInfo(csvFile).absolutePath() + "/curved/" + QFileInfo(csvFile).completeBaseName() + "-CurvedFibrePoints.csv");
+		iAFiberResultCache cache(cachePath + QString("table_%1.cache").arg(QFileInfo(csvFile).completeBaseName()),
+			csvFile, curvedFileName, config);
+		iAFiberCharData curData;
+		curData.mapping = QSharedPointer<QMap<uint, uint> >(new QMap<uint, uint>());
+		bool hasCurveInfo = false;
+		if (!cache.read(curData.table, *curData.mapping.data(), curData.curveInfo, hasCurveInfo))
 		{
-			DEBUG_LOG(QString("Could not load file '%1' - probably it's in a wrong format; skipping!").arg(csvFile));
-			continue;
+			iACsvIO io;
+			iACsvVtkTableCreator tableCreator;
+			if (!io.loadCSV(tableCreator, config))
+			{
+				DEBUG_LOG(QString("Could not load file '%1' - probably it's in a wrong format; skipping!").arg(csvFile));
+				continue;
+			}
+			curData.table = tableCreator.table();
+			curData.mapping = io.getOutputMapping();
+			hasCurveInfo = readCurvedFiberInfo(curvedFileName, curData.curveInfo);
+			cache.write(curData.table, *curData.mapping.data(), curData.curveInfo, hasCurveInfo);
+		}
+		if (hasCurveInfo)
+		{
+			curData.curvedFileName = curvedFileName;
 		}
-
-		iAFiberCharData curData;
-		curData.table = tableCreator.table();
 		curData.fiberCount = curData.table->GetNumberOfRows();
 		totalFiberCount += curData.fiberCount;
 		if (curData.fiberCount > std::numeric_limits<int>::max())
@@ -230,7 +248,6 @@ bool iAFiberResultsCollection::loadData(QString const & path, iACsvConfig const
 			DEBUG_LOG(QString("Large number of objects (%1) detected - currently only up to %2 objects are supported!")
 				.arg(curData.fiberCount).arg(std::numeric_limits<int>::max()));
 		}
-		curData.mapping = io.getOutputMapping();
 		curData.fileName = csvFile;
 		if (curData.fiberCount < minFiberCount)
 		{
@@ -243,9 +260,9 @@ bool iAFiberResultsCollection::loadData(QString const & path, iACsvConfig const
 
 		if (result.empty())
 		{
-			for (int h = 0; h < io.getOutputHeaders().size(); ++h)
+			for (vtkIdType col = 0; col < curData.table->GetNumberOfColumns(); ++col)
 			{
-				paramNames.push_back(io.getOutputHeaders()[h]);
+				paramNames.push_back(QString::fromUtf8(curData.table->GetColumnName(col)));
 			}
 		}
 		else
@@ -512,12 +529,6 @@ bool iAFiberResultsCollection::loadData(QString const & path, iACsvConfig const
 			}
 		}
 
-		QString curvedFileName(QFileInfo(csvFile).absolutePath() + "/curved/" + QFileInfo(csvFile).completeBaseName() + "-CurvedFibrePoints.csv");
-		if (readCurvedFiberInfo(curvedFileName, curData.curveInfo))
-		{
-			curData.curvedFileName = curvedFileName;
-		}
-
 		if (thisResultStepMax > optimStepMax)
 		{
 			if (optimStepMax > 1)
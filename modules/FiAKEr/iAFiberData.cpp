@@ -582,6 +582,10 @@ double getDissimilarity(iAFiberData const & fiber1raw, iAFiberData const & fiber
 }
 
 
+bool isOverlapMeasure(int measureID)
+{
+	return measureID >= 5 && measureID <= 7;
+}
 
 QStringList getAvailableDissimilarityMeasureNames()
 {
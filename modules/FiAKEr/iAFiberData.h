@@ -63,4 +63,8 @@ void samplePoints(iAFiberData const & fiber, std::vector<iAVec3f> & result, size
 double getDissimilarity(iAFiberData const & fiber1raw, iAFiberData const & fiber2,
 	int measureID, double diagonalLength, double maxLength);
 
+//! Whether the given measure is based on the overlap of the fiber volumes.
+//! For such measures, fibers whose bounds do not intersect always have a dissimilarity of 1.
+bool isOverlapMeasure(int measureID);
+
 QStringList getAvailableDissimilarityMeasureNames();
\ No newline at end of file
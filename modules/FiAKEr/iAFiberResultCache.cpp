@@ -0,0 +1,453 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iAFiberResultCache.h"
+
+#include <iAConsole.h>
+
+#include <vtkDataArray.h>
+#include <vtkTable.h>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cstring>  // for memcpy
+
+namespace
+{
+	const char CacheFileMagic[8] = { 'F', 'I', 'A', 'K', 'E', 'R', 'T', 'C' };
+	const quint32 EndianMarker = 0x01020304;
+	//! History of the format versions:
+	//!   - 1: initial version (sections: key, table, mapping, curved fiber points)
+	const quint32 CacheFormatVersion = 1;
+	const quint64 SectionAlignment = 8;
+
+	enum SectionTag
+	{
+		KeySection = 1,
+		TableSection = 2,
+		MappingSection = 3,
+		CurvedSection = 4
+	};
+
+	struct SectionEntry
+	{
+		quint32 tag;
+		quint32 reserved;
+		quint64 offset;
+		quint64 size;
+	};
+
+	quint64 aligned(quint64 pos)
+	{
+		return (pos + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+	}
+
+	//! Sequential reader for a (memory-mapped) block of data; all reads are bounds-checked.
+	class iABlockReader
+	{
+	public:
+		iABlockReader(uchar const * data = nullptr, quint64 size = 0) : m_data(data), m_size(size), m_pos(0), m_ok(true)
+		{}
+		template <typename T>
+		T read()
+		{
+			T result = T();
+			uchar const * src = bytes(sizeof(T));
+			if (src)
+			{
+				std::memcpy(&result, src, sizeof(T));
+			}
+			return result;
+		}
+		uchar const * bytes(quint64 count)
+		{
+			if (!m_ok || count > m_size - m_pos)
+			{
+				m_ok = false;
+				return nullptr;
+			}
+			uchar const * result = m_data + m_pos;
+			m_pos += count;
+			return result;
+		}
+		void align()
+		{
+			m_pos = std::min(aligned(m_pos), m_size);
+		}
+		bool ok() const
+		{
+			return m_ok;
+		}
+	private:
+		uchar const * m_data;
+		quint64 m_size, m_pos;
+		bool m_ok;
+	};
+
+	//! Sequential writer for a block of data
+	class iABlockWriter
+	{
+	public:
+		template <typename T>
+		void write(T value)
+		{
+			m_data.append(reinterpret_cast<char const *>(&value), sizeof(T));
+		}
+		void write(void const * data, quint64 size)
+		{
+			m_data.append(static_cast<char const *>(data), static_cast<int>(size));
+		}
+		void align()
+		{
+			m_data.append(QByteArray(static_cast<int>(aligned(m_data.size()) - m_data.size()), '\0'));
+		}
+		QByteArray const & data() const
+		{
+			return m_data;
+		}
+	private:
+		QByteArray m_data;
+	};
+
+	void addFileHash(QCryptographicHash & hash, QString const & fileName)
+	{
+		QFile file(fileName);
+		if (!QFileInfo(fileName).isFile() || !file.open(QIODevice::ReadOnly))
+		{
+			hash.addData("-", 1);
+			return;
+		}
+		hash.addData(&file);
+	}
+
+	QByteArray configHash(iACsvConfig const & config)
+	{
+		QByteArray configData;
+		QDataStream out(&configData, QIODevice::WriteOnly);
+		out << config.encoding << config.containsHeader
+			<< static_cast<quint64>(config.skipLinesStart) << static_cast<quint64>(config.skipLinesEnd)
+			<< config.columnSeparator << config.decimalSeparator << config.addAutoID
+			<< config.currentHeaders << config.selectedHeaders
+			<< config.computeLength << config.computeAngles << config.computeTensors
+			<< config.computeCenter << config.computeStartEnd
+			<< config.columnMapping
+			<< config.offset[0] << config.offset[1] << config.offset[2]
+			<< config.isDiameterFixed << config.fixedDiameterValue << config.addClassID;
+		return configData;
+	}
+}
+
+iAFiberResultCache::iAFiberResultCache(QString const & cacheFileName, QString const & csvFileName,
+	QString const & curvedFileName, iACsvConfig const & config):
+	m_cacheFileName(cacheFileName)
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	addFileHash(hash, csvFileName);
+	addFileHash(hash, curvedFileName);
+	hash.addData(configHash(config));
+	m_key = hash.result();
+}
+
+bool iAFiberResultCache::read(vtkSmartPointer<vtkTable> & table, QMap<uint, uint> & mapping,
+	std::map<size_t, std::vector<iAVec3f> > & curveInfo, bool & hasCurveInfo)
+{
+	QFile file(m_cacheFileName);
+	if (!file.exists())
+	{
+		return false;
+	}
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		DEBUG_LOG(QString("Couldn't open file %1 for reading!").arg(m_cacheFileName));
+		return false;
+	}
+	quint64 fileSize = static_cast<quint64>(file.size());
+	uchar const * data = file.map(0, file.size());
+	if (!data)
+	{
+		DEBUG_LOG(QString("FIAKER table cache file '%1': Could not map file: %2").arg(m_cacheFileName).arg(file.errorString()));
+		return false;
+	}
+	iABlockReader header(data, fileSize);
+	uchar const * magic = header.bytes(sizeof(CacheFileMagic));
+	if (!magic || std::memcmp(magic, CacheFileMagic, sizeof(CacheFileMagic)) != 0 ||
+		header.read<quint32>() != EndianMarker)
+	{
+		DEBUG_LOG(QString("FIAKER table cache file '%1': Unknown cache file format or byte order.").arg(m_cacheFileName));
+		return false;
+	}
+	quint32 version = header.read<quint32>();
+	if (version > CacheFormatVersion)
+	{
+		DEBUG_LOG(QString("FIAKER table cache file '%1': Invalid or too high version number (%2), expected %3 or less.")
+			.arg(m_cacheFileName).arg(version).arg(CacheFormatVersion));
+		return false;
+	}
+	quint32 sectionCount = header.read<quint32>();
+	header.read<quint32>(); // reserved
+	QMap<quint32, iABlockReader> sections;
+	for (quint32 s = 0; s < sectionCount && header.ok(); ++s)
+	{
+		SectionEntry entry = header.read<SectionEntry>();
+		if (entry.offset > fileSize || entry.size > fileSize - entry.offset)
+		{
+			DEBUG_LOG(QString("FIAKER table cache file '%1': Section %2 exceeds file size; file is probably truncated.")
+				.arg(m_cacheFileName).arg(entry.tag));
+			return false;
+		}
+		sections.insert(entry.tag, iABlockReader(data + entry.offset, entry.size));
+	}
+	if (!header.ok() || !sections.contains(KeySection) || !sections.contains(TableSection) || !sections.contains(MappingSection))
+	{
+		DEBUG_LOG(QString("FIAKER table cache file '%1': Invalid header or required section missing.").arg(m_cacheFileName));
+		return false;
+	}
+
+	// check key:
+	iABlockReader& keySection = sections[KeySection];
+	quint32 keySize = keySection.read<quint32>();
+	uchar const * key = keySection.bytes(keySize);
+	if (!key || QByteArray(reinterpret_cast<char const *>(key), keySize) != m_key)
+	{
+		DEBUG_LOG(QString("FIAKER table cache file '%1': Source data or configuration has changed, re-reading csv.").arg(m_cacheFileName));
+		return false;
+	}
+
+	// read table:
+	iABlockReader& tableSection = sections[TableSection];
+	quint64 rowCount = tableSection.read<quint64>();
+	quint32 colCount = tableSection.read<quint32>();
+	std::vector<std::pair<int, QString>> columns;
+	for (quint32 c = 0; c < colCount && tableSection.ok(); ++c)
+	{
+		qint32 dataType = tableSection.read<qint32>();
+		quint32 nameLen = tableSection.read<quint32>();
+		uchar const * name = tableSection.bytes(nameLen);
+		if (name)
+		{
+			columns.push_back(std::make_pair(dataType, QString::fromUtf8(reinterpret_cast<char const *>(name), nameLen)));
+		}
+	}
+	auto newTable = vtkSmartPointer<vtkTable>::New();
+	for (auto const & col : columns)
+	{
+		tableSection.align();
+		vtkSmartPointer<vtkDataArray> arr;
+		arr.TakeReference(vtkDataArray::CreateDataArray(col.first));
+		if (!arr)
+		{
+			DEBUG_LOG(QString("FIAKER table cache file '%1': Invalid data type %2 for column %3.")
+				.arg(m_cacheFileName).arg(col.first).arg(col.second));
+			return false;
+		}
+		arr->SetName(col.second.toUtf8().constData());
+		arr->SetNumberOfTuples(rowCount);
+		quint64 byteCount = rowCount * arr->GetDataTypeSize();
+		uchar const * values = tableSection.bytes(byteCount);
+		if (!values)
+		{
+			break;
+		}
+		std::memcpy(arr->GetVoidPointer(0), values, byteCount);
+		newTable->AddColumn(arr);
+	}
+	if (!tableSection.ok())
+	{
+		DEBUG_LOG(QString("FIAKER table cache file '%1': Table section is corrupt.").arg(m_cacheFileName));
+		return false;
+	}
+
+	// read mapping:
+	iABlockReader& mappingSection = sections[MappingSection];
+	quint32 mappingCount = mappingSection.read<quint32>();
+	QMap<uint, uint> newMapping;
+	for (quint32 m = 0; m < mappingCount && mappingSection.ok(); ++m)
+	{
+		quint32 mapKey = mappingSection.read<quint32>();
+		quint32 mapValue = mappingSection.read<quint32>();
+		newMapping.insert(mapKey, mapValue);
+	}
+	if (!mappingSection.ok())
+	{
+		DEBUG_LOG(QString("FIAKER table cache file '%1': Mapping section is corrupt.").arg(m_cacheFileName));
+		return false;
+	}
+
+	// read curved fiber points:
+	std::map<size_t, std::vector<iAVec3f> > newCurveInfo;
+	bool newHasCurveInfo = sections.contains(CurvedSection);
+	if (newHasCurveInfo)
+	{
+		iABlockReader& curvedSection = sections[CurvedSection];
+		quint64 curvedFiberCount = curvedSection.read<quint64>();
+		std::vector<std::pair<quint64, quint64>> fiberPointCounts;
+		for (quint64 f = 0; f < curvedFiberCount && curvedSection.ok(); ++f)
+		{
+			quint64 fiberID = curvedSection.read<quint64>();
+			quint64 pointCount = curvedSection.read<quint64>();
+			fiberPointCounts.push_back(std::make_pair(fiberID, pointCount));
+		}
+		curvedSection.align();
+		for (auto const & f : fiberPointCounts)
+		{
+			quint64 byteCount = f.second * 3 * sizeof(float);
+			float const * coords = reinterpret_cast<float const *>(curvedSection.bytes(byteCount));
+			if (!coords)
+			{
+				break;
+			}
+			std::vector<iAVec3f> points(f.second);
+			std::memcpy(points.data(), coords, byteCount);
+			newCurveInfo.insert(std::make_pair(static_cast<size_t>(f.first), points));
+		}
+		if (!curvedSection.ok())
+		{
+			DEBUG_LOG(QString("FIAKER table cache file '%1': Curved fiber section is corrupt.").arg(m_cacheFileName));
+			return false;
+		}
+	}
+	file.unmap(const_cast<uchar*>(data));
+	file.close();
+
+	table = newTable;
+	mapping = newMapping;
+	curveInfo.swap(newCurveInfo);
+	hasCurveInfo = newHasCurveInfo;
+	return true;
+}
+
+bool iAFiberResultCache::write(vtkTable* table, QMap<uint, uint> const & mapping,
+	std::map<size_t, std::vector<iAVec3f> > const & curveInfo, bool hasCurveInfo)
+{
+	static_assert(sizeof(iAVec3f) == 3 * sizeof(float), "iAVec3f is expected to be tightly packed!");
+	std::vector<std::pair<quint32, QByteArray>> sections;
+
+	iABlockWriter keySection;
+	keySection.write(static_cast<quint32>(m_key.size()));
+	keySection.write(m_key.constData(), m_key.size());
+	sections.push_back(std::make_pair(static_cast<quint32>(KeySection), keySection.data()));
+
+	iABlockWriter tableSection;
+	quint64 rowCount = static_cast<quint64>(table->GetNumberOfRows());
+	tableSection.write(rowCount);
+	tableSection.write(static_cast<quint32>(table->GetNumberOfColumns()));
+	std::vector<vtkDataArray*> columns;
+	for (vtkIdType c = 0; c < table->GetNumberOfColumns(); ++c)
+	{
+		vtkDataArray* arr = vtkDataArray::SafeDownCast(table->GetColumn(c));
+		if (!arr || arr->GetNumberOfComponents() != 1)
+		{
+			DEBUG_LOG(QString("FIAKER table cache file '%1': Column %2 is not a scalar numeric column, not writing cache.")
+				.arg(m_cacheFileName).arg(c));
+			return false;
+		}
+		columns.push_back(arr);
+		QByteArray name(arr->GetName() ? arr->GetName() : "");
+		tableSection.write(static_cast<qint32>(arr->GetDataType()));
+		tableSection.write(static_cast<quint32>(name.size()));
+		tableSection.write(name.constData(), name.size());
+	}
+	for (auto arr : columns)
+	{
+		tableSection.align();
+		tableSection.write(arr->GetVoidPointer(0), rowCount * arr->GetDataTypeSize());
+	}
+	sections.push_back(std::make_pair(static_cast<quint32>(TableSection), tableSection.data()));
+
+	iABlockWriter mappingSection;
+	mappingSection.write(static_cast<quint32>(mapping.size()));
+	for (auto key : mapping.keys())
+	{
+		mappingSection.write(static_cast<quint32>(key));
+		mappingSection.write(static_cast<quint32>(mapping[key]));
+	}
+	sections.push_back(std::make_pair(static_cast<quint32>(MappingSection), mappingSection.data()));
+
+	if (hasCurveInfo)
+	{
+		iABlockWriter curvedSection;
+		curvedSection.write(static_cast<quint64>(curveInfo.size()));
+		for (auto const & f : curveInfo)
+		{
+			curvedSection.write(static_cast<quint64>(f.first));
+			curvedSection.write(static_cast<quint64>(f.second.size()));
+		}
+		curvedSection.align();
+		for (auto const & f : curveInfo)
+		{
+			curvedSection.write(f.second.data(), f.second.size() * sizeof(iAVec3f));
+		}
+		sections.push_back(std::make_pair(static_cast<quint32>(CurvedSection), curvedSection.data()));
+	}
+
+	iABlockWriter header;
+	header.write(CacheFileMagic, sizeof(CacheFileMagic));
+	header.write(EndianMarker);
+	header.write(CacheFormatVersion);
+	header.write(static_cast<quint32>(sections.size()));
+	header.write(static_cast<quint32>(0)); // reserved
+	quint64 offset = aligned(header.data().size() + sections.size() * sizeof(SectionEntry));
+	for (auto const & s : sections)
+	{
+		SectionEntry entry;
+		entry.tag = s.first;
+		entry.reserved = 0;
+		entry.offset = offset;
+		entry.size = s.second.size();
+		header.write(entry);
+		offset = aligned(offset + entry.size);
+	}
+
+	// write to temporary file first, to avoid leaving behind a partially written cache file:
+	QString tempFileName(m_cacheFileName + ".tmp");
+	QFile file(tempFileName);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		DEBUG_LOG(QString("Couldn't open file %1 for writing!").arg(tempFileName));
+		return false;
+	}
+	bool ok = true;
+	header.align();
+	ok &= file.write(header.data()) == header.data().size();
+	for (auto const & s : sections)
+	{
+		QByteArray padding(static_cast<int>(aligned(file.pos()) - file.pos()), '\0');
+		ok &= file.write(padding) == padding.size();
+		ok &= file.write(s.second) == s.second.size();
+	}
+	file.close();
+	if (!ok)
+	{
+		DEBUG_LOG(QString("FIAKER table cache file '%1': Error while writing: %2").arg(tempFileName).arg(file.errorString()));
+		QFile::remove(tempFileName);
+		return false;
+	}
+	QFile::remove(m_cacheFileName);
+	if (!QFile::rename(tempFileName, m_cacheFileName))
+	{
+		DEBUG_LOG(QString("FIAKER table cache file '%1': Could not rename from temporary file.").arg(m_cacheFileName));
+		return false;
+	}
+	return true;
+}
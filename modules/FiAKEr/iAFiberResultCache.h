@@ -0,0 +1,72 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#pragma once
+
+#include "iACsvConfig.h"
+
+#include <iAvec3.h>
+
+#include <vtkSmartPointer.h>
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+
+#include <map>
+#include <vector>
+
+class vtkTable;
+
+//! Binary cache for the data parsed from a single result csv file, i.e. the fiber table,
+//! the column mapping and (optionally) the curved fiber points.
+//!
+//! The cache file is memory-mapped for reading; the table is stored column-wise, so that
+//! each column can be copied into its vtk array in one go, without any text parsing.
+//! The cache is keyed by a hash of the content of the csv file (and the curved fiber file),
+//! as well as of the csv configuration used for parsing it; if any of these changes, the
+//! cache is considered invalid.
+//! The file consists of a header with a format version and a directory of tagged sections.
+//! Sections with unknown tags are ignored; files with a higher format version are rejected.
+class iAFiberResultCache
+{
+public:
+	//! @param cacheFileName the name of the cache file
+	//! @param csvFileName the name of the result csv file
+	//! @param curvedFileName the name of the file containing curved fiber points (might not exist)
+	//! @param config the configuration used for parsing the csv file
+	iAFiberResultCache(QString const & cacheFileName, QString const & csvFileName,
+		QString const & curvedFileName, iACsvConfig const & config);
+	//! Read cached data, if a valid cache file exists.
+	//! @param table the fiber table
+	//! @param mapping the column mapping
+	//! @param curveInfo the curved fiber points
+	//! @param hasCurveInfo whether curved fiber points were available
+	//! @return true if the data could be read from cache, false otherwise
+	bool read(vtkSmartPointer<vtkTable> & table, QMap<uint, uint> & mapping,
+		std::map<size_t, std::vector<iAVec3f> > & curveInfo, bool & hasCurveInfo);
+	//! Write the given data to the cache file.
+	//! @return true if the cache file could be written, false otherwise
+	bool write(vtkTable* table, QMap<uint, uint> const & mapping,
+		std::map<size_t, std::vector<iAVec3f> > const & curveInfo, bool hasCurveInfo);
+private:
+	QString m_cacheFileName;
+	QByteArray m_key;
+};
@@ -0,0 +1,227 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iAFiberSpatialIndex.h"
+
+#include "iAConsole.h"
+
+#include <vtkTable.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	//! maximum number of fibers in a leaf node of the hierarchy
+	const quint32 MaxLeafSize = 8;
+
+	//! slack added to fiber bounds to make sure that rounding errors don't exclude any actually touching fibers
+	const float BoundsEpsilon = 1e-4f;
+
+	void extendBounds(iAFiberBounds & b, iAVec3f const & pt)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			b.min[i] = std::min(b.min[i], pt[i]);
+			b.max[i] = std::max(b.max[i], pt[i]);
+		}
+	}
+
+	void extendBounds(iAFiberBounds & b, iAFiberBounds const & other)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			b.min[i] = std::min(b.min[i], other.min[i]);
+			b.max[i] = std::max(b.max[i], other.max[i]);
+		}
+	}
+
+	iAFiberBounds emptyBounds()
+	{
+		iAFiberBounds b;
+		for (int i = 0; i < 3; ++i)
+		{
+			b.min[i] = std::numeric_limits<float>::max();
+			b.max[i] = std::numeric_limits<float>::lowest();
+		}
+		return b;
+	}
+
+	float center(iAFiberBounds const & b, int axis)
+	{
+		return (b.min[axis] + b.max[axis]) / 2;
+	}
+}
+
+bool iAFiberBounds::intersects(iAFiberBounds const & other, float margin) const
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		if (min[i] - margin > other.max[i] || max[i] + margin < other.min[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+iAFiberBounds getFiberBounds(iAFiberData const & fiber)
+{
+	iAFiberBounds result = emptyBounds();
+	extendBounds(result, fiber.pts[PtStart]);
+	extendBounds(result, fiber.pts[PtEnd]);
+	for (auto const & pt : fiber.curvedPoints)
+	{
+		extendBounds(result, pt);
+	}
+	float radius = static_cast<float>(fiber.diameter / 2.0);
+	float maxCoord = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		maxCoord = std::max(maxCoord, std::max(std::abs(result.min[i]), std::abs(result.max[i])));
+	}
+	float slack = (1.0f + radius + maxCoord) * BoundsEpsilon;
+	for (int i = 0; i < 3; ++i)
+	{
+		result.min[i] -= radius + slack;
+		result.max[i] += radius + slack;
+	}
+	return result;
+}
+
+iAFiberSpatialIndex::iAFiberSpatialIndex(vtkTable* table, QMap<uint, uint> const & mapping,
+	std::map<size_t, std::vector<iAVec3f> > const & curveInfo)
+{
+	size_t fiberCount = table->GetNumberOfRows();
+	if (fiberCount > std::numeric_limits<quint32>::max())
+	{
+		DEBUG_LOG(QString("Number of fibers (%1) exceeds maximum supported by spatial index!").arg(fiberCount));
+		return;
+	}
+	m_fibers.reserve(fiberCount);
+	m_bounds.reserve(fiberCount);
+	m_order.resize(fiberCount);
+	for (size_t fiberID = 0; fiberID < fiberCount; ++fiberID)
+	{
+		auto it = curveInfo.find(fiberID);
+		m_fibers.push_back(iAFiberData(table, fiberID, mapping, (it != curveInfo.end()) ? it->second : std::vector<iAVec3f>()));
+		m_bounds.push_back(getFiberBounds(m_fibers[fiberID]));
+		m_order[fiberID] = static_cast<quint32>(fiberID);
+	}
+	if (fiberCount > 0)
+	{
+		m_nodes.reserve(2 * (fiberCount / MaxLeafSize + 1));
+		build(0, static_cast<quint32>(fiberCount));
+	}
+}
+
+quint32 iAFiberSpatialIndex::build(quint32 first, quint32 last)
+{
+	quint32 nodeIdx = static_cast<quint32>(m_nodes.size());
+	m_nodes.push_back(Node());
+	iAFiberBounds nodeBounds = emptyBounds();
+	iAFiberBounds centerBounds = emptyBounds();
+	for (quint32 i = first; i < last; ++i)
+	{
+		auto const & b = m_bounds[m_order[i]];
+		extendBounds(nodeBounds, b);
+		extendBounds(centerBounds, iAVec3f(center(b, 0), center(b, 1), center(b, 2)));
+	}
+	m_nodes[nodeIdx].bounds = nodeBounds;
+	if (last - first <= MaxLeafSize)
+	{
+		m_nodes[nodeIdx].offset = first;
+		m_nodes[nodeIdx].count = last - first;
+		return nodeIdx;
+	}
+	// split at median of bounds centers along axis of largest extent:
+	int axis = 0;
+	for (int i = 1; i < 3; ++i)
+	{
+		if (centerBounds.max[i] - centerBounds.min[i] > centerBounds.max[axis] - centerBounds.min[axis])
+		{
+			axis = i;
+		}
+	}
+	quint32 mid = first + (last - first) / 2;
+	std::nth_element(m_order.begin() + first, m_order.begin() + mid, m_order.begin() + last,
+		[this, axis](quint32 a, quint32 b)
+		{
+			return center(m_bounds[a], axis) < center(m_bounds[b], axis);
+		});
+	build(first, mid);
+	quint32 rightIdx = build(mid, last);
+	m_nodes[nodeIdx].offset = rightIdx;
+	m_nodes[nodeIdx].count = 0;
+	return nodeIdx;
+}
+
+size_t iAFiberSpatialIndex::fiberCount() const
+{
+	return m_fibers.size();
+}
+
+iAFiberData const & iAFiberSpatialIndex::fiber(size_t fiberID) const
+{
+	return m_fibers[fiberID];
+}
+
+iAFiberBounds const & iAFiberSpatialIndex::bounds(size_t fiberID) const
+{
+	return m_bounds[fiberID];
+}
+
+void iAFiberSpatialIndex::findCandidates(iAFiberBounds const & query, double radius, std::vector<size_t> & result) const
+{
+	result.clear();
+	if (m_nodes.empty())
+	{
+		return;
+	}
+	float margin = static_cast<float>(std::max(0.0, radius));
+	std::vector<quint32> stack;
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		quint32 nodeIdx = stack.back();
+		stack.pop_back();
+		Node const & node = m_nodes[nodeIdx];
+		if (!node.bounds.intersects(query, margin))
+		{
+			continue;
+		}
+		if (node.count > 0)
+		{
+			for (quint32 i = node.offset; i < node.offset + node.count; ++i)
+			{
+				if (m_bounds[m_order[i]].intersects(query, margin))
+				{
+					result.push_back(m_order[i]);
+				}
+			}
+		}
+		else
+		{
+			stack.push_back(node.offset);
+			stack.push_back(nodeIdx + 1);
+		}
+	}
+	std::sort(result.begin(), result.end());
+}
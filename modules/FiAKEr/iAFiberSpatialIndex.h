@@ -0,0 +1,76 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#pragma once
+
+#include "iAFiberData.h"
+
+#include <QMap>
+
+#include <map>
+#include <vector>
+
+class vtkTable;
+
+//! Axis-aligned bounding box of a fiber cylinder (i.e. including its radius).
+struct iAFiberBounds
+{
+	float min[3], max[3];
+	//! whether this box, enlarged by the given margin, intersects the other box
+	bool intersects(iAFiberBounds const & other, float margin = 0.0f) const;
+};
+
+//! Computes the bounds of a fiber; curved points (if any) as well as start and end point are considered.
+iAFiberBounds getFiberBounds(iAFiberData const & fiber);
+
+//! Spatial index over the fibers of one result (typically the reference).
+//! Decodes all fibers of the given table once into a contiguous array, and builds
+//! a bounding volume hierarchy over the fiber bounds, which can be used to quickly
+//! determine the candidate fibers close to a given query fiber.
+class iAFiberSpatialIndex
+{
+public:
+	iAFiberSpatialIndex(vtkTable* table, QMap<uint, uint> const & mapping,
+		std::map<size_t, std::vector<iAVec3f> > const & curveInfo);
+	//! number of fibers in the index
+	size_t fiberCount() const;
+	//! the decoded data of the fiber with the given ID
+	iAFiberData const & fiber(size_t fiberID) const;
+	//! the bounds of the fiber with the given ID
+	iAFiberBounds const & bounds(size_t fiberID) const;
+	//! Collects the IDs of all fibers whose bounds lie within the given distance
+	//! from the given query bounds (in ascending order of fiber ID).
+	void findCandidates(iAFiberBounds const & query, double radius, std::vector<size_t> & result) const;
+private:
+	struct Node
+	{
+		iAFiberBounds bounds;
+		//! for leaves: index of first entry in m_order; for inner nodes: index of right child (left child is next node)
+		quint32 offset;
+		//! number of fibers in leaf, 0 for inner nodes
+		quint32 count;
+	};
+	quint32 build(quint32 first, quint32 last);
+
+	std::vector<iAFiberData> m_fibers;
+	std::vector<iAFiberBounds> m_bounds;
+	std::vector<quint32> m_order;
+	std::vector<Node> m_nodes;
+};
@@ -139,4 +139,9 @@ int iAMeasureSelectionDlg::bestMeasureIdx() const
 		}
 	}
 	return -1;
-}
\ No newline at end of file
+}
+
+double iAMeasureSelectionDlg::candidateSearchRadius() const
+{
+	return dsbCandidateRadius->value();
+}
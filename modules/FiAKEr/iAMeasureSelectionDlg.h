@@ -33,6 +33,7 @@ public:
 	TMeasureSelection measures() const;
 	int optimizeMeasureIdx() const;
 	int bestMeasureIdx() const;
+	double candidateSearchRadius() const;
 private slots:
 	void okBtnClicked();
 private:
@@ -22,6 +22,7 @@
 
 #include "iAFiberCharData.h"
 #include "iAFiberData.h"
+#include "iAFiberSpatialIndex.h"
 
 #include "iACsvConfig.h"
 
@@ -36,6 +37,7 @@
 
 #include <QDataStream>
 #include <QDir>
+#include <QScopedPointer>
 
 #include <array>
 #include <cassert>
@@ -56,6 +58,12 @@ namespace
 	//QString CacheFileClosestFibers("ClosestFibers");
 	//QString CacheFileResultPattern("Result%1");
 	quint32 CacheFileVersion(3);
+	//! cache files of this version contain wrong dc1 and do3 values; they are not migrated to the current version,
+	//! so that they are not mistaken for correct ones and the warning about them keeps being shown
+	quint32 CacheFileVersionWrongValues(1);
+
+	//! dissimilarity of two fibers which don't overlap at all, according to the overlap measures
+	const double NoOverlapDissimilarity = 1.0;
 
 	bool verifyOpenCacheFile(QFile & cacheFile)
 	{
@@ -73,14 +81,21 @@ namespace
 }
 
 iARefDistCompute::ContainerSizeType iARefDistCompute::MaxNumberOfCloseFibers = 25;
+double iARefDistCompute::DefaultCandidateSearchRadius = 0.0;
 
 iARefDistCompute::iARefDistCompute(QSharedPointer<iAFiberResultsCollection> data, size_t referenceID) :
 	m_data(data),
 	m_referenceID(referenceID),
 	m_columnsBefore(data->spmData->numParams()),
 	m_optimizationMeasureIdx(0),
-	m_bestMeasure(0)
+	m_bestMeasure(0),
+	m_candidateSearchRadius(DefaultCandidateSearchRadius)
+{
+}
+
+void iARefDistCompute::setCandidateSearchRadius(double radius)
 {
+	m_candidateSearchRadius = radius;
 }
 
 bool iARefDistCompute::setMeasuresToCompute(std::vector<std::pair<int, bool>> const& measuresToCompute,
@@ -122,23 +137,40 @@ bool iARefDistCompute::setMeasuresToCompute(std::vector<std::pair<int, bool>> co
 }
 
 void getBestMatches(iAFiberData const& fiber,
-	QMap<uint, uint> const& mapping,
-	vtkTable* refTable,
+	iAFiberSpatialIndex const& refIndex,
 	QVector<QVector<iAFiberSimilarity> >& bestMatches,
-	std::map<size_t, std::vector<iAVec3f> > const& refCurveInfo,
 	double diagonalLength, double maxLength,
-	std::vector<std::pair<int, bool>>& measuresToCompute, int optimizationMeasureIdx)
+	std::vector<std::pair<int, bool>>& measuresToCompute, int optimizationMeasureIdx,
+	double candidateSearchRadius)
 {
-	iARefDistCompute::ContainerSizeType refFiberCount = refTable->GetNumberOfRows();
+	assert(refIndex.fiberCount() < static_cast<size_t>(std::numeric_limits<iARefDistCompute::ContainerSizeType>::max()));
+	iARefDistCompute::ContainerSizeType refFiberCount = static_cast<iARefDistCompute::ContainerSizeType>(refIndex.fiberCount());
 	int bestMatchesStartIdx = bestMatches.size();
 	assert(measuresToCompute.size() < std::numeric_limits<int>::max());
 	assert(bestMatchesStartIdx + measuresToCompute.size() < std::numeric_limits<int>::max());
 	int numOfNewMeasures = static_cast<int>(measuresToCompute.size());
 	bestMatches.resize(bestMatchesStartIdx + numOfNewMeasures);
 	auto maxNumberOfCloseFibers = std::min(iARefDistCompute::MaxNumberOfCloseFibers, refFiberCount);
+	iAFiberBounds fiberBounds = getFiberBounds(fiber);
+	std::vector<size_t> candidates;
 	for (int d = 0; d < numOfNewMeasures; ++d)
 	{
 		QVector<iAFiberSimilarity> similarities;
+		int measureID = measuresToCompute[d].first;
+		bool overlapMeasure = isOverlapMeasure(measureID);
+		auto computeDissimilarity = [&](size_t refFiberID) -> double
+		{
+			if (overlapMeasure && !fiberBounds.intersects(refIndex.bounds(refFiberID)))
+			{	// fibers don't touch, so there can't be any overlap:
+				return NoOverlapDissimilarity;
+			}
+			double curDissimilarity = getDissimilarity(fiber, refIndex.fiber(refFiberID), measureID, diagonalLength, maxLength);
+			if (std::isnan(curDissimilarity))
+			{
+				curDissimilarity = 0;
+			}
+			return curDissimilarity;
+		};
 		bool optimize = measuresToCompute[d].second;
 		if (optimize && (optimizationMeasureIdx < 0 || optimizationMeasureIdx >= d))
 		{
@@ -149,18 +181,48 @@ void getBestMatches(iAFiberData const& fiber,
 		}
 		if (!optimize)
 		{
-			similarities.resize(refFiberCount);
-			for (iARefDistCompute::ContainerSizeType refFiberID = 0; refFiberID < refFiberCount; ++refFiberID)
+			// overlap measures: only intersecting fibers can have a dissimilarity other than 1 -> exact pruning;
+			// other measures: only prune if requested, and only if enough candidates are found:
+			bool prune = overlapMeasure || candidateSearchRadius > 0;
+			if (prune)
+			{
+				refIndex.findCandidates(fiberBounds, overlapMeasure ? 0.0 : candidateSearchRadius, candidates);
+				prune = overlapMeasure || candidates.size() >= static_cast<size_t>(maxNumberOfCloseFibers);
+			}
+			if (prune)
+			{
+				similarities.reserve(std::max(static_cast<int>(candidates.size()), maxNumberOfCloseFibers));
+				for (size_t refFiberID : candidates)
+				{
+					iAFiberSimilarity sim;
+					sim.index = refFiberID;
+					sim.dissimilarity = computeDissimilarity(refFiberID);
+					similarities.push_back(sim);
+				}
+				// fill up with non-overlapping fibers in case not enough candidates were found:
+				size_t candIdx = 0;
+				for (iARefDistCompute::ContainerSizeType refFiberID = 0;
+					refFiberID < refFiberCount && similarities.size() < maxNumberOfCloseFibers; ++refFiberID)
+				{
+					if (candIdx < candidates.size() && candidates[candIdx] == static_cast<size_t>(refFiberID))
+					{
+						++candIdx;
+						continue;
+					}
+					iAFiberSimilarity sim;
+					sim.index = refFiberID;
+					sim.dissimilarity = NoOverlapDissimilarity;
+					similarities.push_back(sim);
+				}
+			}
+			else
 			{
-				auto it = refCurveInfo.find(refFiberID);
-				iAFiberData refFiber(refTable, refFiberID, mapping, (it != refCurveInfo.end()) ? it->second : std::vector<iAVec3f>());
-				similarities[refFiberID].index = refFiberID;
-				double curDissimilarity = getDissimilarity(fiber, refFiber, measuresToCompute[d].first, diagonalLength, maxLength);
-				if (std::isnan(curDissimilarity))
+				similarities.resize(refFiberCount);
+				for (iARefDistCompute::ContainerSizeType refFiberID = 0; refFiberID < refFiberCount; ++refFiberID)
 				{
-					curDissimilarity = 0;
+					similarities[refFiberID].index = refFiberID;
+					similarities[refFiberID].dissimilarity = computeDissimilarity(refFiberID);
 				}
-				similarities[refFiberID].dissimilarity = curDissimilarity;
 			}
 		}
 		else
@@ -170,19 +232,13 @@ void getBestMatches(iAFiberData const& fiber,
 			for (iARefDistCompute::ContainerSizeType bestMatchID = 0; bestMatchID < otherMatches.size(); ++bestMatchID)
 			{
 				size_t refFiberID = otherMatches[bestMatchID].index;
-				auto it = refCurveInfo.find(refFiberID);
-				iAFiberData refFiber(refTable, refFiberID, mapping, (it != refCurveInfo.end()) ? it->second : std::vector<iAVec3f>());
 				similarities[bestMatchID].index = refFiberID;
-				double curDissimilarity = getDissimilarity(fiber, refFiber, measuresToCompute[d].first, diagonalLength, maxLength);
-				if (std::isnan(curDissimilarity))
-				{
-					curDissimilarity = 0;
-				}
-				similarities[bestMatchID].dissimilarity = curDissimilarity;
+				similarities[bestMatchID].dissimilarity = computeDissimilarity(refFiberID);
 			}
 		}
 		std::sort(similarities.begin(), similarities.end());
-		std::copy(similarities.begin(), similarities.begin() + maxNumberOfCloseFibers, std::back_inserter(bestMatches[bestMatchesStartIdx+d]));
+		std::copy(similarities.begin(), similarities.begin() + std::min(maxNumberOfCloseFibers, similarities.size()),
+			std::back_inserter(bestMatches[bestMatchesStartIdx+d]));
 	}
 }
 
@@ -191,6 +247,11 @@ void iARefDistCompute::run()
 	QString cachePath(m_data->folder + "/cache/");
 	QDir().mkdir(cachePath);
 	QString referenceName(QFileInfo(m_data->result[m_referenceID].fileName).completeBaseName());
+	// results computed with a candidate search radius may differ from the full computation, so they get their own cache files:
+	if (m_candidateSearchRadius > 0)
+	{
+		referenceName += QString("_r%1").arg(m_candidateSearchRadius);
+	}
 	m_progress.setStatus("Computing the distance of fibers in all results to the fibers in reference and find best matching ones, "
 		"and the difference between consecutive steps.");
 	auto & ref = m_data->result[m_referenceID];
@@ -217,12 +278,18 @@ void iARefDistCompute::run()
 	bool recomputeAverages = false;
 	std::vector<bool> writeResultCache(m_data->result.size(), false);
 	bool first = true;
+	QScopedPointer<iAFiberSpatialIndex> refIndex;
 	for (size_t resultID = 0; resultID < m_data->result.size(); ++resultID)
 	{
 		QString resultName(QFileInfo(m_data->result[resultID].fileName).completeBaseName());
 		QString resultCacheFileName(cachePath + QString("refDist_%1_%2.cache").arg(referenceName).arg(resultName));
 		QFile cacheFile(resultCacheFileName);
-		bool readCacheResult = readResultRefComparison(cacheFile, resultID, first);
+		bool cacheOutdated = false;
+		bool readCacheResult = readResultRefComparison(cacheFile, resultID, first, cacheOutdated);
+		if (readCacheResult && cacheOutdated)
+		{	// migrate cache file to current version:
+			writeResultCache[resultID] = true;
+		}
 		bool skip = (resultID == m_referenceID) || readCacheResult;
 		auto& d = m_data->result[resultID];
 		if (resultID != m_referenceID && readCacheResult && d.avgDifference.size() == 0)
@@ -246,6 +313,12 @@ void iARefDistCompute::run()
 		}
 		writeResultCache[resultID] = true;
 		recomputeAverages = true; // if any result is not loaded from cache, we have to recompute averages
+		if (!refIndex)
+		{
+			m_progress.setStatus("Building spatial index of reference fibers.");
+			refIndex.reset(new iAFiberSpatialIndex(ref.table, mapping, ref.curveInfo));
+			m_progress.setStatus("Computing the distance of fibers in all results to the fibers in reference and find best matching ones.");
+		}
 		qint64 const fiberCount = d.table->GetNumberOfRows();
 		d.refDiffFiber.resize(fiberCount);
 #pragma omp parallel for
@@ -254,8 +327,8 @@ void iARefDistCompute::run()
 			auto it = d.curveInfo.find(fiberID);
 			// find the best-matching fibers in reference & compute difference:
 			iAFiberData fiber(d.table, fiberID, mapping, (it != d.curveInfo.end())? it->second : std::vector<iAVec3f>());
-			getBestMatches(fiber, mapping, ref.table, d.refDiffFiber[fiberID].dist, ref.curveInfo,
-				m_diagonalLength, m_maxLength, m_measuresToCompute, m_optimizationMeasureIdx);
+			getBestMatches(fiber, *refIndex.data(), d.refDiffFiber[fiberID].dist,
+				m_diagonalLength, m_maxLength, m_measuresToCompute, m_optimizationMeasureIdx, m_candidateSearchRadius);
 		}
 /*
 		// Computing the difference between consecutive steps.
@@ -360,8 +433,9 @@ void iARefDistCompute::run()
 	// Computing reference differences:
 	QString avgCacheFileName(cachePath + QString("refAvg_%1.cache").arg(referenceName));
 	QFile avgCacheFile(avgCacheFileName);
+	bool avgCacheOutdated = false;
 	if (recomputeAverages // if any of the results was not loaded from cache
-		|| !readAverageMeasures(avgCacheFile))  // or cache file not found / number of results cached previously is not the same as currently loaded
+		|| !readAverageMeasures(avgCacheFile, avgCacheOutdated))  // or cache file not found / number of results cached previously is not the same as currently loaded
 	{
 		m_progress.setStatus("Summing up match quality (+ whether there is a match) for all reference fibers.");
 		std::vector<double> refDistSum(ref.fiberCount, 0.0);
@@ -425,6 +499,11 @@ void iARefDistCompute::run()
 		}
 		writeAverageMeasures(avgCacheFile);
 	}
+	else if (avgCacheOutdated)
+	{	// migrate cache file to current version:
+		avgCacheFile.close();
+		writeAverageMeasures(avgCacheFile);
+	}
 	for (size_t resultID = 0; resultID < m_data->result.size(); ++resultID)
 	{
 		if (!writeResultCache[resultID])
@@ -446,7 +525,7 @@ void iARefDistCompute::run()
 	}
 }
 
-bool iARefDistCompute::readResultRefComparison(QFile& cacheFile, size_t resultID, bool& first)
+bool iARefDistCompute::readResultRefComparison(QFile& cacheFile, size_t resultID, bool& first, bool& outdated)
 {
 	if (!verifyOpenCacheFile(cacheFile))
 	{
@@ -466,7 +545,7 @@ bool iARefDistCompute::readResultRefComparison(QFile& cacheFile, size_t resultID
 	}
 	quint32 version;
 	in >> version;
-	if (version == 1)
+	if (version == CacheFileVersionWrongValues)
 	{
 		DEBUG_LOG(QString("FIAKER cache file '%1': Found file of version 1 which is known to have wrong dc1 and do3 computations. "
 			"If you want to recompute with correct values, please delete the 'cache' subfolder!")
@@ -479,6 +558,7 @@ bool iARefDistCompute::readResultRefComparison(QFile& cacheFile, size_t resultID
 			.arg(version).arg(CacheFileVersion));
 		return false;
 	}
+	outdated = version < CacheFileVersion && version != CacheFileVersionWrongValues;
 	if (first)
 	{
 		QVector<qulonglong> cachedMeasures;
@@ -575,7 +655,7 @@ void iARefDistCompute::writeAverageMeasures(QFile& cacheFile)
 	cacheFile.close();
 }
 
-bool iARefDistCompute::readAverageMeasures(QFile& cacheFile)
+bool iARefDistCompute::readAverageMeasures(QFile& cacheFile, bool& outdated)
 {
 	if (!verifyOpenCacheFile(cacheFile))
 	{
@@ -600,6 +680,7 @@ bool iARefDistCompute::readAverageMeasures(QFile& cacheFile)
 			.arg(cacheFile.fileName()).arg(version).arg(CacheFileVersion));
 		return false;
 	}
+	outdated = version < CacheFileVersion && version != CacheFileVersionWrongValues;
 	quint32 numberOfResults;
 	in >> numberOfResults;
 	if (numberOfResults != m_data->result.size())
@@ -636,6 +717,11 @@ size_t iARefDistCompute::referenceID() const
 	return m_referenceID;
 }
 
+double iARefDistCompute::candidateSearchRadius() const
+{
+	return m_candidateSearchRadius;
+}
+
 size_t iARefDistCompute::columnsBefore() const
 {
 	return m_columnsBefore;
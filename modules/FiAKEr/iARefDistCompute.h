@@ -31,6 +31,7 @@
 #include <vector>
 
 class iAFiberResultsCollection;
+class iAFiberSpatialIndex;
 
 class vtkTable;
 
@@ -43,17 +44,27 @@ public:
 	//! type for containers - but since we mix QVector and std::vector usages, it doesn't really help!
 	typedef int ContainerSizeType;
 	static ContainerSizeType MaxNumberOfCloseFibers;
+	//! search radius for candidate fibers used for non-overlap measures if not set otherwise (0 = no pruning)
+	static double DefaultCandidateSearchRadius;
 	iARefDistCompute(QSharedPointer<iAFiberResultsCollection> data, size_t referenceID);
 	bool setMeasuresToCompute(std::vector<std::pair<int, bool>> const& measuresToCompute, int optimizationMeasure, int bestMeasure);
+	//! Set the maximum distance between the bounds of a fiber and a reference fiber for the reference fiber to be
+	//! considered as match candidate for non-overlap measures; 0 means all reference fibers are considered
+	void setCandidateSearchRadius(double radius);
 	void run() override;
 	iAProgress* progress();
 	size_t referenceID() const;
+	double candidateSearchRadius() const;
 	size_t columnsBefore() const;
 	size_t columnsAdded() const;
 private:
-	bool readResultRefComparison(QFile& file, size_t resultID, bool& first);
+	//! read cached comparison of a result to the reference; outdated is set to true if the file has an older format version
+	//! which can be migrated to the current one (version 1 files are never migrated since their values are known to be wrong)
+	bool readResultRefComparison(QFile& file, size_t resultID, bool& first, bool& outdated);
 	void writeResultRefComparison(QFile& cacheFile, size_t resultID);
-	bool readAverageMeasures(QFile& cacheFile);
+	//! read cached average measures; outdated is set to true if the file has an older format version
+	//! which can be migrated to the current one (see readResultRefComparison)
+	bool readAverageMeasures(QFile& cacheFile, bool& outdated);
 	void writeAverageMeasures(QFile& cacheFile);
 
 	iAProgress m_progress;
@@ -63,16 +74,20 @@ private:
 	size_t m_columnsBefore;
 	int m_optimizationMeasureIdx,
 		m_bestMeasure;
+	double m_candidateSearchRadius;
 
 	//! @{ internal computation caches:
 	double m_diagonalLength, m_maxLength;
 	//! @}
 };
 
+//! Find the best-matching reference fibers for the given fiber, for each of the given measures.
+//! For overlap measures, only reference fibers intersecting the given fiber are evaluated (others
+//! have a dissimilarity of 1 anyway); for other measures, the candidates are restricted to fibers
+//! within the given search radius (if larger than 0 and if enough candidates are found).
 void getBestMatches(iAFiberData const& fiber,
-	QMap<uint, uint> const& mapping,
-	vtkTable* refTable,
+	iAFiberSpatialIndex const& refIndex,
 	QVector<QVector<iAFiberSimilarity> >& bestMatches,
-	std::map<size_t, std::vector<iAVec3f> > const& refCurveInfo,
 	double diagonalLength, double maxLength,
-	std::vector<std::pair<int, bool>>& measuresToCompute, int optimizationMeasureIdx);
+	std::vector<std::pair<int, bool>>& measuresToCompute, int optimizationMeasureIdx,
+	double candidateSearchRadius);
@@ -0,0 +1,10 @@
+IF (openiA_TESTING_ENABLED)
+	ADD_EXECUTABLE(AgglomerativeClusteringTest GEMSe/iAAgglomerativeClusteringTest.cpp GEMSe/iAAgglomerativeClustering.cpp)
+	IF (OpenMP_CXX_FOUND)
+		TARGET_LINK_LIBRARIES(AgglomerativeClusteringTest PRIVATE OpenMP::OpenMP_CXX)
+	ENDIF()
+	ADD_TEST(NAME AgglomerativeClusteringTest COMMAND AgglomerativeClusteringTest)
+	IF (openiA_USE_IDE_FOLDERS)
+		SET_PROPERTY(TARGET AgglomerativeClusteringTest PROPERTY FOLDER "Tests")
+	ENDIF()
+ENDIF()
\ No newline at end of file
@@ -0,0 +1,158 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iAAgglomerativeClustering.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+iAAgglomerativeClustering::iAAgglomerativeClustering(int count):
+	m_count(count),
+	m_distances(count > 1 ? static_cast<size_t>(count) * (count - 1) / 2 : 0, 0.0f)
+{
+}
+
+int iAAgglomerativeClustering::count() const
+{
+	return m_count;
+}
+
+size_t iAAgglomerativeClustering::index(int i, int j) const
+{
+	assert(i != j && i >= 0 && j >= 0 && i < m_count && j < m_count);
+	if (j < i)
+	{
+		std::swap(i, j);
+	}
+	// offset of row i in the condensed upper triangle, plus position of j within that row:
+	return static_cast<size_t>(i) * (2 * static_cast<size_t>(m_count) - i - 1) / 2 + (j - i - 1);
+}
+
+void iAAgglomerativeClustering::setDistance(int i, int j, float distance)
+{
+	m_distances[index(i, j)] = distance;
+}
+
+float iAAgglomerativeClustering::distance(int i, int j) const
+{
+	return m_distances[index(i, j)];
+}
+
+std::vector<iAAgglomerativeClustering::Merge> iAAgglomerativeClustering::run()
+{
+	std::vector<Merge> merges;
+	if (m_count < 2)
+	{
+		return merges;
+	}
+	merges.reserve(m_count - 1);
+	float const NoNeighbour = std::numeric_limits<float>::max();
+	// matrix rows are "slots"; a merged cluster takes over the slot of the merged cluster with the lower node index
+	std::vector<int> nodeIdx(m_count);      // node index of the cluster in each slot
+	std::vector<int> activeSlots(m_count);  // slots still holding a cluster
+	std::vector<int> nn(m_count, -1);       // slot of the closest cluster with a higher node index
+	std::vector<float> nnDist(m_count, NoNeighbour);
+	for (int s = 0; s < m_count; ++s)
+	{
+		nodeIdx[s] = s;
+		activeSlots[s] = s;
+	}
+	auto updateNearestNeighbour = [&](int s)
+	{
+		nn[s] = -1;
+		nnDist[s] = NoNeighbour;
+		for (int t : activeSlots)
+		{
+			if (nodeIdx[t] <= nodeIdx[s])
+			{
+				continue;
+			}
+			float d = distance(s, t);
+			if (nn[s] == -1 || d < nnDist[s] || (d == nnDist[s] && nodeIdx[t] < nodeIdx[nn[s]]))
+			{
+				nn[s] = t;
+				nnDist[s] = d;
+			}
+		}
+	};
+#pragma omp parallel for schedule(dynamic)
+	for (long long s = 0; s < m_count; ++s)
+	{
+		updateNearestNeighbour(static_cast<int>(s));
+	}
+	std::vector<int> toUpdate;
+	for (int nextNodeIdx = m_count; activeSlots.size() > 1; ++nextNodeIdx)
+	{
+		// closest pair overall: the minimum candidate distance, ties broken by the lower node index
+		int a = -1;
+		for (int s : activeSlots)
+		{
+			if (nn[s] != -1 && (a == -1 || nnDist[s] < nnDist[a] || (nnDist[s] == nnDist[a] && nodeIdx[s] < nodeIdx[a])))
+			{
+				a = s;
+			}
+		}
+		assert(a != -1);
+		int b = nn[a];
+		merges.push_back(Merge{ nodeIdx[a], nodeIdx[b], nnDist[a] });
+
+		// merged cluster goes to slot a; complete linkage - its distance to another cluster is the maximum
+		// of the distances of the two merged clusters to that cluster:
+		activeSlots.erase(std::find(activeSlots.begin(), activeSlots.end(), b));
+		for (int s : activeSlots)
+		{
+			if (s != a)
+			{
+				float & d = m_distances[index(s, a)];
+				d = std::max(d, distance(s, b));
+			}
+		}
+		nodeIdx[a] = nextNodeIdx;
+		nn[a] = -1;                  // the new cluster has the highest node index, so it has no candidate itself
+		nnDist[a] = NoNeighbour;
+
+		// the new cluster is a candidate for all other clusters; those which had a or b as candidate need to search anew:
+		toUpdate.clear();
+		for (int s : activeSlots)
+		{
+			if (s == a)
+			{
+				continue;
+			}
+			if (nn[s] == a || nn[s] == b)
+			{
+				toUpdate.push_back(s);
+			}
+			else if (distance(s, a) < nnDist[s])   // on equal distance, the existing candidate has the lower node index
+			{
+				nn[s] = a;
+				nnDist[s] = distance(s, a);
+			}
+		}
+#pragma omp parallel for schedule(dynamic)
+		for (long long u = 0; u < static_cast<long long>(toUpdate.size()); ++u)
+		{
+			updateNearestNeighbour(toUpdate[u]);
+		}
+	}
+	return merges;
+}
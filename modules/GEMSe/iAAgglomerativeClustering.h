@@ -0,0 +1,53 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//! Agglomerative hierarchical clustering with complete (maximum) linkage on a dense, symmetric distance matrix.
+//! Produces exactly the merges of the naive algorithm, which repeatedly merges the closest pair of clusters
+//! (of equally close pairs, the one with the smallest node indices), but in O(n²) time for typical inputs:
+//! for each cluster, the closest cluster with a higher node index is kept as candidate, and only candidates
+//! affected by a merge are recomputed. The new cluster reuses the matrix row of one of the merged clusters,
+//! so only n*(n-1)/2 distances are stored.
+class iAAgglomerativeClustering
+{
+public:
+	//! A single merge step.
+	//! Node indices: 0..n-1 are the initial clusters, n+k is the cluster created by the k-th merge.
+	struct Merge
+	{
+		int first, second;   //!< node indices of the merged clusters, first < second
+		float distance;      //!< linkage distance of the two clusters
+	};
+	explicit iAAgglomerativeClustering(int count);
+	int count() const;
+	//! Sets the distance between initial clusters i and j (i != j). Different pairs may be set in parallel.
+	void setDistance(int i, int j, float distance);
+	float distance(int i, int j) const;
+	//! Performs all merges (count() - 1 of them). Modifies the stored distances.
+	std::vector<Merge> run();
+private:
+	size_t index(int i, int j) const;
+	int m_count;
+	std::vector<float> m_distances;  //!< condensed upper triangle, row-major
+};
@@ -0,0 +1,140 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iAAgglomerativeClustering.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Compares the merges of iAAgglomerativeClustering to those of a naive greedy complete linkage clustering
+// (which scans all pairs of remaining clusters for the closest one before each merge, and of equally close
+// pairs takes the one with the smallest node indices), on random distance matrices with many tied distances.
+
+namespace
+{
+	const int MatrixCount = 300;
+	const int MaxSize = 60;
+
+	std::vector<iAAgglomerativeClustering::Merge> naiveClustering(std::vector<std::vector<float> > dist)
+	{
+		int const count = static_cast<int>(dist.size());
+		int const nodeCount = 2 * count - 1;
+		// distance matrix over all node indices (initial and merged clusters); only active ones are considered:
+		for (auto & row : dist)
+		{
+			row.resize(nodeCount, 0.0f);
+		}
+		dist.resize(nodeCount, std::vector<float>(nodeCount, 0.0f));
+		std::vector<bool> active(nodeCount, false);
+		for (int i = 0; i < count; ++i)
+		{
+			active[i] = true;
+		}
+		std::vector<iAAgglomerativeClustering::Merge> merges;
+		for (int newNode = count; newNode < nodeCount; ++newNode)
+		{
+			int minI = -1, minJ = -1;
+			float minDist = std::numeric_limits<float>::max();
+			for (int i = 0; i < newNode; ++i)
+			{
+				for (int j = i + 1; j < newNode; ++j)
+				{
+					if (active[i] && active[j] && (minI == -1 || dist[i][j] < minDist))
+					{
+						minI = i;
+						minJ = j;
+						minDist = dist[i][j];
+					}
+				}
+			}
+			merges.push_back(iAAgglomerativeClustering::Merge{ minI, minJ, minDist });
+			active[minI] = active[minJ] = false;
+			for (int k = 0; k < newNode; ++k)
+			{
+				if (active[k])
+				{
+					dist[k][newNode] = dist[newNode][k] = std::max(dist[k][minI], dist[k][minJ]);
+				}
+			}
+			active[newNode] = true;
+		}
+		return merges;
+	}
+
+	bool testMatrix(int matrixNo, int count, int distinctValues, std::mt19937 & rng)
+	{
+		// few distinct distance values, so that many pairs are tied:
+		std::uniform_int_distribution<int> valueDist(0, distinctValues - 1);
+		std::vector<std::vector<float> > dist(count, std::vector<float>(count, 0.0f));
+		iAAgglomerativeClustering clustering(count);
+		for (int i = 0; i < count; ++i)
+		{
+			for (int j = i + 1; j < count; ++j)
+			{
+				float d = static_cast<float>(valueDist(rng)) / distinctValues;
+				dist[i][j] = dist[j][i] = d;
+				clustering.setDistance(i, j, d);
+			}
+		}
+		auto expected = naiveClustering(dist);
+		auto actual = clustering.run();
+		if (actual.size() != expected.size())
+		{
+			std::cout << "Matrix " << matrixNo << " (size " << count << "): expected " << expected.size()
+				<< " merges, got " << actual.size() << std::endl;
+			return false;
+		}
+		for (size_t m = 0; m < expected.size(); ++m)
+		{
+			if (actual[m].first != expected[m].first || actual[m].second != expected[m].second ||
+				actual[m].distance != expected[m].distance)
+			{
+				std::cout << "Matrix " << matrixNo << " (size " << count << "), merge " << m << ": expected ("
+					<< expected[m].first << ", " << expected[m].second << ", " << expected[m].distance << "), got ("
+					<< actual[m].first << ", " << actual[m].second << ", " << actual[m].distance << ")" << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> sizeDist(2, MaxSize);
+	std::uniform_int_distribution<int> distinctDist(1, 5);
+	int failed = 0;
+	for (int matrixNo = 0; matrixNo < MatrixCount; ++matrixNo)
+	{
+		// distinctValues == 1: all distances equal
+		if (!testMatrix(matrixNo, sizeDist(rng), distinctDist(rng), rng))
+		{
+			++failed;
+		}
+	}
+	std::cout << (MatrixCount - failed) << " of " << MatrixCount << " random matrices yielded the expected merges." << std::endl;
+	bool result = (failed == 0);
+	std::cout << "Overall: " << (result ? "PASSED" : "FAILED") << std::endl;
+	return result ? 0 : 1;
+}
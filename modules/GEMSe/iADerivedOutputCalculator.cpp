@@ -51,6 +51,11 @@ iADerivedOutputCalculator::iADerivedOutputCalculator(
 
 
 void iADerivedOutputCalculator::run()
+{
+	m_success = calculate(m_result, m_objCountIdx, m_avgUncIdx, m_labelCount);
+}
+
+bool iADerivedOutputCalculator::calculate(QSharedPointer<iASingleResult> result, int objCountIdx, int avgUncIdx, int labelCount)
 {
 	try
 	{
@@ -58,16 +63,15 @@ void iADerivedOutputCalculator::run()
 		typedef itk::ScalarConnectedComponentImageFilter <LabelImageType, OutputImageType > ConnectedComponentImageFilterType;
 		ConnectedComponentImageFilterType::Pointer connected = ConnectedComponentImageFilterType::New();
 		connected->SetDistanceThreshold(0);
-		if (m_result->GetLabelledImage().IsNull())
+		if (result->GetLabelledImage().IsNull())
 		{
 			DEBUG_LOG("Labelled Image is null");
-			m_success = false;
-			return;
+			return false;
 		}
-		LabelImageType* lblImg = dynamic_cast<LabelImageType*>(m_result->GetLabelledImage().GetPointer());
+		LabelImageType* lblImg = dynamic_cast<LabelImageType*>(result->GetLabelledImage().GetPointer());
 		connected->SetInput(lblImg);
 		connected->Update();
-		m_result->DiscardDetails();
+		result->DiscardDetails();
 		typedef itk::RelabelComponentImageFilter <OutputImageType, OutputImageType >
 			RelabelFilterType;
 		RelabelFilterType::Pointer relabel = RelabelFilterType::New();
@@ -75,16 +79,16 @@ void iADerivedOutputCalculator::run()
 		//relabel->SetSortByObjectSize(false);
 		relabel->Update();
 		int objCount = relabel->GetNumberOfObjects();
-		m_result->SetAttribute(m_objCountIdx, objCount);
+		result->SetAttribute(objCountIdx, objCount);
 
-		if (m_result->ProbabilityAvailable())
+		if (result->ProbabilityAvailable())
 		{
 			//typedef itk::ImageRegionConstIterator<ProbabilityImageType> ConstDblIt;
 			typedef iAEntropyImageFilter<ProbabilityImageType, ProbabilityImageType> EntropyFilter;
 			auto entropyFilter = EntropyFilter::New();
-			for (int i = 0; i < m_labelCount; ++i)
+			for (int i = 0; i < labelCount; ++i)
 			{
-				ProbabilityImageType* probImg = dynamic_cast<ProbabilityImageType*>(m_result->GetProbabilityImg(i).GetPointer());
+				ProbabilityImageType* probImg = dynamic_cast<ProbabilityImageType*>(result->GetProbabilityImg(i).GetPointer());
 				entropyFilter->SetInput(i, probImg);
 			}
 			entropyFilter->SetNormalize(true);
@@ -96,13 +100,13 @@ void iADerivedOutputCalculator::run()
 				DEBUG_LOG("AverageEntropy was infinity! Setting to -1")
 				avgEntropy = -1;
 			}
-			m_result->SetAttribute(m_avgUncIdx, avgEntropy);
-			m_result->DiscardProbability();
+			result->SetAttribute(avgUncIdx, avgEntropy);
+			result->DiscardProbability();
 		}
 	} catch (std::exception & e)
 	{
 		DEBUG_LOG(QString("An exception occured while computing derived output: %1").arg(e.what()));
-		m_success = false;
+		return false;
 	}
 	/*
 	itk::ImageFileWriter<OutputImageType>::Pointer writer = itk::ImageFileWriter<OutputImageType>::New();
@@ -111,6 +115,7 @@ void iADerivedOutputCalculator::run()
 	writer->SetInput(relabel->GetOutput() );
 	writer->Update();
 	*/
+	return true;
 }
 
 bool iADerivedOutputCalculator::success()
@@ -37,6 +37,10 @@ public:
 		int avgUncIdx,
 		int labelCount);
 	bool success();
+	//! Computes object count and average uncertainty of the given result and stores them in its attributes
+	//! with the given indices. Uses the label image already set in the result, if any (loads it otherwise).
+	//! @return true if successful, false if label (or probability) image could not be read or processed
+	static bool calculate(QSharedPointer<iASingleResult> result, int objCountIdx, int avgUncIdx, int labelCount);
 
 private:
 	QSharedPointer<iASingleResult> m_result;
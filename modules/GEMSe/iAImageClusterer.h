@@ -58,7 +58,7 @@ private:
 	bool m_aborted;
 	iAPerformanceTimer m_perfTimer;
 	int m_remainingNodes;
-	int m_currImage;
+	long m_comparedPairs, m_totalPairs;
 	iAPerformanceTimer::DurationType m_imageDistCalcDuration;
 	QString m_outputDirectory;
 };
@@ -23,24 +23,79 @@
 #include "iAAttributes.h"
 #include "iACommandRunner.h"
 #include "iADerivedOutputCalculator.h"
+#include "iAImageTreeNode.h"    // for ProbabilityPixel
 #include "iAParameterGenerator.h"
 #include "iASingleResult.h"
 #include "iASamplingResults.h"
 
 #include <iAAttributeDescriptor.h>
+#include <iAConnector.h>
 #include <iAConsole.h>
+#include <iAFilter.h>
+#include <iAFilterRegistry.h>
 #include <iAImageCoordinate.h>
 #include <iAModality.h>
 #include <iAModalityList.h>
 #include <iANameMapper.h>
+#include <iAProgress.h>
 #include <iAStringHelper.h>
+#include <iAToolsITK.h>
+#include <iATypedCallHelper.h>
+
+#include <itkImageDuplicator.h>
+
+#include <vtkImageData.h>
 
 #include <QDir>
 #include <QMap>
+#include <QRunnable>
 #include <QTextStream>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <functional>
 
 const int CONCURRENT_COMPUTATION_RUNS = 1;
 
+namespace
+{
+	//! memory that may be occupied by all concurrently running in-process computations
+	const double InProcessMemoryBudgetMB = 4096;
+	//! estimated memory required by one in-process computation (for its copy of the inputs, outputs and
+	//! intermediate images), as multiple of the size of all input images
+	const double InProcessMemoryFactor = 5;
+
+	template <typename T>
+	void internalDuplicateImage(iAITKIO::ImagePointer img, iAITKIO::ImagePointer & result)
+	{
+		typedef itk::Image<T, iAITKIO::m_DIM> ImageType;
+		auto duplicator = itk::ImageDuplicator<ImageType>::New();
+		duplicator->SetInputImage(dynamic_cast<ImageType*>(img.GetPointer()));
+		duplicator->Update();
+		result = duplicator->GetOutput();
+	}
+
+	iAITKIO::ImagePointer duplicateImage(iAITKIO::ImagePointer img)
+	{
+		iAITKIO::ImagePointer result;
+		ITK_TYPED_CALL(internalDuplicateImage, itkScalarPixelType(img), img, result);
+		return result;
+	}
+
+	class iASampleRunnable : public QRunnable
+	{
+	public:
+		explicit iASampleRunnable(std::function<void()> func) : m_func(func)
+		{}
+		void run() override
+		{
+			m_func();
+		}
+	private:
+		std::function<void()> m_func;
+	};
+}
+
 iAPerformanceTimer m_computationTimer;
 
 iAImageSampler::iAImageSampler(
@@ -98,9 +153,10 @@ void iAImageSampler::StatusMsg(QString const & msg)
 void iAImageSampler::run()
 {
 	m_overallTimer.start();
-	if (!QFile(m_executable).exists())
+	bool inProcess = iAFilterRegistry::filterID(m_executable) != -1;
+	if (!inProcess && !QFile(m_executable).exists())
 	{
-		DEBUG_LOG("Executable doesn't exist!");
+		DEBUG_LOG(QString("Executable '%1' doesn't exist, and there is no filter with that name either!").arg(m_executable));
 		return;
 	}
 	if (m_parameters->size() == 0)
@@ -145,6 +201,12 @@ void iAImageSampler::run()
 
 	int numDigits = std::floor(std::log10(std::abs(m_parameterSets->size()))) + 1;  // number of required digits for number >= 1
 
+	if (inProcess)
+	{
+		runInProcess(numDigits);
+		return;
+	}
+
 	for (m_curLoop=0; !m_aborted && m_curLoop<m_parameterSets->size(); ++m_curLoop)
 	{
 		ParameterSet const & paramSet = m_parameterSets->at(m_curLoop);
@@ -157,21 +219,11 @@ void iAImageSampler::run()
 			break;
 		}
 		StatusMsg(QString("Sampling run %1.").arg(m_curLoop));
-		QString outputDirectory = m_separateOutputDir ?
-			m_outputBaseDir + "/sample" + QString::number(m_curLoop) :
-			m_outputBaseDir;
-		QDir d(QDir::root());
-		if (!QDir(outputDirectory).exists() && !d.mkpath(outputDirectory))
+		QString outputFile = outputFileName(m_curLoop, numDigits);
+		if (outputFile.isEmpty())
 		{
-			DEBUG_LOG(QString("Could not create output directory '%1'").arg(outputDirectory));
 			return;
 		}
-		QFileInfo fi(m_imageBaseName);
-		QString outputFile = outputDirectory + "/" + (m_separateOutputDir ?
-			m_imageBaseName :
-			QString("%1%2%3").arg(fi.baseName()).arg(m_curLoop, numDigits, 10, QChar('0')).arg(
-				fi.completeSuffix().size() > 0 ? QString(".%1").arg(fi.completeSuffix()) : QString("") )
-		);
 		QStringList argumentList;
 		argumentList << additionalArgumentList;
 		argumentList << outputFile;
@@ -183,21 +235,7 @@ void iAImageSampler::run()
 
 		for (int i = 0; i < m_parameterCount; ++i)
 		{
-			QString value;
-			switch (m_parameters->at(i)->valueType())
-			{
-			default:
-			case Continuous:
-				value = QString::number(paramSet.at(i), 'g', 12);
-				break;
-			case Discrete:
-				value = QString::number(static_cast<long>(paramSet.at(i)));
-				break;
-			case Categorical:
-				value = m_parameters->at(i)->nameMapper()->name(static_cast<long>(paramSet.at(i)));
-				break;
-			}
-			argumentList << value;
+			argumentList << parameterValue(paramSet, i);
 		}
 		iACommandRunner* cmd = new iACommandRunner(m_executable, argumentList);
 
@@ -223,6 +261,234 @@ void iAImageSampler::run()
 	DEBUG_LOG("---------- SAMPLING FINISHED! ----------");
 }
 
+QString iAImageSampler::outputFileName(int id, int numDigits)
+{
+	QString outputDirectory = m_separateOutputDir ?
+		m_outputBaseDir + "/sample" + QString::number(id) :
+		m_outputBaseDir;
+	QDir d(QDir::root());
+	if (!QDir(outputDirectory).exists() && !d.mkpath(outputDirectory))
+	{
+		DEBUG_LOG(QString("Could not create output directory '%1'").arg(outputDirectory));
+		return QString();
+	}
+	QFileInfo fi(m_imageBaseName);
+	return outputDirectory + "/" + (m_separateOutputDir ?
+		m_imageBaseName :
+		QString("%1%2%3").arg(fi.baseName()).arg(id, numDigits, 10, QChar('0')).arg(
+			fi.completeSuffix().size() > 0 ? QString(".%1").arg(fi.completeSuffix()) : QString("") )
+	);
+}
+
+QString iAImageSampler::parameterValue(ParameterSet const & paramSet, int paramIdx) const
+{
+	switch (m_parameters->at(paramIdx)->valueType())
+	{
+	default:
+	case Continuous:
+		return QString::number(paramSet.at(paramIdx), 'g', 12);
+	case Discrete:
+		return QString::number(static_cast<long>(paramSet.at(paramIdx)));
+	case Categorical:
+		return m_parameters->at(paramIdx)->nameMapper()->name(static_cast<long>(paramSet.at(paramIdx)));
+	}
+}
+
+void iAImageSampler::runInProcess(int numDigits)
+{
+	if (!m_additionalArguments.trimmed().isEmpty())
+	{
+		DEBUG_LOG(QString("Additional arguments ('%1') are not supported when running filter '%2' in-process!")
+			.arg(m_additionalArguments).arg(m_executable));
+		return;
+	}
+	auto filter = iAFilterRegistry::filter(m_executable);
+	if (filter->parameters().size() != m_parameterCount)
+	{
+		DEBUG_LOG(QString("Filter '%1' expects %2 parameters, but %3 are sampled!")
+			.arg(m_executable).arg(filter->parameters().size()).arg(m_parameterCount));
+		return;
+	}
+	if (m_modalities->size() < filter->requiredInputs())
+	{
+		DEBUG_LOG(QString("Filter '%1' requires %2 input images, but only %3 modalities are loaded!")
+			.arg(m_executable).arg(filter->requiredInputs()).arg(m_modalities->size()));
+		return;
+	}
+	// convert the loaded modalities only once; the connectors need to be kept alive as they hold the ITK images:
+	QVector<QSharedPointer<iAConnector>> inputConnectors;
+	QVector<iAITKIO::ImagePointer> inputs;
+	double inputSizeMB = 0;
+	for (int m = 0; m < m_modalities->size(); ++m)
+	{
+		QSharedPointer<iAConnector> con(new iAConnector());
+		con->setImage(m_modalities->get(m)->image());
+		inputConnectors.push_back(con);
+		inputs.push_back(con->itkImage());
+		inputSizeMB += m_modalities->get(m)->image()->GetActualMemorySize() / 1024.0;
+	}
+	int threadCount = std::max(1, std::min(QThread::idealThreadCount(),
+		static_cast<int>(InProcessMemoryBudgetMB / std::max(1.0, InProcessMemoryFactor * inputSizeMB))));
+	DEBUG_LOG(QString("Running filter '%1' in-process, on up to %2 samples in parallel.").arg(m_executable).arg(threadCount));
+	QThreadPool pool;
+	pool.setMaxThreadCount(threadCount);
+	int runningSamples = 0;
+	m_curLoop = 0;
+	while (true)
+	{
+		while (!m_aborted && runningSamples < threadCount && m_curLoop < m_parameterSets->size())
+		{
+			int id = m_curLoop;
+			QString outputFile = outputFileName(id, numDigits);
+			if (outputFile.isEmpty())
+			{
+				m_aborted = true;
+				break;
+			}
+			StatusMsg(QString("Sampling run %1.").arg(id));
+			pool.start(new iASampleRunnable([this, id, outputFile, inputs]()
+			{
+				SampleRun sampleRun = computeSample(id, outputFile, inputs);
+				QMutexLocker locker(&m_mutex);
+				m_finishedSampleRuns.push_back(sampleRun);
+				m_sampleRunFinished.wakeOne();
+			}));
+			++runningSamples;
+			++m_curLoop;
+		}
+		if (runningSamples == 0)
+		{
+			break;
+		}
+		QList<SampleRun> finished;
+		{
+			QMutexLocker locker(&m_mutex);
+			while (m_finishedSampleRuns.isEmpty())
+			{
+				m_sampleRunFinished.wait(&m_mutex);
+			}
+			finished.swap(m_finishedSampleRuns);
+		}
+		for (auto const & sampleRun : finished)
+		{
+			--runningSamples;
+			m_computationDuration += sampleRun.duration;
+			if (!sampleRun.result)
+			{
+				DEBUG_LOG(QString("Computation of sample %1 was NOT successful, aborting!").arg(sampleRun.id));
+				m_aborted = true;
+				continue;
+			}
+			StatusMsg(QString("Sample %1 finished in %2 seconds.").arg(sampleRun.id).arg(sampleRun.duration));
+			m_results->GetAttributes()->at(m_parameterCount + 2)->adjustMinMax(sampleRun.duration);
+			if (m_calculateCharacteristics)
+			{
+				if (!sampleRun.derivedOutputSuccess)
+				{
+					DEBUG_LOG(QString("ERROR: Derived output calculation for sample %1 was not successful!").arg(sampleRun.id));
+					continue;
+				}
+				m_results->GetAttributes()->at(m_parameterCount)->adjustMinMax(sampleRun.result->GetAttribute(m_parameterCount));
+				m_results->GetAttributes()->at(m_parameterCount + 1)->adjustMinMax(sampleRun.result->GetAttribute(m_parameterCount + 1));
+			}
+			storeResult(sampleRun.result);
+		}
+	}
+	if (!m_aborted)
+	{
+		DEBUG_LOG("---------- SAMPLING FINISHED! ----------");
+	}
+}
+
+iAImageSampler::SampleRun iAImageSampler::computeSample(int id, QString const & outputFile, QVector<iAITKIO::ImagePointer> const & inputs)
+{
+	SampleRun sampleRun{ id, 0, QSharedPointer<iASingleResult>(), false };
+	iAPerformanceTimer timer;
+	try
+	{
+		// separate filter instance and copy of the inputs per sample; sharing the pixel buffer is not safe,
+		// as filters running in-place (e.g. ITK's in-place image filters) would overwrite it, and with it
+		// the modality data and the input of all other samples:
+		auto filter = iAFilterRegistry::filter(m_executable);
+		QVector<QSharedPointer<iAConnector>> inputConnectors;
+		for (auto input : inputs)
+		{
+			iAITKIO::ImagePointer img = duplicateImage(input);
+			QSharedPointer<iAConnector> con(new iAConnector());
+			con->setImage(img);
+			inputConnectors.push_back(con);
+			filter->addInput(con.data());
+		}
+		ParameterSet const & paramSet = m_parameterSets->at(id);
+		QMap<QString, QVariant> parameters;
+		for (int i = 0; i < m_parameterCount; ++i)
+		{
+			parameters.insert(filter->parameters()[i]->name(), parameterValue(paramSet, i));
+		}
+		iAProgress progress;
+		filter->setProgress(&progress);
+		filter->setLogger(iAConsoleLogger::get());
+		if (!filter->checkParameters(parameters) || !filter->run(parameters) || filter->output().size() == 0)
+		{
+			return sampleRun;
+		}
+		// write output(s), named as the command line runner would:
+		QFileInfo fi(outputFile);
+		for (int o = 0; o < filter->output().size(); ++o)
+		{
+			QString outFileName = (o == 0) ? outputFile :
+				QString("%1/%2%3.%4").arg(fi.absolutePath()).arg(fi.baseName()).arg(o).arg(fi.completeSuffix());
+			iAITKIO::writeFile(outFileName, filter->output()[o]->itkImage(), filter->output()[o]->itkScalarPixelType());
+		}
+		sampleRun.duration = timer.elapsed();
+		sampleRun.result = iASingleResult::Create(id, *m_results.data(), paramSet,
+			m_outputBaseDir + "/sample" + QString::number(id) + "/label.mhd");
+		sampleRun.result->SetAttribute(m_parameterCount + 2, sampleRun.duration);
+		if (m_calculateCharacteristics)
+		{
+			// compute derived output from the images still in memory instead of reading them back:
+			iAITKIO::ImagePointer labelImg = filter->output()[0]->itkImage();
+			if (filter->output()[0]->itkScalarPixelType() != itk::ImageIOBase::INT)
+			{
+				labelImg = castImageTo<int>(labelImg);
+			}
+			sampleRun.result->SetLabelImage(labelImg);
+			if (filter->output().size() == m_labelCount + 1)
+			{   // label image followed by one probability image per label
+				QVector<iAITKIO::ImagePointer> probImgs;
+				for (int o = 1; o < filter->output().size(); ++o)
+				{
+					probImgs.push_back(castImageTo<ProbabilityPixel>(filter->output()[o]->itkImage()));
+				}
+				sampleRun.result->AddProbabilityImages(probImgs);
+			}
+			sampleRun.derivedOutputSuccess = iADerivedOutputCalculator::calculate(sampleRun.result, m_parameterCount, m_parameterCount + 1, m_labelCount);
+			sampleRun.result->DiscardDetails();
+			sampleRun.result->DiscardProbability();
+		}
+	}
+	catch (std::exception & e)
+	{
+		DEBUG_LOG(QString("An exception occured while computing sample %1: %2").arg(id).arg(e.what()));
+		sampleRun.result.clear();
+	}
+	return sampleRun;
+}
+
+void iAImageSampler::storeResult(QSharedPointer<iASingleResult> result)
+{
+	// TODO: pass in from somewhere! Or don't store here at all? but what in case of a power outage/error?
+	QString sampleMetaFile    = m_outputBaseDir + "/" + m_parameterRangeFile;
+	QString parameterSetFile  = m_outputBaseDir + "/" + m_parameterSetFile;
+	QString derivedOutputFile = m_outputBaseDir + "/" + m_derivedOutputFile;
+	m_results->AddResult(result);
+	emit Progress((100 * m_results->size()) / m_parameterSets->size());
+	if (!m_results->Store(sampleMetaFile, parameterSetFile, derivedOutputFile))
+	{
+		DEBUG_LOG("Error writing parameter file.");
+	}
+}
+
 void iAImageSampler::computationFinished()
 {
 	iACommandRunner* cmd = dynamic_cast<iACommandRunner*>(QObject::sender());
@@ -266,15 +532,7 @@ void iAImageSampler::computationFinished()
 	}
 	else
 	{
-		QString sampleMetaFile = m_outputBaseDir + "/" + m_parameterRangeFile;
-		QString parameterSetFile = m_outputBaseDir + "/" + m_parameterSetFile;
-		QString derivedOutputFile = m_outputBaseDir + "/" + m_derivedOutputFile;
-		m_results->AddResult(result);
-		emit Progress((100 * m_results->size()) / m_parameterSets->size());
-		if (!m_results->Store(sampleMetaFile, parameterSetFile, derivedOutputFile))
-		{
-			DEBUG_LOG("Error writing parameter file.");
-		}
+		storeResult(result);
 	}
 	m_runningComputation.remove(cmd);
 	delete cmd;
@@ -302,17 +560,7 @@ void iAImageSampler::derivedOutputFinished()
 	QSharedPointer<iASingleResult> result = m_runningDerivedOutput[charactCalc];
 	m_results->GetAttributes()->at(m_parameterCount)->adjustMinMax(result->GetAttribute(m_parameterCount));
 	m_results->GetAttributes()->at(m_parameterCount+1)->adjustMinMax(result->GetAttribute(m_parameterCount+1));
-
-	// TODO: pass in from somewhere! Or don't store here at all? but what in case of a power outage/error?
-	QString sampleMetaFile      = m_outputBaseDir + "/" + m_parameterRangeFile;
-	QString parameterSetFile    = m_outputBaseDir + "/" + m_parameterSetFile;
-	QString derivedOutputFile = m_outputBaseDir + "/" + m_derivedOutputFile;
-	m_results->AddResult(result);
-	emit Progress((100*m_results->size()) / m_parameterSets->size());
-	if (!m_results->Store(sampleMetaFile, parameterSetFile, derivedOutputFile))
-	{
-		DEBUG_LOG("Error writing parameter file.");
-	}
+	storeResult(result);
 	m_runningDerivedOutput.remove(charactCalc);
 	delete charactCalc;
 	m_mutex.lock();
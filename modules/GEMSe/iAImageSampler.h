@@ -25,11 +25,15 @@
 #include "iAParameterGenerator.h"
 
 #include <iAPerformanceHelper.h>
+#include <io/iAITKIO.h>
 
+#include <QList>
 #include <QMap>
 #include <QMutex>
 #include <QSharedPointer>
 #include <QThread>
+#include <QVector>
+#include <QWaitCondition>
 
 class iAAttributes;
 class iAModalityList;
@@ -38,6 +42,9 @@ class iASingleResult;
 class iADerivedOutputCalculator;
 class iACommandRunner;
 
+//! Samples the parameter space of a segmentation algorithm, i.e. computes the algorithm's result for a number of
+//! parameter sets. The algorithm is either an external executable, which is run once per parameter set, or
+//! the name of a registered iAFilter, which is run directly in this process on the loaded modalities.
 class iAImageSampler: public QThread, public iADurationEstimator, public iAAbortListener
 {
 	Q_OBJECT
@@ -112,7 +119,28 @@ private:
 	int m_parameterCount;
 	int m_samplingID;
 
+	//! @{
+	//! in-process computation
+	struct SampleRun
+	{
+		int id;
+		iAPerformanceTimer::DurationType duration;
+		QSharedPointer<iASingleResult> result;  //!< null if the computation failed
+		bool derivedOutputSuccess;
+	};
+	QList<SampleRun> m_finishedSampleRuns;      //!< runs finished since last check, guarded by m_mutex
+	QWaitCondition m_sampleRunFinished;
+	void runInProcess(int numDigits);
+	SampleRun computeSample(int id, QString const & outputFile, QVector<iAITKIO::ImagePointer> const & inputs);
+	//! @}
+
 	void StatusMsg(QString const & msg);
+	//! Creates the output directory for the given sample; returns the name of the output image file
+	//! (or an empty string if the directory could not be created).
+	QString outputFileName(int id, int numDigits);
+	//! The given parameter value, formatted as expected by the sampled algorithm
+	QString parameterValue(ParameterSet const & paramSet, int paramIdx) const;
+	void storeResult(QSharedPointer<iASingleResult> result);
 private slots:
 	void computationFinished();
 	void derivedOutputFinished();
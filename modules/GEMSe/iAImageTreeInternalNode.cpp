@@ -22,11 +22,13 @@
 
 #include "iAGEMSeConstants.h" // for iARepresentativeType -> move to iARepresentative?
 #include "iARepresentative.h"
+#include "iASingleResult.h"
 
 #include <iAConsole.h>
 #include <iAMathUtility.h>
 #include <iAToolsITK.h>
 
+#include <QCryptographicHash>
 #include <QFileInfo>
 
 #include <random>
@@ -172,6 +174,13 @@ ClusterImageType iAImageTreeInternalNode::CalculateFilteredRepresentative(int ty
 	{
 	case iARepresentativeType::Difference:
 	{
+		QString cacheFile = GetFilteredCachedFileName(type);
+		if (QFileInfo(cacheFile).exists())
+		{
+			iAITKIO::ScalarPixelType pixelType;
+			m_filteredRepresentative[type] = iAITKIO::readFile(cacheFile, pixelType, false);
+			return m_filteredRepresentative[type];
+		}
 		QVector<iAITKIO::ImagePointer> imgs;
 		for (int i = 0; i < GetChildCount(); ++i)
 		{
@@ -183,6 +192,10 @@ ClusterImageType iAImageTreeInternalNode::CalculateFilteredRepresentative(int ty
 		}
 		m_filteredRepresentative[type] =
 			CalculateDifferenceMarkers(imgs, m_differenceMarkerValue);
+		if (imgs.size() > 1 && m_filteredRepresentative[type])	// otherwise, it's the representative of a child
+		{
+			storeImage(m_filteredRepresentative[type], cacheFile, true);
+		}
 		return m_filteredRepresentative[type];
 	}
 	case iARepresentativeType::AverageEntropy:
@@ -371,6 +384,19 @@ QString iAImageTreeInternalNode::GetCachedFileName(int type) const
 		".mhd";
 }
 
+QString iAImageTreeInternalNode::GetFilteredCachedFileName(int type) const
+{
+	QVector<QSharedPointer<iASingleResult> > selection;
+	GetSelection(selection);
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(QString("%1,%2").arg(type).arg(m_differenceMarkerValue).toUtf8());
+	for (auto result : selection)
+	{
+		hash.addData(QString(";%1-%2").arg(result->GetDatasetID()).arg(result->GetID()).toUtf8());
+	}
+	return m_cachePath + "/rep-filtered-" + QString(hash.result().toHex()) + ".mhd";
+}
+
 ClusterDistanceType iAImageTreeInternalNode::GetDistance() const
 {
 	return m_distance;
@@ -385,8 +411,6 @@ LabelPixelHistPtr iAImageTreeInternalNode::UpdateLabelDistribution() const
 	LabelPixelHistPtr childResult1 = GetChild(0)->UpdateLabelDistribution();
 	LabelPixelHistPtr childResult2 = GetChild(1)->UpdateLabelDistribution();
 
-	LabelImagePointer child1Img = childResult1->hist.at(0);
-	LabelImageType::SizeType size = child1Img->GetLargestPossibleRegion().GetSize();
 	for (int l = 0; l < m_differenceMarkerValue; ++l)
 	{
 		typedef itk::AddImageFilter<LabelImageType> AddImgFilterType;
@@ -398,38 +422,7 @@ LabelPixelHistPtr iAImageTreeInternalNode::UpdateLabelDistribution() const
 	}
 	result->count = childResult1->count + childResult2->count;
 
-	ProbabilityImagePointer labelEntropy = createImage<ProbabilityImageType>(
-		size,
-		child1Img->GetSpacing()
-		);
-	LabelImageType::IndexType idx;
-
-	double limit = -std::log(1.0 / m_differenceMarkerValue);
-	double normalizeFactor = 1 / limit;
-
-	for (idx[0] = 0; idx[0] >= 0 && static_cast<uint64_t>(idx[0]) < size[0]; ++idx[0])
-	{	// >= 0 checks to prevent signed int overflow!
-		for (idx[1] = 0; idx[1] >= 0 && static_cast<uint64_t>(idx[1]) < size[1]; ++idx[1])
-		{
-			for (idx[2] = 0; idx[2] >= 0 && static_cast<uint64_t>(idx[2]) < size[2]; ++idx[2])
-			{
-				double entropy = 0;
-				for (int l = 0; l < m_differenceMarkerValue; ++l)
-				{
-					LabelImagePointer img = result->hist.at(l);
-					double histValue = img->GetPixel(idx);
-					if (histValue > 0) // to avoid infinity - we take 0, which is appropriate according to limit
-					{
-						double prob = histValue / result->count;
-						entropy += (prob * std::log(prob));
-					}
-				}
-				entropy = -entropy;
-				entropy = clamp(0.0, limit, entropy);
-				labelEntropy->SetPixel(idx, entropy * normalizeFactor);
-			}
-		}
-	}
+	ProbabilityImagePointer labelEntropy = CalculateLabelEntropy(result->hist, result->count);
 
 	if (m_representative.size() <= iARepresentativeType::LabelDistribution)
 	{
@@ -452,8 +445,6 @@ CombinedProbPtr iAImageTreeInternalNode::UpdateProbabilities() const
 		return result;
 	}
 
-	ProbabilityImagePointer child1Img = childResult1->prob.at(0);
-	ProbabilityImageType::SizeType size = child1Img->GetLargestPossibleRegion().GetSize();
 	for (int l = 0; l < m_differenceMarkerValue; ++l)
 	{
 		if (childResult1->prob.at(l) && childResult2->prob.at(l))
@@ -474,51 +465,9 @@ CombinedProbPtr iAImageTreeInternalNode::UpdateProbabilities() const
 	}
 	result->count = childResult1->count + childResult2->count;
 
-	ProbabilityImagePointer averageEntropy = createImage<ProbabilityImageType>(
-		size,
-		child1Img->GetSpacing()
-		);
-	ProbabilityImageType::IndexType idx;
-
-	LabelImagePointer averageLabel = createImage<LabelImageType>(
-		size,
-		child1Img->GetSpacing()
-		);
-
-	double limit = -std::log(1.0 / m_differenceMarkerValue);
-	double normalizeFactor = 1 / limit;
-
-	for (idx[0] = 0; idx[0] >= 0 && static_cast<uint64_t>(idx[0]) < size[0]; ++idx[0])
-	{	// >= 0 checks to prevent signed int overflow!
-		for (idx[1] = 0; idx[1] >= 0 && static_cast<uint64_t>(idx[1]) < size[1]; ++idx[1])
-		{
-			for (idx[2] = 0; idx[2] >= 0 && static_cast<uint64_t>(idx[2]) < size[2]; ++idx[2])
-			{
-				double entropy = 0;
-				double probMax = -1;
-				int label = -1;
-				for (int l = 0; l < m_differenceMarkerValue; ++l)
-				{
-					ProbabilityImagePointer img = result->prob.at(l);
-					double probSum = img->GetPixel(idx);
-					if (probSum > probMax)
-					{
-						label = l;
-						probMax = probSum;
-					}
-					if (probSum > 0) // to avoid infinity - we take 0, which is appropriate according to limit
-					{
-						double prob = probSum / result->count;
-						entropy += (prob * std::log(prob));
-					}
-				}
-				entropy = -entropy;
-				entropy = clamp(0.0, limit, entropy);
-				averageEntropy->SetPixel(idx, entropy * normalizeFactor);
-				averageLabel->SetPixel(idx, label);
-			}
-		}
-	}
+	ProbabilityImagePointer averageEntropy;
+	LabelImagePointer averageLabel;
+	CalculateAverageLabelAndEntropy(result->prob, result->count, averageLabel, averageEntropy);
 
 	if (m_representative.size() <= iARepresentativeType::AverageLabel)
 	{
@@ -58,6 +58,9 @@ public:
 private:
 	void RecalculateFilteredRepresentative(int type, LabelImagePointer refImg) const;
 	QString GetCachedFileName(int type) const;
+	//! Name of the cache file for the representative of the given type over the currently not filtered
+	//! results; based on a hash of the IDs of these results, so it is independent of the filter settings.
+	QString GetFilteredCachedFileName(int type) const;
 	ClusterImageType CalculateRepresentative(int type, LabelImagePointer refImg) const;
 	ClusterImageType CalculateFilteredRepresentative(int type, LabelImagePointer refImg) const;
 	ClusterIDType m_ID;
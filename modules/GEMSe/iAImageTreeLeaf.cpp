@@ -26,6 +26,8 @@
 
 #include <iAToolsITK.h>
 
+#include <vector>
+
 iAImageTreeLeaf::iAImageTreeLeaf(QSharedPointer<iASingleResult> img, int labelCount) :
 	m_filtered(false),
 	m_labelCount(labelCount),
@@ -131,18 +133,17 @@ LabelPixelHistPtr iAImageTreeLeaf::UpdateLabelDistribution() const
 			img->GetSpacing());
 		result->hist.push_back(p);
 	}
-	// calculate actual histogram:
-	LabelImageType::IndexType idx;
-	for (idx[0] = 0; idx[0] >= 0 && static_cast<uint64_t>(idx[0]) < size[0]; ++idx[0])
-	{	// >= 0 checks to prevent signed int overflow!
-		for (idx[1] = 0;  idx[1] >= 0 && static_cast<uint64_t>(idx[1]) < size[1]; ++idx[1])
-		{
-			for (idx[2] = 0;  idx[2] >= 0 && static_cast<uint64_t>(idx[2]) < size[2]; ++idx[2])
-			{
-				int label = img->GetPixel(idx);
-				result->hist.at(label)->SetPixel(idx, 1);
-			}
-		}
+	// calculate actual histogram, in raster order over all buffers:
+	std::vector<LabelPixelType *> hist;
+	for (auto histImg : result->hist)
+	{
+		hist.push_back(histImg->GetBufferPointer());
+	}
+	LabelPixelType const * labels = img->GetBufferPointer();
+	size_t voxelCount = img->GetLargestPossibleRegion().GetNumberOfPixels();
+	for (size_t v = 0; v < voxelCount; ++v)
+	{
+		hist[labels[v]][v] = 1;
 	}
 	result->count = 1;
 	return result;
@@ -0,0 +1,178 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iALabelImageCache.h"
+
+#include "iAImageTreeNode.h"    // for LabelImageType
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+	template <typename T1, typename T2>
+	double overlapDistance(T1 const * labels1, T2 const * labels2, size_t voxelCount)
+	{
+		// per voxel, as in itk::LabelOverlapMeasuresImageFilter: if both labels are equal, the voxel counts
+		// once to intersection and union of that label; otherwise it counts to the union of both labels.
+		// Background (label 0) is excluded from both sums.
+		size_t intersection = 0, unionSize = 0;
+		for (size_t i = 0; i < voxelCount; ++i)
+		{
+			int const l1 = labels1[i], l2 = labels2[i];
+			size_t const fg1 = (l1 != 0), fg2 = (l2 != 0);
+			if (l1 == l2)
+			{
+				intersection += fg1;
+				unionSize += fg1;
+			}
+			else
+			{
+				unionSize += fg1 + fg2;
+			}
+		}
+		if (unionSize == 0)
+		{	// mean overlap is undefined (0/0) if both images contain only background;
+			// as previously (where itk::LabelOverlapMeasuresImageFilter yielded NaN), treat them as maximally distant:
+			return 1.0;
+		}
+		double unionOverlap = static_cast<double>(intersection) / unionSize;
+		double meanOverlap = 2.0 * unionOverlap / (1.0 + unionOverlap);
+		return 1 - meanOverlap;
+	}
+}
+
+iACompactLabelImage::iACompactLabelImage(iAITKIO::ImagePointer img):
+	m_voxelCount(0)
+{
+	LabelImageType * labelImg = dynamic_cast<LabelImageType*>(img.GetPointer());
+	if (!labelImg)
+	{
+		return;
+	}
+	size_t voxelCount = labelImg->GetLargestPossibleRegion().GetNumberOfPixels();
+	int const * labels = labelImg->GetBufferPointer();
+	bool fitsInBytes = true;
+	for (size_t i = 0; i < voxelCount && fitsInBytes; ++i)
+	{
+		fitsInBytes = labels[i] >= 0 && labels[i] <= std::numeric_limits<unsigned char>::max();
+	}
+	if (fitsInBytes)
+	{
+		m_byteLabels.assign(labels, labels + voxelCount);
+	}
+	else
+	{
+		m_intLabels.assign(labels, labels + voxelCount);
+	}
+	m_voxelCount = voxelCount;
+}
+
+bool iACompactLabelImage::isValid() const
+{
+	return m_voxelCount > 0;
+}
+
+size_t iACompactLabelImage::voxelCount() const
+{
+	return m_voxelCount;
+}
+
+size_t iACompactLabelImage::byteSize() const
+{
+	return m_byteLabels.size() * sizeof(unsigned char) + m_intLabels.size() * sizeof(int);
+}
+
+double overlapDistance(iACompactLabelImage const & img1, iACompactLabelImage const & img2)
+{
+	assert(img1.m_voxelCount == img2.m_voxelCount);
+	size_t voxelCount = std::min(img1.m_voxelCount, img2.m_voxelCount);
+	bool bytes1 = !img1.m_byteLabels.empty(), bytes2 = !img2.m_byteLabels.empty();
+	if (bytes1 && bytes2)
+	{
+		return overlapDistance(img1.m_byteLabels.data(), img2.m_byteLabels.data(), voxelCount);
+	}
+	else if (bytes1)
+	{
+		return overlapDistance(img1.m_byteLabels.data(), img2.m_intLabels.data(), voxelCount);
+	}
+	else if (bytes2)
+	{
+		return overlapDistance(img1.m_intLabels.data(), img2.m_byteLabels.data(), voxelCount);
+	}
+	return overlapDistance(img1.m_intLabels.data(), img2.m_intLabels.data(), voxelCount);
+}
+
+
+iALabelImageCache::iALabelImageCache(int count, size_t budgetBytes, std::function<iAITKIO::ImagePointer(int)> loader):
+	m_loader(loader),
+	m_entries(count),
+	m_budget(budgetBytes),
+	m_usedBytes(0),
+	m_loadCount(0)
+{
+}
+
+iALabelImageCache::ImagePtr iALabelImageCache::get(int idx)
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		Entry & entry = m_entries[idx];
+		if (entry.image)
+		{
+			m_lru.splice(m_lru.begin(), m_lru, entry.lruPos);
+			return entry.image;
+		}
+	}
+	// load and convert outside of the lock, so that several images can be loaded in parallel:
+	ImagePtr image(new iACompactLabelImage(m_loader(idx)));
+	if (!image->isValid())
+	{
+		return ImagePtr();
+	}
+	QMutexLocker locker(&m_mutex);
+	++m_loadCount;
+	Entry & entry = m_entries[idx];
+	if (entry.image)    // loaded by another thread in the meantime
+	{
+		return entry.image;
+	}
+	entry.image = image;
+	m_lru.push_front(idx);
+	entry.lruPos = m_lru.begin();
+	m_usedBytes += image->byteSize();
+	while (m_usedBytes > m_budget && m_lru.size() > 1)
+	{
+		Entry & evicted = m_entries[m_lru.back()];
+		m_usedBytes -= evicted.image->byteSize();
+		evicted.image.reset();
+		m_lru.pop_back();
+	}
+	return image;
+}
+
+size_t iALabelImageCache::loadCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_loadCount;
+}
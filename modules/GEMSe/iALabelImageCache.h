@@ -0,0 +1,84 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#pragma once
+
+#include <io/iAITKIO.h>
+
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <functional>
+#include <list>
+#include <vector>
+
+//! The labels of a label image as flat array, for fast pairwise comparison of ensemble members.
+//! Labels are stored as bytes if all of them fit into one, which is the case for all but the
+//! most exotic segmentations; only when this fails, the full int labels are kept.
+class iACompactLabelImage
+{
+public:
+	//! Creates the compact representation of the given image (which needs to be of type LabelImageType).
+	explicit iACompactLabelImage(iAITKIO::ImagePointer img);
+	//! whether the given image could be converted (i.e., whether it was a non-empty label image)
+	bool isValid() const;
+	size_t voxelCount() const;
+	//! memory occupied by the labels
+	size_t byteSize() const;
+	//! Distance of two label images, 1 - mean overlap (Dice coefficient, over all non-background labels).
+	//! Gives the same value as 1 - GetMeanOverlap() of itk::LabelOverlapMeasuresImageFilter, but
+	//! computes it in a single pass over both label arrays without any per-label bookkeeping.
+	//! Returns 1 if both images contain only background (the mean overlap is undefined then).
+	friend double overlapDistance(iACompactLabelImage const & img1, iACompactLabelImage const & img2);
+private:
+	size_t m_voxelCount;
+	std::vector<unsigned char> m_byteLabels;
+	std::vector<int> m_intLabels;
+};
+
+//! Thread-safe cache of the compact label images of all ensemble members.
+//! Images are loaded on first access; when the memory budget is exceeded, the least recently used
+//! images are evicted (images still in use by a caller stay valid until the caller releases them).
+class iALabelImageCache
+{
+public:
+	typedef QSharedPointer<iACompactLabelImage const> ImagePtr;
+	//! @param count the number of images
+	//! @param budgetBytes maximum memory to be occupied by the cached images
+	//! @param loader loads the label image with the given index (needs to be callable from multiple threads
+	//!        for different indices); returning a null pointer signals that the image could not be loaded.
+	iALabelImageCache(int count, size_t budgetBytes, std::function<iAITKIO::ImagePointer(int)> loader);
+	//! Returns the image with the given index, loading it if it is not cached (null if loading failed).
+	ImagePtr get(int idx);
+	//! number of times an image had to be loaded so far
+	size_t loadCount() const;
+private:
+	struct Entry
+	{
+		ImagePtr image;
+		std::list<int>::iterator lruPos;
+	};
+	std::function<iAITKIO::ImagePointer(int)> m_loader;
+	QVector<Entry> m_entries;
+	std::list<int> m_lru;    //!< indices of the cached images, most recently used first
+	size_t m_budget, m_usedBytes, m_loadCount;
+	mutable QMutex m_mutex;
+};
@@ -20,15 +20,53 @@
 * ************************************************************************************/
 #include "iARepresentative.h"
 
+#include <iAConsole.h>
+#include <iAMathUtility.h>
 #include <iAToolsITK.h>
 
 #include <QVector>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	//! Calls func(begin, end) for the voxel index ranges of all z slices of an image of the given size, in parallel.
+	template <typename Func>
+	void forEachSlab(iAITKIO::ImageBaseType::SizeType const & size, Func func)
+	{
+		size_t const sliceSize = static_cast<size_t>(size[0]) * size[1];
+#pragma omp parallel for
+		for (long long z = 0; z < static_cast<long long>(size[2]); ++z)
+		{
+			func(z * sliceSize, (z + 1) * sliceSize);
+		}
+	}
+
+	//! Adds the summand for one label to an entropy sum; probabilities of 0 are skipped
+	//! (their limit contribution is 0), which also avoids taking the logarithm of 0.
+	inline void addEntropy(double & entropy, double prob)
+	{
+		if (prob > 0)
+		{
+			entropy += prob * std::log(prob);
+		}
+	}
+
+	//! Negates the entropy sum and normalizes it to [0..1] using the maximum entropy (limit) for the given label count.
+	inline double normalizedEntropy(double entropySum, double limit)
+	{
+		return clamp(0.0, limit, -entropySum) * (1 / limit);
+	}
+}
+
 template <class T>
 void diff_marker_tmpl(QVector<iAITKIO::ImagePointer> imgsBase, double differenceMarkerValue, iAITKIO::ImagePointer & result)
 {
 	typedef itk::Image<T, iAITKIO::m_DIM > ImgType;
-	QVector<ImgType*> imgs;
+	std::vector<T const *> buffers;
+	size_t voxelCount = imgsBase[0]->GetLargestPossibleRegion().GetNumberOfPixels();
 	for (int i = 0; i < imgsBase.size(); ++i)
 	{
 		auto ptr = dynamic_cast<ImgType*>(imgsBase[i].GetPointer());
@@ -37,30 +75,30 @@ void diff_marker_tmpl(QVector<iAITKIO::ImagePointer> imgsBase, double difference
 			DEBUG_LOG("Differnce Marker: Invalid type conversion - images must have same type!");
 			return;
 		}
-		imgs.push_back(ptr);
+		if (ptr->GetLargestPossibleRegion().GetNumberOfPixels() != voxelCount)
+		{
+			DEBUG_LOG("Difference Marker: Images must have same size!");
+			return;
+		}
+		buffers.push_back(ptr->GetBufferPointer());
 	}
-	typename ImgType::Pointer out = createImage<ImgType>(imgs[0]);
-	typename iAITKIO::ImageBaseType::RegionType reg = imgs[0]->GetLargestPossibleRegion();
-	typename iAITKIO::ImageBaseType::SizeType size = reg.GetSize();
-	typename iAITKIO::ImageBaseType::IndexType idx;
-	for (idx[0] = 0; idx[0] >= 0 && static_cast<uint64_t>(idx[0]) < size[0]; ++idx[0])
-	{	// >= 0 checks to prevent signed int overflow!
-		for (idx[1] = 0; idx[1] >= 0 && static_cast<uint64_t>(idx[1]) < size[1]; ++idx[1])
+	typename ImgType::Pointer out = createImage<ImgType>(dynamic_cast<ImgType*>(imgsBase[0].GetPointer()));
+	T * outBuf = out->GetBufferPointer();
+	T const marker = static_cast<T>(differenceMarkerValue);
+	forEachSlab(out->GetLargestPossibleRegion().GetSize(), [&buffers, outBuf, marker](size_t begin, size_t end)
+	{
+		std::copy(buffers[0] + begin, buffers[0] + end, outBuf + begin);
+		// branch-free per image, so that the compiler can vectorize the comparisons;
+		// once a voxel is marked it stays marked, as the marker is only kept by an image which also has it there:
+		for (size_t i = 1; i < buffers.size(); ++i)
 		{
-			for (idx[2] = 0; idx[2] >= 0 && static_cast<uint64_t>(idx[2]) < size[2]; ++idx[2])
+			T const * buf = buffers[i];
+			for (size_t v = begin; v < end; ++v)
 			{
-				double pixel = imgs[0]->GetPixel(idx);
-				for (int i = 1; i < imgs.size(); ++i)
-				{
-					if (imgs[i]->GetPixel(idx) != pixel)
-					{
-						pixel = differenceMarkerValue;
-					}
-				}
-				out->SetPixel(idx, pixel);
+				outBuf[v] = (buf[v] == outBuf[v]) ? outBuf[v] : marker;
 			}
 		}
-	}
+	});
 	result = out;
 }
 
@@ -78,3 +116,66 @@ iAITKIO::ImagePointer CalculateDifferenceMarkers(QVector<iAITKIO::ImagePointer>
 	ITK_TYPED_CALL(diff_marker_tmpl, itkScalarPixelType(imgs[0]), imgs, differenceMarkerValue, result);
 	return result;
 }
+
+ProbabilityImagePointer CalculateLabelEntropy(QVector<LabelImagePointer> const & labelHist, int count)
+{
+	auto size = labelHist[0]->GetLargestPossibleRegion().GetSize();
+	ProbabilityImagePointer labelEntropy = createImage<ProbabilityImageType>(size, labelHist[0]->GetSpacing());
+	std::vector<LabelPixelType const *> hist;
+	for (auto img : labelHist)
+	{
+		hist.push_back(img->GetBufferPointer());
+	}
+	ProbabilityPixel * out = labelEntropy->GetBufferPointer();
+	double const limit = -std::log(1.0 / labelHist.size());
+	forEachSlab(size, [&hist, out, count, limit](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			double entropy = 0;
+			for (size_t l = 0; l < hist.size(); ++l)
+			{
+				addEntropy(entropy, static_cast<double>(hist[l][v]) / count);
+			}
+			out[v] = normalizedEntropy(entropy, limit);
+		}
+	});
+	return labelEntropy;
+}
+
+void CalculateAverageLabelAndEntropy(QVector<ProbabilityImagePointer> const & probSum, int count,
+	LabelImagePointer & averageLabel, ProbabilityImagePointer & averageEntropy)
+{
+	auto size = probSum[0]->GetLargestPossibleRegion().GetSize();
+	averageEntropy = createImage<ProbabilityImageType>(size, probSum[0]->GetSpacing());
+	averageLabel = createImage<LabelImageType>(size, probSum[0]->GetSpacing());
+	std::vector<ProbabilityPixel const *> prob;
+	for (auto img : probSum)
+	{
+		prob.push_back(img->GetBufferPointer());
+	}
+	ProbabilityPixel * entropyOut = averageEntropy->GetBufferPointer();
+	LabelPixelType * labelOut = averageLabel->GetBufferPointer();
+	double const limit = -std::log(1.0 / probSum.size());
+	forEachSlab(size, [&prob, entropyOut, labelOut, count, limit](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			double entropy = 0;
+			double probMax = -1;
+			int label = -1;
+			for (size_t l = 0; l < prob.size(); ++l)
+			{
+				double const p = prob[l][v];
+				if (p > probMax)
+				{
+					label = static_cast<int>(l);
+					probMax = p;
+				}
+				addEntropy(entropy, p / count);
+			}
+			entropyOut[v] = normalizedEntropy(entropy, limit);
+			labelOut[v] = label;
+		}
+	});
+}
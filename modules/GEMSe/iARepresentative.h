@@ -20,6 +20,27 @@
 * ************************************************************************************/
 #pragma once
 
+#include "iAImageTreeNode.h"    // for LabelImagePointer, ProbabilityImagePointer
+
 #include <io/iAITKIO.h>
 
+//! Computation of cluster representatives. All functions process the voxel buffers of all given images
+//! simultaneously in raster order, in parallel over z slices.
+
+//! Per voxel, the value all given images agree on, or the difference marker value where they differ.
+//! All images need to be of the same type and size.
 iAITKIO::ImagePointer CalculateDifferenceMarkers(QVector<iAITKIO::ImagePointer> imgs, double differenceMarkerValue);
+
+//! Per voxel, the entropy of the distribution of labels over a number of label images, normalized to [0..1].
+//! @param labelHist for each label l, the number of label images having label l at a voxel
+//! @param count the number of label images
+ProbabilityImagePointer CalculateLabelEntropy(QVector<LabelImagePointer> const & labelHist, int count);
+
+//! Per voxel, the label with the highest summed probability (the lowest label of equally probable ones),
+//! and the entropy of the averaged label probabilities, normalized to [0..1].
+//! @param probSum for each label l, the sum of the probabilities for label l over a number of results
+//! @param count the number of results
+//! @param averageLabel the most probable label per voxel (output)
+//! @param averageEntropy the normalized entropy per voxel (output)
+void CalculateAverageLabelAndEntropy(QVector<ProbabilityImagePointer> const & probSum, int count,
+	LabelImagePointer & averageLabel, ProbabilityImagePointer & averageEntropy);
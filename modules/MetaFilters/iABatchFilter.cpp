@@ -26,14 +26,28 @@
 #include <iAFilterRegistry.h>
 #include <iAProgress.h>
 #include <iAStringHelper.h>
+#include <iAToolsITK.h>
+#include <iATypedCallHelper.h>
 #include <io/iAITKIO.h>
 #include <io/iAFileUtils.h>
 
+#include <itkImageDuplicator.h>
+
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QTextStream>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 iABatchFilter::iABatchFilter():
 	iAFilter("Batch...", "",
 		"Runs a filter on a selected set of images.<br/>"
@@ -71,7 +85,14 @@ iABatchFilter::iABatchFilter():
 		"in case there is an error. If it is disabled, an error will interrupt the whole batch run. "
 		"Under <em>Work on</em> it can be specified whether the batched filter should get passed "
 		"only files, only folders, or both files and folders."
-		"<em>Output format</em> specifies the file format for the output image(s).", 0, 0)
+		"<em>Output format</em> specifies the file format for the output image(s).<br/>"
+		"Files are processed in a pipeline: while the filter runs, the next <em>Prefetch count</em> "
+		"input images are already read (0 disables prefetching), and output images are written "
+		"in the background. <em>Parallel files</em> specifies how many files are processed at the "
+		"same time, each with a separate instance of the filter. <em>Memory budget (MB)</em> limits "
+		"the memory used by input and output images held in the pipeline; no further input images "
+		"are read ahead while the budget is exhausted (0 means no limit). The output csv file "
+		"lists the files in the same order regardless of these settings.", 0, 0)
 {
 	QStringList filesFoldersBoth;
 	filesFoldersBoth << "Files" << "Folders" << "Both Files and Folders";
@@ -94,16 +115,181 @@ iABatchFilter::iABatchFilter():
 	outputFormat << "Same as input"
 		<< "MetaImage (*.mhd)";
 	addParameter("Output format", Categorical, outputFormat);
+	addParameter("Parallel files", Discrete, 1, 1);
+	addParameter("Prefetch count", Discrete, 1, 0);
+	addParameter("Memory budget (MB)", Discrete, 0, 0);
+}
+
+namespace
+{
+	//! A simple thread-safe FIFO queue with optional capacity limit, for passing jobs between pipeline stages
+	template <typename T>
+	class iABlockingQueue
+	{
+	public:
+		//! @param capacity the maximum number of items in the queue, 0 means unlimited
+		iABlockingQueue(size_t capacity = 0) : m_capacity(capacity), m_closed(false)
+		{}
+		//! Add an item; blocks while the queue is full. @return false if the queue was closed
+		bool push(T item)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_notFull.wait(lock, [this] { return m_closed || m_capacity == 0 || m_items.size() < m_capacity; });
+			if (m_closed)
+			{
+				return false;
+			}
+			m_items.push_back(std::move(item));
+			m_notEmpty.notify_one();
+			return true;
+		}
+		//! Take an item; blocks while the queue is empty. @return false if the queue is closed and empty
+		bool pop(T & item)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+			if (m_items.empty())
+			{
+				return false;
+			}
+			item = std::move(m_items.front());
+			m_items.pop_front();
+			m_notFull.notify_one();
+			return true;
+		}
+		//! Signal that no more items will be added; waiting consumers return once the queue is drained
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_closed = true;
+			m_notEmpty.notify_all();
+			m_notFull.notify_all();
+		}
+	private:
+		std::deque<T> m_items;
+		size_t m_capacity;
+		bool m_closed;
+		std::mutex m_mutex;
+		std::condition_variable m_notEmpty, m_notFull;
+	};
+
+	//! Keeps track of the memory used by images currently held in the batch pipeline
+	class iAMemoryBudget
+	{
+	public:
+		//! @param budget the memory budget in bytes, 0 means unlimited
+		iAMemoryBudget(size_t budget) : m_budget(budget), m_used(0), m_cancelled(false)
+		{}
+		//! Blocks until the used memory is below the budget; an empty pipeline is always allowed to proceed
+		void waitForBudget()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_released.wait(lock, [this] { return m_cancelled || m_budget == 0 || m_used == 0 || m_used < m_budget; });
+		}
+		void add(size_t bytes)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_used += bytes;
+		}
+		void release(size_t bytes)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_used -= std::min(bytes, m_used);
+			m_released.notify_all();
+		}
+		void cancel()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_cancelled = true;
+			m_released.notify_all();
+		}
+	private:
+		size_t m_budget, m_used;
+		bool m_cancelled;
+		std::mutex m_mutex;
+		std::condition_variable m_released;
+	};
+
+	size_t imageBytes(iAITKIO::ImagePointer img)
+	{
+		size_t componentSize;
+		switch (itkScalarPixelType(img))
+		{
+		case itk::ImageIOBase::UCHAR:  // intentional fall-through
+		case itk::ImageIOBase::CHAR:   componentSize = 1; break;
+		case itk::ImageIOBase::USHORT: // intentional fall-through
+		case itk::ImageIOBase::SHORT:  componentSize = 2; break;
+		case itk::ImageIOBase::UINT:   // intentional fall-through
+		case itk::ImageIOBase::INT:    // intentional fall-through
+		case itk::ImageIOBase::FLOAT:  componentSize = 4; break;
+		default:                       componentSize = 8; break;
+		}
+		return img->GetLargestPossibleRegion().GetNumberOfPixels() * img->GetNumberOfComponentsPerPixel() * componentSize;
+	}
+
+	template <typename T>
+	void internalStandaloneImage(iAITKIO::ImagePointer img, iAITKIO::ImagePointer & result)
+	{
+		typedef itk::Image<T, iAITKIO::m_DIM> ImageType;
+		auto typedImg = dynamic_cast<ImageType*>(img.GetPointer());
+		if (typedImg->GetPixelContainer()->GetContainerManageMemory())
+		{   // the image owns its buffer, so it stays valid on its own
+			result = img;
+			return;
+		}
+		auto duplicator = itk::ImageDuplicator<ImageType>::New();
+		duplicator->SetInputImage(typedImg);
+		duplicator->Update();
+		result = duplicator->GetOutput();
+	}
+
+	//! Get the ITK image of the given output connector such that it stays valid after the connector is deleted.
+	//! An ITK image created from a VTK image (e.g. by filters producing VTK output) only references the
+	//! buffer of the VTK image, which is owned by the connector; such images are copied.
+	iAITKIO::ImagePointer standaloneImage(iAConnector* con)
+	{
+		iAITKIO::ImagePointer result;
+		ITK_TYPED_CALL(internalStandaloneImage, con->itkScalarPixelType(), con->itkImage(), result);
+		return result;
+	}
+
+	//! A file to be processed by the batch filter, with its image if already loaded
+	struct iABatchJob
+	{
+		int index;
+		QString fileName;
+		iAITKIO::ImagePointer image;
+		size_t bytes;
+	};
+
+	//! Output images of one processed file, waiting to be written
+	struct iABatchWriteJob
+	{
+		QString relFileName;
+		QVector<iAITKIO::ImagePointer> images;
+		QVector<iAITKIO::ScalarPixelType> pixelTypes;
+		size_t bytes;
+	};
+
+	//! Result of processing one file
+	struct iABatchResult
+	{
+		iABatchResult() : success(false) {}
+		bool success;
+		QVector<QPair<QString, QVariant>> outputValues;
+	};
 }
 
 void iABatchFilter::performWork(QMap<QString, QVariant> const & parameters)
 {
-	auto filter = iAFilterRegistry::filter(parameters["Filter"].toString());
-	if (!filter)
+	int filterID = iAFilterRegistry::filterID(parameters["Filter"].toString());
+	if (filterID == -1)
 	{
 		addMsg(QString("Batch: Cannot run filter '%1', it does not exist!").arg(parameters["Filter"].toString()));
 		return;
 	}
+	auto filterFactory = iAFilterRegistry::filterFactories()[filterID];
+	auto filter = filterFactory->create();
 	QMap<QString, QVariant> filterParams;
 	QStringList filterParamStrs = splitPossiblyQuotedString(parameters["Parameters"].toString());
 	if (filter->parameters().size() != filterParamStrs.size())
@@ -114,16 +300,10 @@ void iABatchFilter::performWork(QMap<QString, QVariant> const & parameters)
 		return;
 	}
 	QString batchDir = parameters["Image folder"].toString();
-	QVector<iAConnector*> inputImages;
 	QStringList additionalInput = splitPossiblyQuotedString(parameters["Additional Input"].toString());
-	for (QString fileName : additionalInput)
+	for (QString & fileName : additionalInput)
 	{
 		fileName = MakeAbsolute(batchDir, fileName);
-		auto newCon = new iAConnector();
-		iAITKIO::ScalarPixelType pixelType;
-		iAITKIO::ImagePointer img = iAITKIO::readFile(fileName, pixelType, false);
-		newCon->setImage(img);
-		inputImages.push_back(newCon);
 	}
 
 	for (int i = 0; i < filterParamStrs.size(); ++i)
@@ -146,9 +326,6 @@ void iABatchFilter::performWork(QMap<QString, QVariant> const & parameters)
 			file.close();
 		}
 	}
-	iAProgress p;	// dummy progress swallowing progress from filter which we don't want to propagate
-	filter->setProgress(&p);
-	filter->setLogger(logger());
 
 	QStringList filters = parameters["File mask"].toString().split(";");
 
@@ -193,111 +370,292 @@ void iABatchFilter::performWork(QMap<QString, QVariant> const & parameters)
 	QString outSuffix = parameters["Output suffix"].toString();
 	bool overwrite = parameters["Overwrite output"].toBool();
 	bool useCompression = parameters["Compress output"].toBool();
-	int curLine = 0;
-	for (QString fileName : files)
+	bool continueOnError = parameters["Continue on error"].toBool();
+	bool metaImageOutput = parameters["Output format"].toString().contains("MetaImage");
+	bool loadImages = filter->requiredInputs() > 0;
+	int parallelFiles = std::max(1, parameters["Parallel files"].toInt());
+	int prefetchCount = std::max(0, parameters["Prefetch count"].toInt());
+	iAMemoryBudget memoryBudget(static_cast<size_t>(std::max(0, parameters["Memory budget (MB)"].toInt())) * 1024 * 1024);
+
+	// Processing is pipelined: a loader thread reads up to "Prefetch count" images ahead,
+	// "Parallel files" workers each run their own filter instance, and a writer thread stores the outputs.
+	std::vector<iABatchResult> results(files.size());
+	std::atomic<bool> aborted(false);
+	std::atomic<int> nextFile(0), finishedFiles(0);
+	std::mutex errorMutex;
+	QString firstError;
+	auto abortBatch = [&](QString const & msg)
 	{
-		try
+		std::lock_guard<std::mutex> lock(errorMutex);
+		if (!aborted)
 		{
-			filter->clearInput();
-			iAConnector con;
-			if (QFileInfo(fileName).isDir())
+			firstError = msg;
+		}
+		aborted = true;
+		memoryBudget.cancel();
+	};
+	auto handleError = [&](QString const & fileName, QString const & msg)
+	{
+		DEBUG_LOG(QString("Batch processing: Error while processing file '%1': %2").arg(fileName).arg(msg));
+		if (!continueOnError)
+		{
+			abortBatch(msg);
+		}
+	};
+	auto loadJob = [&](int index, iABatchJob & job) -> bool
+	{
+		job.index = index;
+		job.fileName = files[index];
+		job.bytes = 0;
+		if (loadImages && !QFileInfo(job.fileName).isDir())
+		{
+			memoryBudget.waitForBudget();
+			try
 			{
-				filterParams["Folder name"] = fileName;
+				iAITKIO::ScalarPixelType pixelType;
+				job.image = iAITKIO::readFile(job.fileName, pixelType, false);
+				job.bytes = imageBytes(job.image);
+				memoryBudget.add(job.bytes);
 			}
-			else
+			catch (std::exception & e)
 			{
-				if (filter->requiredInputs() > 0)
-				{
-					iAITKIO::ScalarPixelType pixelType;
-					iAITKIO::ImagePointer img = iAITKIO::readFile(fileName, pixelType, false);
-					con.setImage(img);
-					filter->addInput(&con);
-					for (int i = 0; i < inputImages.size(); ++i)
-						filter->addInput(inputImages[i]);
-				}
-				else
-				{
-					filterParams["File name"] = fileName;
-				}
+				handleError(job.fileName, e.what());
+				return false;
 			}
-			filter->run(filterParams);
-			if (curLine == 0)
+		}
+		return true;
+	};
+	iABlockingQueue<iABatchJob> loadQueue(std::max(prefetchCount, 1));
+	iABlockingQueue<iABatchWriteJob> writeQueue;
+	std::thread loader;
+	if (prefetchCount > 0)
+	{
+		loader = std::thread([&]
+		{
+			for (int f = 0; f < files.size() && !aborted; ++f)
 			{
-				QStringList captions;
-				if (parameters["Add filename"].toBool())
+				iABatchJob job;
+				if (!loadJob(f, job))
 				{
-					captions << "filename";
+					++finishedFiles;
+					continue;
 				}
-				for (auto outValue : filter->outputValues())
+				if (!loadQueue.push(job))
 				{
-					QString curCap(outValue.first);
-					curCap.replace(",", "");
-					captions << curCap;
+					break;
 				}
-				if (outputBuffer.empty())
-				{
-					outputBuffer.append("");
-				}
-				outputBuffer[0] += (outputBuffer[0].isEmpty() || captions.empty() ? "" : ",") + captions.join(",");
-				++curLine;
-			}
-			if (curLine >= outputBuffer.size())
-			{
-				outputBuffer.append("");
-			}
-			QStringList values;
-			QString relFileName = MakeRelative(batchDir, fileName);
-			if (parameters["Add filename"].toBool())
-			{
-				values << relFileName;
 			}
-			for (auto outValue : filter->outputValues())
-			{
-				values.append(outValue.second.toString());
-			}
-			QString textToAdd = (outputBuffer[curLine].isEmpty() || values.empty() ? "" : ",") + values.join(",");
-			outputBuffer[curLine] += textToAdd;
-			++curLine;
-			for (int o = 0; o < filter->output().size(); ++o)
+			loadQueue.close();
+		});
+	}
+	std::thread writer([&]
+	{
+		iABatchWriteJob writeJob;
+		while (writeQueue.pop(writeJob))
+		{
+			for (int o = 0; o < writeJob.images.size(); ++o)
 			{
-				QFileInfo fi(outDir + "/" + relFileName);
-				QString multiFileSuffix = filter->output().size() > 1 ? QString::number(o) : "";
+				QFileInfo fi(outDir + "/" + writeJob.relFileName);
+				QString multiFileSuffix = writeJob.images.size() > 1 ? QString::number(o) : "";
 				QString outName = QString("%1/%2%3%4.%5").arg(fi.absolutePath()).arg(
-					parameters["Output format"].toString().contains("MetaImage") ? fi.fileName() : fi.baseName())
+					metaImageOutput ? fi.fileName() : fi.baseName())
 					.arg(outSuffix).arg(multiFileSuffix).arg(
-						parameters["Output format"].toString().contains("MetaImage")? "mhd" :	fi.completeSuffix());
+						metaImageOutput ? "mhd" : fi.completeSuffix());
 				int overwriteSuffix = 0;
 				while (!overwrite && QFile(outName).exists())
 				{
 					outName = QString("%1/%2%3%4-%5.%6").arg(fi.absolutePath()).arg(
-						parameters["Output format"].toString().contains("MetaImage") ? fi.fileName() : fi.baseName())
+						metaImageOutput ? fi.fileName() : fi.baseName())
 						.arg(outSuffix).arg(multiFileSuffix).arg(overwriteSuffix).arg(
-							parameters["Output format"].toString().contains("MetaImage") ? "mhd" :	fi.completeSuffix());
+							metaImageOutput ? "mhd" : fi.completeSuffix());
 					++overwriteSuffix;
 				}
 				if (!QDir(fi.absolutePath()).exists() && !QDir(fi.absolutePath()).mkpath("."))
 				{
 					addMsg(QString("Error creating output directory %1, skipping writing output file %2")
 						.arg(fi.absolutePath()).arg(outName));
+					continue;
+				}
+				try
+				{
+					iAITKIO::writeFile(outName, writeJob.images[o], writeJob.pixelTypes[o], useCompression);
+				}
+				catch (std::exception & e)
+				{
+					handleError(outName, e.what());
+				}
+			}
+			writeJob.images.clear();
+			memoryBudget.release(writeJob.bytes);
+		}
+	});
+	std::vector<std::thread> workers;
+	for (int w = 0; w < parallelFiles; ++w)
+	{
+		workers.push_back(std::thread([&]
+		{
+			auto workerFilter = filterFactory->create();
+			iAProgress p;	// dummy progress swallowing progress from filter which we don't want to propagate
+			workerFilter->setProgress(&p);
+			workerFilter->setLogger(logger());
+			auto workerParams = filterParams;
+			// each worker reads its own copy of the additional input, since ITK filters
+			// modify the requested region of their input images:
+			std::vector<std::unique_ptr<iAConnector>> additionalImages;
+			try
+			{
+				for (QString fileName : additionalInput)
+				{
+					std::unique_ptr<iAConnector> newCon(new iAConnector());
+					iAITKIO::ScalarPixelType pixelType;
+					newCon->setImage(iAITKIO::readFile(fileName, pixelType, false));
+					additionalImages.push_back(std::move(newCon));
+				}
+			}
+			catch (std::exception & e)
+			{	// without the additional input, no file can be processed; so this is fatal even if continuing on errors:
+				DEBUG_LOG(QString("Batch processing: Error while reading additional input '%1': %2")
+					.arg(additionalInput.join(", ")).arg(e.what()));
+				abortBatch(QString("Could not read additional input: %1").arg(e.what()));
+				return;
+			}
+			while (!aborted)
+			{
+				iABatchJob job;
+				if (prefetchCount > 0)
+				{
+					if (!loadQueue.pop(job))
+					{
+						break;
+					}
 				}
 				else
 				{
-					iAITKIO::writeFile(outName, filter->output()[o]->itkImage(),
-						filter->output()[o]->itkScalarPixelType(), useCompression);
+					int index = nextFile++;
+					if (index >= files.size())
+					{
+						break;
+					}
+					if (!loadJob(index, job))
+					{
+						++finishedFiles;
+						continue;
+					}
+				}
+				try
+				{
+					workerFilter->clearInput();
+					iAConnector con;
+					if (QFileInfo(job.fileName).isDir())
+					{
+						workerParams["Folder name"] = job.fileName;
+					}
+					else if (loadImages)
+					{
+						con.setImage(job.image);
+						workerFilter->addInput(&con);
+						for (auto & additionalCon : additionalImages)
+						{
+							workerFilter->addInput(additionalCon.get());
+						}
+					}
+					else
+					{
+						workerParams["File name"] = job.fileName;
+					}
+					workerFilter->run(workerParams);
+					results[job.index].outputValues = workerFilter->outputValues();
+					results[job.index].success = true;
+					iABatchWriteJob writeJob;
+					writeJob.relFileName = MakeRelative(batchDir, job.fileName);
+					writeJob.bytes = 0;
+					for (auto outCon : workerFilter->output())
+					{   // output connectors are deleted on the next run of the filter, before the writer is done:
+						writeJob.images.push_back(standaloneImage(outCon));
+						writeJob.pixelTypes.push_back(outCon->itkScalarPixelType());
+						writeJob.bytes += imageBytes(writeJob.images.last());
+					}
+					if (!writeJob.images.isEmpty())
+					{
+						memoryBudget.add(writeJob.bytes);
+						writeQueue.push(writeJob);
+					}
+				}
+				catch (std::exception & e)
+				{
+					handleError(job.fileName, e.what());
 				}
+				job.image = nullptr;
+				memoryBudget.release(job.bytes);
+				int finished = ++finishedFiles;
+				progress()->emitProgress(static_cast<int>(100.0 * finished / files.size()));
 			}
+		}));
+	}
+	for (auto & worker : workers)
+	{
+		worker.join();
+	}
+	// in case workers stopped early, unblock the loader, no matter whether it waits for queue space or memory:
+	loadQueue.close();
+	memoryBudget.cancel();
+	if (loader.joinable())
+	{
+		loader.join();
+	}
+	writeQueue.close();
+	writer.join();
+	if (aborted)
+	{
+		throw std::runtime_error(firstError.toStdString());
+	}
+
+	// assemble output values in file order:
+	int curLine = 0;
+	for (int f = 0; f < files.size(); ++f)
+	{
+		if (!results[f].success)
+		{
+			continue;
 		}
-		catch (std::exception & e)
+		auto const & outputValues = results[f].outputValues;
+		if (curLine == 0)
 		{
-			DEBUG_LOG(QString("Batch processing: Error while processing file '%1': %2").arg(fileName).arg(e.what()));
-			if (!parameters["Continue on error"].toBool())
+			QStringList captions;
+			if (parameters["Add filename"].toBool())
+			{
+				captions << "filename";
+			}
+			for (auto outValue : outputValues)
 			{
-				throw e;
+				QString curCap(outValue.first);
+				curCap.replace(",", "");
+				captions << curCap;
 			}
+			if (outputBuffer.empty())
+			{
+				outputBuffer.append("");
+			}
+			outputBuffer[0] += (outputBuffer[0].isEmpty() || captions.empty() ? "" : ",") + captions.join(",");
+			++curLine;
 		}
-		progress()->emitProgress( static_cast<int>(100 * (curLine - 1.0) / files.size()) );
+		if (curLine >= outputBuffer.size())
+		{
+			outputBuffer.append("");
+		}
+		QStringList values;
+		if (parameters["Add filename"].toBool())
+		{
+			values << MakeRelative(batchDir, files[f]);
+		}
+		for (auto outValue : outputValues)
+		{
+			values.append(outValue.second.toString());
+		}
+		QString textToAdd = (outputBuffer[curLine].isEmpty() || values.empty() ? "" : ",") + values.join(",");
+		outputBuffer[curLine] += textToAdd;
+		++curLine;
 	}
-
 	if (!outputFile.isEmpty())
 	{
 		QFile file(outputFile);
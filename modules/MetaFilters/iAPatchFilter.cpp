@@ -33,10 +33,18 @@
 
 #include <itkImage.h>
 
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QTextStream>
 
+#include <omp.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
 namespace
 {
 	size_t getRequiredParts(size_t size, size_t partSize)
@@ -63,15 +71,27 @@ namespace
 			: (x < size - patchSize) ? patchSize : size - x;
 	}
 
+	//! Position and extent of a single patch
+	struct iAPatchInfo
+	{
+		size_t pos[3];               //!< the (start or center) voxel position of the patch
+		itk::Index<DIM> outIdx;      //!< index of the patch in the output value images
+		size_t extractIndex[3];      //!< start voxel of the region to extract
+		size_t extractSize[3];       //!< size of the region to extract
+	};
+
 	template <typename T>
 	void patch(iAFilter* patchFilter, QMap<QString, QVariant> const & parameters)
 	{
-		auto filter = iAFilterRegistry::filter(parameters["Filter"].toString());
-		if (!filter)
+		QString filterName = parameters["Filter"].toString();
+		int filterID = iAFilterRegistry::filterID(filterName);
+		if (filterID == -1)
 		{
-			patchFilter->addMsg(QString("Patch: Cannot run filter '%1', it does not exist!").arg(parameters["Filter"].toString()));
+			patchFilter->addMsg(QString("Patch: Cannot run filter '%1', it does not exist!").arg(filterName));
 			return;
 		}
+		auto filterFactory = iAFilterRegistry::filterFactories()[filterID];
+		auto filter = filterFactory->create();
 		typedef itk::Image<T, DIM> InputImageType;
 		typedef itk::Image<double, DIM> OutputImageType;
 		auto size = dynamic_cast<InputImageType*>(patchFilter->input()[0]->itkImage())->GetLargestPossibleRegion().GetSize();
@@ -93,8 +113,6 @@ namespace
 		QVector<iAConnector*> inputImages;
 		inputImages.push_back(new iAConnector);
 		inputImages[0]->setImage(patchFilter->input()[0]->itkImage());
-		QVector<iAConnector*> smallImageInput;
-		smallImageInput.push_back(new iAConnector);
 		// TODO: read from con array?
 		QStringList additionalInput = splitPossiblyQuotedString(parameters["Additional input"].toString());
 		for (QString fileName : additionalInput)
@@ -105,13 +123,8 @@ namespace
 			iAITKIO::ImagePointer img = iAITKIO::readFile(fileName, pixelType, false);
 			newCon->setImage(img);
 			inputImages.push_back(newCon);
-			smallImageInput.push_back(new iAConnector);
 		}
 
-		iAProgress dummyProgress;
-		QStringList outputBuffer;
-
-		int curOp = 0;
 		size_t patchSize[3] = {
 			parameters["Patch size X"].toULongLong(),
 			parameters["Patch size Y"].toULongLong(),
@@ -131,116 +144,182 @@ namespace
 			outputSpacing[i] = inputSpacing[i] * stepSize[i];
 			patchSizeHalf[i] = patchSize[i] / 2;
 		}
-		int totalOps = blockCount[0] * blockCount[1] * blockCount[2];
-		bool warnOutputNotSupported = false;
 		bool center = parameters["Center patch"].toBool();
 		bool doImage = parameters["Write output value image"].toBool();
-		QVector<iAITKIO::ImagePointer> outputImages;
-		QStringList outputNames;
-		if (doImage)
-			while (outputImages.size() < filter->outputValueNames().size())
-			{
-				outputImages.push_back(allocateImage(blockCount, outputSpacing, itk::ImageIOBase::DOUBLE));
-				outputNames << filter->outputValueNames()[outputImages.size() - 1];
-			}
-		filter->setLogger(patchFilter->logger());
-		filter->setProgress(&dummyProgress);
-		// iterate over all patches:
-		itk::Index<DIM> outIdx; outIdx[0] = 0;
-		for (size_t x = 0; x < size[0]; x += stepSize[0])
+		bool continueOnError = parameters["Continue on error"].toBool();
+
+		// determine all patches up front, in the order in which their results are written:
+		std::vector<iAPatchInfo> patches;
+		patches.reserve(static_cast<size_t>(blockCount[0]) * blockCount[1] * blockCount[2]);
+		iAPatchInfo p;
+		p.outIdx[0] = 0;
+		for (p.pos[0] = 0; p.pos[0] < size[0]; p.pos[0] += stepSize[0])
 		{
-			outIdx[1] = 0;
-			size_t extractIndex[3], extractSize[3];
-			extractIndex[0] = getLeft(x, patchSizeHalf[0], center);
-			extractSize[0] = getSize(x, extractIndex[0], size[0], patchSizeHalf[0], patchSize[0], center);
-			for (size_t y = 0; y < size[1]; y += stepSize[1])
+			p.outIdx[1] = 0;
+			p.extractIndex[0] = getLeft(p.pos[0], patchSizeHalf[0], center);
+			p.extractSize[0] = getSize(p.pos[0], p.extractIndex[0], size[0], patchSizeHalf[0], patchSize[0], center);
+			for (p.pos[1] = 0; p.pos[1] < size[1]; p.pos[1] += stepSize[1])
 			{
-				outIdx[2] = 0;
-				extractIndex[1] = getLeft(y, patchSizeHalf[1], center);
-				extractSize[1] = getSize(y, extractIndex[1], size[1], patchSizeHalf[1], patchSize[1], center);
-				for (size_t z = 0; z < size[2]; z += stepSize[2])
+				p.outIdx[2] = 0;
+				p.extractIndex[1] = getLeft(p.pos[1], patchSizeHalf[1], center);
+				p.extractSize[1] = getSize(p.pos[1], p.extractIndex[1], size[1], patchSizeHalf[1], patchSize[1], center);
+				for (p.pos[2] = 0; p.pos[2] < size[2]; p.pos[2] += stepSize[2])
 				{
-					extractIndex[2] = getLeft(z, patchSizeHalf[2], center);
-					extractSize[2] = getSize(z, extractIndex[2], size[2], patchSizeHalf[2], patchSize[2], center);
-					/*
-					DEBUG_LOG(QString("Working on patch: upper left=(%1, %2, %3), dim=(%4, %5, %6), outIdx=(%10,%11,%12).")
-						.arg(extractParams["Index X"].toUInt())
-						.arg(extractParams["Index Y"].toUInt())
-						.arg(extractParams["Index Z"].toUInt())
-						.arg(extractParams["Size X"].toUInt())
-						.arg(extractParams["Size Y"].toUInt())
-						.arg(extractParams["Size Z"].toUInt())
-						.arg(outIdx[0]).arg(outIdx[1]).arg(outIdx[2]));
-					*/
+					p.extractIndex[2] = getLeft(p.pos[2], patchSizeHalf[2], center);
+					p.extractSize[2] = getSize(p.pos[2], p.extractIndex[2], size[2], patchSizeHalf[2], patchSize[2], center);
 					// apparently some ITK filters (e.g. statistics) have problems with images
 					// with a size of 1 in one dimension, so let's skip such patches for the moment...
-					if (extractSize[0] <= 1 || extractSize[1] <= 1 || extractSize[2] <= 1)
+					// as before, a skipped patch does not advance the z index in the output value images
+					// (while the x and y indices are advanced for every step):
+					if (p.extractSize[0] > 1 && p.extractSize[1] > 1 && p.extractSize[2] > 1)
 					{
-						//DEBUG_LOG("    skipping because one side <= 1.");
-						continue;
+						patches.push_back(p);
+						++p.outIdx[2];
 					}
-					try
-					{
-						// extract patch from all inputs:
-						for (int i = 0; i < inputImages.size(); ++i)
-						{
-							auto itkExtractImg = extractImage(inputImages[i]->itkImage(), extractIndex, extractSize);
-							smallImageInput[i]->setImage(itkExtractImg);
-						}
+				}
+				++p.outIdx[1];
+			}
+			++p.outIdx[0];
+		}
 
-						// run filter on inputs:
-						filter->clearInput();
-						for (int i=0; i<smallImageInput.size(); ++i)
-							filter->addInput(smallImageInput[i]);
-						filter->run(filterParams);
+		// output values of each patch, stored at the patch's index to keep the output order deterministic:
+		std::vector<QVector<QPair<QString, QVariant>>> patchValues(patches.size());
+		int const totalOps = static_cast<int>(patches.size());
+		int threadCount = parameters["Number of threads"].toInt();
+		if (threadCount <= 0)
+		{
+			threadCount = omp_get_max_threads();
+		}
+		std::atomic<int> finishedOps(0);
+		std::atomic<bool> aborted(false);
+		std::atomic<bool> warnOutputNotSupported(false);
+		QString errorMsg;
+		QElapsedTimer timer;
+		timer.start();
+		qint64 lastReport = 0;
+		int const ReportIntervalMS = 10000;
+#pragma omp parallel num_threads(threadCount)
+		{
+			// each thread works with its own filter instance and connectors:
+			auto threadFilter = filterFactory->create();
+			iAProgress dummyProgress;
+			threadFilter->setLogger(patchFilter->logger());
+			threadFilter->setProgress(&dummyProgress);
+			std::vector<std::unique_ptr<iAConnector>> smallImageInput;
+			for (int i = 0; i < inputImages.size(); ++i)
+			{
+				smallImageInput.push_back(std::unique_ptr<iAConnector>(new iAConnector));
+			}
+#pragma omp for schedule(dynamic)
+			for (int patchIdx = 0; patchIdx < totalOps; ++patchIdx)
+			{
+				if (aborted)
+				{
+					continue;
+				}
+				auto const & curPatch = patches[patchIdx];
+				try
+				{
+					// extract patch from all inputs; the extraction modifies the requested
+					// region of the (shared) input images, so it must not run concurrently:
+#pragma omp critical(patchExtract)
+					for (int i = 0; i < inputImages.size(); ++i)
+					{
+						auto itkExtractImg = extractImage(inputImages[i]->itkImage(), curPatch.extractIndex, curPatch.extractSize);
+						smallImageInput[i]->setImage(itkExtractImg);
+					}
 
-						// get output images and values from filter:
-						if (filter->outputCount() > 0 || filter->output().size() > 0)
-							warnOutputNotSupported = true;
+					// run filter on inputs:
+					threadFilter->clearInput();
+					for (size_t i = 0; i < smallImageInput.size(); ++i)
+						threadFilter->addInput(smallImageInput[i].get());
+					threadFilter->run(filterParams);
 
-						if (filter->outputValues().size() > 0)
-						{
-							if (curOp == 0)
-							{
-								QStringList captions;
-								captions << "x" << "y" << "z";
-								for (auto outValue : filter->outputValues())
-								{
-									captions << outValue.first;
-								}
-								outputBuffer.append(captions.join(","));
-							}
-							QStringList values;
-							values << QString::number(x) << QString::number(y) << QString::number(z);
-							for (auto outValue : filter->outputValues())
-								values.append(outValue.second.toString());
-							outputBuffer.append(values.join(","));
-							if (doImage)
-								for (int i = 0; i < filter->outputValues().size(); ++i)
-									(dynamic_cast<OutputImageType*>(outputImages[i].GetPointer()))->SetPixel(outIdx, filter->outputValues()[i].second.toDouble());
-						}
+					if (threadFilter->outputCount() > 0 || threadFilter->output().size() > 0)
+						warnOutputNotSupported = true;
+					patchValues[patchIdx] = threadFilter->outputValues();
+				}
+				catch (std::exception& e)
+				{
+					if (continueOnError)
+					{
+						DEBUG_LOG(QString("Patch filter: An error has occurred: %1, continueing anyway.").arg(e.what()));
 					}
-					catch (std::exception& e)
+					else
 					{
-						if (parameters["Continue on error"].toBool())
-						{
-							DEBUG_LOG(QString("Patch filter: An error has occurred: %1, continueing anyway.").arg(e.what()));
-						}
-						else
-							throw e;
+#pragma omp critical(patchError)
+						errorMsg = e.what();
+						aborted = true;
+					}
+				}
+				int finished = ++finishedOps;
+				patchFilter->progress()->emitProgress(static_cast<int>(100.0 * finished / totalOps));
+#pragma omp critical(patchReport)
+				{
+					qint64 elapsed = timer.elapsed();
+					if (elapsed - lastReport >= ReportIntervalMS)
+					{
+						lastReport = elapsed;
+						double patchesPerSec = finished * 1000.0 / elapsed;
+						patchFilter->addMsg(QString("Patch filter: %1 of %2 patches done, %3 patches/s, estimated remaining time: %4 s.")
+							.arg(finished).arg(totalOps).arg(patchesPerSec, 0, 'f', 2)
+							.arg((totalOps - finished) / patchesPerSec, 0, 'f', 0));
 					}
-
-					patchFilter->progress()->emitProgress(static_cast<int>(100.0 * curOp / totalOps));
-					++curOp;
-					++outIdx[2];
 				}
-				++outIdx[1];
 			}
-			++outIdx[0];
 		}
+		for (auto con : inputImages)
+		{
+			delete con;
+		}
+		if (aborted)
+		{
+			throw std::runtime_error(errorMsg.toStdString());
+		}
+		qint64 elapsed = std::max(timer.elapsed(), static_cast<qint64>(1));
+		patchFilter->addMsg(QString("Patch filter: processed %1 patches in %2 s using %3 threads (%4 patches/s).")
+			.arg(totalOps).arg(elapsed / 1000.0, 0, 'f', 1).arg(threadCount)
+			.arg(totalOps * 1000.0 / elapsed, 0, 'f', 2));
 		if (warnOutputNotSupported)
 			DEBUG_LOG("Creating output images from each patch not yet supported!");
 
+		// collect output values in patch order:
+		QStringList outputBuffer;
+		QVector<iAITKIO::ImagePointer> outputImages;
+		QStringList outputNames;
+		for (size_t patchIdx = 0; patchIdx < patches.size(); ++patchIdx)
+		{
+			auto const & values = patchValues[patchIdx];
+			if (values.isEmpty())
+			{
+				continue;
+			}
+			if (outputBuffer.isEmpty())
+			{
+				QStringList captions;
+				captions << "x" << "y" << "z";
+				for (auto outValue : values)
+				{
+					captions << outValue.first;
+				}
+				outputBuffer.append(captions.join(","));
+				if (doImage)
+					while (outputImages.size() < values.size())
+					{
+						outputImages.push_back(allocateImage(blockCount, outputSpacing, itk::ImageIOBase::DOUBLE));
+						outputNames << values[outputImages.size() - 1].first;
+					}
+			}
+			auto const & curPatch = patches[patchIdx];
+			QStringList line;
+			line << QString::number(curPatch.pos[0]) << QString::number(curPatch.pos[1]) << QString::number(curPatch.pos[2]);
+			for (auto outValue : values)
+				line.append(outValue.second.toString());
+			outputBuffer.append(line.join(","));
+			for (int i = 0; i < std::min(outputImages.size(), values.size()); ++i)
+				(dynamic_cast<OutputImageType*>(outputImages[i].GetPointer()))->SetPixel(curPatch.outIdx, values[i].second.toDouble());
+		}
+
 		QString outputFile = parameters["Output csv file"].toString();
 		QFile file(outputFile);
 		if (file.open(QIODevice::WriteOnly | QIODevice::Text))
@@ -270,7 +349,11 @@ namespace
 
 iAPatchFilter::iAPatchFilter():
 	iAFilter("Patch Filter", "Image Ensembles",
-		"Create patches from an input image and apply a filter each patch.<br/>", 1, 0)
+		"Create patches from an input image and apply a filter each patch.<br/>"
+		"The patches are processed in parallel, each thread using its own instance of the given filter; "
+		"<em>Number of threads</em> limits how many patches are processed at the same time "
+		"(0 means using as many threads as there are processor cores). "
+		"Progress and throughput (patches per second) are reported regularly in the log.<br/>", 1, 0)
 {
 	addParameter("Patch size X", Discrete, 1, 1);
 	addParameter("Patch size Y", Discrete, 1, 1);
@@ -287,6 +370,7 @@ iAPatchFilter::iAPatchFilter():
 	addParameter("Output image base name", String, "output.mhd");
 	addParameter("Compress image", Boolean, true);
 	addParameter("Continue on error", Boolean, true);
+	addParameter("Number of threads", Discrete, 0, 0);
 }
 
 void iAPatchFilter::performWork(QMap<QString, QVariant> const & parameters)
@@ -424,6 +424,10 @@ struct IParameterInfo
 	virtual float asFloat() const = 0;
 	virtual double asDouble() const = 0;
 	virtual QString asString() const = 0;
+	//! exact textual representation of the current value, for comparing samples
+	virtual QString asKey() const = 0;
+	//! a copy holding the current value, e.g. to keep a sample while the original is incremented
+	virtual IParameterInfo * clone() const = 0;
 
 	QString name;
 	int numSamples;
@@ -494,6 +498,14 @@ struct ParameterInfo : public IParameterInfo
 	{
 		return QString::number( val );
 	}
+	inline virtual QString asKey() const
+	{
+		return QString::number( static_cast<double>( val ), 'g', 17 );
+	}
+	inline virtual IParameterInfo * clone() const
+	{
+		return new ParameterInfo<T>( *this );
+	}
 };
 
 inline bool incrementParameterSet( QList<IParameterInfo*> & parameters )
@@ -87,7 +87,10 @@
 #endif
 #endif
 
+#include <algorithm>
 #include <cassert>
+#include <numeric>
+#include <vector>
 
 struct RunInfo
 {
@@ -130,6 +133,29 @@ struct RunInfo
 	double avgFeatureLength;
 };
 
+//! Memory (in MB) which the intermediate results of pipeline prefixes and the final masks
+//! of the pending samples may occupy.
+const double PendingResultsBudgetMB = 2048;
+//! Number of samples per thread whose final pipeline stage is computed in one parallel pass.
+const int PendingSamplesPerThread = 2;
+
+//! One parameter sample of a batch.
+struct BatchSample
+{
+	int sampleNo;                   //!< index of the sample in the order in which the parameters were enumerated
+	QList<IParameterInfo*> params;  //!< the parameter values of this sample
+	QStringList stageKeys;          //!< for each pipeline stage, the exact values of this stage's parameters
+};
+
+//! A sample whose pipeline prefix is computed, waiting for its final stage.
+struct PendingSampleRun
+{
+	int sampleNo;
+	RunInfo results;
+	bool success;
+	QStringList errors;
+};
+
 static float calcPorosity( const MaskImageType::Pointer image, int surroundingVoxels )
 {
 	const unsigned int MeasurementVectorSize = 1;
@@ -1014,16 +1040,23 @@ void computeFhwThreshold( ImagePointer & image, PorosityFilterID /*filterId*/, R
 }
 
 template<class T>
-void runBatch( const QList<PorosityFilterID> & filterIds, ImagePointer & image, RunInfo & results, const QList<IParameterInfo*> & params )
+void runStages( const QList<PorosityFilterID> & filterIds, int firstStage, int endStage, ImagePointer & image, RunInfo & results, const QList<IParameterInfo*> & params )
 {
-	ImagePointer curImage = image;
-	results.startTime = QLocale().toString( QDateTime::currentDateTime(), QLocale::ShortFormat );
+	// stages after the first one continue on the result of the previous stage stored in results
+	ImagePointer curImage = (firstStage == 0) ? image : results.maskImage;
 	int pind = 0;
-	for (PorosityFilterID fid: filterIds)
+	for (int stage = 0; stage < firstStage; ++stage)
+	{
+		pind += FilterIdToParamList[filterIds[stage]].size();
+	}
+	for (int stage = firstStage; stage < endStage; ++stage)
 	{
+		PorosityFilterID fid = filterIds[stage];
 		QElapsedTimer t;
 		t.start();
-		bool releaseData = (fid != filterIds.last());
+		// intermediate results are cached and reused by all samples sharing the pipeline prefix
+		// (see iARunBatchThread::executeBatch), so their data must not be released:
+		bool const releaseData = false;
 		switch( fid )
 		{
 			case P_BINARY_THRESHOLD:
@@ -1105,6 +1138,35 @@ void runBatch( const QList<PorosityFilterID> & filterIds, ImagePointer & image,
 	}
 }
 
+template<class T>
+void getPixelSize( size_t & pixelSize )
+{
+	pixelSize = sizeof( T );
+}
+
+//! Dice metric, false positive and false negative rate of the given mask with respect to a ground truth mask.
+static void calcDiceMetrics( MaskImageType * mask, MaskImageType * gtImage, RunInfo & results )
+{
+	MaskImageType::RegionType reg = mask->GetLargestPossibleRegion();
+	long long size = static_cast<long long>(reg.GetSize()[0]) * reg.GetSize()[1] * reg.GetSize()[2];
+	size_t tp = 0, fn = 0, fp = 0, tn = 0;
+
+#pragma omp parallel for reduction(+:tp,fn,fp,tn)
+	for (long long i = 0; i < size; ++i )
+	{
+		MaskImageType::PixelType gt = gtImage->GetBufferPointer()[i];
+		MaskImageType::PixelType m = mask->GetBufferPointer()[i];
+		if (gt == 1 && m == 1) tp = tp + 1;
+		if (gt == 1 && m == 0) fn = fn + 1;
+		if (gt == 0 && m == 1) fp = fp + 1;
+		if (gt == 0 && m == 0) tn = tn + 1;
+	}
+
+	results.falseNegativeRate = static_cast<float>(fn) / (tp + fn);
+	results.falsePositiveRate = static_cast<float>(fp) / (tn + fp);
+	results.dice = 2 * static_cast<float>(tp) / (2 * tp + fp + fn);
+}
+
 void iARunBatchThread::Init(iAPorosityAnalyserModuleInterface * pmi, QString datasetFolder,
 	bool rbNewPipelineDataNoPores, bool rbNewPipelineData)
 {
@@ -1184,33 +1246,32 @@ void iARunBatchThread::initRunsCSVFile( QTableWidget & runsCSV, QString batchDir
 	iACSVToQTableWidgetConverter::saveToCSVFile( runsCSV, runsCSVFile.fileName() );
 }
 
-void iARunBatchThread::saveResultsToRunsCSV( RunInfo & results, QString masksDir, QTableWidget & runsCSV, bool success /*= true */ )
+void iARunBatchThread::saveResultsToRunsCSV( RunInfo & results, QString masksDir, QTableWidget & runsCSV, int row, bool success /*= true */ )
 {
-	int lastRow = runsCSV.rowCount(), col = 0;
-	runsCSV.insertRow( lastRow );
-	runsCSV.setItem( lastRow, col++, new QTableWidgetItem( results.startTime ) );
-	runsCSV.setItem( lastRow, col++, new QTableWidgetItem( QString::number( results.elapsedTime ) ) );
-	runsCSV.setItem( lastRow, col++, new QTableWidgetItem( QString::number( results.porosity ) ) );
-	runsCSV.setItem( lastRow, col++, new QTableWidgetItem( QString::number( results.threshold ) ) );
-	QString maskName = "mask" + QString::number( lastRow ) + ".mhd";
+	int col = 0;
+	runsCSV.setItem( row, col++, new QTableWidgetItem( results.startTime ) );
+	runsCSV.setItem( row, col++, new QTableWidgetItem( QString::number( results.elapsedTime ) ) );
+	runsCSV.setItem( row, col++, new QTableWidgetItem( QString::number( results.porosity ) ) );
+	runsCSV.setItem( row, col++, new QTableWidgetItem( QString::number( results.threshold ) ) );
+	QString maskName = "mask" + QString::number( row ) + ".mhd";
 	QString maskFilename = "";
 	if ( success )
 		maskFilename = masksDir + "/" + maskName;
-	runsCSV.setItem( lastRow, col++, new QTableWidgetItem( maskName ) );
+	runsCSV.setItem( row, col++, new QTableWidgetItem( maskName ) );
 	//dice metric
-	runsCSV.setItem( lastRow, col++, new QTableWidgetItem( QString::number( results.falsePositiveRate ) ) );
-	runsCSV.setItem( lastRow, col++, new QTableWidgetItem( QString::number( results.falseNegativeRate ) ) );
-	runsCSV.setItem( lastRow, col++, new QTableWidgetItem( QString::number( results.dice ) ) );
+	runsCSV.setItem( row, col++, new QTableWidgetItem( QString::number( results.falsePositiveRate ) ) );
+	runsCSV.setItem( row, col++, new QTableWidgetItem( QString::number( results.falseNegativeRate ) ) );
+	runsCSV.setItem( row, col++, new QTableWidgetItem( QString::number( results.dice ) ) );
 	//avg feature chars
-	runsCSV.setItem(lastRow, col++, new QTableWidgetItem(QString::number(results.featureCnt)));
-	runsCSV.setItem(lastRow, col++, new QTableWidgetItem(QString::number(results.avgFeatureVol)));
-	runsCSV.setItem(lastRow, col++, new QTableWidgetItem(QString::number(results.avgFeaturePhi)));
-	runsCSV.setItem(lastRow, col++, new QTableWidgetItem(QString::number(results.avgFeatureTheta)));
-	runsCSV.setItem(lastRow, col++, new QTableWidgetItem(QString::number(results.avgFeatureRoundness)));
-	runsCSV.setItem(lastRow, col++, new QTableWidgetItem(QString::number(results.avgFeatureLength)));
+	runsCSV.setItem(row, col++, new QTableWidgetItem(QString::number(results.featureCnt)));
+	runsCSV.setItem(row, col++, new QTableWidgetItem(QString::number(results.avgFeatureVol)));
+	runsCSV.setItem(row, col++, new QTableWidgetItem(QString::number(results.avgFeaturePhi)));
+	runsCSV.setItem(row, col++, new QTableWidgetItem(QString::number(results.avgFeatureTheta)));
+	runsCSV.setItem(row, col++, new QTableWidgetItem(QString::number(results.avgFeatureRoundness)));
+	runsCSV.setItem(row, col++, new QTableWidgetItem(QString::number(results.avgFeatureLength)));
 	//input params
 	for ( int i = 0; i < results.parameters.size(); ++i )
-		runsCSV.setItem( lastRow, col++, new QTableWidgetItem( results.parameters[i] ) );
+		runsCSV.setItem( row, col++, new QTableWidgetItem( results.parameters[i] ) );
 
 	iAITKIO::writeFile( maskFilename, results.maskImage, itk::ImageIOBase::CHAR, true );
 
@@ -1300,9 +1361,60 @@ void iARunBatchThread::executeBatch( const QList<PorosityFilterID> & filterIds,
 		}
 	}
 
+	// Enumerate all samples up front, so that samples sharing a pipeline prefix (i.e., the same filters
+	// with the same parameters in all but the last stage) can share the computation of that prefix:
+	int const stageCount = filterIds.size();
+	int const prefixStages = stageCount - 1;
+	int const sampleCount = static_cast<int>( totalNumSamples );
+	std::vector<BatchSample> samples( sampleCount );
+	for( int sampleNo = 0; sampleNo < sampleCount; ++sampleNo )
+	{
+		BatchSample & sample = samples[sampleNo];
+		sample.sampleNo = sampleNo;
+		int pind = 0;
+		for (PorosityFilterID fid: filterIds)
+		{
+			QStringList stageValues;
+			for (int i = 0; i < FilterIdToParamList[fid].size(); ++i, ++pind)
+			{
+				sample.params.push_back( params[pind]->clone() );
+				stageValues << params[pind]->asKey();
+			}
+			sample.stageKeys << stageValues.join( " " );
+		}
+		if (randSampling)
+		{
+			randomlySampleParameters(params);
+		}
+		else
+		{
+			incrementParameterSet(params);
+		}
+	}
+	qDeleteAll( params );
+	if ( stageCount == 0 )
+	{
+		m_pmi->log( tr( "Pipeline contains no filters, nothing to compute." ) );
+		return;
+	}
+	// Order the samples by their stage parameters in pipeline order; that way, samples sharing a prefix
+	// of any length are adjacent, and each prefix needs to be computed only once:
+	std::vector<int> order( sampleCount );
+	std::iota( order.begin(), order.end(), 0 );
+	std::stable_sort( order.begin(), order.end(), [&samples, prefixStages]( int a, int b )
+	{
+		QStringList const & keysA = samples[a].stageKeys;
+		QStringList const & keysB = samples[b].stageKeys;
+		return std::lexicographical_compare( keysA.begin(), keysA.begin() + prefixStages,
+			keysB.begin(), keysB.begin() + prefixStages );
+	});
+
 	// initialize runsCSV data
 	m_runsCSV.clear();
 	initRunsCSVFile( m_runsCSV, batchDir, paramsNameType );
+	// each sample gets the row it would get if the samples were computed one after the other:
+	int const firstRow = m_runsCSV.rowCount();
+	m_runsCSV.setRowCount( firstRow + sampleCount );
 	// inintialize input datset
 	ScalarPixelType pixelType;
 	ImagePointer image = iAITKIO::readFile( datasetName, pixelType, true);
@@ -1317,100 +1429,173 @@ void iARunBatchThread::executeBatch( const QList<PorosityFilterID> & filterIds,
 		QString gtMaskFile = dsPath + "/" + m_datasetGTs[dsFN];
 		gtMask = iAITKIO::readFile( gtMaskFile, maskPixType, true);
 	}
+	MaskImageType * gtImage = dynamic_cast<MaskImageType*>(gtMask.GetPointer());
 	emit batchProgress( 0 );
 
-	for( int sampleNo = 0; sampleNo < totalNumSamples; ++sampleNo ) //iterate over parameters
+	// Intermediate results are at most as large as the input (smoothing filters cast back to the input type);
+	// a pending prefix may keep the results of all its stages alive, and each pending sample produces a mask.
+	// The budget limits how many distinct prefixes and samples are pending at the same time:
+	size_t pixelSize = 0;
+	ITK_TYPED_CALL( getPixelSize, pixelType, pixelSize );
+	double const pixelCount = static_cast<double>( image->GetLargestPossibleRegion().GetNumberOfPixels() );
+	double const prefixBytes = pixelCount * pixelSize * prefixStages;
+	double const maskBytes = pixelCount * sizeof( MaskImageType::PixelType );
+	double const budgetBytes = PendingResultsBudgetMB * 1024 * 1024;
+	size_t const maxPendingSamples = static_cast<size_t>( std::max( 1, QThread::idealThreadCount() ) * PendingSamplesPerThread );
+
+	QVector<RunInfo> prefixStack;      // results after each prefix stage of the current sample
+	QStringList prefixStackKeys;       // parameters of the stages in prefixStack
+	QStringList prefixErrors;          // errors that occurred while computing the current prefix
+	std::vector<PendingSampleRun> pending;
+	int pendingPrefixes = 0, prefixRuns = 0, finishedSamples = 0;
+
+	// computes the final stage of all pending samples in parallel, then stores their results in sample order:
+	auto finishPendingSamples = [&]()
 	{
-		while (m_pmi->ui()->rbPause->isChecked())
-		{
-			QCoreApplication::processEvents();
-		}
-
-		RunInfo results;
-		//fill in parameters info
-		for( int i = 0; i < numParams; ++i )
-		{
-			results.parameters.push_back( params[i]->asString() );
-			results.parameterNames << params[i]->name;
-		}
-
-		bool success = true;
-		results.elapsedTime = 0;	// reset elapsed time
-
-		try
+		long long const pendingCount = static_cast<long long>( pending.size() );
+#pragma omp parallel for schedule(dynamic)
+		for (long long i = 0; i < pendingCount; ++i)
 		{
-			ITK_TYPED_CALL(runBatch, pixelType, filterIds, image, results, params);
-			//calculate porosity
-			MaskImageType * mask = dynamic_cast<MaskImageType*>(results.maskImage.GetPointer());
-			MaskImageType * gtImage = dynamic_cast<MaskImageType*>(gtMask.GetPointer());
-			results.porosity = calcPorosity( mask, results.surroundingVoxels );
-
-			if (m_rbNewPipelineData)
+			PendingSampleRun & run = pending[i];
+			if ( !run.success )
+				continue;
+			try
 			{
-				QString currMaskFilePath = masksDir + "/mask" + QString::number(sampleNo + 1) + ".mhd";
-				calcFeatureCharsForMask(results, currMaskFilePath);
+				run.results.startTime = QLocale().toString( QDateTime::currentDateTime(), QLocale::ShortFormat );
+				ITK_TYPED_CALL(runStages, pixelType, filterIds, prefixStages, stageCount, image, run.results, samples[run.sampleNo].params);
+				//calculate porosity
+				MaskImageType * mask = dynamic_cast<MaskImageType*>(run.results.maskImage.GetPointer());
+				run.results.porosity = calcPorosity( mask, run.results.surroundingVoxels );
+				//Dice metric, false positve error, false negative error
+				if ( gtImage )
+					calcDiceMetrics( mask, gtImage, run.results );
 			}
-
-			//Dice metric, false positve error, false negative error
-			if ( m_datasetGTs[dsFN] != "" )
+			catch( itk::ExceptionObject &excep )
 			{
-				MaskImageType::RegionType reg = mask->GetLargestPossibleRegion();
-				long long size = static_cast<long long>(reg.GetSize()[0]) * reg.GetSize()[1] * reg.GetSize()[2];
-				size_t tp = 0, fn = 0, fp = 0, tn = 0;
-				MaskImageType::PixelType gt, m;
-
-#pragma omp parallel for reduction(+:tp,fn,fp,tn)
-				for (long long i = 0; i < size; ++i )
-				{
-					gt = gtImage->GetBufferPointer()[i];
-					m = mask->GetBufferPointer()[i];
-					if (gt == 1 && m == 1) tp = tp + 1;
-					if (gt == 1 && m == 0) fn = fn + 1;
-					if (gt == 0 && m == 1) fp = fp + 1;
-					if (gt == 0 && m == 0) tn = tn + 1;
-				}
-
-				results.falseNegativeRate = static_cast<float>(fn) / (tp + fn);
-				results.falsePositiveRate = static_cast<float>(fp) / (tn + fp);
-				results.dice = 2 * static_cast<float>(tp) / (2 * tp + fp + fn);
-				emit batchProgress( ( sampleNo + 1 ) * 100 / totalNumSamples );
+				run.errors << tr( "Filter run terminated unexpectedly." )
+					<< tr( "  %1 in File %2, Line %3" ).arg( excep.GetDescription() )
+					.arg( excep.GetFile() )
+					.arg( excep.GetLine() );
+				run.success = false;
+			}
+			catch( ... )
+			{
+				run.errors << tr( "Filter run terminated unexpectedly with unknown exception." );
+				run.success = false;
 			}
 		}
-		catch( itk::ExceptionObject &excep )
+		for (PendingSampleRun & run: pending)
 		{
-			m_pmi->log( tr( "Filter run terminated unexpectedly." ) );
-			m_pmi->log( tr( "  %1 in File %2, Line %3" ).arg( excep.GetDescription() )
-				.arg( excep.GetFile() )
-				.arg( excep.GetLine() ) );
-			success = false;
+			if ( run.success && m_rbNewPipelineData )
+			{
+				try
+				{
+					QString currMaskFilePath = masksDir + "/mask" + QString::number(run.sampleNo + 1) + ".mhd";
+					calcFeatureCharsForMask(run.results, currMaskFilePath);
+				}
+				catch( itk::ExceptionObject &excep )
+				{
+					run.errors << tr( "Filter run terminated unexpectedly." )
+						<< tr( "  %1 in File %2, Line %3" ).arg( excep.GetDescription() )
+						.arg( excep.GetFile() )
+						.arg( excep.GetLine() );
+					run.success = false;
+				}
+			}
+			for (QString const & msg: run.errors)
+			{
+				m_pmi->log( msg );
+			}
+			try
+			{
+				saveResultsToRunsCSV( run.results, masksDir, m_runsCSV, firstRow + run.sampleNo, run.success );
+			}
+			catch( itk::ExceptionObject &excep )
+			{
+				m_pmi->log( tr( "Writing the mask terminated unexpectedly." ) );
+				m_pmi->log( tr( "  %1 in File %2, Line %3" ).arg( excep.GetDescription() )
+					.arg( excep.GetFile() )
+					.arg( excep.GetLine() ) );
+			}
+			emit batchProgress( ( ++finishedSamples ) * 100 / sampleCount );
 		}
-		catch( ... )
+		pending.clear();
+		pendingPrefixes = 0;
+	};
+
+	for( int sampleIdx: order )
+	{
+		while (m_pmi->ui()->rbPause->isChecked())
 		{
-			m_pmi->log( tr( "Filter run terminated unexpectedly with unknown exception." ) );
-			success = false;
+			QCoreApplication::processEvents();
 		}
 
-		try
+		BatchSample const & sample = samples[sampleIdx];
+		int reusedStages = 0;
+		while ( reusedStages < prefixStack.size() && prefixStackKeys[reusedStages] == sample.stageKeys[reusedStages] )
 		{
-			saveResultsToRunsCSV( results, masksDir, m_runsCSV, success );
+			++reusedStages;
 		}
-		catch( itk::ExceptionObject &excep )
+		bool const newPrefix = reusedStages < prefixStages;
+		double const requiredBytes = ( pendingPrefixes + ( newPrefix ? 1 : 0 ) ) * prefixBytes + ( pending.size() + 1 ) * maskBytes;
+		if ( !pending.empty() && ( pending.size() >= maxPendingSamples || requiredBytes > budgetBytes ) )
 		{
-			m_pmi->log( tr( "Writing the mask terminated unexpectedly." ) );
-			m_pmi->log( tr( "  %1 in File %2, Line %3" ).arg( excep.GetDescription() )
-				.arg( excep.GetFile() )
-				.arg( excep.GetLine() ) );
+			finishPendingSamples();
 		}
-
-		if (randSampling)
+		if ( newPrefix )
 		{
-			randomlySampleParameters(params);
+			prefixStack.resize( reusedStages );
+			prefixStackKeys = prefixStackKeys.mid( 0, reusedStages );
+			prefixErrors.clear();
+			for ( int stage = reusedStages; stage < prefixStages; ++stage )
+			{
+				RunInfo stageResults = prefixStack.isEmpty() ? RunInfo() : prefixStack.last();
+				++prefixRuns;
+				try
+				{
+					ITK_TYPED_CALL(runStages, pixelType, filterIds, stage, stage + 1, image, stageResults, sample.params);
+				}
+				catch( itk::ExceptionObject &excep )
+				{
+					prefixErrors << tr( "Filter run terminated unexpectedly." )
+						<< tr( "  %1 in File %2, Line %3" ).arg( excep.GetDescription() )
+						.arg( excep.GetFile() )
+						.arg( excep.GetLine() );
+					break;
+				}
+				catch( ... )
+				{
+					prefixErrors << tr( "Filter run terminated unexpectedly with unknown exception." );
+					break;
+				}
+				prefixStack.push_back( stageResults );
+				prefixStackKeys << sample.stageKeys[stage];
+			}
+			++pendingPrefixes;
 		}
-		else
+
+		PendingSampleRun run;
+		run.sampleNo = sample.sampleNo;
+		run.success = prefixErrors.isEmpty();
+		run.errors = prefixErrors;
+		if ( run.success && !prefixStack.isEmpty() )
+			run.results = prefixStack.last();	// includes the elapsed time of the prefix stages
+		//fill in parameters info
+		for (IParameterInfo * p: sample.params)
 		{
-			incrementParameterSet(params);
+			run.results.parameters.push_back( p->asString() );
+			run.results.parameterNames << p->name;
 		}
+		pending.push_back( run );
+	}
+	finishPendingSamples();
+	prefixStack.clear();
+	for (BatchSample & sample: samples)
+	{
+		qDeleteAll( sample.params );
 	}
+	m_pmi->log( tr( "Computed %1 pipeline prefix stages for %2 samples, %3 prefix computations saved by reuse." )
+		.arg( prefixRuns ).arg( sampleCount ).arg( sampleCount * prefixStages - prefixRuns ) );
 	iACSVToQTableWidgetConverter::saveToCSVFile( m_runsCSV, batchDir + "/runs.csv" );
 }
 
@@ -44,7 +44,7 @@ protected:
 	void executeNewBatches( QTableWidget & settingsCSV, QMap<int, bool> & isBatchNew );
 	void executeBatch( const QList<PorosityFilterID> & filterIds, QString datasetName, QString batchDir, QTableWidget * settingsCSV, int row );
 	void initRunsCSVFile( QTableWidget & runsCSV, QString batchDir, const QList<ParamNameType> & paramNames );
-	void saveResultsToRunsCSV( RunInfo & results, QString masksDir, QTableWidget & runsCSV, bool success = true );
+	void saveResultsToRunsCSV( RunInfo & results, QString masksDir, QTableWidget & runsCSV, int row, bool success = true );
 	void updateComputerCSVFile( QTableWidget & settingsCSV );
 	void updateBatchesCSVFiles( QTableWidget & settingsCSV, QMap<int, bool> & isBatchNew );
 	bool updateBatchesCSVFile( QTableWidget & settingsCSV, int row, QString batchesFile );
@@ -3,22 +3,39 @@ IF (openiA_TESTING_ENABLED)
 	get_filename_component(CoreBinDir "../core" REALPATH BASE_DIR "${CMAKE_CURRENT_BINARY_DIR}")
 	ADD_EXECUTABLE(ImageGraphTest Segmentation/iAImageGraphTest.cpp Segmentation/iAImageGraph.cpp ${CoreSrcDir}/iAImageCoordinate.cpp)
 	ADD_EXECUTABLE(DistanceMeasureTest Segmentation/iADistanceMeasureTest.cpp Segmentation/iAVectorDistanceImpl.cpp Segmentation/iAVectorArrayImpl.cpp Segmentation/iAVectorTypeImpl.cpp ${CoreSrcDir}/iAImageCoordinate.cpp)
+	ADD_EXECUTABLE(RandomWalkerSolverTest Segmentation/iARandomWalkerSolverTest.cpp Segmentation/iARandomWalkerSolver.cpp)
+	ADD_EXECUTABLE(SVMPredictionTest Segmentation/iASVMPredictionTest.cpp Segmentation/iASVMImageFilter.cpp Segmentation/svm.cpp)
 	TARGET_LINK_LIBRARIES(ImageGraphTest PRIVATE ${QT_LIBRARIES})
 	TARGET_LINK_LIBRARIES(DistanceMeasureTest PRIVATE ${QT_LIBRARIES} ${VTK_LIBRARIES})
+	TARGET_LINK_LIBRARIES(RandomWalkerSolverTest PRIVATE ${CORE_LIBRARY_NAME})
+	TARGET_LINK_LIBRARIES(SVMPredictionTest PRIVATE ${CORE_LIBRARY_NAME})
+	IF (OpenMP_CXX_FOUND)
+		TARGET_LINK_LIBRARIES(SVMPredictionTest PRIVATE OpenMP::OpenMP_CXX)
+	ENDIF()
 	TARGET_INCLUDE_DIRECTORIES(ImageGraphTest PRIVATE ${CoreSrcDir} ${CoreBinDir})
 	TARGET_INCLUDE_DIRECTORIES(DistanceMeasureTest PRIVATE ${CoreSrcDir} ${CoreBinDir})
+	TARGET_INCLUDE_DIRECTORIES(RandomWalkerSolverTest PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/Segmentation ${CoreSrcDir} ${CoreBinDir})
+	TARGET_INCLUDE_DIRECTORIES(SVMPredictionTest PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/Segmentation ${CoreSrcDir} ${CoreBinDir})
 	TARGET_COMPILE_DEFINITIONS(ImageGraphTest PRIVATE NO_DLL_LINKAGE)
 	TARGET_COMPILE_DEFINITIONS(DistanceMeasureTest PRIVATE NO_DLL_LINKAGE)
 	ADD_TEST(NAME ImageGraphTest COMMAND ImageGraphTest)
 	ADD_TEST(NAME DistanceMeasureTest COMMAND DistanceMeasureTest)
+	# small volume sizes for the regular test run; for actual benchmarking, run without arguments
+	# (volume sizes from 32^3 up to 256^3) or pass the desired sizes:
+	ADD_TEST(NAME RandomWalkerSolverTest COMMAND RandomWalkerSolverTest 16 32)
+	ADD_TEST(NAME SVMPredictionTest COMMAND SVMPredictionTest)
 	IF (MSVC)
 		STRING(REGEX REPLACE "/" "\\\\" QT_WIN_DLL_DIR ${QT_LIB_DIR})
 		SET_TESTS_PROPERTIES(ImageGraphTest PROPERTIES ENVIRONMENT "PATH=${QT_WIN_DLL_DIR};$ENV{PATH}")
 		SET_TESTS_PROPERTIES(DistanceMeasureTest PROPERTIES ENVIRONMENT "PATH=${QT_WIN_DLL_DIR};$ENV{PATH}")
+		SET_TESTS_PROPERTIES(RandomWalkerSolverTest PROPERTIES ENVIRONMENT "PATH=${QT_WIN_DLL_DIR};$ENV{PATH}")
+		SET_TESTS_PROPERTIES(SVMPredictionTest PROPERTIES ENVIRONMENT "PATH=${QT_WIN_DLL_DIR};$ENV{PATH}")
 	ENDIF()
 
 	IF (openiA_USE_IDE_FOLDERS)
 		SET_PROPERTY(TARGET ImageGraphTest PROPERTY FOLDER "Tests")
 		SET_PROPERTY(TARGET DistanceMeasureTest PROPERTY FOLDER "Tests")
+		SET_PROPERTY(TARGET RandomWalkerSolverTest PROPERTY FOLDER "Tests")
+		SET_PROPERTY(TARGET SVMPredictionTest PROPERTY FOLDER "Tests")
 	ENDIF()
 ENDIF ()
\ No newline at end of file
@@ -26,6 +26,7 @@
 #include "iAMathUtility.h"    // for dblApproxEqual used in assert
 #endif
 #include "iANormalizerImpl.h"
+#include "iARandomWalkerSolver.h"
 #include "iAVectorArrayImpl.h"
 #include "iAVectorDistanceImpl.h"
 
@@ -39,6 +40,8 @@
 
 #include <QSet>
 
+#include <cmath>
+
 #ifdef USE_EIGEN
 
 #include <Eigen/Core>
@@ -220,6 +223,11 @@ namespace
 		filter->addParameter("Distance Function", Categorical, distanceFunctions);
 		filter->addParameter("Normalizer", Categorical, normalizeFunctions);
 	}
+
+	QString const SolverSparseLU("Sparse LU");
+	QString const SolverConjugateGradient("Conjugate Gradient (matrix-free)");
+	QString const Neighbourhood6("6");
+	QString const Neighbourhood26("26");
 	QString CommonRWParameterDescription("The <em>Distance Function</em> "
 		"determines how the distance between two data points is calculated."
 		"The <em>Normalizer</em> determines how these distances (used as weights "
@@ -236,12 +244,24 @@ iARandomWalker::iARandomWalker() :
 		"where x, y and z are the coordinates (set z = 0 for 2D images) and label is the index of the label "
 		"for this seed point. Label indices should start at 0 and be contiguous (so if you have N different "
 		"labels, you should use label indices 0..N - 1 and make sure that there is at least one seed per label).<br/>"
+		"The <em>Solver</em> determines how the linear system is solved: <em>" + SolverSparseLU + "</em> assembles "
+		"the graph Laplacian and factorizes it; this is exact, but its memory requirements grow superlinearly "
+		"with the image size, which limits it to small images. <em>" + SolverConjugateGradient + "</em> uses an "
+		"iterative, Jacobi-preconditioned conjugate gradient method that works directly on the image grid, "
+		"without storing the edges or the Laplacian explicitly; its memory requirements are linear in the number "
+		"of voxels, and it runs multi-threaded. For it, <em>Neighbourhood</em> determines whether each voxel is "
+		"connected to its 6 face neighbours or to all its 26 neighbours; iterations stop when the relative residual "
+		"is below <em>Tolerance</em>, or after <em>Maximum Iterations</em>.<br/>"
 		"For more information see "
 		"<a href=\"http://leogrady.net/publications/\">Leo Grady's website "
 		"(inventor of the algorithm)</a>")
 {
 	AddCommonRWParameters(this);
 	addParameter("Seeds", Text, "");
+	addParameter("Solver", Categorical, QStringList() << SolverSparseLU << SolverConjugateGradient);
+	addParameter("Neighbourhood", Categorical, QStringList() << Neighbourhood6 << Neighbourhood26);
+	addParameter("Tolerance", Continuous, 1e-6, 0);
+	addParameter("Maximum Iterations", Discrete, 1000, 1);
 }
 
 IAFILTER_CREATE(iARandomWalker)
@@ -263,13 +283,14 @@ void iARandomWalker::performWork(QMap<QString, QVariant> const & parameters)
 	inputChannel.weight = 1.0;
 	inputChannels.push_back(inputChannel);
 	iAVertexIndexType vertexCount = static_cast<iAVertexIndexType>(dim[0]) * dim[1] * dim[2];
-	iAImageGraph imageGraph(dim[0], dim[1], dim[2], iAImageCoordinate::ColRowDepMajor);
 	iASeedsPointer seeds = ExtractSeedVector(parameters["Seeds"].toString(), dim[0], dim[1], dim[2]);
 	int minLabel = std::numeric_limits<int>::max(),
 		maxLabel = std::numeric_limits<int>::lowest();
+	QSet<int> labelSet;
 	for (int i = 0; i<seeds->size(); ++i)
 	{
 		int label = seeds->at(i).second;
+		labelSet.insert(label);
 		if (label < minLabel)
 		{
 			minLabel = label;
@@ -295,13 +316,6 @@ void iARandomWalker::performWork(QMap<QString, QVariant> const & parameters)
 		return;
 	}
 
-	IndexMap seedMap;
-	QSet<int> labelSet;
-	for (iAVertexIndexType seedIdx = 0; seedIdx < static_cast<iAVertexIndexType>(seeds->size()); ++seedIdx)
-	{
-		seedMap.insert(imageGraph.converter().indexFromCoordinates(seeds->at(seedIdx).first), seedIdx);
-		labelSet.insert(seeds->at(seedIdx).second);
-	}
 	int labelCount = labelSet.size();
 	if (maxLabel != labelCount - 1)
 	{
@@ -309,6 +323,75 @@ void iARandomWalker::performWork(QMap<QString, QVariant> const & parameters)
 		return;
 	}
 
+	if (parameters["Solver"].toString() == SolverConjugateGradient)
+	{
+		iAStencilGraph graph(dim, parameters["Neighbourhood"].toString() == Neighbourhood26 ?
+			iAStencilGraph::Neighbourhood26 : iAStencilGraph::Neighbourhood6);
+		iARWInputChannel const & channel = inputChannels[0];
+		graph.computeWeights([&channel](size_t voxelIdx, size_t neighbourIdx)
+		{
+			return channel.distanceFunc->GetDistance(channel.image->get(voxelIdx), channel.image->get(neighbourIdx));
+		});
+		channel.normalizeFunc->SetMaxValue(graph.maxWeight());
+		graph.transformWeights([&channel](double distance)
+		{
+			// 1-x - because we need "resistance" for RW, not "conductance"
+			return channel.weight * (1 - channel.normalizeFunc->Normalize(distance)) + iAVectorDistance::EPSILON;
+		});
+		std::vector<int> seedLabels(graph.voxelCount(), -1);
+		for (int i = 0; i < seeds->size(); ++i)
+		{
+			iAImageCoordinate const & c = seeds->at(i).first;
+			seedLabels[c.x + static_cast<size_t>(c.y) * dim[0] + static_cast<size_t>(c.z) * dim[0] * dim[1]] = seeds->at(i).second;
+		}
+		double tolerance = parameters["Tolerance"].toDouble();
+		std::vector<double> probabilities;
+		auto result = solveRandomWalker(graph, seedLabels, labelCount, tolerance,
+			parameters["Maximum Iterations"].toInt(), probabilities,
+			[this, tolerance](int /*iteration*/, double residual)
+			{
+				// residual decreases roughly exponentially, so report progress on a logarithmic scale;
+				// for a tolerance >= 1, the scale is undefined (log(1) = 0), but the solver is done anyway:
+				double percent = (tolerance >= 1 || residual <= tolerance) ? 100 :
+					(residual < 1) ? 100 * std::log(residual) / std::log(tolerance) : 0;
+				progress()->emitProgress(static_cast<int>(clamp(0.0, 100.0, percent)));
+			});
+		addMsg(QString("Conjugate gradient solver: %1 iterations, relative residual %2.")
+			.arg(result.iterations).arg(result.residual));
+		if (!result.converged)
+		{
+			addMsg("The solver did not reach the given tolerance; consider increasing the maximum number of iterations!");
+		}
+		QVector<iAITKIO::ImagePointer> probImgs;
+		for (int l = 0; l < labelCount; ++l)
+		{
+			iAITKIO::ImagePointer pImg = allocateImage(dim, spc, itk::ImageIOBase::DOUBLE);
+			double* buf = dynamic_cast<ProbImageType*>(pImg.GetPointer())->GetBufferPointer();
+#pragma omp parallel for
+			for (long long v = 0; v < static_cast<long long>(graph.voxelCount()); ++v)
+			{
+				buf[v] = probabilities[v * labelCount + l];
+			}
+			probImgs.push_back(pImg);
+		}
+		auto labelImg = CreateLabelImage(dim, spc, probImgs, labelCount);
+		addOutput(labelImg);
+		setOutputName(0u, "Label Image");
+		for (int i = 0; i < labelCount; ++i)
+		{
+			addOutput(probImgs[i]);
+			setOutputName(static_cast<unsigned int>(1 + i), QString("Probability image label %1").arg(i));
+		}
+		return;
+	}
+
+	iAImageGraph imageGraph(dim[0], dim[1], dim[2], iAImageCoordinate::ColRowDepMajor);
+	IndexMap seedMap;
+	for (iAVertexIndexType seedIdx = 0; seedIdx < static_cast<iAVertexIndexType>(seeds->size()); ++seedIdx)
+	{
+		seedMap.insert(imageGraph.converter().indexFromCoordinates(seeds->at(seedIdx).first), seedIdx);
+	}
+
 	QVector<QSharedPointer<iAGraphWeights> > graphWeights(inputChannels.size());
 	QVector<double> weightsForChannels(inputChannels.size());
 	for (int i = 0; i<inputChannels.size(); ++i)
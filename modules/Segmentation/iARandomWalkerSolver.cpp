@@ -0,0 +1,389 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iARandomWalkerSolver.h"
+
+#include <cmath>
+
+namespace
+{
+	int const Offsets26[13][3] = {
+		{ 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 },
+		{ 1, 1, 0 }, { -1, 1, 0 }, { 1, 0, 1 }, { -1, 0, 1 }, { 0, 1, 1 }, { 0, -1, 1 },
+		{ 1, 1, 1 }, { -1, 1, 1 }, { 1, -1, 1 }, { -1, -1, 1 }
+	};
+
+	//! Visits all voxels (in parallel over slices), passing per-thread partial sums for numCols columns
+	//! to func(x, y, z, voxelIdx, partial); the partial sums of all threads are added up in result.
+	template <typename Func>
+	void forAllVoxels(int const dim[3], int numCols, std::vector<double> & result, Func func)
+	{
+		long long const sliceSize = static_cast<long long>(dim[0]) * dim[1];
+		std::fill(result.begin(), result.end(), 0.0);
+#pragma omp parallel
+		{
+			std::vector<double> partial(numCols, 0.0);
+#pragma omp for schedule(static)
+			for (int z = 0; z < dim[2]; ++z)
+			{
+				for (int y = 0; y < dim[1]; ++y)
+				{
+					size_t voxelIdx = static_cast<size_t>(z * sliceSize + static_cast<long long>(y) * dim[0]);
+					for (int x = 0; x < dim[0]; ++x, ++voxelIdx)
+					{
+						func(x, y, z, voxelIdx, partial.data());
+					}
+				}
+			}
+#pragma omp critical(rwSolverReduce)
+			for (int c = 0; c < numCols; ++c)
+			{
+				result[c] += partial[c];
+			}
+		}
+	}
+
+	//! Multiplies the (unlabeled rows of the) Laplacian with the given block of column vectors:
+	//! out = L * in for unlabeled voxels, out = 0 for seed voxels.
+	//! The columns of in and out are stored interleaved, with the given strides; only active columns
+	//! are computed. Additionally, the dot product of in and out is accumulated per column in inDotOut.
+	void applyLaplacian(iAStencilGraph const & graph, std::vector<int> const & seedLabels,
+		std::vector<char> const & active, double const * in, int inStride, double * out, int outStride,
+		std::vector<double> & inDotOut)
+	{
+		int const * dim = graph.dim();
+		int const offsetCount = graph.offsetCount();
+		int const cols = static_cast<int>(active.size());
+		long long delta[13];
+		for (int o = 0; o < offsetCount; ++o)
+		{
+			int const * d = graph.offset(o);
+			delta[o] = d[0] + static_cast<long long>(d[1]) * dim[0] + static_cast<long long>(d[2]) * dim[0] * dim[1];
+		}
+		auto const & degrees = graph.degrees();
+		forAllVoxels(dim, cols, inDotOut, [&](int x, int y, int z, size_t voxelIdx, double* partial)
+		{
+			double * o = out + voxelIdx * outStride;
+			if (seedLabels[voxelIdx] >= 0)
+			{
+				for (int c = 0; c < cols; ++c)
+				{
+					o[c] = 0;
+				}
+				return;
+			}
+			double const * i = in + voxelIdx * inStride;
+			if (x > 0 && x < dim[0] - 1 && y > 0 && y < dim[1] - 1 && z > 0 && z < dim[2] - 1)
+			{	// fast path for the image interior, where all neighbours exist:
+				for (int c = 0; c < cols; ++c)
+				{
+					if (!active[c])
+					{
+						continue;
+					}
+					double sum = degrees[voxelIdx] * i[c];
+					for (int n = 0; n < offsetCount; ++n)
+					{
+						sum -= graph.weight(voxelIdx, n) * i[delta[n] * inStride + c] +
+							graph.weight(voxelIdx - delta[n], n) * i[-delta[n] * inStride + c];
+					}
+					o[c] = sum;
+					partial[c] += i[c] * sum;
+				}
+				return;
+			}
+			// border: gather the existing neighbours once, then compute all columns from them
+			size_t neighbourIdx[26];
+			double neighbourWeight[26];
+			int neighbourCount = 0;
+			for (int n = 0; n < offsetCount; ++n)
+			{
+				int const * d = graph.offset(n);
+				if (graph.hasNeighbour(x, y, z, n))
+				{
+					neighbourIdx[neighbourCount] = (voxelIdx + delta[n]) * inStride;
+					neighbourWeight[neighbourCount++] = graph.weight(voxelIdx, n);
+				}
+				int bx = x - d[0], by = y - d[1], bz = z - d[2];
+				if (bx >= 0 && bx < dim[0] && by >= 0 && by < dim[1] && bz >= 0 && bz < dim[2])
+				{
+					neighbourIdx[neighbourCount] = (voxelIdx - delta[n]) * inStride;
+					neighbourWeight[neighbourCount++] = graph.weight(voxelIdx - delta[n], n);
+				}
+			}
+			for (int c = 0; c < cols; ++c)
+			{
+				if (!active[c])
+				{
+					continue;
+				}
+				double sum = degrees[voxelIdx] * i[c];
+				for (int k = 0; k < neighbourCount; ++k)
+				{
+					sum -= neighbourWeight[k] * in[neighbourIdx[k] + c];
+				}
+				o[c] = sum;
+				partial[c] += i[c] * sum;
+			}
+		});
+	}
+}
+
+iAStencilGraph::iAStencilGraph(int const dim[3], iANeighbourhood neighbourhood) :
+	m_offsetCount(neighbourhood == Neighbourhood26 ? 13 : 3)
+{
+	std::copy(dim, dim + 3, m_dim);
+	std::copy(&Offsets26[0][0], &Offsets26[0][0] + 13 * 3, &m_offsets[0][0]);
+	m_weights.resize(voxelCount() * m_offsetCount, 0.0f);
+	m_degrees.resize(voxelCount(), 0.0);
+}
+
+int const * iAStencilGraph::dim() const
+{
+	return m_dim;
+}
+
+size_t iAStencilGraph::voxelCount() const
+{
+	return static_cast<size_t>(m_dim[0]) * m_dim[1] * m_dim[2];
+}
+
+int iAStencilGraph::offsetCount() const
+{
+	return m_offsetCount;
+}
+
+int const * iAStencilGraph::offset(int o) const
+{
+	return m_offsets[o];
+}
+
+bool iAStencilGraph::hasNeighbour(int x, int y, int z, int o) const
+{
+	int nx = x + m_offsets[o][0], ny = y + m_offsets[o][1], nz = z + m_offsets[o][2];
+	return nx >= 0 && nx < m_dim[0] && ny >= 0 && ny < m_dim[1] && nz >= 0 && nz < m_dim[2];
+}
+
+float iAStencilGraph::weight(size_t voxelIdx, int o) const
+{
+	return m_weights[voxelIdx * m_offsetCount + o];
+}
+
+std::vector<double> const & iAStencilGraph::degrees() const
+{
+	return m_degrees;
+}
+
+float iAStencilGraph::maxWeight() const
+{
+	return m_weights.empty() ? 0.0f : *std::max_element(m_weights.begin(), m_weights.end());
+}
+
+void iAStencilGraph::updateDegrees()
+{
+	long long delta[13];
+	for (int o = 0; o < m_offsetCount; ++o)
+	{
+		delta[o] = m_offsets[o][0] + static_cast<long long>(m_offsets[o][1]) * m_dim[0] +
+			static_cast<long long>(m_offsets[o][2]) * m_dim[0] * m_dim[1];
+	}
+	std::vector<double> unused;
+	forAllVoxels(m_dim, 0, unused, [&](int x, int y, int z, size_t voxelIdx, double* /*partial*/)
+	{
+		double degree = 0;
+		for (int o = 0; o < m_offsetCount; ++o)
+		{
+			degree += m_weights[voxelIdx * m_offsetCount + o];   // 0 for neighbours outside of the image
+			int bx = x - m_offsets[o][0], by = y - m_offsets[o][1], bz = z - m_offsets[o][2];
+			if (bx >= 0 && bx < m_dim[0] && by >= 0 && by < m_dim[1] && bz >= 0 && bz < m_dim[2])
+			{
+				degree += m_weights[(voxelIdx - delta[o]) * m_offsetCount + o];
+			}
+		}
+		m_degrees[voxelIdx] = degree;
+	});
+}
+
+iARandomWalkerSolverResult solveRandomWalker(iAStencilGraph const & graph, std::vector<int> const & seedLabels,
+	int labelCount, double tolerance, int maxIterations, std::vector<double> & probabilities,
+	std::function<void(int, double)> progress)
+{
+	iARandomWalkerSolverResult result;
+	result.iterations = 0;
+	result.residual = 0;
+	result.converged = true;
+	size_t const voxelCount = graph.voxelCount();
+	int const * dim = graph.dim();
+	probabilities.assign(voxelCount * labelCount, 1.0);
+	if (labelCount < 2)
+	{
+		return result;
+	}
+	// the probabilities of all labels sum up to 1, so the last one doesn't need to be solved for:
+	int const cols = labelCount - 1;
+	int const stride = labelCount;
+	double * x = probabilities.data();    // solution is computed in-place in the first cols columns
+	std::vector<double> r(voxelCount * cols), p(voxelCount * cols), q(voxelCount * cols);
+	std::vector<char> active(cols, 1);
+	std::vector<double> pq(cols), alpha(cols), beta(cols), rz(cols), bNorm(cols), residual(cols, 0.0);
+	std::vector<double> sums(2 * cols), unused;
+	auto const & degrees = graph.degrees();
+
+	// right-hand side b = -B * x_seeds; with unlabeled voxels set to 0, it is the negative of L * x:
+	for (size_t v = 0; v < voxelCount; ++v)
+	{
+		for (int c = 0; c < cols; ++c)
+		{
+			x[v * stride + c] = (seedLabels[v] < 0) ? 0.0 : (seedLabels[v] == c ? 1.0 : 0.0);
+		}
+	}
+	applyLaplacian(graph, seedLabels, active, x, stride, q.data(), cols, pq);
+	forAllVoxels(dim, cols, bNorm, [&](int, int, int, size_t v, double* partial)
+	{
+		for (int c = 0; c < cols; ++c)
+		{
+			partial[c] += q[v * cols + c] * q[v * cols + c];
+		}
+	});
+	for (int c = 0; c < cols; ++c)
+	{
+		bNorm[c] = (bNorm[c] > 0) ? std::sqrt(bNorm[c]) : 1.0;
+	}
+	// initial guess: equal probability for all labels at unlabeled voxels
+	double const initialGuess = 1.0 / labelCount;
+	for (size_t v = 0; v < voxelCount; ++v)
+	{
+		if (seedLabels[v] < 0)
+		{
+			for (int c = 0; c < cols; ++c)
+			{
+				x[v * stride + c] = initialGuess;
+			}
+		}
+	}
+	applyLaplacian(graph, seedLabels, active, x, stride, q.data(), cols, pq);
+	// r = b - A x = -(L x); p = z = D^-1 r
+	forAllVoxels(dim, 2 * cols, sums, [&](int, int, int, size_t v, double* partial)
+	{
+		double invDeg = (degrees[v] > 0) ? 1.0 / degrees[v] : 0.0;
+		for (int c = 0; c < cols; ++c)
+		{
+			double res = -q[v * cols + c];
+			r[v * cols + c] = res;
+			p[v * cols + c] = invDeg * res;
+			partial[c] += invDeg * res * res;
+			partial[cols + c] += res * res;
+		}
+	});
+	bool allConverged = true;
+	for (int c = 0; c < cols; ++c)
+	{
+		rz[c] = sums[c];
+		residual[c] = std::sqrt(sums[cols + c]) / bNorm[c];
+		active[c] = residual[c] > tolerance;
+		allConverged = allConverged && !active[c];
+	}
+	int iteration = 0;
+	while (!allConverged && iteration < maxIterations)
+	{
+		++iteration;
+		// q = A p, pq = p . q; single stencil traversal for all labels
+		applyLaplacian(graph, seedLabels, active, p.data(), cols, q.data(), cols, pq);
+		for (int c = 0; c < cols; ++c)
+		{
+			alpha[c] = (active[c] && pq[c] != 0) ? rz[c] / pq[c] : 0.0;
+		}
+		// x += alpha p; r -= alpha q; accumulate r . z and r . r
+		forAllVoxels(dim, 2 * cols, sums, [&](int, int, int, size_t v, double* partial)
+		{
+			if (seedLabels[v] >= 0)
+			{
+				return;
+			}
+			double invDeg = (degrees[v] > 0) ? 1.0 / degrees[v] : 0.0;
+			for (int c = 0; c < cols; ++c)
+			{
+				if (!active[c])
+				{
+					continue;
+				}
+				x[v * stride + c] += alpha[c] * p[v * cols + c];
+				double res = r[v * cols + c] - alpha[c] * q[v * cols + c];
+				r[v * cols + c] = res;
+				partial[c] += invDeg * res * res;
+				partial[cols + c] += res * res;
+			}
+		});
+		allConverged = true;
+		double maxResidual = 0;
+		for (int c = 0; c < cols; ++c)
+		{
+			if (active[c])
+			{
+				residual[c] = std::sqrt(sums[cols + c]) / bNorm[c];
+				beta[c] = (rz[c] != 0) ? sums[c] / rz[c] : 0.0;
+				rz[c] = sums[c];
+				if (residual[c] <= tolerance)
+				{   // freeze converged labels
+					active[c] = 0;
+				}
+			}
+			allConverged = allConverged && !active[c];
+			maxResidual = std::max(maxResidual, residual[c]);
+		}
+		if (progress)
+		{
+			progress(iteration, maxResidual);
+		}
+		if (allConverged)
+		{
+			break;
+		}
+		// p = z + beta p
+		forAllVoxels(dim, 0, unused, [&](int, int, int, size_t v, double*)
+		{
+			double invDeg = (seedLabels[v] < 0 && degrees[v] > 0) ? 1.0 / degrees[v] : 0.0;
+			for (int c = 0; c < cols; ++c)
+			{
+				if (active[c])
+				{
+					p[v * cols + c] = invDeg * r[v * cols + c] + beta[c] * p[v * cols + c];
+				}
+			}
+		});
+	}
+	result.iterations = iteration;
+	result.converged = allConverged;
+	result.residual = *std::max_element(residual.begin(), residual.end());
+	// derive last label's probability, and clamp numerical inaccuracies:
+#pragma omp parallel for
+	for (long long v = 0; v < static_cast<long long>(voxelCount); ++v)
+	{
+		double * prob = x + v * stride;
+		double sum = 0;
+		for (int c = 0; c < cols; ++c)
+		{
+			prob[c] = std::min(1.0, std::max(0.0, prob[c]));
+			sum += prob[c];
+		}
+		prob[cols] = (seedLabels[v] >= 0) ? (seedLabels[v] == cols ? 1.0 : 0.0) : std::max(0.0, 1.0 - sum);
+	}
+	return result;
+}
@@ -0,0 +1,150 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+//! Graph over a regular voxel grid whose edges are given implicitly by a 6- or 26-neighbourhood stencil.
+//! In contrast to iAImageGraph, no edge list is stored; each voxel only holds the weights of the edges
+//! to its "forward" neighbours (3 for the 6-neighbourhood, 13 for the 26-neighbourhood), the weights
+//! of the remaining edges are found at the respective neighbour. Voxel indices are x-fastest.
+class iAStencilGraph
+{
+public:
+	enum iANeighbourhood
+	{
+		Neighbourhood6,
+		Neighbourhood26
+	};
+	iAStencilGraph(int const dim[3], iANeighbourhood neighbourhood);
+	int const * dim() const;
+	size_t voxelCount() const;
+	//! number of forward offsets (half the neighbourhood size)
+	int offsetCount() const;
+	//! the (x, y, z) delta of the given forward offset
+	int const * offset(int o) const;
+	//! whether the neighbour of voxel (x, y, z) in direction of forward offset o lies within the image
+	bool hasNeighbour(int x, int y, int z, int o) const;
+	//! weight of the edge from the given voxel to its neighbour at forward offset o
+	//! (0 if that neighbour lies outside of the image)
+	float weight(size_t voxelIdx, int o) const;
+	//! the sum of weights of all edges incident to each voxel (i.e. the diagonal of the graph Laplacian)
+	std::vector<double> const & degrees() const;
+	//! largest weight of any edge in the graph
+	float maxWeight() const;
+	//! Computes the weight of every edge as func(voxelIdx, neighbourIdx); func is called in parallel.
+	template <typename Func> void computeWeights(Func func);
+	//! Replaces the weight w of every edge by func(w); func is called in parallel.
+	//! Also updates the degrees, so call this last when computing the weights.
+	template <typename Func> void transformWeights(Func func);
+private:
+	void updateDegrees();
+	int m_dim[3];
+	int m_offsetCount;
+	int m_offsets[13][3];
+	std::vector<float> m_weights;   //!< edge weights, voxelIdx * offsetCount + offset
+	std::vector<double> m_degrees;
+};
+
+//! Result of solveRandomWalker.
+struct iARandomWalkerSolverResult
+{
+	int iterations;        //!< number of conjugate gradient iterations performed
+	double residual;       //!< the largest relative residual norm of all labels
+	bool converged;        //!< whether all labels reached the requested tolerance
+};
+
+//! Solves the Random Walker linear system (Grady 2006) with a matrix-free, Jacobi-preconditioned
+//! conjugate gradient method directly on the stencil graph, without assembling the Laplacian.
+//! All labels are solved as one block, i.e. each iteration traverses the stencil only once for all
+//! labels. Since the probabilities of all labels sum up to one, only labelCount - 1 systems are solved;
+//! the probability of the last label is derived from the others.
+//! @param graph the weighted graph
+//! @param seedLabels per voxel the label index of the seed at this voxel, or -1 if the voxel is unlabeled
+//! @param labelCount the number of labels (seed labels need to be in the range 0..labelCount-1)
+//! @param tolerance the residual norm, relative to the norm of the right-hand side, at which to stop
+//! @param maxIterations the maximum number of iterations to perform
+//! @param probabilities receives the probability of each label at each voxel (voxelIdx * labelCount + label)
+//! @param progress if set, called after each iteration with the iteration number and current relative residual
+iARandomWalkerSolverResult solveRandomWalker(iAStencilGraph const & graph, std::vector<int> const & seedLabels,
+	int labelCount, double tolerance, int maxIterations, std::vector<double> & probabilities,
+	std::function<void(int, double)> progress = std::function<void(int, double)>());
+
+
+template <typename Func>
+void iAStencilGraph::computeWeights(Func func)
+{
+	long long const sliceSize = static_cast<long long>(m_dim[0]) * m_dim[1];
+#pragma omp parallel for schedule(dynamic)
+	for (int z = 0; z < m_dim[2]; ++z)
+	{
+		for (int y = 0; y < m_dim[1]; ++y)
+		{
+			for (int x = 0; x < m_dim[0]; ++x)
+			{
+				size_t voxelIdx = static_cast<size_t>(z * sliceSize + static_cast<long long>(y) * m_dim[0] + x);
+				for (int o = 0; o < m_offsetCount; ++o)
+				{
+					if (!hasNeighbour(x, y, z, o))
+					{
+						m_weights[voxelIdx * m_offsetCount + o] = 0;
+						continue;
+					}
+					size_t neighbourIdx = static_cast<size_t>(
+						(z + m_offsets[o][2]) * sliceSize +
+						static_cast<long long>(y + m_offsets[o][1]) * m_dim[0] +
+						x + m_offsets[o][0]);
+					m_weights[voxelIdx * m_offsetCount + o] = static_cast<float>(func(voxelIdx, neighbourIdx));
+				}
+			}
+		}
+	}
+	updateDegrees();
+}
+
+template <typename Func>
+void iAStencilGraph::transformWeights(Func func)
+{
+	long long const sliceSize = static_cast<long long>(m_dim[0]) * m_dim[1];
+#pragma omp parallel for
+	for (int z = 0; z < m_dim[2]; ++z)
+	{
+		for (int y = 0; y < m_dim[1]; ++y)
+		{
+			for (int x = 0; x < m_dim[0]; ++x)
+			{
+				size_t voxelIdx = static_cast<size_t>(z * sliceSize + static_cast<long long>(y) * m_dim[0] + x);
+				for (int o = 0; o < m_offsetCount; ++o)
+				{
+					if (hasNeighbour(x, y, z, o))
+					{
+						float & w = m_weights[voxelIdx * m_offsetCount + o];
+						w = static_cast<float>(func(w));
+					}
+				}
+			}
+		}
+	}
+	updateDegrees();
+}
@@ -0,0 +1,124 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iARandomWalkerSolver.h"
+
+#include "iAPerformanceHelper.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// Runs the matrix-free Random Walker solver on a synthetic volume (two regions of different intensity
+// plus noise, one seed plane per region) for a series of volume sizes; checks that the probabilities
+// are valid and that the regions are labeled correctly, and reports time and peak memory per size.
+// Usage: RandomWalkerSolverTest [size1 [size2 ...]] - each size is the edge length of a cubic volume.
+
+namespace
+{
+	const int DefaultSizes[] = { 32, 64, 128, 192, 256 };
+	const double Beta = 100;
+	const double Epsilon = 1e-5;
+	const double Tolerance = 1e-6;
+	const int MaxIterations = 5000;
+
+	bool runBenchmark(int size, iAStencilGraph::iANeighbourhood neighbourhood)
+	{
+		int dim[3] = { size, size, size };
+		size_t voxelCount = static_cast<size_t>(size) * size * size;
+		iAPeakMemoryTracker memTracker;
+		auto start = std::chrono::steady_clock::now();
+
+		// left half: intensity ~0, right half: intensity ~100
+		std::vector<float> values(voxelCount);
+		std::mt19937 rng(42);
+		std::normal_distribution<float> noise(0.0f, 5.0f);
+		for (size_t v = 0; v < voxelCount; ++v)
+		{
+			int x = static_cast<int>(v % size);
+			values[v] = ((x < size / 2) ? 0.0f : 100.0f) + noise(rng);
+		}
+		std::vector<int> seeds(voxelCount, -1);
+		for (size_t v = 0; v < voxelCount; v += size)
+		{
+			seeds[v] = 0;
+			seeds[v + size - 1] = 1;
+		}
+		iAStencilGraph graph(dim, neighbourhood);
+		graph.computeWeights([&values](size_t a, size_t b)
+		{
+			return std::abs(values[a] - values[b]);
+		});
+		double maxDist = graph.maxWeight();
+		graph.transformWeights([maxDist](double d)
+		{
+			double normalized = d / maxDist;
+			return std::exp(-Beta * normalized * normalized) + Epsilon;
+		});
+		std::vector<double> probabilities;
+		auto result = solveRandomWalker(graph, seeds, 2, Tolerance, MaxIterations, probabilities);
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		memTracker.stop();
+
+		size_t invalid = 0, misclassified = 0;
+		for (size_t v = 0; v < voxelCount; ++v)
+		{
+			double p0 = probabilities[2 * v], p1 = probabilities[2 * v + 1];
+			if (p0 < 0 || p1 < 0 || std::abs(p0 + p1 - 1) > 1e-9)
+			{
+				++invalid;
+			}
+			int expectedLabel = (static_cast<int>(v % size) < size / 2) ? 0 : 1;
+			if ((p0 >= p1 ? 0 : 1) != expectedLabel)
+			{
+				++misclassified;
+			}
+		}
+		std::cout << size << "^3, " << (neighbourhood == iAStencilGraph::Neighbourhood26 ? 26 : 6) << "-neighbourhood: "
+			<< elapsed << " s, peak memory " << (memTracker.peakRSS() - memTracker.startRSS()) / (1024 * 1024) << " MB, "
+			<< result.iterations << " iterations, residual " << result.residual
+			<< (result.converged ? "" : " (NOT converged)") << ", "
+			<< invalid << " invalid, " << misclassified << " misclassified voxels" << std::endl;
+		return result.converged && invalid == 0 && misclassified == 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<int> sizes;
+	for (int i = 1; i < argc; ++i)
+	{
+		sizes.push_back(std::atoi(argv[i]));
+	}
+	if (sizes.empty())
+	{
+		sizes.assign(std::begin(DefaultSizes), std::end(DefaultSizes));
+	}
+	bool success = true;
+	for (int size : sizes)
+	{
+		success = runBenchmark(size, iAStencilGraph::Neighbourhood6) && success;
+		success = runBenchmark(size, iAStencilGraph::Neighbourhood26) && success;
+	}
+	std::cout << "Overall: " << (success ? "PASSED" : "FAILED") << std::endl;
+	return success ? 0 : 1;
+}
@@ -28,7 +28,6 @@
 #include <iAImageCoordinate.h>
 #include <iAProgress.h>
 #include <iASeedType.h>
-#include <iAVtkDraw.h>
 #include <iAToolsVTK.h>
 #include <iATypedCallHelper.h>
 
@@ -36,12 +35,34 @@
 
 #include <vtkImageData.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
 namespace
 {
 	void myNullPrintFunc(char const *)
 	{
 	}
 	const double MY_EPSILON = 1e-6;
+	//! number of voxels for which the SVM prediction is computed in one go
+	const int PredictionBatchSize = 256;
+
+	//! copy the (first component) values of count consecutive voxels, starting at voxel index start, into out
+	template <typename T>
+	void gatherChannel(vtkImageData* img, long long start, int count, double* out)
+	{
+		T const * data = static_cast<T const *>(img->GetScalarPointer());
+		int const components = img->GetNumberOfScalarComponents();
+		for (int v = 0; v < count; ++v)
+		{
+			out[v] = static_cast<double>(data[(start + v) * components]);
+		}
+	}
 
 	int MapKernelTypeToIndex(QString const & type)
 	{
@@ -70,7 +91,7 @@ void iASVMImageFilter::performWork(QMap<QString, QVariant> const & parameters)
 	param.kernel_type = MapKernelTypeToIndex(parameters["Kernel Type"].toString());
 	param.gamma = parameters["Gamma"].toDouble();
 	param.C = parameters["C"].toDouble();
-	param.degree = parameters["Degree"].toInt();
+	param.degree = parameters["Dimension"].toInt();
 	param.coef0 = parameters["Coef0"].toDouble();
 	param.probability = 1;
 
@@ -143,60 +164,82 @@ void iASVMImageFilter::performWork(QMap<QString, QVariant> const & parameters)
 	int labelCount = labelMax - labelMin + 1;
 
 	QVector<vtkSmartPointer<vtkImageData> > probabilities(labelCount);
-	svm_node* node = new svm_node[input().size() + 1];
-	node[input().size()].index = -1;	// the termination marker
 	double const* spc = input()[0]->vtkImage()->GetSpacing();
-	double * prob_estimates = new double[labelCount];
-
+	std::vector<double*> probData(labelCount);
 	for (int l = 0; l < labelCount; ++l)
 	{
 		probabilities[l] = allocateImage(VTK_DOUBLE, dim, spc, 1);
-		prob_estimates[l] = 0;
+		probData[l] = static_cast<double*>(probabilities[l]->GetScalarPointer());
+	}
+	int const channelCount = input().size();
+	std::vector<vtkImageData*> channels(channelCount);
+	for (int m = 0; m < channelCount; ++m)
+	{
+		channels[m] = input()[m]->vtkImage();
 	}
 
-	// for each pixel, execute svm_predict :
-	FOR_VTKIMG_PIXELS(input()[0]->vtkImage(), x, y, z)
+	// predict in parallel, in batches of voxels, for which the kernel values are computed in one go:
+	long long const voxelCount = static_cast<long long>(dim[0]) * dim[1] * dim[2];
+	long long const batchCount = (voxelCount + PredictionBatchSize - 1) / PredictionBatchSize;
+	std::atomic<long long> finishedBatches(0);
+#pragma omp parallel
 	{
-		for (int m = 0; m < input().size(); ++m)
-		{
-			node[m].index = m;
-			node[m].value = input()[m]->vtkImage()->GetScalarComponentAsDouble(x, y, z, 0);
-		}
-		/*double label =*/ svm_predict_probability(model, node, prob_estimates);
-		/*double label2 =*/ svm_predict(model, node);
-		double probSum = 0;
-		for (int l = 0; l < labelCount; ++l)
+		std::vector<double> channelValues(static_cast<size_t>(channelCount) * PredictionBatchSize);
+		std::vector<double> kernelValues(static_cast<size_t>(model->l) * PredictionBatchSize);
+		std::vector<double> probEstimates(labelCount, 0.0);
+#pragma omp for schedule(dynamic)
+		for (long long b = 0; b < batchCount; ++b)
 		{
-			drawPixel(probabilities[l], x, y, z, prob_estimates[l]);
-			probSum += prob_estimates[l];
-			// DEBUG check begin
-			if (prob_estimates[l] < -MY_EPSILON || prob_estimates[l] > 1.0+MY_EPSILON)
+			long long batchStart = b * PredictionBatchSize;
+			int count = static_cast<int>(std::min(static_cast<long long>(PredictionBatchSize), voxelCount - batchStart));
+			for (int m = 0; m < channelCount; ++m)
 			{
-				DEBUG_LOG(QString("SVM: Invalid probability (%1) at %2, %3, %4")
-					.arg(prob_estimates[l])
-					.arg(x)
-					.arg(y)
-					.arg(z));
+				VTK_TYPED_CALL(gatherChannel, channels[m]->GetScalarType(), channels[m], batchStart, count,
+					channelValues.data() + static_cast<size_t>(m) * count);
+			}
+			svm_batch_kernel_values(model, channelValues.data(), count, channelCount, kernelValues.data());
+			for (int v = 0; v < count; ++v)
+			{
+				svm_predict_probability_kvalues(model, kernelValues.data() + v, count, probEstimates.data());
+				long long voxelIdx = batchStart + v;
+				double probSum = 0;
+				for (int l = 0; l < labelCount; ++l)
+				{
+					probData[l][voxelIdx] = probEstimates[l];
+					probSum += probEstimates[l];
+					// DEBUG check begin
+					if (probEstimates[l] < -MY_EPSILON || probEstimates[l] > 1.0 + MY_EPSILON)
+					{
+						DEBUG_LOG(QString("SVM: Invalid probability (%1) at voxel %2")
+							.arg(probEstimates[l])
+							.arg(voxelIdx));
+					}
+					// DEBUG check end
+				}
+				// DEBUG check begin
+				if (probSum - 1.0 > MY_EPSILON)
+				{
+					DEBUG_LOG(QString("SVM: Probabilities at voxel %1 add up to %2 instead of 1!")
+						.arg(voxelIdx)
+						.arg(probSum));
+				}
+				// DEBUG check end
+			}
+			long long finished = ++finishedBatches;
+#ifdef _OPENMP
+			// progress might be connected to GUI elements, so only report it from the thread which called performWork:
+			if (omp_get_thread_num() == 0)
+#endif
+			{
+				progress()->emitProgress(static_cast<int>(100 * finished / batchCount));
 			}
-			// DEBUG check end
-		}
-		// DEBUG check begin
-		if (probSum - 1.0 > MY_EPSILON)
-		{
-			DEBUG_LOG(QString("SVM: Probabilities at %1, %2, %3 add up to %4 instead of 1!")
-				.arg(x)
-				.arg(y)
-				.arg(z)
-				.arg(probSum) );
 		}
-		// DEBUG check end
 	}
 	for (int l = 0; l < labelCount; ++l)
 	{
 		addOutput(probabilities[l]);
 	}
-	delete[] prob_estimates;
-	delete[] node;
+	svm_free_and_destroy_model(&model);
 	delete[] x_space;
 	delete[] problem.x;
 	delete[] problem.y;
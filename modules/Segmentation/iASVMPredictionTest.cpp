@@ -0,0 +1,232 @@
+/*************************************  open_iA  ************************************ *
+* **********   A tool for visual analysis and processing of 3D CT images   ********** *
+* *********************************************************************************** *
+* Copyright (C) 2016-2020  C. Heinzl, M. Reiter, A. Reh, W. Li, M. Arikan, Ar. &  Al. *
+*                          Amirkhanov, J. Weissenböck, B. Fröhler, M. Schiwarth       *
+* *********************************************************************************** *
+* This program is free software: you can redistribute it and/or modify it under the   *
+* terms of the GNU General Public License as published by the Free Software           *
+* Foundation, either version 3 of the License, or (at your option) any later version. *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful, but WITHOUT ANY     *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A     *
+* PARTICULAR PURPOSE.  See the GNU General Public License for more details.           *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License along with this   *
+* program.  If not, see http://www.gnu.org/licenses/                                  *
+* *********************************************************************************** *
+* Contact: FH OÖ Forschungs & Entwicklungs GmbH, Campus Wels, CT-Gruppe,              *
+*          Stelzhamerstraße 23, 4600 Wels / Austria, Email: c.heinzl@fh-wels.at       *
+* ************************************************************************************/
+#include "iASVMImageFilter.h"
+#include "svm.h"
+
+#include <iAConnector.h>
+#include <iAProgress.h>
+
+#include <vtkImageData.h>
+
+#include <QStringList>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Checks that the Probabilistic SVM filter, which predicts in parallel batches of voxels
+// (svm_batch_kernel_values + svm_predict_probability_kvalues), yields the same probabilities
+// as libsvm's serial svm_predict_probability, for all supported kernel types. The batched kernel
+// computation may be contracted differently by the compiler (e.g. to fused multiply-adds), so the
+// results are compared with a small relative tolerance instead of bit by bit.
+
+namespace
+{
+	const int ChannelCount = 3;
+	const int ClassCount = 4;
+	const int SeedsPerClass = 20;
+	const int ImageDim[3] = { 20, 17, 15 };  // voxel count deliberately not a multiple of the prediction batch size
+	const double Gamma = 0.3;
+	const int Degree = 3;
+	const double Coef0 = 0.1;
+	const double C = 1;
+	const double RelTolerance = 1e-9;
+	const double AbsTolerance = 1e-12;
+	//! seed for the random number generator used by libsvm for the cross validation in probability training
+	const unsigned int LibSVMRandSeed = 1;
+
+	void nullPrint(const char *)
+	{}
+
+	//! training seeds at the given voxel indices, with one cluster of values per class, with overlap so that
+	//! probabilities are non-trivial; the voxel values of all other voxels are uniformly distributed
+	std::vector<vtkSmartPointer<vtkImageData>> createChannels(std::vector<long long> const & seedVoxels, QString & seedString)
+	{
+		std::mt19937 rng(42);
+		std::normal_distribution<double> noise(0.0, 0.8);
+		std::uniform_real_distribution<double> uniform(-1.0, 5.0);
+		long long const voxelCount = static_cast<long long>(ImageDim[0]) * ImageDim[1] * ImageDim[2];
+		std::vector<vtkSmartPointer<vtkImageData>> channels(ChannelCount);
+		for (int c = 0; c < ChannelCount; ++c)
+		{
+			channels[c] = vtkSmartPointer<vtkImageData>::New();
+			channels[c]->SetDimensions(ImageDim[0], ImageDim[1], ImageDim[2]);
+			channels[c]->AllocateScalars(VTK_DOUBLE, 1);
+			auto data = static_cast<double*>(channels[c]->GetScalarPointer());
+			for (long long v = 0; v < voxelCount; ++v)
+			{
+				data[v] = uniform(rng);
+			}
+		}
+		QStringList seedLines;
+		for (size_t s = 0; s < seedVoxels.size(); ++s)
+		{
+			int label = static_cast<int>(s % ClassCount);
+			long long v = seedVoxels[s];
+			for (int c = 0; c < ChannelCount; ++c)
+			{
+				static_cast<double*>(channels[c]->GetScalarPointer())[v] = ((label >> (c % 2)) & 1) * 3.0 + c * 0.5 + noise(rng);
+			}
+			seedLines << QString("%1 %2 %3 %4")
+				.arg(v % ImageDim[0])
+				.arg((v / ImageDim[0]) % ImageDim[1])
+				.arg(v / (static_cast<long long>(ImageDim[0]) * ImageDim[1]))
+				.arg(label);
+		}
+		seedString = seedLines.join("\n");
+		return channels;
+	}
+
+	//! serial reference: train the model the same way as the filter does, and predict voxel by voxel
+	std::vector<double> predictSerially(int kernelType, std::vector<vtkSmartPointer<vtkImageData>> const & channels,
+		std::vector<long long> const & seedVoxels)
+	{
+		int const seedCount = static_cast<int>(seedVoxels.size());
+		std::vector<svm_node> xSpace(static_cast<size_t>(seedCount) * (ChannelCount + 1));
+		std::vector<svm_node*> x(seedCount);
+		std::vector<double> y(seedCount);
+		for (int s = 0; s < seedCount; ++s)
+		{
+			y[s] = s % ClassCount;
+			x[s] = &xSpace[static_cast<size_t>(s) * (ChannelCount + 1)];
+			for (int c = 0; c < ChannelCount; ++c)
+			{
+				x[s][c].index = c;
+				x[s][c].value = static_cast<double*>(channels[c]->GetScalarPointer())[seedVoxels[s]];
+			}
+			x[s][ChannelCount].index = -1;
+		}
+		svm_problem problem;
+		problem.l = seedCount;
+		problem.x = x.data();
+		problem.y = y.data();
+
+		// same parameters as in iASVMImageFilter::performWork:
+		svm_parameter param;
+		param.svm_type = C_SVC;
+		param.kernel_type = kernelType;
+		param.degree = Degree;
+		param.gamma = Gamma;
+		param.coef0 = Coef0;
+		param.C = C;
+		param.probability = 1;
+		param.nu = 0.5;
+		param.cache_size = 100;
+		param.eps = 1e-3;
+		param.p = 0.1;
+		param.shrinking = 0;
+		param.nr_weight = 0;
+		param.weight_label = nullptr;
+		param.weight = nullptr;
+		std::srand(LibSVMRandSeed);
+		svm_model* model = svm_train(&problem, &param);
+
+		long long const voxelCount = static_cast<long long>(ImageDim[0]) * ImageDim[1] * ImageDim[2];
+		std::vector<double> result(static_cast<size_t>(voxelCount) * ClassCount);
+		std::vector<svm_node> node(ChannelCount + 1);
+		node[ChannelCount].index = -1;
+		for (long long v = 0; v < voxelCount; ++v)
+		{
+			for (int c = 0; c < ChannelCount; ++c)
+			{
+				node[c].index = c;
+				node[c].value = static_cast<double*>(channels[c]->GetScalarPointer())[v];
+			}
+			svm_predict_probability(model, node.data(), result.data() + v * ClassCount);
+		}
+		svm_free_and_destroy_model(&model);
+		return result;
+	}
+
+	bool testKernel(int kernelType, QString const & kernelName)
+	{
+		long long const voxelCount = static_cast<long long>(ImageDim[0]) * ImageDim[1] * ImageDim[2];
+		int const seedCount = ClassCount * SeedsPerClass;
+		std::vector<long long> seedVoxels(seedCount);
+		for (int s = 0; s < seedCount; ++s)
+		{
+			seedVoxels[s] = s * (voxelCount / seedCount);
+		}
+		QString seedString;
+		auto channels = createChannels(seedVoxels, seedString);
+		auto serial = predictSerially(kernelType, channels, seedVoxels);
+
+		auto filter = iASVMImageFilter::create();
+		iAProgress progress;
+		filter->setProgress(&progress);
+		std::vector<iAConnector> cons(ChannelCount);
+		for (int c = 0; c < ChannelCount; ++c)
+		{
+			cons[c].setImage(channels[c]);
+			filter->addInput(&cons[c]);
+		}
+		QMap<QString, QVariant> parameters;
+		parameters["Kernel Type"] = kernelName;
+		parameters["Gamma"] = Gamma;
+		parameters["Dimension"] = Degree;
+		parameters["Coef0"] = Coef0;
+		parameters["C"] = C;
+		parameters["Seeds"] = seedString;
+		std::srand(LibSVMRandSeed);
+		if (!filter->run(parameters) || filter->output().size() != ClassCount)
+		{
+			std::cout << kernelName.toStdString() << ": Running filter failed!" << std::endl;
+			return false;
+		}
+
+		long long mismatches = 0;
+		for (int l = 0; l < ClassCount; ++l)
+		{
+			auto probabilities = static_cast<double*>(filter->output()[l]->vtkImage()->GetScalarPointer());
+			for (long long v = 0; v < voxelCount; ++v)
+			{
+				double expected = serial[v * ClassCount + l];
+				double actual = probabilities[v];
+				if (std::abs(expected - actual) > RelTolerance * std::max(std::abs(expected), std::abs(actual)) + AbsTolerance)
+				{
+					if (mismatches < 5)
+					{
+						std::cout << kernelName.toStdString() << ": probability " << l << " of voxel " << v
+							<< " differs: serial=" << expected << ", filter=" << actual << std::endl;
+					}
+					++mismatches;
+				}
+			}
+		}
+		std::cout << kernelName.toStdString() << ": " << (mismatches == 0 ? "PASSED" : "FAILED")
+			<< " (" << mismatches << " mismatching values)" << std::endl;
+		return mismatches == 0;
+	}
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+	svm_set_print_string_function(nullPrint);
+	bool result = testKernel(LINEAR, "Linear");
+	result = testKernel(POLY, "Polynomial") && result;
+	result = testKernel(RBF, "RBF") && result;
+	result = testKernel(SIGMOID, "Sigmoid") && result;
+	std::cout << "Overall: " << (result ? "PASSED" : "FAILED") << std::endl;
+	return result ? 0 : 1;
+}
@@ -2541,6 +2541,9 @@ double svm_get_svr_probability(const svm_model *model)
 	}
 }
 
+static double predict_values_from_kvalues(const svm_model *model, const double *kvalue, int kvalue_stride, double* dec_values);
+static double probability_from_dec_values(const svm_model *model, const double *dec_values, double *prob_estimates);
+
 double svm_predict_values(const svm_model *model, const svm_node *x, double* dec_values)
 {
 	int i;
@@ -2562,59 +2565,69 @@ double svm_predict_values(const svm_model *model, const svm_node *x, double* dec
 	}
 	else
 	{
-		int nr_class = model->nr_class;
 		int l = model->l;
 
 		double *kvalue = Malloc(double,l);
 		for(i=0;i<l;i++)
 			kvalue[i] = Kernel::k_function(x,model->SV[i],model->param);
 
-		int *start = Malloc(int,nr_class);
-		start[0] = 0;
-		for(i=1;i<nr_class;i++)
-			start[i] = start[i-1]+model->nSV[i-1];
+		double result = predict_values_from_kvalues(model, kvalue, 1, dec_values);
+		free(kvalue);
+		return result;
+	}
+}
 
-		int *vote = Malloc(int,nr_class);
-		for(i=0;i<nr_class;i++)
-			vote[i] = 0;
+// open_iA: split off from svm_predict_values, to be able to reuse it with kernel values computed in batches;
+// kvalue[i*kvalue_stride] is the kernel value for the i-th support vector
+static double predict_values_from_kvalues(const svm_model *model, const double *kvalue, int kvalue_stride, double* dec_values)
+{
+	int i;
+	int nr_class = model->nr_class;
 
-		int p=0;
-		for(i=0;i<nr_class;i++)
-			for(int j=i+1;j<nr_class;j++)
-			{
-				double sum = 0;
-				int si = start[i];
-				int sj = start[j];
-				int ci = model->nSV[i];
-				int cj = model->nSV[j];
+	int *start = Malloc(int,nr_class);
+	start[0] = 0;
+	for(i=1;i<nr_class;i++)
+		start[i] = start[i-1]+model->nSV[i-1];
 
-				int k;
-				double *coef1 = model->sv_coef[j-1];
-				double *coef2 = model->sv_coef[i];
-				for(k=0;k<ci;k++)
-					sum += coef1[si+k] * kvalue[si+k];
-				for(k=0;k<cj;k++)
-					sum += coef2[sj+k] * kvalue[sj+k];
-				sum -= model->rho[p];
-				dec_values[p] = sum;
+	int *vote = Malloc(int,nr_class);
+	for(i=0;i<nr_class;i++)
+		vote[i] = 0;
 
-				if(dec_values[p] > 0)
-					++vote[i];
-				else
-					++vote[j];
-				p++;
-			}
+	int p=0;
+	for(i=0;i<nr_class;i++)
+		for(int j=i+1;j<nr_class;j++)
+		{
+			double sum = 0;
+			int si = start[i];
+			int sj = start[j];
+			int ci = model->nSV[i];
+			int cj = model->nSV[j];
 
-		int vote_max_idx = 0;
-		for(i=1;i<nr_class;i++)
-			if(vote[i] > vote[vote_max_idx])
-				vote_max_idx = i;
+			int k;
+			double *coef1 = model->sv_coef[j-1];
+			double *coef2 = model->sv_coef[i];
+			for(k=0;k<ci;k++)
+				sum += coef1[si+k] * kvalue[(si+k)*kvalue_stride];
+			for(k=0;k<cj;k++)
+				sum += coef2[sj+k] * kvalue[(sj+k)*kvalue_stride];
+			sum -= model->rho[p];
+			dec_values[p] = sum;
+
+			if(dec_values[p] > 0)
+				++vote[i];
+			else
+				++vote[j];
+			p++;
+		}
 
-		free(kvalue);
-		free(start);
-		free(vote);
-		return model->label[vote_max_idx];
-	}
+	int vote_max_idx = 0;
+	for(i=1;i<nr_class;i++)
+		if(vote[i] > vote[vote_max_idx])
+			vote_max_idx = i;
+
+	free(start);
+	free(vote);
+	return model->label[vote_max_idx];
 }
 
 double svm_predict(const svm_model *model, const svm_node *x)
@@ -2638,43 +2651,121 @@ double svm_predict_probability(
 	if ((model->param.svm_type == C_SVC || model->param.svm_type == NU_SVC) &&
 	    model->probA!=nullptr && model->probB!=nullptr)
 	{
-		int i;
 		int nr_class = model->nr_class;
 		double *dec_values = Malloc(double, nr_class*(nr_class-1)/2);
 		svm_predict_values(model, x, dec_values);
+		double result = probability_from_dec_values(model, dec_values, prob_estimates);
+		free(dec_values);
+		return result;
+	}
+	else
+		return svm_predict(model, x);
+}
 
-		double min_prob=1e-7;
-		double **pairwise_prob=Malloc(double *,nr_class);
-		for(i=0;i<nr_class;i++)
-			pairwise_prob[i]=Malloc(double,nr_class);
-		int k=0;
-		for(i=0;i<nr_class;i++)
-			for(int j=i+1;j<nr_class;j++)
+// open_iA: split off from svm_predict_probability, to be able to reuse it with kernel values computed in batches
+static double probability_from_dec_values(const svm_model *model, const double *dec_values, double *prob_estimates)
+{
+	int i;
+	int nr_class = model->nr_class;
+	double min_prob=1e-7;
+	double **pairwise_prob=Malloc(double *,nr_class);
+	for(i=0;i<nr_class;i++)
+		pairwise_prob[i]=Malloc(double,nr_class);
+	int k=0;
+	for(i=0;i<nr_class;i++)
+		for(int j=i+1;j<nr_class;j++)
+		{
+			pairwise_prob[i][j]=min(max(sigmoid_predict(dec_values[k],model->probA[k],model->probB[k]),min_prob),1-min_prob);
+			pairwise_prob[j][i]=1-pairwise_prob[i][j];
+			k++;
+		}
+	if (nr_class == 2)
+	{
+		prob_estimates[0] = pairwise_prob[0][1];
+		prob_estimates[1] = pairwise_prob[1][0];
+	}
+	else
+		multiclass_probability(nr_class,pairwise_prob,prob_estimates);
+
+	int prob_max_idx = 0;
+	for(i=1;i<nr_class;i++)
+		if(prob_estimates[i] > prob_estimates[prob_max_idx])
+			prob_max_idx = i;
+	for(i=0;i<nr_class;i++)
+		free(pairwise_prob[i]);
+	free(pairwise_prob);
+	return model->label[prob_max_idx];
+}
+
+void svm_batch_kernel_values(const svm_model *model, const double *x, int count, int dim, double *kvalue)
+{
+	const svm_parameter & param = model->param;
+	double *sv = Malloc(double, dim);
+	for (int s = 0; s < model->l; ++s)
+	{
+		// dense copy of the support vector (indices missing in the sparse representation are 0):
+		for (int c = 0; c < dim; ++c)
+			sv[c] = 0;
+		for (const svm_node *node = model->SV[s]; node->index != -1; ++node)
+			if (node->index >= 0 && node->index < dim)
+				sv[node->index] = node->value;
+		double *k = kvalue + static_cast<size_t>(s) * count;
+		for (int v = 0; v < count; ++v)
+			k[v] = 0;
+		// the inner loops run over the input vectors and can thus be vectorized;
+		// per input vector, the summation order is the same as in Kernel::k_function:
+		if (param.kernel_type == RBF)
+		{
+			for (int c = 0; c < dim; ++c)
 			{
-				pairwise_prob[i][j]=min(max(sigmoid_predict(dec_values[k],model->probA[k],model->probB[k]),min_prob),1-min_prob);
-				pairwise_prob[j][i]=1-pairwise_prob[i][j];
-				k++;
+				const double *xc = x + static_cast<size_t>(c) * count;
+				const double svc = sv[c];
+				for (int v = 0; v < count; ++v)
+				{
+					double d = xc[v] - svc;
+					k[v] += d * d;
+				}
 			}
-		if (nr_class == 2)
-		{
-			prob_estimates[0] = pairwise_prob[0][1];
-			prob_estimates[1] = pairwise_prob[1][0];
+			for (int v = 0; v < count; ++v)
+				k[v] = exp(-param.gamma*k[v]);
 		}
 		else
-			multiclass_probability(nr_class,pairwise_prob,prob_estimates);
-
-		int prob_max_idx = 0;
-		for(i=1;i<nr_class;i++)
-			if(prob_estimates[i] > prob_estimates[prob_max_idx])
-				prob_max_idx = i;
-		for(i=0;i<nr_class;i++)
-			free(pairwise_prob[i]);
-		free(dec_values);
-		free(pairwise_prob);
-		return model->label[prob_max_idx];
+		{
+			for (int c = 0; c < dim; ++c)
+			{
+				const double *xc = x + static_cast<size_t>(c) * count;
+				const double svc = sv[c];
+				for (int v = 0; v < count; ++v)
+					k[v] += xc[v] * svc;
+			}
+			switch (param.kernel_type)
+			{
+				case POLY:
+					for (int v = 0; v < count; ++v)
+						k[v] = powi(param.gamma*k[v]+param.coef0,param.degree);
+					break;
+				case SIGMOID:
+					for (int v = 0; v < count; ++v)
+						k[v] = tanh(param.gamma*k[v]+param.coef0);
+					break;
+				default:  // LINEAR: dot product is the kernel value
+					break;
+			}
+		}
 	}
-	else
-		return svm_predict(model, x);
+	free(sv);
+}
+
+double svm_predict_probability_kvalues(const svm_model *model, const double *kvalue, int kvalue_stride, double *prob_estimates)
+{
+	int nr_class = model->nr_class;
+	double *dec_values = Malloc(double, nr_class*(nr_class-1)/2);
+	double result = predict_values_from_kvalues(model, kvalue, kvalue_stride, dec_values);
+	if ((model->param.svm_type == C_SVC || model->param.svm_type == NU_SVC) &&
+	    model->probA!=nullptr && model->probB!=nullptr)
+		result = probability_from_dec_values(model, dec_values, prob_estimates);
+	free(dec_values);
+	return result;
 }
 
 static const char *svm_type_table[] =
@@ -122,6 +122,12 @@ double svm_get_svr_probability(const struct svm_model *model);
 double svm_predict_values(const struct svm_model *model, const struct svm_node *x, double* dec_values);
 double svm_predict(const struct svm_model *model, const struct svm_node *x);
 double svm_predict_probability(const struct svm_model *model, const struct svm_node *x, double* prob_estimates);
+// open_iA additions for batched prediction of dense input vectors (only for C_SVC and NU_SVC models, and non-precomputed kernels):
+// computes the kernel values between all support vectors and count input vectors of dimension dim;
+// x holds the input vectors channel-wise (x[c*count+v]), kvalue receives model->l * count values (kvalue[s*count+v])
+void svm_batch_kernel_values(const struct svm_model *model, const double *x, int count, int dim, double *kvalue);
+// like svm_predict_probability, but from kernel values (kvalue[s*kvalue_stride] for support vector s)
+double svm_predict_probability_kvalues(const struct svm_model *model, const double *kvalue, int kvalue_stride, double *prob_estimates);
 
 void svm_free_model_content(struct svm_model *model_ptr);
 void svm_free_and_destroy_model(struct svm_model **model_ptr_ptr);
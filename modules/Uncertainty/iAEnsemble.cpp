@@ -31,15 +31,15 @@
 #include <iAModalityList.h>
 #include <iAToolsITK.h>
 
-#include <itkConstNeighborhoodIterator.h>
-
 #include <vtkImageData.h>
 
 #include <QDir>
 #include <QFileInfo>
 #include <QTextStream>
 
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 
 iAUncertaintyImages::~iAUncertaintyImages()
@@ -124,29 +124,26 @@ namespace
 		double limit = std::log(distribution.size());  // max entropy: - N* (1/N * log(1/N)) = log(N)
 		double normalizeFactor = normalize ? 1.0 / limit : 1.0;
 		auto result = createImage<DoubleImage>(size, spacing);
-		assert(size[0] < static_cast<itk::SizeValueType>(std::numeric_limits<itk::IndexValueType>::max()) &&
-		       size[1] < static_cast<itk::SizeValueType>(std::numeric_limits<itk::IndexValueType>::max()) &&
-		       size[2] < static_cast<itk::SizeValueType>(std::numeric_limits<itk::IndexValueType>::max()));
-		itk::Index<3> idx; // optimize speed via iterators / direct access?
-		for (idx[0] = 0; static_cast<itk::SizeValueType>(idx[0]) < size[0]; ++idx[0])
+		QVector<typename TImage::PixelType const *> distrBuffers;
+		for (int l = 0; l < distribution.size(); ++l)
+		{
+			distrBuffers.push_back(distribution[l]->GetBufferPointer());
+		}
+		double * out = result->GetBufferPointer();
+		long long voxelCount = static_cast<long long>(size[0]) * size[1] * size[2];
+#pragma omp parallel for
+		for (long long v = 0; v < voxelCount; ++v)
 		{
-			for (idx[1] = 0; static_cast<itk::SizeValueType>(idx[1]) < size[1]; ++idx[1])
+			double entropy = 0;
+			for (int l = 0; l < distrBuffers.size(); ++l)
 			{
-				for (idx[2] = 0; static_cast<itk::SizeValueType>(idx[2]) < size[2]; ++idx[2])
+				double prob = distrBuffers[l][v] * probFactor;
+				if (prob > 0) // to avoid infinity - we take 0, which is appropriate according to limit of 0 times infinity
 				{
-					double entropy = 0;
-					for (int l = 0; l < distribution.size(); ++l)
-					{
-						double prob = distribution[l]->GetPixel(idx) * probFactor;
-						if (prob > 0) // to avoid infinity - we take 0, which is appropriate according to limit of 0 times infinity
-						{
-							entropy += (prob * std::log(prob));
-						}
-					}
-					entropy = clamp(0.0, limit, -entropy * normalizeFactor);
-					result->SetPixel(idx, entropy);
+					entropy += (prob * std::log(prob));
 				}
 			}
+			out[v] = clamp(0.0, limit, -entropy * normalizeFactor);
 		}
 		return result;
 	}
@@ -331,66 +328,93 @@ namespace
 	}
 }
 
-DoubleImage::Pointer NeighbourhoodEntropyImage(IntImage::Pointer intImage, int labelCount, size_t patchSize, itk::Size<3> size, itk::Vector<double, 3> spacing)
+namespace
 {
-	DoubleImage::Pointer result = createImage<DoubleImage>(size, spacing);
-	int neighbourhoodSize = std::pow(patchSize * 2 + 1, 3);
-	int * labelHistogram = new int[neighbourhoodSize];
-	double probFactor = 1.0 / neighbourhoodSize;
-	double limit = std::log(labelCount);  // max entropy: - N* (1/N * log(1/N)) = log(N)
-	double normalizeFactor = 1.0 / limit;
-	bool IsInBounds;
-	itk::Size<3> patch3Dsize = { patchSize, patchSize, patchSize };
-	itk::ConstNeighborhoodIterator<IntImage> it(patch3Dsize, intImage, intImage->GetLargestPossibleRegion());
-	itk::ImageRegionIterator<DoubleImage> outIt(result, result->GetLargestPossibleRegion());
-	it.GoToBegin();
-	outIt.GoToBegin();
-	while (!it.IsAtEnd() && !outIt.IsAtEnd())
+	//! Adds (direction = 1) or removes (direction = -1) the labels in the given yz-plane at position x
+	//! to/from the histogram, keeping the sum over c * log(c) of all label counts c up to date.
+	inline void UpdateHistogramPlane(int const * labels, long long x, long long width, long long sliceSize,
+		long long y0, long long y1, long long z0, long long z1, int direction,
+		int * histogram, std::vector<double> const & cLogC, double & cLogCSum)
 	{
-		std::fill(labelHistogram, labelHistogram + labelCount, 0);
-		int valueCount = 0;
-		for (int i = 0; i < neighbourhoodSize; ++i)
+		for (long long z = z0; z <= z1; ++z)
 		{
-			int value = it.GetPixel(i, IsInBounds);
-			if (IsInBounds)
+			int const * row = labels + z * sliceSize + y0 * width + x;
+			for (long long y = y0; y <= y1; ++y, row += width)
 			{
-				labelHistogram[value]++;
-				valueCount++;
+				int & count = histogram[*row];
+				cLogCSum -= cLogC[count];
+				count += direction;
+				cLogCSum += cLogC[count];
 			}
 		}
+	}
+}
 
-		double entropy = 0;
-		if (valueCount == neighbourhoodSize)
+DoubleImage::Pointer NeighbourhoodEntropyImage(IntImage::Pointer intImage, int labelCount, size_t patchSize, itk::Size<3> size, itk::Vector<double, 3> spacing)
+{
+	// The label histogram of the (2*patchSize+1)^3 neighbourhood is built once per image row;
+	// moving along x, it is updated by adding the yz-plane entering the neighbourhood and removing
+	// the one leaving it. The entropy is derived from the sum of c*log(c) over all label counts c
+	// (H = log(n) - sum(c*log(c))/n for n values), which is updated along with the histogram.
+	DoubleImage::Pointer result = createImage<DoubleImage>(size, spacing);
+	long long const width = size[0], height = size[1], depth = size[2];
+	long long const sliceSize = width * height;
+	long long const p = static_cast<long long>(patchSize);
+	int neighbourhoodSize = std::pow(patchSize * 2 + 1, 3);
+	std::vector<double> cLogC(neighbourhoodSize + 1, 0.0);
+	for (int c = 1; c <= neighbourhoodSize; ++c)
+	{
+		cLogC[c] = c * std::log(c);
+	}
+	double limit = std::log(labelCount);  // max entropy: - N* (1/N * log(1/N)) = log(N)
+	double normalizeFactor = 1.0 / limit;
+	int const * labels = intImage->GetBufferPointer();
+	double * out = result->GetBufferPointer();
+#pragma omp parallel
+	{
+		std::vector<int> labelHistogram(labelCount);
+#pragma omp for schedule(dynamic)
+		for (long long z = 0; z < depth; ++z)
 		{
-			for (int l = 0; l < labelCount; ++l)
+			long long z0 = std::max(0LL, z - p), z1 = std::min(depth - 1, z + p);
+			for (long long y = 0; y < height; ++y)
 			{
-				double prob = labelHistogram[l] * probFactor;
-				if (prob > 0) // to avoid infinity - we take 0, which is appropriate according to limit of 0 times infinity
+				long long y0 = std::max(0LL, y - p), y1 = std::min(height - 1, y + p);
+				long long planeCount = (z1 - z0 + 1) * (y1 - y0 + 1);
+				std::fill(labelHistogram.begin(), labelHistogram.end(), 0);
+				double cLogCSum = 0;
+				for (long long x = 0; x < std::min(width, p); ++x)
 				{
-					entropy += (prob * std::log(prob));
+					UpdateHistogramPlane(labels, x, width, sliceSize, y0, y1, z0, z1, 1, labelHistogram.data(), cLogC, cLogCSum);
 				}
-			}
-			entropy = clamp(0.0, limit, -entropy * normalizeFactor);
-		}
-		else // if on boundary
-		{
-			for (int l = 0; l < labelCount; ++l)
-			{
-				double prob = static_cast<double>(labelHistogram[l]) / valueCount;
-				if (prob > 0) // to avoid infinity - we take 0, which is appropriate according to limit of 0 times infinity
+				double * outRow = out + z * sliceSize + y * width;
+				for (long long x = 0; x < width; ++x)
 				{
-					entropy += (prob * std::log(prob));
+					if (x + p < width)
+					{
+						UpdateHistogramPlane(labels, x + p, width, sliceSize, y0, y1, z0, z1, 1, labelHistogram.data(), cLogC, cLogCSum);
+					}
+					if (x - p - 1 >= 0)
+					{
+						UpdateHistogramPlane(labels, x - p - 1, width, sliceSize, y0, y1, z0, z1, -1, labelHistogram.data(), cLogC, cLogCSum);
+					}
+					long long valueCount = (std::min(width - 1, x + p) - std::max(0LL, x - p) + 1) * planeCount;
+					double entropy = std::log(static_cast<double>(valueCount)) - cLogCSum / valueCount;
+					if (valueCount == neighbourhoodSize)
+					{
+						entropy = clamp(0.0, limit, entropy * normalizeFactor);
+					}
+					else // if on boundary
+					{
+						double localLimit = std::log(valueCount);  // max entropy: - N* (1/N * log(1/N)) = log(N)
+						double localNormalizeFactor = 1.0 / localLimit;
+						entropy = clamp(0.0, localLimit, entropy * localNormalizeFactor);
+					}
+					outRow[x] = entropy;
 				}
 			}
-			double localLimit = std::log(valueCount);  // max entropy: - N* (1/N * log(1/N)) = log(N)
-			double localNormalizeFactor = 1.0 / localLimit;
-			entropy = clamp(0.0, localLimit, -entropy * localNormalizeFactor);
 		}
-		outIt.Set(entropy);
-		++it;
-		++outIt;
 	}
-	delete[] labelHistogram;
 	return result;
 }
 
@@ -415,7 +439,6 @@ void iAEnsemble::CreateUncertaintyImages()
 			DEBUG_LOG("No samplings or no members found!");
 			return;
 		}
-		itk::Index<3> idx;
 		itk::Size<3> size;               size   .Fill(0);
 		itk::Vector<double, 3> spacing;  spacing.Fill(1);
 
@@ -454,17 +477,17 @@ void iAEnsemble::CreateUncertaintyImages()
 					assert(size[0] < static_cast<itk::SizeValueType>(std::numeric_limits<itk::IndexValueType>::max()) &&
 					       size[1] < static_cast<itk::SizeValueType>(std::numeric_limits<itk::IndexValueType>::max()) &&
 					       size[2] < static_cast<itk::SizeValueType>(std::numeric_limits<itk::IndexValueType>::max()));
-					for (idx[0] = 0; static_cast<itk::SizeValueType>(idx[0]) < size[0]; ++idx[0])
+					QVector<int*> distrBuffers;
+					for (int l = 0; l < m_labelCount; ++l)
 					{
-						for (idx[1] = 0; static_cast<itk::SizeValueType>(idx[1]) < size[1]; ++idx[1])
-						{
-							for (idx[2] = 0; static_cast<itk::SizeValueType>(idx[2]) < size[2]; ++idx[2])
-							{
-								int label = intlabelImg->GetPixel(idx);
-								// optimize speed via iterators / direct access?
-								m_labelDistr[label]->SetPixel(idx, m_labelDistr[label]->GetPixel(idx) + 1);
-							}
-						}
+						distrBuffers.push_back(m_labelDistr[l]->GetBufferPointer());
+					}
+					int const * labels = intlabelImg->GetBufferPointer();
+					long long voxelCount = static_cast<long long>(size[0]) * size[1] * size[2];
+#pragma omp parallel for
+					for (long long v = 0; v < voxelCount; ++v)
+					{
+						++distrBuffers[labels[v]][v];
 					}
 				}
 			}
@@ -183,6 +183,7 @@ void dlg_XRF::init(double minEnergy, double maxEnergy, bool haveEnergyLevels,
 	m_cTF->AddRGBPoint ( maxEnergy, 0.0, 0.0, 0.0 );
 	m_cTF->Build();
 	m_xrfData->SetEnergyRange(minEnergy, maxEnergy);
+	m_xrfData->BuildSpectra();
 	m_accumulatedXRF = QSharedPointer<iAAccumulatedXRFData>(new iAAccumulatedXRFData(m_xrfData, minEnergy, maxEnergy));
 	m_voxelEnergy = QSharedPointer<iAEnergySpectrumDiagramData>(new iAEnergySpectrumDiagramData(m_xrfData.data(), m_accumulatedXRF.data()));
 	m_voxelSpectrumDrawer = QSharedPointer<iAStepFunctionPlot>(new iAStepFunctionPlot(m_voxelEnergy, QColor(150, 0, 0)));
@@ -331,6 +332,11 @@ QSharedPointer<iAXRFData> dlg_XRF::GetXRFData()
 	return m_xrfData;
 }
 
+void dlg_XRF::SetXRFFileName(QString const & fileName)
+{
+	m_xrfFileName = fileName;
+}
+
 void dlg_XRF::updateComposition(QVector<double> const & concentration)
 {
 	if (m_refSpectraLib->spectra.size() == 0) // can't do anything without refspectra!
@@ -635,7 +641,8 @@ void dlg_XRF::decomposeElements()
 	if (m_decompositionCalculator)
 	{
 		m_decompositionCalculator->Stop();
-		(dynamic_cast<MdiChild*>(parent()))->addMsg(tr("Decomposition was aborted by user."));
+		(dynamic_cast<MdiChild*>(parent()))->addMsg(tr("Decomposition was aborted by user; "
+			"calculating it again with the same elements resumes from the last completed slice."));
 		return;
 	}
 	m_elementConcentrations = QSharedPointer<iAElementConcentrations>(new iAElementConcentrations());
@@ -658,6 +665,9 @@ void dlg_XRF::decomposeElements()
 		(dynamic_cast<MdiChild*>(parent()))->addMsg(tr("You have to select at least one element from the reference spectra list!"));
 		return;
 	}
+	MdiChild* mdiChild = dynamic_cast<MdiChild*>(parent());
+	m_decompositionCalculator->SetCheckpointFile(QDir(mdiChild->filePath()).filePath(
+		mdiChild->fileInfo().completeBaseName() + "_xrfdecomposition.checkpoint"), m_xrfFileName);
 	pb_decompose->setText("Stop");
 	connect(m_decompositionCalculator.data(), SIGNAL( success() ), this, SLOT (decompositionSuccess()) );
 	connect(m_decompositionCalculator.data(), SIGNAL( finished() ), this, SLOT (decompositionFinished()) );
@@ -80,6 +80,8 @@ public:
 	vtkSmartPointer<vtkColorTransferFunction> GetColorTransferFunction();
 	QThread* UpdateForVisualization();
 	QSharedPointer<iAXRFData> GetXRFData();
+	//! Set the name of the file the XRF data is loaded from (used to identify it in decomposition checkpoints).
+	void SetXRFFileName(QString const & fileName);
 	QSharedPointer<iAElementConcentrations> GetElementConcentrations();
 
 	void UpdateVoxelSpectrum(int x, int y, int z);
@@ -179,6 +181,7 @@ private:
 	vtkSmartPointer<vtkPiecewiseFunction>          m_oTF;
 	vtkSmartPointer<vtkColorTransferFunction>      m_cTF;
 	QSharedPointer<iAXRFData>                      m_xrfData;
+	QString                                        m_xrfFileName;
 	QSharedPointer<iAEnergySpectrumDiagramData>    m_voxelEnergy;
 	QSharedPointer<iAAccumulatedXRFData>           m_accumulatedXRF;
 	QMap<int, QSharedPointer<iAStepFunctionPlot> > m_refSpectraDrawers;
@@ -112,14 +112,14 @@ void iAAccumulatedXRFData::retrieveHistData( long numBin_in, DataType * &data_ou
 
 namespace
 {
-	iASpectrumFunction * createSpectrumFunction(QSharedPointer<iAXRFData const> xrfData, int x, int y, int z)
+	template <typename T>
+	void copySpectrumValues(void* dataVoidPtr, size_t count, unsigned int * values)
 	{
-		iASpectrumFunction *result = new iASpectrumFunction();
-		for (size_t i=0; i<xrfData->size(); ++i)
+		T* data = static_cast<T*>(dataVoidPtr);
+		for (size_t i = 0; i < count; ++i)
 		{
-			result->insert(std::make_pair(i, static_cast<unsigned int>(xrfData->image(i)->GetScalarComponentAsFloat(x, y, z, 0))));
+			values[i] = static_cast<unsigned int>(data[i]);
 		}
-		return result;
 	}
 
 	template <typename T>
@@ -201,41 +201,19 @@ void iAAccumulatedXRFData::calculateStatistics()
 	}
 }
 
-void iAAccumulatedXRFData::createSpectrumFunctions()
-{
-	vtkSmartPointer<vtkImageData> img = m_xrfData->image(0);
-	int extent[6];
-	img->GetExtent(extent);
-	for (int x = extent[0]; x <= extent[1]; ++x)
-	{
-		for (int y = extent[2]; y <= extent[3]; ++y)
-		{
-			for (int z = extent[4]; z <= extent[5]; ++z)
-			{
-				iASpectrumFunction *wrap = createSpectrumFunction(m_xrfData, x, y, z);
-				m_spectrumFunctions.push_back(wrap);
-			}
-		}
-	}
-	//size_t numSpectra = (extent[1] - extent[0] + 1) * (extent[3] - extent[2] + 1) * (extent[5] - extent[4] + 1);
-}
-
-std::vector<iAFunction<size_t, unsigned int> *> const & iAAccumulatedXRFData::spectrumFunctions()
-{
-	if (m_spectrumFunctions.size() == 0)
-	{
-		createSpectrumFunctions();
-	}
-	return m_spectrumFunctions;
-}
-
 void iAAccumulatedXRFData::calculateFunctionBoxplots()
 {
 	assert(!m_functionalBoxplotData);
-	iAModifiedDepthMeasure<size_t, unsigned int> measure;
-	std::vector<iAFunction<size_t, unsigned int> *> functions = spectrumFunctions();
-	m_functionalBoxplotData = new iAFunctionalBoxplot<size_t, unsigned int>(
-		functions, &measure, 2);
+	// one function per pixel, its argument is the energy level:
+	size_t spectrumCount = m_xrfData->image(0)->GetNumberOfPoints();
+	iASampledFunctions<size_t, unsigned int> functions(0, 1, m_xrfData->size(), spectrumCount);
+	for (size_t i = 0; i < m_xrfData->size(); ++i)
+	{
+		vtkSmartPointer<vtkImageData> img = m_xrfData->image(i);
+		assert(img->GetNumberOfScalarComponents() == 1 && static_cast<size_t>(img->GetNumberOfPoints()) == spectrumCount);
+		VTK_TYPED_CALL(copySpectrumValues, img->GetScalarType(), img->GetScalarPointer(), spectrumCount, functions.valuesAt(i));
+	}
+	m_functionalBoxplotData = new iAFunctionalBoxplot<size_t, unsigned int>(functions);
 }
 
 FunctionalBoxPlot* iAAccumulatedXRFData::functionalBoxPlot()
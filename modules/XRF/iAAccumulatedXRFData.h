@@ -64,8 +64,6 @@ private:
 	iAAccumulatedXRFData operator=(iAAccumulatedXRFData const & other);
 	void calculateStatistics();
 	void calculateFunctionBoxplots();
-	void createSpectrumFunctions();
-	std::vector<iAFunction<size_t, unsigned int> *> const & spectrumFunctions();
 
 	QSharedPointer<iAXRFData> m_xrfData;
 	CountType* m_minimum;
@@ -75,6 +73,5 @@ private:
 	double m_xBounds[2];
 	DataType m_yBounds[2];
 	FunctionalBoxPlot* m_functionalBoxplotData;
-	std::vector<iAFunction<size_t, unsigned int> *> m_spectrumFunctions;
 	QSharedPointer<iASpectraHistograms>	m_spectraHistograms;
 };
@@ -23,10 +23,161 @@
 #include "iAAccumulatedXRFData.h"
 #include "iAElementConcentrations.h"
 #include "iAElementalDecomposition.h"
+#include "iAElementSpectralInfo.h"
 #include "iAXRFData.h"
 
+#include <iAConsole.h>
+
 #include <vtkImageData.h>
 
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+#include <algorithm>
+
+namespace
+{
+	QString CheckpointFileIdentifier("XRFDecompositionCheckpoint");
+	quint32 CheckpointFileVersion(2);
+	QDataStream::Version CheckpointQtDataStreamVersion(QDataStream::Qt_5_6);
+
+	//! Computes a hash identifying the input of the decomposition: the adapted element spectra
+	//! (which depend on the reference spectra and the energy calibration), as well as
+	//! size and last modification time of the dataset file.
+	QByteArray decompositionInputHash(QVector<QSharedPointer<iAEnergySpectrum> > const & spectra, QString const & datasetFileName)
+	{
+		QCryptographicHash hash(QCryptographicHash::Sha1);
+		for (auto spectrum : spectra)
+		{
+			hash.addData(reinterpret_cast<char const*>(spectrum->constData()), spectrum->size() * static_cast<int>(sizeof(CountType)));
+		}
+		QFileInfo datasetInfo(datasetFileName);
+		QByteArray datasetId;
+		QDataStream datasetIdStream(&datasetId, QIODevice::WriteOnly);
+		datasetIdStream << datasetInfo.absoluteFilePath() << datasetInfo.size() << datasetInfo.lastModified().toMSecsSinceEpoch();
+		hash.addData(datasetId);
+		return hash.result();
+	}
+
+	//! Reads the slices completed in a previous, aborted run from the checkpoint file into the concentration images.
+	//! @param validSize receives the size of the checkpoint file up to the end of the last completed slice
+	//! @return the number of completed slices; 0 if the file does not exist or belongs to another decomposition
+	int readCheckpoint(QFile & file, quint32 channelCount, int const extent[6], QStringList const & elementNames,
+		qint32 threshold, QByteArray const & inputHash, std::vector<float*> const & concentrations, qint64 & validSize)
+	{
+		if (!file.exists())
+		{
+			return 0;
+		}
+		if (!file.open(QFile::ReadOnly))
+		{
+			DEBUG_LOG(QString("Couldn't open file %1 for reading!").arg(file.fileName()));
+			return 0;
+		}
+		QDataStream in(&file);
+		in.setVersion(CheckpointQtDataStreamVersion);
+		QString identifier;
+		quint32 version, fileChannelCount;
+		qint32 fileExtent[6], fileThreshold;
+		QStringList fileElementNames;
+		QByteArray fileInputHash;
+		in >> identifier >> version;
+		if (identifier != CheckpointFileIdentifier || version != CheckpointFileVersion)
+		{
+			DEBUG_LOG(QString("Decomposition checkpoint file '%1': Unknown file format or version; it will be overwritten.")
+				.arg(file.fileName()));
+			return 0;
+		}
+		in >> fileChannelCount;
+		for (int i = 0; i < 6; ++i)
+		{
+			in >> fileExtent[i];
+		}
+		in >> fileElementNames >> fileThreshold >> fileInputHash;
+		if (in.status() != QDataStream::Ok || fileChannelCount != channelCount || !std::equal(extent, extent + 6, fileExtent) ||
+			fileElementNames != elementNames || fileThreshold != threshold || fileInputHash != inputHash)
+		{
+			DEBUG_LOG(QString("Decomposition checkpoint file '%1' belongs to a different dataset or element selection; it will be overwritten.")
+				.arg(file.fileName()));
+			return 0;
+		}
+		size_t sliceSize = static_cast<size_t>(extent[1] - extent[0] + 1) * (extent[3] - extent[2] + 1);
+		int const sliceBytes = static_cast<int>(sliceSize * sizeof(float));
+		int const sliceCount = extent[5] - extent[4] + 1;
+		int completed = 0;
+		validSize = file.pos();
+		while (completed < sliceCount && !in.atEnd())
+		{
+			qint32 z;
+			in >> z;
+			if (in.status() != QDataStream::Ok || z != extent[4] + completed)
+			{
+				break;
+			}
+			bool complete = true;
+			for (size_t e = 0; e < concentrations.size() && complete; ++e)
+			{
+				complete = in.readRawData(reinterpret_cast<char*>(concentrations[e] + completed * sliceSize), sliceBytes) == sliceBytes;
+			}
+			if (!complete)
+			{
+				break;
+			}
+			++completed;
+			validSize = file.pos();
+		}
+		return completed;
+	}
+
+	//! Opens the checkpoint file for appending completed slices; if no slices were read from it
+	//! (completedSlices == 0), it is (re-)created with the header identifying the decomposition.
+	bool openCheckpoint(QFile & file, int completedSlices, qint64 validSize, quint32 channelCount, int const extent[6],
+		QStringList const & elementNames, qint32 threshold, QByteArray const & inputHash)
+	{
+		if (completedSlices > 0)
+		{
+			// discard a partially written slice:
+			if (!file.resize(validSize) || !file.open(QFile::WriteOnly | QFile::Append))
+			{
+				DEBUG_LOG(QString("Couldn't open file %1 for writing!").arg(file.fileName()));
+				return false;
+			}
+			return true;
+		}
+		if (!file.open(QFile::WriteOnly))
+		{
+			DEBUG_LOG(QString("Couldn't open file %1 for writing!").arg(file.fileName()));
+			return false;
+		}
+		QDataStream out(&file);
+		out.setVersion(CheckpointQtDataStreamVersion);
+		out << CheckpointFileIdentifier << CheckpointFileVersion << channelCount;
+		for (int i = 0; i < 6; ++i)
+		{
+			out << static_cast<qint32>(extent[i]);
+		}
+		out << elementNames << threshold << inputHash;
+		file.flush();
+		return true;
+	}
+
+	void writeCheckpointSlice(QFile & file, int z, size_t sliceOffset, size_t sliceSize, std::vector<float*> const & concentrations)
+	{
+		QDataStream out(&file);
+		out.setVersion(CheckpointQtDataStreamVersion);
+		out << static_cast<qint32>(z);
+		for (size_t e = 0; e < concentrations.size(); ++e)
+		{
+			out.writeRawData(reinterpret_cast<char const*>(concentrations[e] + sliceOffset), static_cast<int>(sliceSize * sizeof(float)));
+		}
+		file.flush();
+	}
+}
+
 iADecompositionCalculator::iADecompositionCalculator(
 	QSharedPointer<iAElementConcentrations> data,
 	QSharedPointer<iAXRFData const> xrfData,
@@ -38,6 +189,12 @@ iADecompositionCalculator::iADecompositionCalculator(
 	m_stopped(false)
 {}
 
+void iADecompositionCalculator::SetCheckpointFile(QString const & fileName, QString const & datasetFileName)
+{
+	m_checkpointFileName = fileName;
+	m_datasetFileName = datasetFileName;
+}
+
 void iADecompositionCalculator::AddElement(iAElementSpectralInfo* element)
 {
 	m_elements.push_back(element);
@@ -79,36 +236,72 @@ void iADecompositionCalculator::run()
 
 	m_data->initImages(m_elements.size(), extent, spacing, origin);
 
-	iAElementConcentrations::VoxelConcentrationType concentration;
-	concentration.reserve(m_elements.size());
-	int width = extent[1]-extent[0]+1;
-	int height = extent[3]-extent[2]+1;
-	int depth = extent[5]-extent[4]+1;
-	int pixelCount = width * height * depth;
-	for (int x=extent[0]; x<=extent[1] && !m_stopped; ++x)
+	int const elementCount = m_elements.size();
+	int const channelCount = static_cast<int>(m_xrfData->size());
+	int const width = extent[1]-extent[0]+1;
+	size_t const sliceSize = static_cast<size_t>(width) * (extent[3]-extent[2]+1);
+	std::vector<float*> concentrations(elementCount);
+	QStringList elementNames;
+	for (int e=0; e<elementCount; ++e)
+	{
+		concentrations[e] = static_cast<float*>(m_data->m_ElementConcentration[e]->GetScalarPointer());
+		elementNames << m_elements[e]->name();
+	}
+
+	// continue where a previous run with the same data and elements was aborted:
+	QFile checkpointFile(m_checkpointFileName);
+	bool checkpointOpen = false;
+	int startZ = extent[4];
+	if (!m_checkpointFileName.isEmpty())
+	{
+		qint64 validSize = 0;
+		QByteArray inputHash = decompositionInputHash(*adaptedElementSpectra, m_datasetFileName);
+		int completedSlices = readCheckpoint(checkpointFile, channelCount, extent, elementNames, threshold, inputHash, concentrations, validSize);
+		checkpointFile.close();
+		if (completedSlices > 0)
+		{
+			DEBUG_LOG(QString("Resuming decomposition from checkpoint file '%1', %2 of %3 slices already done.")
+				.arg(m_checkpointFileName).arg(completedSlices).arg(extent[5]-extent[4]+1));
+		}
+		startZ += completedSlices;
+		checkpointOpen = openCheckpoint(checkpointFile, completedSlices, validSize, channelCount, extent, elementNames, threshold, inputHash);
+	}
+
+	iASpectrumFitter fitter(adaptedElementSpectra, threshold);
+	for (int z=startZ; z<=extent[5] && !m_stopped; ++z)
 	{
-		for (int y=extent[2]; y<=extent[3] && !m_stopped; ++y)
+		size_t const sliceOffset = (z-extent[4]) * sliceSize;
+#pragma omp parallel
 		{
-#pragma omp parallel for private (concentration)
-			for (int z=extent[4]; z<=extent[5]; ++z)
+			iASpectrumFitter::Scratch scratch;
+			iAElementConcentrations::VoxelConcentrationType concentration;
+			concentration.reserve(elementCount);
+#pragma omp for schedule(dynamic)
+			for (int y=extent[2]; y<=extent[3]; ++y)
 			{
-				iAEnergySpectrum unknownSpectrum;
-				iAXRFData::Iterator it= m_xrfData->begin();
-				while (it != m_xrfData->end())
-				{
-					unknownSpectrum.push_back(static_cast<unsigned int>((*it)->GetScalarComponentAsFloat(x, y, z, 0)));
-					++it;
-				}
-				concentration.clear();
-				fitSpectrum(unknownSpectrum, adaptedElementSpectra, threshold, concentration);
-				for (int i=0; i<concentration.size() && !m_stopped; ++i)
+				size_t voxelIdx = sliceOffset + static_cast<size_t>(y-extent[2]) * width;
+				for (int x=extent[0]; x<=extent[1]; ++x, ++voxelIdx)
 				{
-					m_data->m_ElementConcentration[i]->SetScalarComponentFromDouble(x, y, z, 0, concentration[i]);
+					concentration.clear();
+					fitter.fit(m_xrfData->spectrum(x, y, z), channelCount, concentration, scratch);
+					for (int e=0; e<elementCount; ++e)
+					{
+						concentrations[e][voxelIdx] = (e < concentration.size()) ? static_cast<float>(concentration[e]) : 0.0f;
+					}
 				}
 			}
-			int percent = static_cast<int>(static_cast<double>(x*height*depth + y*depth)/pixelCount*100);
-			progress(percent);
 		}
+		if (checkpointOpen)
+		{
+			writeCheckpointSlice(checkpointFile, z, sliceOffset, sliceSize, concentrations);
+		}
+		int percent = static_cast<int>(static_cast<double>(z-extent[4]+1)/(extent[5]-extent[4]+1)*100);
+		progress(percent);
+	}
+	checkpointFile.close();
+	if (!m_stopped && checkpointOpen)
+	{
+		checkpointFile.remove();
 	}
 	if (!m_stopped)
 	{
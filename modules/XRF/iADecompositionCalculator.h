@@ -21,6 +21,7 @@
 #pragma once
 
 #include <QSharedPointer>
+#include <QString>
 #include <QThread>
 #include <QVector>
 
@@ -39,6 +40,12 @@ public:
 		QSharedPointer<iAAccumulatedXRFData const> accumulatedXRF);
 	void AddElement(iAElementSpectralInfo* element);
 	int ElementCount() const;
+	//! Set the file in which the results are checkpointed after each slice. If the file exists and stems from
+	//! an aborted run with the same data, elements, element spectra and threshold, the calculation resumes from there.
+	//! The file is removed once the calculation completes.
+	//! @param datasetFileName the file the XRF data was loaded from; its size and modification time are
+	//!        recorded to detect whether the dataset changed in between
+	void SetCheckpointFile(QString const & fileName, QString const & datasetFileName);
 	void Stop();
 	virtual void run();
 private:
@@ -46,6 +53,8 @@ private:
 	QSharedPointer<iAXRFData const> m_xrfData;
 	QSharedPointer<iAAccumulatedXRFData const> m_accumulatedXRF;
 	QVector<iAElementSpectralInfo*> m_elements;
+	QString m_checkpointFileName;
+	QString m_datasetFileName;
 	bool m_stopped;
 signals:
 	void success();
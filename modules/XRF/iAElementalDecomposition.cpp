@@ -22,115 +22,204 @@
 
 #include "iAEnergySpectrum.h"
 
-#include <vtkMath.h>
-
 #include <algorithm>
+#include <cmath>
 
 namespace
 {
-template<class TReal>
-TReal **create_matrix ( size_t nrow, size_t ncol )
-{
-	typedef TReal* TRealPointer;
-	TReal **m = new TRealPointer[nrow];
-	for (size_t row = 0; row < nrow; ++row)
+	//! LU-factorizes the row-major n x n matrix a in place, with partial pivoting.
+	//! @return false if the matrix is (numerically) singular
+	bool luFactorize(double * a, int * pivot, int n)
 	{
-		m[row] = new TReal[ncol];
+		double maxAbs = 0;
+		for (int i = 0; i < n * n; ++i)
+		{
+			maxAbs = std::max(maxAbs, std::abs(a[i]));
+		}
+		double const tolerance = maxAbs * 1e-12;
+		for (int k = 0; k < n; ++k)
+		{
+			int p = k;
+			for (int i = k + 1; i < n; ++i)
+			{
+				if (std::abs(a[i * n + k]) > std::abs(a[p * n + k]))
+				{
+					p = i;
+				}
+			}
+			if (!(std::abs(a[p * n + k]) > tolerance))
+			{
+				return false;
+			}
+			pivot[k] = p;
+			if (p != k)
+			{
+				std::swap_ranges(a + k * n, a + (k + 1) * n, a + p * n);
+			}
+			for (int i = k + 1; i < n; ++i)
+			{
+				double f = a[i * n + k] /= a[k * n + k];
+				for (int j = k + 1; j < n; ++j)
+				{
+					a[i * n + j] -= f * a[k * n + j];
+				}
+			}
+		}
+		return true;
 	}
-	return m;
-}
 
-template<class TReal>
-void free_matrix ( TReal **m, size_t nrow)
-{
-	for (size_t row = 0; row < nrow; ++row)
+	//! Solves the system factorized by luFactorize for right-hand side b (in place).
+	void luSolve(double const * lu, int const * pivot, double * b, int n)
 	{
-		delete [] m[row];
+		for (int k = 0; k < n; ++k)
+		{
+			std::swap(b[k], b[pivot[k]]);
+			for (int i = k + 1; i < n; ++i)
+			{
+				b[i] -= lu[i * n + k] * b[k];
+			}
+		}
+		for (int k = n - 1; k >= 0; --k)
+		{
+			for (int j = k + 1; j < n; ++j)
+			{
+				b[k] -= lu[k * n + j] * b[j];
+			}
+			b[k] /= lu[k * n + k];
+		}
 	}
-	delete[] m;
-}
 
-bool anyElementAboveThreshold(QSharedPointer<QVector<QSharedPointer<iAEnergySpectrum> > > const & elements, int i, unsigned int threshold)
+	//! adds the outer product of x (size n) with itself to the row-major n x n matrix m
+	void addOuterProduct(double * m, double const * x, int n)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			for (int j = 0; j < n; ++j)
+			{
+				m[i * n + j] += x[i] * x[j];
+			}
+		}
+	}
+} // namespace
+
+iASpectrumFitter::iASpectrumFitter(QSharedPointer<QVector<QSharedPointer<iAEnergySpectrum> > > elements, CountType threshold) :
+	m_elementCount(elements ? elements->size() : 0),
+	m_channelCount((m_elementCount > 0) ? (*elements)[0]->size() : 0),
+	m_threshold(threshold),
+	m_counts(m_channelCount * m_elementCount),
+	m_elementRelevant(m_channelCount, 0),
+	m_gram(m_elementCount * m_elementCount, 0.0),
+	m_gramLU(m_elementCount * m_elementCount),
+	m_gramPivot(m_elementCount),
+	m_gramValid(false)
 {
-	for (
-		QVector<QSharedPointer<iAEnergySpectrum> >::const_iterator it = elements->begin();
-		it != elements->end();
-		++it)
+	for (size_t c = 0; c < m_channelCount; ++c)
 	{
-		if ((**it)[i] > threshold)
+		double * x = m_counts.data() + c * m_elementCount;
+		for (int e = 0; e < m_elementCount; ++e)
+		{
+			CountType count = (*(*elements)[e])[static_cast<int>(c)];
+			m_elementRelevant[c] |= (count > m_threshold) ? 1 : 0;
+			x[e] = static_cast<unsigned int>(count);
+		}
+		if (m_elementRelevant[c])
 		{
-			return true;
+			addOuterProduct(m_gram.data(), x, m_elementCount);
 		}
 	}
-	return false;
+	m_gramLU = m_gram;
+	m_gramValid = m_elementCount > 0 && luFactorize(m_gramLU.data(), m_gramPivot.data(), m_elementCount);
 }
 
-} // namespace
-
-bool fitSpectrum(
-	iAEnergySpectrum const & unknownSpectrum,
-	QSharedPointer<QVector<QSharedPointer<iAEnergySpectrum> > > elements,
-	CountType threshold,
-	QVector<double> & result)
+template <typename T>
+bool iASpectrumFitter::fitImpl(T const * spectrum, size_t spectrumSize, QVector<double> & result, Scratch & scratch) const
 {
-	if (!elements || elements->size() == 0 ||
-		unknownSpectrum.size() != (*elements)[0]->size())
+	if (m_elementCount == 0 || spectrumSize != m_channelCount)
 	{
 		// impossible to calculate decomposition if
 		// no reference spectra or
 		// reference spectra and unknown spectrum are of different size
 		return false;
 	}
-	int noOfDataPoints = 0;
+	int const n = m_elementCount;
+	scratch.rhs.assign(n, 0.0);
+	scratch.extraChannels.clear();
 	int dataSampleRelevantPoints = 0;
-	QVector<int> dataPointIdx;
-	for (int i=0; i<unknownSpectrum.size(); ++i)
+	for (size_t c = 0; c < m_channelCount; ++c)
 	{
-		if (unknownSpectrum[i] > threshold || anyElementAboveThreshold(elements, i, threshold) )
+		bool aboveThreshold = spectrum[c] > m_threshold;
+		if (!aboveThreshold && !m_elementRelevant[c])
 		{
-			if (unknownSpectrum[i] > threshold) {
-				dataSampleRelevantPoints++;
+			continue;
+		}
+		if (aboveThreshold)
+		{
+			++dataSampleRelevantPoints;
+			if (!m_elementRelevant[c])
+			{
+				scratch.extraChannels.push_back(c);
 			}
-			dataPointIdx.push_back(i);
-			noOfDataPoints++;
+		}
+		double const * x = m_counts.data() + c * n;
+		for (int e = 0; e < n; ++e)
+		{
+			scratch.rhs[e] += x[e] * spectrum[c];
 		}
 	}
-
-	if (dataSampleRelevantPoints == 0)
+	bool solvable = dataSampleRelevantPoints > 0;
+	double const * lu = m_gramLU.data();
+	int const * pivot = m_gramPivot.data();
+	if (solvable && !scratch.extraChannels.empty())
 	{
-		for (int i=0; i<elements->size(); ++i)
+		// data points relevant only for this spectrum; extend the normal equations by them:
+		scratch.matrix = m_gram;
+		for (size_t c : scratch.extraChannels)
 		{
-			result.push_back(0.0);
+			addOuterProduct(scratch.matrix.data(), m_counts.data() + c * n, n);
 		}
-		return false;
+		scratch.pivot.resize(n);
+		solvable = luFactorize(scratch.matrix.data(), scratch.pivot.data(), n);
+		lu = scratch.matrix.data();
+		pivot = scratch.pivot.data();
 	}
-
-	double **X = create_matrix<double>(noOfDataPoints, elements->size());
-	double **y = create_matrix<double>(noOfDataPoints, 1);
-
-	double **c = create_matrix<double>(elements->size(), 1);
-
-	for (int i = 0; i < noOfDataPoints; i++)
+	else
+	{
+		solvable = solvable && m_gramValid;
+	}
+	if (!solvable)
 	{
-		for (int j=0; j<elements->size(); ++j)
+		for (int e = 0; e < n; ++e)
 		{
-			unsigned int elemCount = (*(*elements)[j])[dataPointIdx[i]];
-			X[i][j] = elemCount;
+			result.push_back(0.0);
 		}
-		y[i][0] = unknownSpectrum[dataPointIdx[i]];
+		return false;
 	}
-
-	vtkMath::SolveLeastSquares(noOfDataPoints, X, static_cast<int>(elements->size()), y, 1, c);
-
+	luSolve(lu, pivot, scratch.rhs.data(), n);
 	result.clear();
-	for (int i=0; i<elements->size(); ++i)
+	for (int e = 0; e < n; ++e)
 	{
-		result.push_back(std::max(c[i][0], 0.0));
+		result.push_back(std::max(scratch.rhs[e], 0.0));
 	}
+	return true;
+}
 
-	free_matrix(X, noOfDataPoints);
-	free_matrix(y, noOfDataPoints);
-	free_matrix(c, elements->size());
+bool iASpectrumFitter::fit(float const * spectrum, size_t spectrumSize, QVector<double> & result, Scratch & scratch) const
+{
+	return fitImpl(spectrum, spectrumSize, result, scratch);
+}
 
-	return true;
-}
\ No newline at end of file
+bool iASpectrumFitter::fit(CountType const * spectrum, size_t spectrumSize, QVector<double> & result, Scratch & scratch) const
+{
+	return fitImpl(spectrum, spectrumSize, result, scratch);
+}
+
+bool fitSpectrum(
+	iAEnergySpectrum const & unknownSpectrum,
+	QSharedPointer<QVector<QSharedPointer<iAEnergySpectrum> > > elements,
+	CountType threshold,
+	QVector<double> & result)
+{
+	iASpectrumFitter fitter(elements, threshold);
+	iASpectrumFitter::Scratch scratch;
+	return fitter.fit(unknownSpectrum.data(), unknownSpectrum.size(), result, scratch);
+}
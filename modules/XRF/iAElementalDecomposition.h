@@ -24,8 +24,47 @@
 
 #include <QSharedPointer>
 
+#include <vector>
+
 class iAElementSpectralInfo;
 
+//! Fits many spectra against the same element spectra, each with the same result as fitSpectrum.
+//! The least squares fit considers all data points where either the spectrum or any element spectrum
+//! lies above the threshold. The normal equations for the data points where an element spectrum
+//! does are the same for all spectra, so they are set up and factorized only once; per spectrum, only
+//! the data points where just the spectrum itself lies above the threshold are added.
+class iASpectrumFitter
+{
+public:
+	//! Scratch memory for fitting; use one per thread, to avoid allocations per spectrum.
+	struct Scratch
+	{
+		std::vector<double> matrix, rhs;
+		std::vector<int> pivot;
+		std::vector<size_t> extraChannels;
+	};
+	iASpectrumFitter(QSharedPointer<QVector<QSharedPointer<iAEnergySpectrum> > > elements, CountType threshold);
+	//! Determine the distribution of the elements in the given spectrum; see fitSpectrum for details.
+	//! @param spectrum the counts of the spectrum to analyze
+	//! @param spectrumSize the number of channels in spectrum
+	//! @param result the storage space for the result
+	//! @param scratch scratch memory (only used by one thread at a time)
+	bool fit(float const * spectrum, size_t spectrumSize, QVector<double> & result, Scratch & scratch) const;
+	bool fit(CountType const * spectrum, size_t spectrumSize, QVector<double> & result, Scratch & scratch) const;
+private:
+	template <typename T>
+	bool fitImpl(T const * spectrum, size_t spectrumSize, QVector<double> & result, Scratch & scratch) const;
+	int m_elementCount;
+	size_t m_channelCount;
+	CountType m_threshold;
+	std::vector<double> m_counts;          //!< element counts (channel * elementCount + element)
+	std::vector<char> m_elementRelevant;   //!< per channel, whether any element spectrum lies above the threshold
+	std::vector<double> m_gram;            //!< normal matrix over all channels with m_elementRelevant set
+	std::vector<double> m_gramLU;          //!< LU factorization of m_gram
+	std::vector<int> m_gramPivot;          //!< pivot indices of m_gramLU
+	bool m_gramValid;                      //!< whether m_gram could be factorized
+};
+
 //! Determine the distribution of given elements in the given spectrum.
 //! @param unknownSpectrum the spectrum to analyze
 //! @param elementSpectra the spectra of the elements the unknown spectrum is composed of
@@ -34,7 +73,8 @@ class iAElementSpectralInfo;
 //!		threshold are discarded)
 //! @param result the storage space for the result;
 //! @return true if a fit could be found; false if it was not possible (because the unknown
-//!		spectrum e.g. did not contain any data values above threshold)
+//!		spectrum e.g. did not contain any data values above threshold, or the element spectra are linearly
+//!		dependent); in the latter cases, result receives a zero for each element
 bool fitSpectrum(
 	iAEnergySpectrum const & unknownSpectrum,
 	QSharedPointer<QVector<QSharedPointer<iAEnergySpectrum> > > elements,
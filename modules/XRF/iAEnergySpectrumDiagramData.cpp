@@ -22,8 +22,6 @@
 
 #include "iAXRFData.h"
 
-#include <vtkImageData.h>
-
 iAEnergySpectrumDiagramData::iAEnergySpectrumDiagramData(iAXRFData * xrfData, iAPlotData* other):
 	m_energyFunction(nullptr),
 	m_xrfData_ext(xrfData),
@@ -50,13 +48,10 @@ void iAEnergySpectrumDiagramData::updateEnergyFunction(int x, int y, int z)
 		std::fill_n(m_energyFunction, m_xrfData_ext->size(), 0);
 		return;
 	}
-	iAXRFData::Iterator it= m_xrfData_ext->begin();
-	int idx = 0;
-	while (it != m_xrfData_ext->end())
+	float const * spectrum = m_xrfData_ext->spectrum(x, y, z);
+	for (size_t idx = 0; idx < m_xrfData_ext->size(); ++idx)
 	{
-		m_energyFunction[idx] = static_cast<DataType>((*it)->GetScalarComponentAsFloat(x, y, z, 0));
-		++it;
-		++idx;
+		m_energyFunction[idx] = static_cast<DataType>(spectrum[idx]);
 	}
 }
 
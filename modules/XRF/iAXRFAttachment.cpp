@@ -81,6 +81,7 @@ iAXRFAttachment::iAXRFAttachment( MainWindow * mainWnd, MdiChild * child ) : iAM
 	m_child->splitDockWidget(m_child->slicerDockWidget(iASlicerMode::XY), dlgRefSpectra, Qt::Horizontal);
 
 	dlgXRF = new dlg_XRF( m_child, dlgPeriodicTable, dlgRefSpectra );
+	dlgXRF->SetXRFFileName( f );
 
 	ioThread = new iAIO( m_child->logger(), m_child, dlgXRF->GetXRFData()->GetDataPtr() );
 	m_child->setReInitializeRenderWindows( false );
@@ -30,6 +30,7 @@
 
 #include <QThread>
 
+#include <algorithm>
 #include <map>
 #include <cassert>
 
@@ -229,32 +230,78 @@ vtkSmartPointer<vtkDiscretizableColorTransferFunction> iAXRFData::GetColorTransf
 	return m_colorTransfer;
 }
 
-template <typename T>
-void isInRange(void* data, double const & minVal, double const & maxVal, bool & inRange)
+namespace
 {
-	T value = *static_cast<char*>(data);
-	inRange = (value >= minVal && value <= maxVal);
-}
+	//! number of voxels transposed at once when building the voxel-interleaved spectra
+	const long long SpectraBlockSize = 256;
 
-bool isInRange(vtkSmartPointer<vtkImageData> const & img, int x, int y, int z, double const & minVal, double const & maxVal)
-{
-	bool inRange = false;
-	VTK_TYPED_CALL(isInRange, img->GetScalarType(), img->GetScalarPointer(x, y, z), minVal, maxVal, inRange);
-	return inRange;
+	template <typename T>
+	void copyToSpectra(void* data, size_t voxelStart, size_t voxelEnd, size_t channel, size_t channelCount, float * spectra)
+	{
+		T* counts = static_cast<T*>(data);
+		for (size_t v = voxelStart; v < voxelEnd; ++v)
+		{
+			spectra[v * channelCount + channel] = static_cast<float>(counts[v]);
+		}
+	}
+
+	bool checkFilters(float const * spectrum, QVector<iASpectrumFilter> const & filter, iAFilterMode mode)
+	{
+		for (QVector<iASpectrumFilter>::const_iterator it = filter.begin(); it != filter.end(); ++it)
+		{
+			float value = spectrum[it->binIdx];
+			bool inRange = (value >= it->minVal && value <= it->maxVal);
+			switch (mode)
+			{
+				case filter_AND: if (!inRange) { return 0; } break;
+				case filter_OR : if ( inRange) { return 1; } break;
+			}
+		}
+		return (mode == filter_AND)? 1 : /* filter_OR */ 0;
+	}
 }
 
-bool iAXRFData::CheckFilters(int x, int y, int z, QVector<iASpectrumFilter> const & filter, iAFilterMode mode) const
+void iAXRFData::BuildSpectra()
 {
-	for (QVector<iASpectrumFilter>::const_iterator it = filter.begin(); it != filter.end(); ++it)
+	m_spectra.clear();
+	GetExtent(m_spectraExtent);
+	if (m_data.empty())
+	{
+		return;
+	}
+	size_t channelCount = m_data.size();
+	size_t voxelCount = static_cast<size_t>(m_spectraExtent[1] - m_spectraExtent[0] + 1) *
+		(m_spectraExtent[3] - m_spectraExtent[2] + 1) * (m_spectraExtent[5] - m_spectraExtent[4] + 1);
+	m_spectra.resize(voxelCount * channelCount);
+	// transpose block-wise, so that the part of the spectra written to stays in cache while
+	// the corresponding part of each channel image is read:
+	long long blockCount = (static_cast<long long>(voxelCount) + SpectraBlockSize - 1) / SpectraBlockSize;
+#pragma omp parallel for
+	for (long long b = 0; b < blockCount; ++b)
 	{
-		bool inRange = isInRange(m_data[it->binIdx], x, y, z, it->minVal, it->maxVal);
-		switch (mode)
+		size_t voxelStart = static_cast<size_t>(b * SpectraBlockSize);
+		size_t voxelEnd = std::min(voxelStart + static_cast<size_t>(SpectraBlockSize), voxelCount);
+		for (size_t c = 0; c < channelCount; ++c)
 		{
-			case filter_AND: if (!inRange) { return 0; } break;
-			case filter_OR : if ( inRange) { return 1; } break;
+			assert(m_data[c]->GetNumberOfScalarComponents() == 1 && static_cast<size_t>(m_data[c]->GetNumberOfPoints()) == voxelCount);
+			VTK_TYPED_CALL(copyToSpectra, m_data[c]->GetScalarType(), m_data[c]->GetScalarPointer(),
+				voxelStart, voxelEnd, c, channelCount, m_spectra.data());
 		}
 	}
-	return (mode == filter_AND)? 1 : /* filter_OR */ 0;
+}
+
+float const * iAXRFData::spectrum(int x, int y, int z) const
+{
+	assert(!m_spectra.empty());
+	int width = m_spectraExtent[1] - m_spectraExtent[0] + 1;
+	int height = m_spectraExtent[3] - m_spectraExtent[2] + 1;
+	size_t voxelIdx = (static_cast<size_t>(z - m_spectraExtent[4]) * height + (y - m_spectraExtent[2])) * width + (x - m_spectraExtent[0]);
+	return m_spectra.data() + voxelIdx * m_data.size();
+}
+
+bool iAXRFData::CheckFilters(int x, int y, int z, QVector<iASpectrumFilter> const & filter, iAFilterMode mode) const
+{
+	return checkFilters(spectrum(x, y, z), filter, mode);
 }
 
 vtkSmartPointer<vtkImageData> iAXRFData::FilterSpectrum(QVector<iASpectrumFilter> const & filter, iAFilterMode mode)
@@ -275,16 +322,13 @@ vtkSmartPointer<vtkImageData> iAXRFData::FilterSpectrum(QVector<iASpectrumFilter
 	result->SetSpacing(spacing);
 	result->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
 
+	unsigned char* resultPtr = static_cast<unsigned char*>(result->GetScalarPointer());
+	long long voxelCount = result->GetNumberOfPoints();
+	size_t channelCount = m_data.size();
 #pragma omp parallel for
-	for (int x=extent[0]; x<=extent[1]; ++x)
+	for (long long v = 0; v < voxelCount; ++v)
 	{
-		for (int y=extent[2]; y<=extent[3]; ++y)
-		{
-			for (int z=extent[4]; z<=extent[5]; ++z)
-			{
-				*(static_cast<unsigned char*>(result->GetScalarPointer(x, y, z))) = CheckFilters(x, y, z, filter, mode) ? 1 : 0;
-			}
-		}
+		resultPtr[v] = checkFilters(m_spectra.data() + v * channelCount, filter, mode) ? 1 : 0;
 	}
 	return result;
 }
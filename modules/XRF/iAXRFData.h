@@ -55,6 +55,14 @@ public:
 	vtkSmartPointer<vtkImageData> GetCombinedVolume();
 	vtkSmartPointer<vtkDiscretizableColorTransferFunction> GetColorTransferFunction();
 
+	//! Builds the voxel-interleaved copy of the data, in which the counts of all energy channels of a voxel
+	//! are stored contiguously; required by spectrum(), CheckFilters and FilterSpectrum.
+	//! Call once after the channel images are loaded.
+	void BuildSpectra();
+	//! The spectrum at the given voxel, i.e. the counts in all size() energy channels; points directly into
+	//! the voxel-interleaved storage (see BuildSpectra).
+	float const * spectrum(int x, int y, int z) const;
+
 	//! returns a mask image which contains a 1 for a voxel where the counts in all the given filters lie inside
 	//! the [min,max] interval specified in the filter
 	vtkSmartPointer<vtkImageData> FilterSpectrum(QVector<iASpectrumFilter> const & filter, iAFilterMode mode);
@@ -68,6 +76,8 @@ public:
 	double GetMaxEnergy() const;
 private:
 	Container m_data;
+	std::vector<float> m_spectra;  //!< voxel-interleaved copy of m_data: all channel counts of voxel 0, of voxel 1, ...
+	int m_spectraExtent[6];        //!< extent of the images from which m_spectra was built
 	vtkSmartPointer<vtkImageData> m_combinedVolume;
 	vtkSmartPointer<vtkDiscretizableColorTransferFunction> m_colorTransfer;
 	double m_minEnergy, m_maxEnergy;